@@ -36,7 +36,7 @@
     + Debug breakpoints/asserts
     + Compiler-specific code wrappers
     + PCGRandom implementation
-    + Microsecond timing
+    + Microsecond timing and cycle counter
     + Windowed minimum/maximum
 */
 
@@ -44,6 +44,14 @@
 #include <string.h> // memcpy
 #include <new> // std::nothrow
 
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <intrin.h> // __rdtsc
+#elif defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h> // __rdtsc
+#elif !defined(__aarch64__)
+    #include <chrono> // GetCycles() fallback
+#endif
+
 
 //------------------------------------------------------------------------------
 // Portability macros
@@ -109,6 +117,27 @@ public:
 uint64_t GetTimeUsec();
 uint64_t GetTimeMsec();
 
+/// Read the CPU timestamp counter.  This is much finer-grained than
+/// GetTimeUsec() and cheap enough to wrap around single codec calls.
+/// On x86 this ticks at the nominal (invariant TSC) frequency rather than
+/// the current core clock.  Falls back to microseconds on other platforms,
+/// inline so that the codec does not need SiameseTools.cpp.
+SIAMESE_FORCE_INLINE uint64_t GetCycles()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r" (ticks));
+    return ticks;
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
 
 //------------------------------------------------------------------------------
 // WindowedMinMax
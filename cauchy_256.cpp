@@ -205,6 +205,10 @@
 #include "SiameseTools.h"
 #include "gf256.h"
 
+#include <float.h> // DBL_MAX
+#include <limits.h> // INT_MAX
+#include <stdlib.h> // malloc
+
  //#define CAT_CAUCHY_LOG
 
 // Debugging
@@ -218,6 +222,107 @@ using namespace std;
 #define DLOG(x)
 #endif
 
+// Statistics: Define CAT_CAUCHY_STATS to enable cauchy_256_*_ex() stats.
+// When it is not defined these all compile away to nothing.
+#ifdef CAT_CAUCHY_STATS
+
+// Returns the phase to update, or null when not collecting stats
+static SIAMESE_FORCE_INLINE CauchyPhaseStats *stats_phase(CauchyStats *stats, int phase)
+{
+    return stats ? stats->phase + phase : 0;
+}
+
+// Count `xors` block-row XORs touching `buffers` buffers of `bytes` each
+static SIAMESE_FORCE_INLINE void stats_count(CauchyPhaseStats *phase_stats, int xors, int buffers, int bytes)
+{
+    if (phase_stats) {
+        phase_stats->xor_ops += (unsigned)xors;
+        phase_stats->bytes += (uint64_t)buffers * (unsigned)bytes;
+    }
+}
+
+static SIAMESE_FORCE_INLINE uint64_t stats_start(const CauchyStats *stats)
+{
+    return stats ? siamese::GetCycles() : 0;
+}
+
+// Charge the cycles since t to the phase and restart the clock
+static SIAMESE_FORCE_INLINE void stats_lap(CauchyStats *stats, int phase, uint64_t &t)
+{
+    if (stats) {
+        const uint64_t now = siamese::GetCycles();
+        stats->phase[phase].cycles += now - t;
+        t = now;
+    }
+}
+
+#else // CAT_CAUCHY_STATS
+
+static SIAMESE_FORCE_INLINE CauchyPhaseStats *stats_phase(CauchyStats *, int) { return 0; }
+static SIAMESE_FORCE_INLINE void stats_count(CauchyPhaseStats *, int, int, int) {}
+static SIAMESE_FORCE_INLINE uint64_t stats_start(const CauchyStats *) { return 0; }
+static SIAMESE_FORCE_INLINE void stats_lap(CauchyStats *, int, uint64_t &) {}
+
+#endif // CAT_CAUCHY_STATS
+
+// Bulk memory operations on block data, counted for stats.
+// Block sizes are usually a multiple of 32 bytes, which lets these skip the
+// tail handling in gf256, and buffers from longhair_alloc_blocks() are also
+// aligned to cache lines
+
+static SIAMESE_FORCE_INLINE bool cauchy_is_a64(const void *x, const void *y, int bytes)
+{
+    return (((uintptr_t)x | (uintptr_t)y | (uintptr_t)bytes) & 63) == 0;
+}
+
+static SIAMESE_FORCE_INLINE bool cauchy_is_a64(const void *z, const void *x, const void *y, int bytes)
+{
+    return (((uintptr_t)z | (uintptr_t)x | (uintptr_t)y | (uintptr_t)bytes) & 63) == 0;
+}
+
+static SIAMESE_FORCE_INLINE void cauchy_add_mem(CauchyPhaseStats *phase_stats,
+        void * GF256_RESTRICT x, const void * GF256_RESTRICT y, int bytes)
+{
+    stats_count(phase_stats, 1, 2, bytes);
+    if (cauchy_is_a64(x, y, bytes))
+        gf256_add_mem_a64(x, y, bytes);
+    else if ((bytes & 31) == 0)
+        gf256_add_mem_x32(x, y, bytes);
+    else
+        gf256_add_mem(x, y, bytes);
+}
+
+static SIAMESE_FORCE_INLINE void cauchy_add2_mem(CauchyPhaseStats *phase_stats,
+        void * GF256_RESTRICT z, const void * GF256_RESTRICT x, const void * GF256_RESTRICT y, int bytes)
+{
+    stats_count(phase_stats, 2, 3, bytes);
+    if (cauchy_is_a64(z, x, y, bytes))
+        gf256_add2_mem_a64(z, x, y, bytes);
+    else if ((bytes & 31) == 0)
+        gf256_add2_mem_x32(z, x, y, bytes);
+    else
+        gf256_add2_mem(z, x, y, bytes);
+}
+
+static SIAMESE_FORCE_INLINE void cauchy_addset_mem(CauchyPhaseStats *phase_stats,
+        void * GF256_RESTRICT z, const void * GF256_RESTRICT x, const void * GF256_RESTRICT y, int bytes)
+{
+    stats_count(phase_stats, 1, 3, bytes);
+    if (cauchy_is_a64(z, x, y, bytes))
+        gf256_addset_mem_a64(z, x, y, bytes);
+    else if ((bytes & 31) == 0)
+        gf256_addset_mem_x32(z, x, y, bytes);
+    else
+        gf256_addset_mem(z, x, y, bytes);
+}
+
+static SIAMESE_FORCE_INLINE void cauchy_memswap(CauchyPhaseStats *phase_stats,
+        void * GF256_RESTRICT x, void * GF256_RESTRICT y, int bytes)
+{
+    stats_count(phase_stats, 0, 2, bytes);
+    gf256_memswap(x, y, bytes);
+}
+
 // Constants for precomputed table for window method
 static const int PRECOMP_TABLE_SIZE = 11; // Number of non-zero elements
 static const int PRECOMP_TABLE_THRESH = 4; // Min recovery rows to use window
@@ -387,13 +492,21 @@ static void GFC256Init()
     }
 }
 
+static void cost_tables_init();
+
 extern "C" int _cauchy_256_init(int expected_version)
 {
     if (expected_version != CAUCHY_256_VERSION) {
         return -1;
     }
 
+    // Selects the SIMD kernels used for the bulk XOR operations
+    if (gf256_init()) {
+        return -1;
+    }
+
     GFC256Init();
+    cost_tables_init();
 
     return 0;
 }
@@ -413,6 +526,61 @@ static SIAMESE_FORCE_INLINE uint8_t GFC256Divide(uint8_t x, uint8_t y)
 }
 
 
+//// Workspace
+
+// Scratch buffers reused across calls.  Each buffer only grows, so once it
+// has been reserved for the largest parameters a caller uses, encode and
+// decode do not allocate.
+struct CauchyWorkspace {
+    uint8_t *matrix;        // Cauchy matrix when too large for the stack
+    int matrix_bytes;
+    uint8_t *precomp;       // Precomputation window tables
+    uint8_t *precomp_alloc; // Allocation behind precomp, before alignment
+    int precomp_bytes;
+    uint64_t *bitmatrix;    // Decoder bitmatrix
+    int bitmatrix_words;
+};
+
+template<typename T>
+static T *workspace_grow(T *&buffer, int &capacity, int count)
+{
+    if (count > capacity) {
+        delete []buffer;
+        buffer = new T[count];
+        capacity = count;
+    }
+    return buffer;
+}
+
+static const int CAUCHY_LINE_BYTES = 64;
+
+// The window tables are read by the bulk XORs, so keep them on cache lines
+static uint8_t *workspace_grow_precomp(CauchyWorkspace *ws, int count)
+{
+    if (count > ws->precomp_bytes) {
+        delete []ws->precomp_alloc;
+        ws->precomp_alloc = new uint8_t[count + CAUCHY_LINE_BYTES - 1];
+        ws->precomp = (uint8_t *)(((uintptr_t)ws->precomp_alloc + CAUCHY_LINE_BYTES - 1) &
+                                  ~(uintptr_t)(CAUCHY_LINE_BYTES - 1));
+        ws->precomp_bytes = count;
+    }
+    return ws->precomp;
+}
+
+static void workspace_release(CauchyWorkspace *ws)
+{
+    delete []ws->matrix;
+    delete []ws->precomp_alloc;
+    delete []ws->bitmatrix;
+    memset(ws, 0, sizeof(CauchyWorkspace));
+}
+
+static int precomp_bytes(int subbytes)
+{
+    return subbytes * PRECOMP_TABLE_SIZE * 2;
+}
+
+
 //// Cauchy matrix
 
 #include "cauchy_tables_256.inc"
@@ -420,8 +588,11 @@ static SIAMESE_FORCE_INLINE uint8_t GFC256Divide(uint8_t x, uint8_t y)
 #define CAT_CAUCHY_MATRIX_STACK_SIZE 1024
 
 // Precondition: m > 1
+// Large matrices are placed in the workspace if provided, or else allocated
+// and dynamic_memory is set.
 static const uint8_t *cauchy_matrix(int k, int m, int &stride,
-        uint8_t stack[CAT_CAUCHY_MATRIX_STACK_SIZE], bool &dynamic_memory)
+        uint8_t stack[CAT_CAUCHY_MATRIX_STACK_SIZE], bool &dynamic_memory,
+        CauchyWorkspace *ws = 0)
 {
     dynamic_memory = false;
 
@@ -446,8 +617,12 @@ static const uint8_t *cauchy_matrix(int k, int m, int &stride,
     uint8_t *matrix = stack;
     int matrix_size = k * (m - 1);
     if (matrix_size > CAT_CAUCHY_MATRIX_STACK_SIZE) {
-        matrix = new uint8_t[matrix_size];
-        dynamic_memory = true;
+        if (ws) {
+            matrix = workspace_grow(ws->matrix, ws->matrix_bytes, matrix_size);
+        } else {
+            matrix = new uint8_t[matrix_size];
+            dynamic_memory = true;
+        }
     }
 
     // Get X[] and Y[] vectors
@@ -484,7 +659,8 @@ static const uint8_t *cauchy_matrix(int k, int m, int &stride,
 //// Decoder
 
 // Specialized fast decoder for m = 1
-static void cauchy_decode_m1(int k, Block *blocks, int block_bytes)
+static void cauchy_decode_m1(int k, Block *blocks, int block_bytes,
+        CauchyPhaseStats *phase_stats)
 {
     // Find the missing row by tabulating presence and then finding which is missing
     bool found_rows[256];
@@ -522,7 +698,7 @@ static void cauchy_decode_m1(int k, Block *blocks, int block_bytes)
             if (!in) {
                 in = block->data;
             } else {
-                gf256_add2_mem(out, in, block->data, block_bytes);
+                cauchy_add2_mem(phase_stats, out, in, block->data, block_bytes);
                 in = 0;
             }
         }
@@ -530,7 +706,7 @@ static void cauchy_decode_m1(int k, Block *blocks, int block_bytes)
 
     // Complete XORs
     if (in) {
-        gf256_add_mem(out, in, block_bytes);
+        cauchy_add_mem(phase_stats, out, in, block_bytes);
     }
 }
 
@@ -573,7 +749,7 @@ static void sort_blocks(int k, Block *blocks,
 static void win_original(Block *original[256], int original_count,
                          Block *recovery[256], int recovery_count,
                          const uint8_t *matrix, int stride, int subbytes,
-                         uint8_t **tables[2])
+                         uint8_t **tables[2], CauchyPhaseStats *phase_stats)
 {
     // For each column to generate,
     for (int jj = 0; jj < original_count; ++jj) {
@@ -591,17 +767,17 @@ static void win_original(Block *original[256], int original_count,
             table[4] = (uint8_t *)data + subbytes * 2;
             table[8] = (uint8_t *)data + subbytes * 3;
 
-            gf256_addset_mem(table[3], table[1], table[2], subbytes);
-            gf256_addset_mem(table[6], table[2], table[4], subbytes);
-            gf256_addset_mem(table[5], table[1], table[4], subbytes);
-            gf256_addset_mem(table[7], table[1], table[6], subbytes);
-            gf256_addset_mem(table[9], table[1], table[8], subbytes);
-            gf256_addset_mem(table[12], table[4], table[8], subbytes);
-            gf256_addset_mem(table[10], table[2], table[8], subbytes);
-            gf256_addset_mem(table[11], table[3], table[8], subbytes);
-            gf256_addset_mem(table[13], table[1], table[12], subbytes);
-            gf256_addset_mem(table[14], table[2], table[12], subbytes);
-            gf256_addset_mem(table[15], table[3], table[12], subbytes);
+            cauchy_addset_mem(phase_stats, table[3], table[1], table[2], subbytes);
+            cauchy_addset_mem(phase_stats, table[6], table[2], table[4], subbytes);
+            cauchy_addset_mem(phase_stats, table[5], table[1], table[4], subbytes);
+            cauchy_addset_mem(phase_stats, table[7], table[1], table[6], subbytes);
+            cauchy_addset_mem(phase_stats, table[9], table[1], table[8], subbytes);
+            cauchy_addset_mem(phase_stats, table[12], table[4], table[8], subbytes);
+            cauchy_addset_mem(phase_stats, table[10], table[2], table[8], subbytes);
+            cauchy_addset_mem(phase_stats, table[11], table[3], table[8], subbytes);
+            cauchy_addset_mem(phase_stats, table[13], table[1], table[12], subbytes);
+            cauchy_addset_mem(phase_stats, table[14], table[2], table[12], subbytes);
+            cauchy_addset_mem(phase_stats, table[15], table[3], table[12], subbytes);
         }
 
         const int row_offset = original_count + recovery_count + 1;
@@ -617,7 +793,7 @@ static void win_original(Block *original[256], int original_count,
             // If this matrix element is an 8x8 identity matrix,
             if (matrix_row < 0 || row[0] == 1) {
                 // XOR whole block at once
-                gf256_add_mem(dest, original_block->data, subbytes * 8);
+                cauchy_add_mem(phase_stats, dest, original_block->data, subbytes * 8);
             } else {
                 uint8_t slice = row[0];
 
@@ -628,11 +804,11 @@ static void win_original(Block *original[256], int original_count,
 
                     // Add
                     if (low && high) {
-                        gf256_add2_mem(dest, tables[0][low], tables[1][high], subbytes);
+                        cauchy_add2_mem(phase_stats, dest, tables[0][low], tables[1][high], subbytes);
                     } else if (low) {
-                        gf256_add_mem(dest, tables[0][low], subbytes);
+                        cauchy_add_mem(phase_stats, dest, tables[0][low], subbytes);
                     } else {
-                        gf256_add_mem(dest, tables[1][high], subbytes);
+                        cauchy_add_mem(phase_stats, dest, tables[1][high], subbytes);
                     }
                     dest += subbytes;
 
@@ -649,7 +825,8 @@ static void win_original(Block *original[256], int original_count,
 
 static void eliminate_original(Block *original[256], int original_count,
                                Block *recovery[256], int recovery_count,
-                               const uint8_t *matrix, int stride, int subbytes)
+                               const uint8_t *matrix, int stride, int subbytes,
+                               CauchyPhaseStats *phase_stats)
 {
     DLOG(cout << "Eliminating original:" << endl;)
 
@@ -674,7 +851,7 @@ static void eliminate_original(Block *original[256], int original_count,
             // If this matrix element is an 8x8 identity matrix,
             if (matrix_row < 0 || row[original_row] == 1) {
                 // XOR whole block at once
-                gf256_add_mem(dest, original_block->data, subbytes * 8);
+                cauchy_add_mem(phase_stats, dest, original_block->data, subbytes * 8);
                 DLOG(cout << "XOR" << endl;)
             } else {
                 // Grab the matrix entry for this row,
@@ -686,7 +863,7 @@ static void eliminate_original(Block *original[256], int original_count,
 
                     for (int bit_x = 0; bit_x < 8; ++bit_x, src += subbytes) {
                         if (slice & (1 << bit_x)) {
-                            gf256_add_mem(dest, src, subbytes);
+                            cauchy_add_mem(phase_stats, dest, src, subbytes);
                         }
                     }
 
@@ -706,12 +883,12 @@ static void eliminate_original(Block *original[256], int original_count,
 
 static uint64_t *generate_bitmatrix(int k, Block *recovery[256], int recovery_count,
                         const uint8_t *matrix, int stride, const uint8_t erasures[256],
-                        int &bitstride)
+                        int &bitstride, CauchyWorkspace *ws)
 {
     // Allocate the bitmatrix
     int bitrows = recovery_count * 8;
     bitstride = (bitrows + 63) / 64;
-    uint64_t *bitmatrix = new uint64_t[bitstride * bitrows];
+    uint64_t *bitmatrix = workspace_grow(ws->bitmatrix, ws->bitmatrix_words, bitstride * bitrows);
     uint64_t *bitrow = bitmatrix;
 
     // For each recovery block,
@@ -806,7 +983,8 @@ static uint64_t *generate_bitmatrix(int k, Block *recovery[256], int recovery_co
 // Windowed version of Gaussian elimination
 static void win_gaussian_elimination(int rows, Block *recovery[256],
                                      uint64_t *bitmatrix, int bitstride,
-                                     int subbytes, uint8_t **tables[2])
+                                     int subbytes, uint8_t **tables[2],
+                                     CauchyPhaseStats *phase_stats)
 {
     const int bit_rows = rows * 8;
     uint64_t mask = 1;
@@ -835,7 +1013,7 @@ static void win_gaussian_elimination(int rows, Block *recovery[256],
                 if (option != pivot) {
                     // Reorder data into the right place
                     uint8_t *data = recovery[option >> 3]->data + (option & 7) * subbytes;
-                    gf256_memswap(src, data, subbytes);
+                    cauchy_memswap(phase_stats, src, data, subbytes);
 
                     // Reorder matrix rows
                     gf256_memswap(row - pivot_word, base, bitstride << 3);
@@ -902,7 +1080,7 @@ static void win_gaussian_elimination(int rows, Block *recovery[256],
                     DLOG(print_word(w, 4);)
 
                     if (w) {
-                        gf256_add_mem(hi_table[ii], lo_table[w], subbytes);
+                        cauchy_add_mem(phase_stats, hi_table[ii], lo_table[w], subbytes);
                     }
                 }
 
@@ -920,7 +1098,7 @@ static void win_gaussian_elimination(int rows, Block *recovery[256],
             uint64_t word = bit_row[0] >> bit_shift;
             bit_row += bitstride;
             if (word & 1) {
-                gf256_add_mem(table[2], table[1], subbytes);
+                cauchy_add_mem(phase_stats, table[2], table[1], subbytes);
             }
 
             DLOG(print_word(bit_row[0] >> bit_shift, 4);)
@@ -928,10 +1106,10 @@ static void win_gaussian_elimination(int rows, Block *recovery[256],
             word = bit_row[0] >> bit_shift;
             bit_row += bitstride;
             if (word & 1) {
-                gf256_add_mem(table[4], table[1], subbytes);
+                cauchy_add_mem(phase_stats, table[4], table[1], subbytes);
             }
             if (word & 2) {
-                gf256_add_mem(table[4], table[2], subbytes);
+                cauchy_add_mem(phase_stats, table[4], table[2], subbytes);
             }
 
             DLOG(print_word(bit_row[0] >> bit_shift, 4);)
@@ -939,27 +1117,27 @@ static void win_gaussian_elimination(int rows, Block *recovery[256],
             word = bit_row[0] >> bit_shift;
             bit_row += bitstride;
             if (word & 1) {
-                gf256_add_mem(table[8], table[1], subbytes);
+                cauchy_add_mem(phase_stats, table[8], table[1], subbytes);
             }
             if (word & 2) {
-                gf256_add_mem(table[8], table[2], subbytes);
+                cauchy_add_mem(phase_stats, table[8], table[2], subbytes);
             }
             if (word & 4) {
-                gf256_add_mem(table[8], table[4], subbytes);
+                cauchy_add_mem(phase_stats, table[8], table[4], subbytes);
             }
 
             // Generate table
-            gf256_addset_mem(table[3], table[1], table[2], subbytes);
-            gf256_addset_mem(table[6], table[2], table[4], subbytes);
-            gf256_addset_mem(table[5], table[1], table[4], subbytes);
-            gf256_addset_mem(table[7], table[1], table[6], subbytes);
-            gf256_addset_mem(table[9], table[1], table[8], subbytes);
-            gf256_addset_mem(table[12], table[4], table[8], subbytes);
-            gf256_addset_mem(table[10], table[2], table[8], subbytes);
-            gf256_addset_mem(table[11], table[3], table[8], subbytes);
-            gf256_addset_mem(table[13], table[1], table[12], subbytes);
-            gf256_addset_mem(table[14], table[2], table[12], subbytes);
-            gf256_addset_mem(table[15], table[3], table[12], subbytes);
+            cauchy_addset_mem(phase_stats, table[3], table[1], table[2], subbytes);
+            cauchy_addset_mem(phase_stats, table[6], table[2], table[4], subbytes);
+            cauchy_addset_mem(phase_stats, table[5], table[1], table[4], subbytes);
+            cauchy_addset_mem(phase_stats, table[7], table[1], table[6], subbytes);
+            cauchy_addset_mem(phase_stats, table[9], table[1], table[8], subbytes);
+            cauchy_addset_mem(phase_stats, table[12], table[4], table[8], subbytes);
+            cauchy_addset_mem(phase_stats, table[10], table[2], table[8], subbytes);
+            cauchy_addset_mem(phase_stats, table[11], table[3], table[8], subbytes);
+            cauchy_addset_mem(phase_stats, table[13], table[1], table[12], subbytes);
+            cauchy_addset_mem(phase_stats, table[14], table[2], table[12], subbytes);
+            cauchy_addset_mem(phase_stats, table[15], table[3], table[12], subbytes);
         } // next 4-bit window
 
         // Fix bit shift back to the start of the window
@@ -982,11 +1160,11 @@ static void win_gaussian_elimination(int rows, Block *recovery[256],
 
                 // Add
                 if (low && high) {
-                    gf256_add2_mem(dest, lo_table[low], hi_table[high], subbytes);
+                    cauchy_add2_mem(phase_stats, dest, lo_table[low], hi_table[high], subbytes);
                 } else if (low) {
-                    gf256_add_mem(dest, lo_table[low], subbytes);
+                    cauchy_add_mem(phase_stats, dest, lo_table[low], subbytes);
                 } else {
-                    gf256_add_mem(dest, hi_table[high], subbytes);
+                    cauchy_add_mem(phase_stats, dest, hi_table[high], subbytes);
                 }
             }
         }
@@ -1009,14 +1187,14 @@ static void win_gaussian_elimination(int rows, Block *recovery[256],
 
                 DLOG(cout << "+ Foresub to row " << other_row << endl;)
 
-                gf256_add_mem(dest, src, subbytes);
+                cauchy_add_mem(phase_stats, dest, src, subbytes);
             }
         }
     }
 }
 
 static void gaussian_elimination(int rows, Block *recovery[256], uint64_t *bitmatrix,
-                                 int bitstride, int subbytes)
+                                 int bitstride, int subbytes, CauchyPhaseStats *phase_stats)
 {
     const int bit_rows = rows * 8;
     uint64_t mask = 1;
@@ -1043,7 +1221,7 @@ static void gaussian_elimination(int rows, Block *recovery[256], uint64_t *bitma
                     uint8_t *data = recovery[option >> 3]->data + (option & 7) * subbytes;
 
                     // Reorder data into the right place
-                    gf256_memswap(src, data, subbytes);
+                    cauchy_memswap(phase_stats, src, data, subbytes);
 
                     // Reorder matrix rows
                     gf256_memswap(row, offset, (bitstride - pivot_word) << 3);
@@ -1068,7 +1246,7 @@ static void gaussian_elimination(int rows, Block *recovery[256], uint64_t *bitma
                         // Add in the data
                         uint8_t *dest = recovery[option >> 3]->data + (option & 7) * subbytes;
 
-                        gf256_add_mem(dest, src, subbytes);
+                        cauchy_add_mem(phase_stats, dest, src, subbytes);
                     }
                 }
 
@@ -1081,7 +1259,8 @@ static void gaussian_elimination(int rows, Block *recovery[256], uint64_t *bitma
 
 // Windowed version of back-substitution
 static void win_back_substitution(int rows, Block *recovery[256], uint64_t *bitmatrix,
-                                  int bitstride, int subbytes, uint8_t **tables[2])
+                                  int bitstride, int subbytes, uint8_t **tables[2],
+                                  CauchyPhaseStats *phase_stats)
 {
     // Name tables
     uint8_t **lo_table = tables[1];
@@ -1117,7 +1296,7 @@ static void win_back_substitution(int rows, Block *recovery[256], uint64_t *bitm
                     DLOG(print_word(w, 4);)
 
                     if (w) {
-                        gf256_add_mem(lo_table[ii], hi_table[w], subbytes);
+                        cauchy_add_mem(phase_stats, lo_table[ii], hi_table[w], subbytes);
                     }
                 }
 
@@ -1135,7 +1314,7 @@ static void win_back_substitution(int rows, Block *recovery[256], uint64_t *bitm
             uint64_t word = bit_row[0] >> bit_shift;
             bit_row -= bitstride;
             if (word & 8) {
-                gf256_add_mem(table[4], table[8], subbytes);
+                cauchy_add_mem(phase_stats, table[4], table[8], subbytes);
             }
 
             DLOG(print_word(bit_row[0] >> bit_shift, 4);)
@@ -1143,10 +1322,10 @@ static void win_back_substitution(int rows, Block *recovery[256], uint64_t *bitm
             word = bit_row[0] >> bit_shift;
             bit_row -= bitstride;
             if (word & 8) {
-                gf256_add_mem(table[2], table[8], subbytes);
+                cauchy_add_mem(phase_stats, table[2], table[8], subbytes);
             }
             if (word & 4) {
-                gf256_add_mem(table[2], table[4], subbytes);
+                cauchy_add_mem(phase_stats, table[2], table[4], subbytes);
             }
 
             DLOG(print_word(bit_row[0] >> bit_shift, 4);)
@@ -1154,27 +1333,27 @@ static void win_back_substitution(int rows, Block *recovery[256], uint64_t *bitm
             word = bit_row[0] >> bit_shift;
             bit_row -= bitstride;
             if (word & 8) {
-                gf256_add_mem(table[1], table[8], subbytes);
+                cauchy_add_mem(phase_stats, table[1], table[8], subbytes);
             }
             if (word & 4) {
-                gf256_add_mem(table[1], table[4], subbytes);
+                cauchy_add_mem(phase_stats, table[1], table[4], subbytes);
             }
             if (word & 2) {
-                gf256_add_mem(table[1], table[2], subbytes);
+                cauchy_add_mem(phase_stats, table[1], table[2], subbytes);
             }
 
             // Generate table
-            gf256_addset_mem(table[3], table[1], table[2], subbytes);
-            gf256_addset_mem(table[6], table[2], table[4], subbytes);
-            gf256_addset_mem(table[5], table[1], table[4], subbytes);
-            gf256_addset_mem(table[7], table[1], table[6], subbytes);
-            gf256_addset_mem(table[9], table[1], table[8], subbytes);
-            gf256_addset_mem(table[12], table[4], table[8], subbytes);
-            gf256_addset_mem(table[10], table[2], table[8], subbytes);
-            gf256_addset_mem(table[11], table[3], table[8], subbytes);
-            gf256_addset_mem(table[13], table[1], table[12], subbytes);
-            gf256_addset_mem(table[14], table[2], table[12], subbytes);
-            gf256_addset_mem(table[15], table[3], table[12], subbytes);
+            cauchy_addset_mem(phase_stats, table[3], table[1], table[2], subbytes);
+            cauchy_addset_mem(phase_stats, table[6], table[2], table[4], subbytes);
+            cauchy_addset_mem(phase_stats, table[5], table[1], table[4], subbytes);
+            cauchy_addset_mem(phase_stats, table[7], table[1], table[6], subbytes);
+            cauchy_addset_mem(phase_stats, table[9], table[1], table[8], subbytes);
+            cauchy_addset_mem(phase_stats, table[12], table[4], table[8], subbytes);
+            cauchy_addset_mem(phase_stats, table[10], table[2], table[8], subbytes);
+            cauchy_addset_mem(phase_stats, table[11], table[3], table[8], subbytes);
+            cauchy_addset_mem(phase_stats, table[13], table[1], table[12], subbytes);
+            cauchy_addset_mem(phase_stats, table[14], table[2], table[12], subbytes);
+            cauchy_addset_mem(phase_stats, table[15], table[3], table[12], subbytes);
         } // next 4-bit window
 
         // For each of the rows,
@@ -1195,11 +1374,11 @@ static void win_back_substitution(int rows, Block *recovery[256], uint64_t *bitm
 
                 // Add
                 if (low && high) {
-                    gf256_add2_mem(dest, lo_table[low], hi_table[high], subbytes);
+                    cauchy_add2_mem(phase_stats, dest, lo_table[low], hi_table[high], subbytes);
                 } else if (low) {
-                    gf256_add_mem(dest, lo_table[low], subbytes);
+                    cauchy_add_mem(phase_stats, dest, lo_table[low], subbytes);
                 } else {
-                    gf256_add_mem(dest, hi_table[high], subbytes);
+                    cauchy_add_mem(phase_stats, dest, hi_table[high], subbytes);
                 }
             }
         }
@@ -1219,7 +1398,7 @@ static void win_back_substitution(int rows, Block *recovery[256], uint64_t *bitm
         for (int other_row = pivot - 1; other_row >= 0; --other_row, bit_row -= bitstride) {
             if (bit_row[0] & mask) {
                 uint8_t *dest = recovery[other_row >> 3]->data + (other_row & 7) * subbytes;
-                gf256_add_mem(dest, src, subbytes);
+                cauchy_add_mem(phase_stats, dest, src, subbytes);
                 DLOG(cout << "+ Backsub to row " << other_row << endl;)
             }
         }
@@ -1227,7 +1406,7 @@ static void win_back_substitution(int rows, Block *recovery[256], uint64_t *bitm
 }
 
 static void back_substitution(int rows, Block *recovery[256], uint64_t *bitmatrix,
-                              int bitstride, int subbytes)
+                              int bitstride, int subbytes, CauchyPhaseStats *phase_stats)
 {
     for (int pivot = rows * 8 - 1; pivot > 0; --pivot) {
         const uint8_t *src = recovery[pivot >> 3]->data + (pivot & 7) * subbytes;
@@ -1239,15 +1418,18 @@ static void back_substitution(int rows, Block *recovery[256], uint64_t *bitmatri
         for (int other_row = pivot - 1; other_row >= 0; --other_row) {
             if (offset[bitstride * other_row] & mask) {
                 uint8_t *dest = recovery[other_row >> 3]->data + (other_row & 7) * subbytes;
-                gf256_add_mem(dest, src, subbytes);
+                cauchy_add_mem(phase_stats, dest, src, subbytes);
                 DLOG(cout << "+ Backsub to row " << other_row << endl;)
             }
         }
     }
 }
 
-extern "C" int cauchy_256_decode(int k, int m, Block *blocks, int block_bytes)
+static int cauchy_decode(int k, int m, Block *blocks, int block_bytes,
+                         CauchyWorkspace *ws, CauchyStats *stats)
 {
+    uint64_t t = stats_start(stats);
+
     // If there is only one input block,
     if (k <= 1) {
         // The block is already the same as original data
@@ -1257,7 +1439,8 @@ extern "C" int cauchy_256_decode(int k, int m, Block *blocks, int block_bytes)
 
     // For the special case of one erasure,
     if (m == 1) {
-        cauchy_decode_m1(k, blocks, block_bytes);
+        cauchy_decode_m1(k, blocks, block_bytes, stats_phase(stats, CAUCHY_256_PHASE_ORIGINAL));
+        stats_lap(stats, CAUCHY_256_PHASE_ORIGINAL, t);
         return 0;
     }
 
@@ -1268,6 +1451,7 @@ extern "C" int cauchy_256_decode(int k, int m, Block *blocks, int block_bytes)
     int original_count;
     uint8_t erasures[256];
     sort_blocks(k, blocks, original, original_count, recovery, recovery_count, erasures);
+    stats_lap(stats, CAUCHY_256_PHASE_SORT, t);
 
     DLOG(cout << "Recovery rows(" << recovery_count << "):" << endl;
     for (int ii = 0; ii < recovery_count; ++ii) {
@@ -1304,7 +1488,7 @@ extern "C" int cauchy_256_decode(int k, int m, Block *blocks, int block_bytes)
 
     // If precomputation window is being used,
     if (recovery_count > PRECOMP_TABLE_THRESH) {
-        precomp = new uint8_t[subbytes * PRECOMP_TABLE_SIZE * 2];
+        precomp = workspace_grow_precomp(ws, precomp_bytes(subbytes));
 
         precomp_tables[0] = table_stack;
         precomp_tables[1] = table_stack + 16;
@@ -1331,7 +1515,12 @@ extern "C" int cauchy_256_decode(int k, int m, Block *blocks, int block_bytes)
     int stride;
     uint8_t stack_space[CAT_CAUCHY_MATRIX_STACK_SIZE];
     bool dynamic_matrix;
-    const uint8_t *matrix = cauchy_matrix(k, m, stride, stack_space, dynamic_matrix);
+    const uint8_t *matrix = cauchy_matrix(k, m, stride, stack_space, dynamic_matrix, ws);
+
+    if (stats) {
+        stats->windowed = recovery_count > PRECOMP_TABLE_THRESH;
+    }
+    stats_lap(stats, CAUCHY_256_PHASE_SETUP, t);
 
     // From the Cauchy matrix, each byte value can be expanded into
     // an 8x8 submatrix containing a minimal number of ones.
@@ -1347,10 +1536,13 @@ extern "C" int cauchy_256_decode(int k, int m, Block *blocks, int block_bytes)
     if (original_count > 0) {
         // Eliminate original data from recovery rows
         if (recovery_count > PRECOMP_TABLE_THRESH) {
-            win_original(original, original_count, recovery, recovery_count, matrix, stride, subbytes, precomp_tables);
+            win_original(original, original_count, recovery, recovery_count, matrix, stride, subbytes, precomp_tables,
+                         stats_phase(stats, CAUCHY_256_PHASE_ORIGINAL));
         } else {
-            eliminate_original(original, original_count, recovery, recovery_count, matrix, stride, subbytes);
+            eliminate_original(original, original_count, recovery, recovery_count, matrix, stride, subbytes,
+                               stats_phase(stats, CAUCHY_256_PHASE_ORIGINAL));
         }
+        stats_lap(stats, CAUCHY_256_PHASE_ORIGINAL, t);
     }
 
     // Now that the columns that are missing have been identified,
@@ -1362,7 +1554,8 @@ extern "C" int cauchy_256_decode(int k, int m, Block *blocks, int block_bytes)
     // Generate square bitmatrix for erased columns from recovery rows
     int bitstride;
     uint64_t *bitmatrix = generate_bitmatrix(k, recovery, recovery_count, matrix,
-                                        stride, erasures, bitstride);
+                                        stride, erasures, bitstride, ws);
+    stats_lap(stats, CAUCHY_256_PHASE_BITMATRIX, t);
 
     DLOG(print_matrix(bitmatrix, bitstride, recovery_count * 8);)
 
@@ -1376,7 +1569,9 @@ extern "C" int cauchy_256_decode(int k, int m, Block *blocks, int block_bytes)
 
     // Gaussian elimination to put matrix in upper triangular form
     if (recovery_count > PRECOMP_TABLE_THRESH) {
-        win_gaussian_elimination(recovery_count, recovery, bitmatrix, bitstride, subbytes, precomp_tables);
+        win_gaussian_elimination(recovery_count, recovery, bitmatrix, bitstride, subbytes, precomp_tables,
+                                 stats_phase(stats, CAUCHY_256_PHASE_ELIMINATION));
+        stats_lap(stats, CAUCHY_256_PHASE_ELIMINATION, t);
 
         // The matrix is now in an upper-triangular form, and can be worked from
         // right to left to conceptually produce an identity matrix.  The matrix
@@ -1385,36 +1580,76 @@ extern "C" int cauchy_256_decode(int k, int m, Block *blocks, int block_bytes)
         DLOG(print_matrix(bitmatrix, bitstride, recovery_count * 8);)
 
         // Use back-substitution to solve value for each column
-        win_back_substitution(recovery_count, recovery, bitmatrix, bitstride, subbytes, precomp_tables);
+        win_back_substitution(recovery_count, recovery, bitmatrix, bitstride, subbytes, precomp_tables,
+                              stats_phase(stats, CAUCHY_256_PHASE_SUBSTITUTION));
+        stats_lap(stats, CAUCHY_256_PHASE_SUBSTITUTION, t);
     } else {
         // Non-windowed version:
-        gaussian_elimination(recovery_count, recovery, bitmatrix, bitstride, subbytes);
+        gaussian_elimination(recovery_count, recovery, bitmatrix, bitstride, subbytes,
+                             stats_phase(stats, CAUCHY_256_PHASE_ELIMINATION));
+        stats_lap(stats, CAUCHY_256_PHASE_ELIMINATION, t);
 
         DLOG(print_matrix(bitmatrix, bitstride, recovery_count * 8);)
 
-        back_substitution(recovery_count, recovery, bitmatrix, bitstride, subbytes);
+        back_substitution(recovery_count, recovery, bitmatrix, bitstride, subbytes,
+                          stats_phase(stats, CAUCHY_256_PHASE_SUBSTITUTION));
+        stats_lap(stats, CAUCHY_256_PHASE_SUBSTITUTION, t);
     }
 
-    // Free temporary workspace
-    delete []bitmatrix;
-    if (dynamic_matrix) {
-        delete []matrix;
-    }
-    if (precomp) {
-        delete []precomp;
-    }
+    stats_lap(stats, CAUCHY_256_PHASE_SETUP, t);
 
     return 0;
 }
 
+// Reset stats at the start of an _ex call
+static void stats_reset(CauchyStats *stats)
+{
+    memset(stats, 0, sizeof(CauchyStats));
+#ifdef CAT_CAUCHY_STATS
+    stats->enabled = 1;
+#endif
+}
+
+extern "C" int cauchy_256_decode_ex(int k, int m, Block *blocks, int block_bytes, CauchyStats *stats)
+{
+    CauchyWorkspace ws = {};
+    int result;
+
+    if (!stats) {
+        result = cauchy_decode(k, m, blocks, block_bytes, &ws, 0);
+    } else {
+        stats_reset(stats);
+
+#ifdef CAT_CAUCHY_STATS
+        const uint64_t t0 = siamese::GetCycles();
+        result = cauchy_decode(k, m, blocks, block_bytes, &ws, stats);
+        stats->total_cycles = siamese::GetCycles() - t0;
+#else
+        result = cauchy_decode(k, m, blocks, block_bytes, &ws, 0);
+#endif
+    }
+
+    workspace_release(&ws);
+    return result;
+}
+
+extern "C" int cauchy_256_decode(int k, int m, Block *blocks, int block_bytes)
+{
+    CauchyWorkspace ws = {};
+    const int result = cauchy_decode(k, m, blocks, block_bytes, &ws, 0);
+    workspace_release(&ws);
+    return result;
+}
+
 
 //// Encoder
 
 // Windowed version of encoder
 static void win_encode(int k, int m, const uint8_t *matrix, int stride,
-                       const uint8_t **data, uint8_t *out, int subbytes)
+                       const uint8_t **data, uint8_t *out, int subbytes,
+                       CauchyWorkspace *ws, CauchyPhaseStats *phase_stats)
 {
-    uint8_t *precomp = new uint8_t[subbytes * PRECOMP_TABLE_SIZE * 2];
+    uint8_t *precomp = workspace_grow_precomp(ws, precomp_bytes(subbytes));
     uint8_t *table_stack[16 * 2] = {0};
     uint8_t **tables[2] = {
         table_stack, table_stack + 16
@@ -1447,17 +1682,17 @@ static void win_encode(int k, int m, const uint8_t *matrix, int stride,
             table[4] = (uint8_t *)src + subbytes * 2;
             table[8] = (uint8_t *)src + subbytes * 3;
 
-            gf256_addset_mem(table[3], table[1], table[2], subbytes);
-            gf256_addset_mem(table[6], table[2], table[4], subbytes);
-            gf256_addset_mem(table[5], table[1], table[4], subbytes);
-            gf256_addset_mem(table[7], table[1], table[6], subbytes);
-            gf256_addset_mem(table[9], table[1], table[8], subbytes);
-            gf256_addset_mem(table[12], table[4], table[8], subbytes);
-            gf256_addset_mem(table[10], table[2], table[8], subbytes);
-            gf256_addset_mem(table[11], table[3], table[8], subbytes);
-            gf256_addset_mem(table[13], table[1], table[12], subbytes);
-            gf256_addset_mem(table[14], table[2], table[12], subbytes);
-            gf256_addset_mem(table[15], table[3], table[12], subbytes);
+            cauchy_addset_mem(phase_stats, table[3], table[1], table[2], subbytes);
+            cauchy_addset_mem(phase_stats, table[6], table[2], table[4], subbytes);
+            cauchy_addset_mem(phase_stats, table[5], table[1], table[4], subbytes);
+            cauchy_addset_mem(phase_stats, table[7], table[1], table[6], subbytes);
+            cauchy_addset_mem(phase_stats, table[9], table[1], table[8], subbytes);
+            cauchy_addset_mem(phase_stats, table[12], table[4], table[8], subbytes);
+            cauchy_addset_mem(phase_stats, table[10], table[2], table[8], subbytes);
+            cauchy_addset_mem(phase_stats, table[11], table[3], table[8], subbytes);
+            cauchy_addset_mem(phase_stats, table[13], table[1], table[12], subbytes);
+            cauchy_addset_mem(phase_stats, table[14], table[2], table[12], subbytes);
+            cauchy_addset_mem(phase_stats, table[15], table[3], table[12], subbytes);
         }
 
         // For each of the rows,
@@ -1472,11 +1707,11 @@ static void win_encode(int k, int m, const uint8_t *matrix, int stride,
 
                 // Add
                 if (low && high) {
-                    gf256_add2_mem(dest, tables[0][low], tables[1][high], subbytes);
+                    cauchy_add2_mem(phase_stats, dest, tables[0][low], tables[1][high], subbytes);
                 } else if (low) {
-                    gf256_add_mem(dest, tables[0][low], subbytes);
+                    cauchy_add_mem(phase_stats, dest, tables[0][low], subbytes);
                 } else {
-                    gf256_add_mem(dest, tables[1][high], subbytes);
+                    cauchy_add_mem(phase_stats, dest, tables[1][high], subbytes);
                 }
                 dest += subbytes;
 
@@ -1488,14 +1723,15 @@ static void win_encode(int k, int m, const uint8_t *matrix, int stride,
             }
         }
     }
-
-    delete []precomp;
 }
 
-extern "C" int cauchy_256_encode(int k, int m, const uint8_t *data[],
-                                 void *vrecovery_blocks, int block_bytes)
+static int cauchy_encode(int k, int m, const uint8_t *data[],
+                         void *vrecovery_blocks, int block_bytes,
+                         CauchyWorkspace *ws, CauchyStats *stats)
 {
     uint8_t *recovery_blocks = reinterpret_cast<uint8_t *>( vrecovery_blocks );
+    CauchyPhaseStats *phase_stats = stats_phase(stats, CAUCHY_256_PHASE_ENCODE);
+    uint64_t t = stats_start(stats);
 
     // If only one input block,
     if (k <= 1) {
@@ -1503,21 +1739,24 @@ extern "C" int cauchy_256_encode(int k, int m, const uint8_t *data[],
         for (int ii = 0; ii < m; ++ii, recovery_blocks += block_bytes) {
             // Copy it directly to output
             memcpy(recovery_blocks, data[0], block_bytes);
+            stats_count(phase_stats, 0, 2, block_bytes);
         }
+        stats_lap(stats, CAUCHY_256_PHASE_ENCODE, t);
 
         return 0;
     }
 
     // XOR all input blocks together
-    gf256_addset_mem(recovery_blocks, data[0], data[1], block_bytes);
+    cauchy_addset_mem(phase_stats, recovery_blocks, data[0], data[1], block_bytes);
 
     for (int x = 2; x < k; ++x) {
-        gf256_add_mem(recovery_blocks, data[x], block_bytes);
+        cauchy_add_mem(phase_stats, recovery_blocks, data[x], block_bytes);
     }
 
     // If only one recovery block needed,
     if (m == 1) {
         // We're already done!
+        stats_lap(stats, CAUCHY_256_PHASE_ENCODE, t);
         return 0;
     }
 
@@ -1526,13 +1765,17 @@ extern "C" int cauchy_256_encode(int k, int m, const uint8_t *data[],
         return -1;
     }
 
+    stats_lap(stats, CAUCHY_256_PHASE_ENCODE, t);
+
     GFC256Init();
 
     // Generate Cauchy matrix
     int stride;
     uint8_t stack_space[CAT_CAUCHY_MATRIX_STACK_SIZE];
     bool dynamic_matrix;
-    const uint8_t *matrix = cauchy_matrix(k, m, stride, stack_space, dynamic_matrix);
+    const uint8_t *matrix = cauchy_matrix(k, m, stride, stack_space, dynamic_matrix, ws);
+
+    stats_lap(stats, CAUCHY_256_PHASE_SETUP, t);
 
     // The first 8 rows of the bitmatrix are always the same, 8x8 identity
     // matrices all the way across.  So we don't even bother generating those
@@ -1545,11 +1788,16 @@ extern "C" int cauchy_256_encode(int k, int m, const uint8_t *data[],
 
     // Clear output buffer
     memset(out, 0, block_bytes * (m - 1));
+    stats_count(phase_stats, 0, m - 1, block_bytes);
+
+    if (stats) {
+        stats->windowed = m > PRECOMP_TABLE_THRESH;
+    }
 
     // If the number of symbols to generate gets larger,
-    if (m > 4) {
+    if (m > PRECOMP_TABLE_THRESH) {
         // Start using a windowed approach to encoding
-        win_encode(k, m, matrix, stride, data, out, subbytes);
+        win_encode(k, m, matrix, stride, data, out, subbytes, ws, phase_stats);
     } else {
         const uint8_t *row = matrix;
 
@@ -1571,7 +1819,7 @@ extern "C" int cauchy_256_encode(int k, int m, const uint8_t *data[],
 
                     for (int bit_x = 0; bit_x < 8; ++bit_x, src_x += subbytes) {
                         if (slice & (1 << bit_x)) {
-                            gf256_add_mem(dest, src_x, subbytes);
+                            cauchy_add_mem(phase_stats, dest, src_x, subbytes);
                         }
                     }
 
@@ -1589,7 +1837,421 @@ extern "C" int cauchy_256_encode(int k, int m, const uint8_t *data[],
     if (dynamic_matrix) {
         delete []matrix;
     }
+    stats_lap(stats, CAUCHY_256_PHASE_ENCODE, t);
+
+    return 0;
+}
+
+extern "C" int cauchy_256_encode_ex(int k, int m, const uint8_t *data[],
+                                    void *recovery_blocks, int block_bytes, CauchyStats *stats)
+{
+    CauchyWorkspace ws = {};
+    int result;
+
+    if (!stats) {
+        result = cauchy_encode(k, m, data, recovery_blocks, block_bytes, &ws, 0);
+    } else {
+        stats_reset(stats);
+
+#ifdef CAT_CAUCHY_STATS
+        const uint64_t t0 = siamese::GetCycles();
+        result = cauchy_encode(k, m, data, recovery_blocks, block_bytes, &ws, stats);
+        stats->total_cycles = siamese::GetCycles() - t0;
+#else
+        result = cauchy_encode(k, m, data, recovery_blocks, block_bytes, &ws, 0);
+#endif
+    }
+
+    workspace_release(&ws);
+    return result;
+}
+
+extern "C" int cauchy_256_encode(int k, int m, const uint8_t *data[],
+                                 void *recovery_blocks, int block_bytes)
+{
+    CauchyWorkspace ws = {};
+    const int result = cauchy_encode(k, m, data, recovery_blocks, block_bytes, &ws, 0);
+    workspace_release(&ws);
+    return result;
+}
+
+
+//// Workspace API
+
+extern "C" CauchyWorkspace *cauchy_256_workspace_create(void)
+{
+    CauchyWorkspace *ws = new (std::nothrow) CauchyWorkspace;
+    if (ws) {
+        memset(ws, 0, sizeof(CauchyWorkspace));
+    }
+    return ws;
+}
+
+extern "C" int cauchy_256_workspace_reserve(CauchyWorkspace *ws, int k, int m, int block_bytes)
+{
+    if (!ws || k <= 0 || m <= 0 || k + m > 256 ||
+        block_bytes <= 0 || block_bytes % 8 != 0) {
+        return -1;
+    }
+
+    // Matrices for m <= 6 are static tables
+    const int matrix_size = k * (m - 1);
+    if (m > 6 && matrix_size > CAT_CAUCHY_MATRIX_STACK_SIZE) {
+        workspace_grow(ws->matrix, ws->matrix_bytes, matrix_size);
+    }
+
+    // Windowed encoder or decoder
+    const int recovery_count = k < m ? k : m;
+    if (m > PRECOMP_TABLE_THRESH) {
+        workspace_grow_precomp(ws, precomp_bytes(block_bytes / 8));
+    }
+
+    // Square bitmatrix for the most erasures the decoder can fill in
+    const int bitrows = recovery_count * 8;
+    workspace_grow(ws->bitmatrix, ws->bitmatrix_words, (bitrows + 63) / 64 * bitrows);
 
     return 0;
 }
 
+extern "C" void cauchy_256_workspace_free(CauchyWorkspace *ws)
+{
+    if (ws) {
+        workspace_release(ws);
+        delete ws;
+    }
+}
+
+extern "C" int cauchy_256_encode_ws(CauchyWorkspace *ws, int k, int m, const uint8_t *data[],
+                                    void *recovery_blocks, int block_bytes)
+{
+    if (!ws) {
+        return cauchy_256_encode(k, m, data, recovery_blocks, block_bytes);
+    }
+    return cauchy_encode(k, m, data, recovery_blocks, block_bytes, ws, 0);
+}
+
+extern "C" int cauchy_256_decode_ws(CauchyWorkspace *ws, int k, int m, Block *blocks, int block_bytes)
+{
+    if (!ws) {
+        return cauchy_256_decode(k, m, blocks, block_bytes);
+    }
+    return cauchy_decode(k, m, blocks, block_bytes, ws, 0);
+}
+
+
+
+//// Aligned blocks
+
+extern "C" int longhair_block_stride(int block_bytes)
+{
+    if (block_bytes <= 0 || block_bytes > INT_MAX - CAUCHY_LINE_BYTES) {
+        return 0;
+    }
+    return (block_bytes + CAUCHY_LINE_BYTES - 1) & ~(CAUCHY_LINE_BYTES - 1);
+}
+
+extern "C" uint8_t *longhair_alloc_blocks(int count, int block_bytes)
+{
+    const int stride = longhair_block_stride(block_bytes);
+    if (count <= 0 || stride <= 0) {
+        return 0;
+    }
+    const size_t bytes = (size_t)count * stride;
+
+    // The pointer from malloc() is kept just in front of the aligned buffer
+    uint8_t *raw = (uint8_t *)malloc(bytes + CAUCHY_LINE_BYTES + sizeof(void *));
+    if (!raw) {
+        return 0;
+    }
+    uintptr_t aligned = (uintptr_t)(raw + sizeof(void *));
+    aligned = (aligned + CAUCHY_LINE_BYTES - 1) & ~(uintptr_t)(CAUCHY_LINE_BYTES - 1);
+    uint8_t *blocks = (uint8_t *)aligned;
+    memcpy(blocks - sizeof(void *), &raw, sizeof(void *));
+
+    memset(blocks, 0, bytes);
+    return blocks;
+}
+
+extern "C" void longhair_free_blocks(uint8_t *blocks)
+{
+    if (blocks) {
+        void *raw;
+        memcpy(&raw, blocks - sizeof(void *), sizeof(void *));
+        free(raw);
+    }
+}
+
+
+
+//// Cost model
+
+// Default constants were fit with longhair_bench --calibrate on an x86-64
+// server (2 GHz TSC).  Per-op cost is mostly call overhead and branching.
+static double CostCyclesPerOp = 11.0;
+static double CostCyclesPerByte = 0.032;
+
+// Number of ones in the 8x8 submatrix for each GF(256) element
+static uint8_t CAUCHY_ONES[256];
+
+// Number of the 8 submatrix rows where both 4-bit windows are non-zero,
+// which costs one gf256_add2_mem() instead of one gf256_add_mem()
+static uint8_t CAUCHY_WIN_ADD2[256];
+
+static bool CostTablesReady = false;
+
+static void cost_tables_init()
+{
+    if (CostTablesReady) {
+        return;
+    }
+
+    GFC256Init();
+
+    for (int x = 0; x < 256; ++x) {
+        uint8_t slice = (uint8_t)x;
+        int ones = 0, add2 = 0;
+
+        for (int bit_y = 0; bit_y < 8; ++bit_y) {
+            for (int bit_x = 0; bit_x < 8; ++bit_x) {
+                ones += (slice >> bit_x) & 1;
+            }
+            if ((slice & 15) && (slice >> 4)) {
+                ++add2;
+            }
+            slice = GFC256Multiply(slice, 2);
+        }
+
+        CAUCHY_ONES[x] = (uint8_t)ones;
+        CAUCHY_WIN_ADD2[x] = (uint8_t)add2;
+    }
+
+    CostTablesReady = true;
+}
+
+// Accumulates counts in floating point since decoder terms are expectations
+struct CostAccumulator
+{
+    double xor_ops;
+    double bytes;
+};
+
+static SIAMESE_FORCE_INLINE void cost_add(CostAccumulator &cost, double ops, double buffers, double bytes)
+{
+    cost.xor_ops += ops;
+    cost.bytes += buffers * bytes;
+}
+
+// Cost of building the two 4-bit window tables for one column (win_encode)
+static SIAMESE_FORCE_INLINE void cost_window_tables(CostAccumulator &cost, double subbytes)
+{
+    cost_add(cost, 2 * PRECOMP_TABLE_SIZE, 2 * PRECOMP_TABLE_SIZE * 3, subbytes);
+}
+
+// Cost of XORing one matrix element's 8x8 submatrix through the window tables
+static SIAMESE_FORCE_INLINE void cost_window_element(CostAccumulator &cost, uint8_t element, double subbytes)
+{
+    const int add2 = CAUCHY_WIN_ADD2[element];
+    cost_add(cost, 8 + add2, 8 * 2 + add2, subbytes);
+}
+
+// Cost of XORing one matrix element's 8x8 submatrix bit by bit
+static SIAMESE_FORCE_INLINE void cost_bit_element(CostAccumulator &cost, uint8_t element, double subbytes)
+{
+    const int ones = CAUCHY_ONES[element];
+    cost_add(cost, ones, ones * 2, subbytes);
+}
+
+static void cost_finish(const CostAccumulator &acc, bool windowed, CauchyCost *cost)
+{
+    cost->xor_ops = (unsigned long long)(acc.xor_ops + 0.5);
+    cost->bytes = (unsigned long long)(acc.bytes + 0.5);
+    cost->cycles = CostCyclesPerOp * acc.xor_ops + CostCyclesPerByte * acc.bytes;
+    cost->windowed = windowed ? 1 : 0;
+}
+
+extern "C" int cauchy_256_encode_cost(int k, int m, int block_bytes, CauchyCost *cost)
+{
+    if (!cost || k <= 0 || m <= 0 || block_bytes <= 0) {
+        return -1;
+    }
+    memset(cost, 0, sizeof(CauchyCost));
+
+    CostAccumulator acc = { 0., 0. };
+    const double bytes = block_bytes;
+
+    // Mirrors cauchy_encode()
+    if (k <= 1) {
+        cost_add(acc, 0, 2 * m, bytes);
+        cost_finish(acc, false, cost);
+        return 0;
+    }
+
+    // XOR all input blocks together
+    cost_add(acc, 1, 3, bytes);
+    cost_add(acc, k - 2, 2 * (k - 2), bytes);
+
+    if (m == 1) {
+        cost_finish(acc, false, cost);
+        return 0;
+    }
+
+    if ((k + m > 256) || (block_bytes % 8 != 0)) {
+        return -1;
+    }
+
+    cost_tables_init();
+
+    int stride;
+    uint8_t stack_space[CAT_CAUCHY_MATRIX_STACK_SIZE];
+    bool dynamic_matrix;
+    const uint8_t *matrix = cauchy_matrix(k, m, stride, stack_space, dynamic_matrix);
+
+    // Clear output buffer
+    cost_add(acc, 0, m - 1, bytes);
+
+    const double subbytes = block_bytes / 8;
+    const bool windowed = m > PRECOMP_TABLE_THRESH;
+
+    if (windowed) {
+        for (int x = 0; x < k; ++x) {
+            cost_window_tables(acc, subbytes);
+        }
+    }
+
+    const uint8_t *row = matrix;
+    for (int y = 1; y < m; ++y, row += stride) {
+        for (int x = 0; x < k; ++x) {
+            if (windowed) {
+                cost_window_element(acc, row[x], subbytes);
+            } else {
+                cost_bit_element(acc, row[x], subbytes);
+            }
+        }
+    }
+
+    if (dynamic_matrix) {
+        delete []matrix;
+    }
+
+    cost_finish(acc, windowed, cost);
+    return 0;
+}
+
+extern "C" int cauchy_256_decode_cost(int k, int m, int erasures, int block_bytes, CauchyCost *cost)
+{
+    if (!cost || k <= 0 || m <= 0 || block_bytes <= 0 ||
+        erasures < 0 || erasures > m || erasures > k) {
+        return -1;
+    }
+    memset(cost, 0, sizeof(CauchyCost));
+
+    CostAccumulator acc = { 0., 0. };
+    const double bytes = block_bytes;
+
+    // Nothing to do
+    if (k <= 1 || erasures == 0) {
+        cost_finish(acc, false, cost);
+        return 0;
+    }
+
+    // Mirrors cauchy_decode_m1(): pairs of inputs per gf256_add2_mem()
+    if (m == 1) {
+        const int inputs = k - 1;
+        cost_add(acc, inputs, 3 * (inputs / 2) + 2 * (inputs % 2), bytes);
+        cost_finish(acc, false, cost);
+        return 0;
+    }
+
+    if ((k + m > 256) || (block_bytes % 8 != 0)) {
+        return -1;
+    }
+
+    cost_tables_init();
+
+    int stride;
+    uint8_t stack_space[CAT_CAUCHY_MATRIX_STACK_SIZE];
+    bool dynamic_matrix;
+    const uint8_t *matrix = cauchy_matrix(k, m, stride, stack_space, dynamic_matrix);
+
+    const double subbytes = block_bytes / 8;
+    const int original_count = k - erasures;
+    const bool windowed = erasures > PRECOMP_TABLE_THRESH;
+
+    // Eliminate original data from the first `erasures` recovery rows.
+    // The columns that survive are not known, so average over all of them.
+    if (original_count > 0) {
+        if (windowed) {
+            for (int x = 0; x < original_count; ++x) {
+                cost_window_tables(acc, subbytes);
+            }
+        }
+
+        // First recovery row is all identity submatrices: whole-block XOR
+        cost_add(acc, original_count, 2 * original_count, bytes);
+
+        const uint8_t *row = matrix;
+        for (int y = 1; y < erasures; ++y, row += stride) {
+            CostAccumulator row_cost = { 0., 0. };
+            for (int x = 0; x < k; ++x) {
+                if (windowed) {
+                    cost_window_element(row_cost, row[x], subbytes);
+                } else {
+                    cost_bit_element(row_cost, row[x], subbytes);
+                }
+            }
+            const double scale = (double)original_count / k;
+            cost_add(acc, row_cost.xor_ops * scale, 1, row_cost.bytes * scale);
+        }
+    }
+
+    if (dynamic_matrix) {
+        delete []matrix;
+    }
+
+    // Solve the square bitmatrix.  After the first few pivots the rows fill
+    // in to about half density, so each remaining row below (elimination)
+    // or above (back-substitution) a pivot needs an XOR half of the time.
+    const double bit_rows = erasures * 8;
+
+    if (!windowed) {
+        const double ops = bit_rows * (bit_rows - 1) / 4;
+        cost_add(acc, ops * 2, ops * 2 * 2, subbytes);
+    } else {
+        // Each of win_gaussian_elimination/win_back_substitution:
+        const double win_columns = erasures - 3;
+
+        // Per windowed column: window tables, triangle (6 bits) and the
+        // upper right square (4 windows, non-zero 15/16 of the time)
+        const double column_adds = 6 * 0.5 + 4 * (15. / 16.);
+        // Per row slice: add2 when both windows are non-zero
+        const double p_add2 = (15. / 16.) * (15. / 16.);
+        // Row pairs (x, y > x) over the windowed columns
+        const double row_pairs = win_columns * (erasures - 1) - win_columns * (win_columns - 1) / 2;
+        // Final three columns are done bit by bit: 24 pivots
+        const double tail_ops = 24 * 23 / 4.;
+
+        for (int pass = 0; pass < 2; ++pass) {
+            for (int x = 0; x < (int)win_columns; ++x) {
+                cost_window_tables(acc, subbytes);
+            }
+            cost_add(acc, win_columns * column_adds, win_columns * column_adds * 2, subbytes);
+            cost_add(acc, row_pairs * 8 * (1 + p_add2), row_pairs * 8 * (2 + p_add2), subbytes);
+            cost_add(acc, tail_ops, tail_ops * 2, subbytes);
+        }
+    }
+
+    cost_finish(acc, windowed, cost);
+    return 0;
+}
+
+extern "C" int cauchy_256_set_cost_model(double cycles_per_op, double cycles_per_byte)
+{
+    // Also rejects NaN, which fails every comparison
+    if (!(cycles_per_op >= 0. && cycles_per_op <= DBL_MAX) ||
+        !(cycles_per_byte >= 0. && cycles_per_byte <= DBL_MAX)) {
+        return -1;
+    }
+    CostCyclesPerOp = cycles_per_op;
+    CostCyclesPerByte = cycles_per_byte;
+    return 0;
+}
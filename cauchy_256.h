@@ -103,6 +103,156 @@ extern int cauchy_256_encode(int k, int m, const unsigned char *data_ptrs[], voi
 extern int cauchy_256_decode(int k, int m, Block *blocks, int block_bytes);
 
 
+/*
+ * Workspaces
+ *
+ * cauchy_256_encode() and cauchy_256_decode() allocate scratch memory for
+ * the window tables, large Cauchy matrices and the decoder bitmatrix on
+ * each call.  A workspace keeps those buffers between calls instead.
+ * Reserve it for the largest parameters that will be used and the _ws
+ * calls will not allocate.  Buffers still grow on demand if a call needs
+ * more than was reserved.
+ *
+ * A workspace may only be used by one call at a time; give each thread
+ * its own.  Passing a null workspace to the _ws calls is the same as
+ * calling the plain versions.
+ *
+ * cauchy_256_workspace_create() returns null if out of memory.
+ * cauchy_256_workspace_reserve() returns 0 on success, and any other code
+ * indicates invalid parameters.
+ */
+
+typedef struct CauchyWorkspace CauchyWorkspace;
+
+extern CauchyWorkspace *cauchy_256_workspace_create(void);
+extern int cauchy_256_workspace_reserve(CauchyWorkspace *ws, int k, int m, int block_bytes);
+extern void cauchy_256_workspace_free(CauchyWorkspace *ws);
+
+extern int cauchy_256_encode_ws(CauchyWorkspace *ws, int k, int m, const unsigned char *data_ptrs[], void *recovery_blocks, int block_bytes);
+extern int cauchy_256_decode_ws(CauchyWorkspace *ws, int k, int m, Block *blocks, int block_bytes);
+
+
+/*
+ * Aligned blocks
+ *
+ * longhair_alloc_blocks() returns one buffer holding count blocks.  The
+ * buffer is 64-byte aligned, and each block starts
+ * longhair_block_stride(block_bytes) bytes after the previous one: the
+ * block size rounded up to whole 64-byte cache lines.  Padding is zeroed.
+ * Returns null on invalid parameters or if out of memory.  Release the
+ * buffer with longhair_free_blocks().  longhair_block_stride() returns 0 for
+ * an invalid block size.
+ *
+ * The codec accepts any buffers.  When every block is 64-byte aligned and
+ * block_bytes is a multiple of 512, each of the 8 sub-blocks the codec
+ * splits a block into is whole cache lines, and the bulk XORs run aligned
+ * kernels without tail handling.  In that case the stride equals
+ * block_bytes, so one allocation can also be passed as recovery_blocks.
+ */
+extern unsigned char *longhair_alloc_blocks(int count, int block_bytes);
+extern int longhair_block_stride(int block_bytes);
+extern void longhair_free_blocks(unsigned char *blocks);
+
+/*
+ * Codec statistics
+ *
+ * The _ex variants of encode and decode optionally fill in a breakdown of
+ * where the time went, phase by phase.  Pass a null stats pointer to skip
+ * collection; the cost is then a single predictable branch per bulk XOR
+ * in a LONGHAIR_STATS build, and nothing otherwise.
+ * Collection is cheap enough to enable for a sampled fraction of calls.
+ *
+ * Statistics support is compiled in when the library is built with
+ * CAT_CAUCHY_STATS defined (the LONGHAIR_STATS CMake option, off by default).
+ * Otherwise the _ex functions still work but leave the stats zeroed with
+ * enabled = 0, and none of the statistics code is compiled in.
+ *
+ * xor_ops counts block-row XORs: each source buffer XOR'd into a
+ * destination row counts as one.  bytes counts every byte read or written
+ * by the bulk memory operations of the phase.
+ */
+
+#define CAUCHY_256_PHASE_SETUP        0 /* Matrix lookup and workspace */
+#define CAUCHY_256_PHASE_SORT         1 /* Decoder: sort_blocks */
+#define CAUCHY_256_PHASE_ORIGINAL     2 /* Decoder: eliminate received originals */
+#define CAUCHY_256_PHASE_BITMATRIX    3 /* Decoder: generate_bitmatrix */
+#define CAUCHY_256_PHASE_ELIMINATION  4 /* Decoder: Gaussian elimination */
+#define CAUCHY_256_PHASE_SUBSTITUTION 5 /* Decoder: back-substitution */
+#define CAUCHY_256_PHASE_ENCODE       6 /* Encoder: recovery block generation */
+#define CAUCHY_256_PHASE_COUNT        7
+
+typedef struct _CauchyPhaseStats {
+    unsigned long long cycles;  /* Cycle counter ticks spent in the phase */
+    unsigned long long xor_ops; /* Block-row XOR operations */
+    unsigned long long bytes;   /* Bytes read or written */
+} CauchyPhaseStats;
+
+typedef struct _CauchyStats {
+    CauchyPhaseStats phase[CAUCHY_256_PHASE_COUNT];
+    unsigned long long total_cycles;
+    int enabled;  /* Non-zero if the library was built with stats support */
+    int windowed; /* Non-zero if the 4-bit window method was used */
+} CauchyStats;
+
+/*
+ * Same as cauchy_256_encode() but also fills in stats if it is not null.
+ * The stats are reset at the start of each call.
+ */
+extern int cauchy_256_encode_ex(int k, int m, const unsigned char *data_ptrs[], void *recovery_blocks, int block_bytes, CauchyStats *stats);
+
+/*
+ * Same as cauchy_256_decode() but also fills in stats if it is not null.
+ * The stats are reset at the start of each call.
+ */
+extern int cauchy_256_decode_ex(int k, int m, Block *blocks, int block_bytes, CauchyStats *stats);
+
+
+/*
+ * Cost model
+ *
+ * Predicts the work done by encode/decode so that k, m and block size can be
+ * chosen against a CPU budget before committing to them.  The counts use
+ * the same units as CauchyStats: xor_ops is block-row XORs and bytes is the
+ * memory read or written by them.
+ *
+ * Encoder costs are exact: they are counted from the ones in the 8x8
+ * submatrices of the actual Cauchy matrix for (k, m), taking into account
+ * whether the 4-bit window method is used.
+ *
+ * Decoder costs are an estimate for `erasures` lost originals replaced by
+ * the first `erasures` recovery blocks.  Eliminating the received originals
+ * is averaged over the matrix columns, and the bitmatrix solve assumes the
+ * typical half-dense fill-in.
+ *
+ * Estimated cycles (in siamese::GetCycles() ticks, ie. the TSC on x86) are
+ *     cycles = cycles_per_op * xor_ops + cycles_per_byte * bytes
+ * The default constants were fit on an x86-64 server; run
+ * `longhair_bench --calibrate` on the target machine and pass its output to
+ * cauchy_256_set_cost_model() for better predictions.
+ *
+ * Returns 0 on success, and any other code indicates invalid parameters.
+ */
+
+typedef struct _CauchyCost {
+    unsigned long long xor_ops; /* Block-row XOR operations */
+    unsigned long long bytes;   /* Bytes read or written */
+    double cycles;              /* Estimated cycle counter ticks */
+    int windowed;               /* Non-zero if the 4-bit window method is used */
+} CauchyCost;
+
+extern int cauchy_256_encode_cost(int k, int m, int block_bytes, CauchyCost *cost);
+extern int cauchy_256_decode_cost(int k, int m, int erasures, int block_bytes, CauchyCost *cost);
+
+/*
+ * Set the constants used to convert counts to estimated cycles.
+ * Not thread-safe with concurrent cost queries.
+ *
+ * Returns 0 on success, or -1 if either constant is negative or not finite,
+ * in which case the model is left unchanged.
+ */
+extern int cauchy_256_set_cost_model(double cycles_per_op, double cycles_per_byte);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -222,13 +222,27 @@ static bool CpuHasNeon64 = false;   // And we don't have ASIMD
     #pragma warning(disable: 4752) // found Intel(R) Advanced Vector Extensions; consider using /arch:AVX
 #endif
 
+#ifdef GF256_TRY_AVX512
+static bool CpuHasAVX512 = false;
+static bool CpuDetectedAVX512 = false;
+#endif
 #ifdef GF256_TRY_AVX2
 static bool CpuHasAVX2 = false;
+static bool CpuDetectedAVX2 = false;
 #endif
 static bool CpuHasSSSE3 = false;
+static bool CpuDetectedSSSE3 = false;
+
+#define CPUID_EBX_AVX2      0x00000020
+#define CPUID_EBX_AVX512F   0x00010000
+#define CPUID_EBX_AVX512BW  0x40000000
+#define CPUID_ECX_SSSE3     0x00000200
+#define CPUID_ECX_OSXSAVE   0x08000000
+#define CPUID_ECX_AVX       0x10000000
 
-#define CPUID_EBX_AVX2    0x00000020
-#define CPUID_ECX_SSSE3   0x00000200
+// XCR0 state the OS must save for the wider registers
+#define XCR0_YMM            0x00000006 /* SSE, AVX */
+#define XCR0_ZMM            0x000000e6 /* SSE, AVX, opmask, ZMM0-15, ZMM16-31 */
 
 static void _cpuid(unsigned int cpu_info[4U], const unsigned int cpu_info_type)
 {
@@ -267,6 +281,18 @@ static void _cpuid(unsigned int cpu_info[4U], const unsigned int cpu_info_type)
 #endif
 }
 
+/// Read XCR0, which says which register state the OS saves on context switch
+static uint64_t _xgetbv0()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int lo, hi;
+    __asm__ __volatile__ ("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0U));
+    return ((uint64_t)hi << 32) | lo;
+#endif
+}
+
 #else
 #if defined(LINUX_ARM)
 static void checkLinuxARMNeonCapabilities( bool& cpuHasNeon )
@@ -326,12 +352,33 @@ static void gf256_architecture_init()
 
     _cpuid(cpu_info, 1);
     CpuHasSSSE3 = ((cpu_info[2] & CPUID_ECX_SSSE3) != 0);
+    CpuDetectedSSSE3 = CpuHasSSSE3;
+
+    // AVX registers are only usable if the OS saves them
+    const unsigned osxsave = CPUID_ECX_OSXSAVE | CPUID_ECX_AVX;
+    const uint64_t xcr0 = ((cpu_info[2] & osxsave) == osxsave) ? _xgetbv0() : 0;
+    (void)xcr0;
+
+    _cpuid(cpu_info, 0);
+    const unsigned max_leaf = cpu_info[0];
+    if (max_leaf >= 7)
+        _cpuid(cpu_info, 7);
+    else
+        cpu_info[1] = 0;
 
 #if defined(GF256_TRY_AVX2)
-    _cpuid(cpu_info, 7);
-    CpuHasAVX2 = ((cpu_info[1] & CPUID_EBX_AVX2) != 0);
+    CpuHasAVX2 = ((cpu_info[1] & CPUID_EBX_AVX2) != 0) &&
+                 ((xcr0 & XCR0_YMM) == XCR0_YMM);
+    CpuDetectedAVX2 = CpuHasAVX2;
 #endif // GF256_TRY_AVX2
 
+#if defined(GF256_TRY_AVX512)
+    const unsigned avx512 = CPUID_EBX_AVX512F | CPUID_EBX_AVX512BW;
+    CpuHasAVX512 = ((cpu_info[1] & avx512) == avx512) &&
+                   ((xcr0 & XCR0_ZMM) == XCR0_ZMM);
+    CpuDetectedAVX512 = CpuHasAVX512;
+#endif // GF256_TRY_AVX512
+
     // When AVX2 and SSSE3 are unavailable, Siamese takes 4x longer to decode
     // and 2.6x longer to encode.  Encoding requires a lot more simple XOR ops
     // so it is still pretty fast.  Decoding is usually really quick because
@@ -342,6 +389,600 @@ static void gf256_architecture_init()
 }
 
 
+//------------------------------------------------------------------------------
+// x86 Kernels
+
+/*
+    The SSSE3, AVX2 and AVX-512 code below is compiled with per-function
+    target attributes instead of -mavx2 etc, so the library builds for the
+    x86-64 baseline (SSE2) and still carries the wider kernels.  Which one
+    runs is decided once by gf256_select_kernels(); see Kernel Table below.
+
+    The AVX2 and SSSE3 loops process whole vectors and return the number
+    of bytes done, leaving the rest to a narrower kernel.
+    The AVX-512 kernels finish the whole buffer, using masked loads and
+    stores for the last partial vector.
+*/
+
+#if !defined(GF256_TARGET_MOBILE)
+
+#if defined(__GNUC__)
+    #define GF256_TARGET_SSSE3  __attribute__((target("ssse3")))
+    #define GF256_TARGET_AVX2   __attribute__((target("avx2")))
+    #define GF256_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#else
+    // MSVC emits any intrinsic without /arch flags
+    #define GF256_TARGET_SSSE3
+    #define GF256_TARGET_AVX2
+    #define GF256_TARGET_AVX512
+#endif
+
+/// Advance a pointer by a number of bytes
+template<typename T> static GF256_FORCE_INLINE T* gf256_advance(T* p, int bytes)
+{
+    return reinterpret_cast<T*>(reinterpret_cast<uintptr_t>(p) + bytes);
+}
+
+static GF256_TARGET_SSSE3 int gf256_mul_mem_ssse3_loop(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx, uint8_t y, int bytes)
+{
+    GF256_M128 * GF256_RESTRICT z16 = reinterpret_cast<GF256_M128 *>(vz);
+    const GF256_M128 * GF256_RESTRICT x16 = reinterpret_cast<const GF256_M128 *>(vx);
+    const int done = bytes & ~15;
+
+    // Partial product tables; see above
+    const GF256_M128 table_lo_y = _mm_loadu_si128(GF256Ctx.MM128.TABLE_LO_Y + y);
+    const GF256_M128 table_hi_y = _mm_loadu_si128(GF256Ctx.MM128.TABLE_HI_Y + y);
+
+    // clr_mask = 0x0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f
+    const GF256_M128 clr_mask = _mm_set1_epi8(0x0f);
+
+    // Handle multiples of 16 bytes
+    while (bytes >= 16)
+    {
+        // See above comments for details
+        GF256_M128 x0 = _mm_loadu_si128(x16);
+        GF256_M128 l0 = _mm_and_si128(x0, clr_mask);
+        x0 = _mm_srli_epi64(x0, 4);
+        GF256_M128 h0 = _mm_and_si128(x0, clr_mask);
+        l0 = _mm_shuffle_epi8(table_lo_y, l0);
+        h0 = _mm_shuffle_epi8(table_hi_y, h0);
+        _mm_storeu_si128(z16, _mm_xor_si128(l0, h0));
+
+        bytes -= 16, ++x16, ++z16;
+    }
+
+    return done;
+}
+
+static GF256_TARGET_SSSE3 int gf256_muladd_mem_ssse3_loop(void * GF256_RESTRICT vz, uint8_t y, const void * GF256_RESTRICT vx, int bytes)
+{
+    GF256_M128 * GF256_RESTRICT z16 = reinterpret_cast<GF256_M128 *>(vz);
+    const GF256_M128 * GF256_RESTRICT x16 = reinterpret_cast<const GF256_M128 *>(vx);
+    const int done = bytes & ~15;
+
+    // Partial product tables; see above
+    const GF256_M128 table_lo_y = _mm_loadu_si128(GF256Ctx.MM128.TABLE_LO_Y + y);
+    const GF256_M128 table_hi_y = _mm_loadu_si128(GF256Ctx.MM128.TABLE_HI_Y + y);
+
+    // clr_mask = 0x0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f
+    const GF256_M128 clr_mask = _mm_set1_epi8(0x0f);
+
+    // This unroll seems to provide about 7% speed boost when AVX2 is disabled
+    while (bytes >= 32)
+    {
+        bytes -= 32;
+
+        GF256_M128 x1 = _mm_loadu_si128(x16 + 1);
+        GF256_M128 l1 = _mm_and_si128(x1, clr_mask);
+        x1 = _mm_srli_epi64(x1, 4);
+        GF256_M128 h1 = _mm_and_si128(x1, clr_mask);
+        l1 = _mm_shuffle_epi8(table_lo_y, l1);
+        h1 = _mm_shuffle_epi8(table_hi_y, h1);
+        const GF256_M128 z1 = _mm_loadu_si128(z16 + 1);
+
+        GF256_M128 x0 = _mm_loadu_si128(x16);
+        GF256_M128 l0 = _mm_and_si128(x0, clr_mask);
+        x0 = _mm_srli_epi64(x0, 4);
+        GF256_M128 h0 = _mm_and_si128(x0, clr_mask);
+        l0 = _mm_shuffle_epi8(table_lo_y, l0);
+        h0 = _mm_shuffle_epi8(table_hi_y, h0);
+        const GF256_M128 z0 = _mm_loadu_si128(z16);
+
+        const GF256_M128 p1 = _mm_xor_si128(l1, h1);
+        _mm_storeu_si128(z16 + 1, _mm_xor_si128(p1, z1));
+
+        const GF256_M128 p0 = _mm_xor_si128(l0, h0);
+        _mm_storeu_si128(z16, _mm_xor_si128(p0, z0));
+
+        x16 += 2, z16 += 2;
+    }
+
+    // Handle multiples of 16 bytes
+    while (bytes >= 16)
+    {
+        // See above comments for details
+        GF256_M128 x0 = _mm_loadu_si128(x16);
+        GF256_M128 l0 = _mm_and_si128(x0, clr_mask);
+        x0 = _mm_srli_epi64(x0, 4);
+        GF256_M128 h0 = _mm_and_si128(x0, clr_mask);
+        l0 = _mm_shuffle_epi8(table_lo_y, l0);
+        h0 = _mm_shuffle_epi8(table_hi_y, h0);
+        const GF256_M128 p0 = _mm_xor_si128(l0, h0);
+        const GF256_M128 z0 = _mm_loadu_si128(z16);
+        _mm_storeu_si128(z16, _mm_xor_si128(p0, z0));
+
+        bytes -= 16, ++x16, ++z16;
+    }
+
+    return done;
+}
+
+#ifdef GF256_TRY_AVX2
+
+static GF256_TARGET_AVX2 void gf256_mul_mem_init_avx2(int y, GF256_M128 table_lo, GF256_M128 table_hi)
+{
+    const GF256_M256 table_lo2 = _mm256_broadcastsi128_si256(table_lo);
+    const GF256_M256 table_hi2 = _mm256_broadcastsi128_si256(table_hi);
+    _mm256_storeu_si256(GF256Ctx.MM256.TABLE_LO_Y + y, table_lo2);
+    _mm256_storeu_si256(GF256Ctx.MM256.TABLE_HI_Y + y, table_hi2);
+}
+
+static GF256_TARGET_AVX2 int gf256_add_mem_avx2_loop(void * GF256_RESTRICT vx, const void * GF256_RESTRICT vy, int bytes)
+{
+    GF256_M256 * GF256_RESTRICT x32 = reinterpret_cast<GF256_M256 *>(vx);
+    const GF256_M256 * GF256_RESTRICT y32 = reinterpret_cast<const GF256_M256 *>(vy);
+    const int done = bytes & ~31;
+
+    while (bytes >= 128)
+    {
+        GF256_M256 x0 = _mm256_loadu_si256(x32);
+        GF256_M256 y0 = _mm256_loadu_si256(y32);
+        x0 = _mm256_xor_si256(x0, y0);
+        GF256_M256 x1 = _mm256_loadu_si256(x32 + 1);
+        GF256_M256 y1 = _mm256_loadu_si256(y32 + 1);
+        x1 = _mm256_xor_si256(x1, y1);
+        GF256_M256 x2 = _mm256_loadu_si256(x32 + 2);
+        GF256_M256 y2 = _mm256_loadu_si256(y32 + 2);
+        x2 = _mm256_xor_si256(x2, y2);
+        GF256_M256 x3 = _mm256_loadu_si256(x32 + 3);
+        GF256_M256 y3 = _mm256_loadu_si256(y32 + 3);
+        x3 = _mm256_xor_si256(x3, y3);
+
+        _mm256_storeu_si256(x32, x0);
+        _mm256_storeu_si256(x32 + 1, x1);
+        _mm256_storeu_si256(x32 + 2, x2);
+        _mm256_storeu_si256(x32 + 3, x3);
+
+        bytes -= 128, x32 += 4, y32 += 4;
+    }
+
+    // Handle multiples of 32 bytes
+    while (bytes >= 32)
+    {
+        // x[i] = x[i] xor y[i]
+        _mm256_storeu_si256(x32,
+            _mm256_xor_si256(
+                _mm256_loadu_si256(x32),
+                _mm256_loadu_si256(y32)));
+
+        bytes -= 32, ++x32, ++y32;
+    }
+
+    return done;
+}
+
+static GF256_TARGET_AVX2 int gf256_add2_mem_avx2_loop(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                                                  const void * GF256_RESTRICT vy, int bytes)
+{
+    GF256_M256 * GF256_RESTRICT z32 = reinterpret_cast<GF256_M256 *>(vz);
+    const GF256_M256 * GF256_RESTRICT x32 = reinterpret_cast<const GF256_M256 *>(vx);
+    const GF256_M256 * GF256_RESTRICT y32 = reinterpret_cast<const GF256_M256 *>(vy);
+
+    const unsigned count = bytes / 32;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        _mm256_storeu_si256(z32 + i,
+            _mm256_xor_si256(
+                _mm256_loadu_si256(z32 + i),
+                _mm256_xor_si256(
+                    _mm256_loadu_si256(x32 + i),
+                    _mm256_loadu_si256(y32 + i))));
+    }
+
+    return count * 32;
+}
+
+static GF256_TARGET_AVX2 int gf256_addset_mem_avx2_loop(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                                                    const void * GF256_RESTRICT vy, int bytes)
+{
+    GF256_M256 * GF256_RESTRICT z32 = reinterpret_cast<GF256_M256 *>(vz);
+    const GF256_M256 * GF256_RESTRICT x32 = reinterpret_cast<const GF256_M256 *>(vx);
+    const GF256_M256 * GF256_RESTRICT y32 = reinterpret_cast<const GF256_M256 *>(vy);
+
+    const unsigned count = bytes / 32;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        _mm256_storeu_si256(z32 + i,
+            _mm256_xor_si256(
+                _mm256_loadu_si256(x32 + i),
+                _mm256_loadu_si256(y32 + i)));
+    }
+
+    return count * 32;
+}
+
+static GF256_TARGET_AVX2 int gf256_mul_mem_avx2_loop(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx, uint8_t y, int bytes)
+{
+    GF256_M256 * GF256_RESTRICT z32 = reinterpret_cast<GF256_M256 *>(vz);
+    const GF256_M256 * GF256_RESTRICT x32 = reinterpret_cast<const GF256_M256 *>(vx);
+    const int done = bytes & ~31;
+
+    // Partial product tables; see above
+    const GF256_M256 table_lo_y = _mm256_loadu_si256(GF256Ctx.MM256.TABLE_LO_Y + y);
+    const GF256_M256 table_hi_y = _mm256_loadu_si256(GF256Ctx.MM256.TABLE_HI_Y + y);
+
+    // clr_mask = 0x0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f
+    const GF256_M256 clr_mask = _mm256_set1_epi8(0x0f);
+
+    // Handle multiples of 32 bytes
+    while (bytes >= 32)
+    {
+        // See above comments for details
+        GF256_M256 x0 = _mm256_loadu_si256(x32);
+        GF256_M256 l0 = _mm256_and_si256(x0, clr_mask);
+        x0 = _mm256_srli_epi64(x0, 4);
+        GF256_M256 h0 = _mm256_and_si256(x0, clr_mask);
+        l0 = _mm256_shuffle_epi8(table_lo_y, l0);
+        h0 = _mm256_shuffle_epi8(table_hi_y, h0);
+        _mm256_storeu_si256(z32, _mm256_xor_si256(l0, h0));
+
+        bytes -= 32, ++x32, ++z32;
+    }
+
+    return done;
+}
+
+static GF256_TARGET_AVX2 int gf256_muladd_mem_avx2_loop(void * GF256_RESTRICT vz, uint8_t y, const void * GF256_RESTRICT vx, int bytes)
+{
+    GF256_M256 * GF256_RESTRICT z32 = reinterpret_cast<GF256_M256 *>(vz);
+    const GF256_M256 * GF256_RESTRICT x32 = reinterpret_cast<const GF256_M256 *>(vx);
+    const int done = bytes & ~31;
+
+    // Partial product tables; see above
+    const GF256_M256 table_lo_y = _mm256_loadu_si256(GF256Ctx.MM256.TABLE_LO_Y + y);
+    const GF256_M256 table_hi_y = _mm256_loadu_si256(GF256Ctx.MM256.TABLE_HI_Y + y);
+
+    // clr_mask = 0x0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f
+    const GF256_M256 clr_mask = _mm256_set1_epi8(0x0f);
+
+    // On my Reed Solomon codec, the encoder unit test runs in 640 usec without and 550 usec with the optimization (86% of the original time)
+    const unsigned count = bytes / 64;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        // See above comments for details
+        GF256_M256 x0 = _mm256_loadu_si256(x32 + i * 2);
+        GF256_M256 l0 = _mm256_and_si256(x0, clr_mask);
+        x0 = _mm256_srli_epi64(x0, 4);
+        const GF256_M256 z0 = _mm256_loadu_si256(z32 + i * 2);
+        GF256_M256 h0 = _mm256_and_si256(x0, clr_mask);
+        l0 = _mm256_shuffle_epi8(table_lo_y, l0);
+        h0 = _mm256_shuffle_epi8(table_hi_y, h0);
+        const GF256_M256 p0 = _mm256_xor_si256(l0, h0);
+        _mm256_storeu_si256(z32 + i * 2, _mm256_xor_si256(p0, z0));
+
+        GF256_M256 x1 = _mm256_loadu_si256(x32 + i * 2 + 1);
+        GF256_M256 l1 = _mm256_and_si256(x1, clr_mask);
+        x1 = _mm256_srli_epi64(x1, 4);
+        const GF256_M256 z1 = _mm256_loadu_si256(z32 + i * 2 + 1);
+        GF256_M256 h1 = _mm256_and_si256(x1, clr_mask);
+        l1 = _mm256_shuffle_epi8(table_lo_y, l1);
+        h1 = _mm256_shuffle_epi8(table_hi_y, h1);
+        const GF256_M256 p1 = _mm256_xor_si256(l1, h1);
+        _mm256_storeu_si256(z32 + i * 2 + 1, _mm256_xor_si256(p1, z1));
+    }
+    bytes -= count * 64;
+    z32 += count * 2;
+    x32 += count * 2;
+
+    if (bytes >= 32)
+    {
+        GF256_M256 x0 = _mm256_loadu_si256(x32);
+        GF256_M256 l0 = _mm256_and_si256(x0, clr_mask);
+        x0 = _mm256_srli_epi64(x0, 4);
+        GF256_M256 h0 = _mm256_and_si256(x0, clr_mask);
+        l0 = _mm256_shuffle_epi8(table_lo_y, l0);
+        h0 = _mm256_shuffle_epi8(table_hi_y, h0);
+        const GF256_M256 p0 = _mm256_xor_si256(l0, h0);
+        const GF256_M256 z0 = _mm256_loadu_si256(z32);
+        _mm256_storeu_si256(z32, _mm256_xor_si256(p0, z0));
+    }
+
+    return done;
+}
+
+#endif // GF256_TRY_AVX2
+
+#ifdef GF256_TRY_AVX512
+
+// GCC 12 warns about _mm512_undefined_epi32() inside its own intrinsics
+#if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wuninitialized"
+    #pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+/// Mask of the first bytes (0..63) lanes of a 512-bit vector
+static GF256_FORCE_INLINE uint64_t gf256_tail_mask(int bytes)
+{
+    return ((uint64_t)1 << bytes) - 1;
+}
+
+static GF256_TARGET_AVX512 void gf256_add_mem_avx512(void * GF256_RESTRICT vx, const void * GF256_RESTRICT vy, int bytes)
+{
+    uint8_t * GF256_RESTRICT x1 = reinterpret_cast<uint8_t *>(vx);
+    const uint8_t * GF256_RESTRICT y1 = reinterpret_cast<const uint8_t *>(vy);
+
+    while (bytes >= 256)
+    {
+        const __m512i v0 = _mm512_xor_si512(_mm512_loadu_si512(x1), _mm512_loadu_si512(y1));
+        const __m512i v1 = _mm512_xor_si512(_mm512_loadu_si512(x1 + 64), _mm512_loadu_si512(y1 + 64));
+        const __m512i v2 = _mm512_xor_si512(_mm512_loadu_si512(x1 + 128), _mm512_loadu_si512(y1 + 128));
+        const __m512i v3 = _mm512_xor_si512(_mm512_loadu_si512(x1 + 192), _mm512_loadu_si512(y1 + 192));
+        _mm512_storeu_si512(x1, v0);
+        _mm512_storeu_si512(x1 + 64, v1);
+        _mm512_storeu_si512(x1 + 128, v2);
+        _mm512_storeu_si512(x1 + 192, v3);
+
+        bytes -= 256, x1 += 256, y1 += 256;
+    }
+
+    while (bytes >= 64)
+    {
+        _mm512_storeu_si512(x1, _mm512_xor_si512(_mm512_loadu_si512(x1), _mm512_loadu_si512(y1)));
+        bytes -= 64, x1 += 64, y1 += 64;
+    }
+
+    if (bytes > 0)
+    {
+        const __mmask64 mask = gf256_tail_mask(bytes);
+        const __m512i x0 = _mm512_maskz_loadu_epi8(mask, x1);
+        const __m512i y0 = _mm512_maskz_loadu_epi8(mask, y1);
+        _mm512_mask_storeu_epi8(x1, mask, _mm512_xor_si512(x0, y0));
+    }
+}
+
+static GF256_TARGET_AVX512 void gf256_add2_mem_avx512(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                                                       const void * GF256_RESTRICT vy, int bytes)
+{
+    uint8_t * GF256_RESTRICT z1 = reinterpret_cast<uint8_t *>(vz);
+    const uint8_t * GF256_RESTRICT x1 = reinterpret_cast<const uint8_t *>(vx);
+    const uint8_t * GF256_RESTRICT y1 = reinterpret_cast<const uint8_t *>(vy);
+
+    // 0x96 = three-way XOR
+    while (bytes >= 64)
+    {
+        const __m512i z0 = _mm512_ternarylogic_epi64(
+            _mm512_loadu_si512(z1), _mm512_loadu_si512(x1), _mm512_loadu_si512(y1), 0x96);
+        _mm512_storeu_si512(z1, z0);
+        bytes -= 64, x1 += 64, y1 += 64, z1 += 64;
+    }
+
+    if (bytes > 0)
+    {
+        const __mmask64 mask = gf256_tail_mask(bytes);
+        const __m512i z0 = _mm512_ternarylogic_epi64(
+            _mm512_maskz_loadu_epi8(mask, z1),
+            _mm512_maskz_loadu_epi8(mask, x1),
+            _mm512_maskz_loadu_epi8(mask, y1), 0x96);
+        _mm512_mask_storeu_epi8(z1, mask, z0);
+    }
+}
+
+static GF256_TARGET_AVX512 void gf256_addset_mem_avx512(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                                                         const void * GF256_RESTRICT vy, int bytes)
+{
+    uint8_t * GF256_RESTRICT z1 = reinterpret_cast<uint8_t *>(vz);
+    const uint8_t * GF256_RESTRICT x1 = reinterpret_cast<const uint8_t *>(vx);
+    const uint8_t * GF256_RESTRICT y1 = reinterpret_cast<const uint8_t *>(vy);
+
+    while (bytes >= 64)
+    {
+        _mm512_storeu_si512(z1, _mm512_xor_si512(_mm512_loadu_si512(x1), _mm512_loadu_si512(y1)));
+        bytes -= 64, x1 += 64, y1 += 64, z1 += 64;
+    }
+
+    if (bytes > 0)
+    {
+        const __mmask64 mask = gf256_tail_mask(bytes);
+        const __m512i z0 = _mm512_xor_si512(
+            _mm512_maskz_loadu_epi8(mask, x1),
+            _mm512_maskz_loadu_epi8(mask, y1));
+        _mm512_mask_storeu_epi8(z1, mask, z0);
+    }
+}
+
+/// Product of 64 bytes with the constant whose nibble tables are given
+static GF256_TARGET_AVX512 GF256_FORCE_INLINE __m512i gf256_mul_avx512(
+    __m512i x0, __m512i table_lo_y, __m512i table_hi_y, __m512i clr_mask)
+{
+    const __m512i l0 = _mm512_and_si512(x0, clr_mask);
+    const __m512i h0 = _mm512_and_si512(_mm512_srli_epi64(x0, 4), clr_mask);
+    return _mm512_xor_si512(
+        _mm512_shuffle_epi8(table_lo_y, l0),
+        _mm512_shuffle_epi8(table_hi_y, h0));
+}
+
+static GF256_TARGET_AVX512 void gf256_mul_mem_avx512(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx, uint8_t y, int bytes)
+{
+    uint8_t * GF256_RESTRICT z1 = reinterpret_cast<uint8_t *>(vz);
+    const uint8_t * GF256_RESTRICT x1 = reinterpret_cast<const uint8_t *>(vx);
+
+    // Partial product tables; see above
+    const __m512i table_lo_y = _mm512_broadcast_i32x4(_mm_loadu_si128(GF256Ctx.MM128.TABLE_LO_Y + y));
+    const __m512i table_hi_y = _mm512_broadcast_i32x4(_mm_loadu_si128(GF256Ctx.MM128.TABLE_HI_Y + y));
+    const __m512i clr_mask = _mm512_set1_epi8(0x0f);
+
+    while (bytes >= 64)
+    {
+        _mm512_storeu_si512(z1, gf256_mul_avx512(_mm512_loadu_si512(x1), table_lo_y, table_hi_y, clr_mask));
+        bytes -= 64, x1 += 64, z1 += 64;
+    }
+
+    if (bytes > 0)
+    {
+        const __mmask64 mask = gf256_tail_mask(bytes);
+        const __m512i p0 = gf256_mul_avx512(_mm512_maskz_loadu_epi8(mask, x1), table_lo_y, table_hi_y, clr_mask);
+        _mm512_mask_storeu_epi8(z1, mask, p0);
+    }
+}
+
+static GF256_TARGET_AVX512 void gf256_muladd_mem_avx512(void * GF256_RESTRICT vz, uint8_t y, const void * GF256_RESTRICT vx, int bytes)
+{
+    uint8_t * GF256_RESTRICT z1 = reinterpret_cast<uint8_t *>(vz);
+    const uint8_t * GF256_RESTRICT x1 = reinterpret_cast<const uint8_t *>(vx);
+
+    // Partial product tables; see above
+    const __m512i table_lo_y = _mm512_broadcast_i32x4(_mm_loadu_si128(GF256Ctx.MM128.TABLE_LO_Y + y));
+    const __m512i table_hi_y = _mm512_broadcast_i32x4(_mm_loadu_si128(GF256Ctx.MM128.TABLE_HI_Y + y));
+    const __m512i clr_mask = _mm512_set1_epi8(0x0f);
+
+    // Two vectors per loop, as in the AVX2 version
+    while (bytes >= 128)
+    {
+        const __m512i p0 = gf256_mul_avx512(_mm512_loadu_si512(x1), table_lo_y, table_hi_y, clr_mask);
+        const __m512i p1 = gf256_mul_avx512(_mm512_loadu_si512(x1 + 64), table_lo_y, table_hi_y, clr_mask);
+        _mm512_storeu_si512(z1, _mm512_xor_si512(p0, _mm512_loadu_si512(z1)));
+        _mm512_storeu_si512(z1 + 64, _mm512_xor_si512(p1, _mm512_loadu_si512(z1 + 64)));
+        bytes -= 128, x1 += 128, z1 += 128;
+    }
+
+    if (bytes >= 64)
+    {
+        const __m512i p0 = gf256_mul_avx512(_mm512_loadu_si512(x1), table_lo_y, table_hi_y, clr_mask);
+        _mm512_storeu_si512(z1, _mm512_xor_si512(p0, _mm512_loadu_si512(z1)));
+        bytes -= 64, x1 += 64, z1 += 64;
+    }
+
+    if (bytes > 0)
+    {
+        const __mmask64 mask = gf256_tail_mask(bytes);
+        const __m512i p0 = gf256_mul_avx512(_mm512_maskz_loadu_epi8(mask, x1), table_lo_y, table_hi_y, clr_mask);
+        _mm512_mask_storeu_epi8(z1, mask, _mm512_xor_si512(p0, _mm512_maskz_loadu_epi8(mask, z1)));
+    }
+}
+
+/*
+    Aligned kernels for the *_a64 entry points: every pointer is 64-byte
+    aligned and bytes is a multiple of 64, so each vector is exactly one
+    cache line and there is no masked tail.
+*/
+
+static GF256_TARGET_AVX512 void gf256_add_mem_avx512_a64(void * GF256_RESTRICT vx, const void * GF256_RESTRICT vy, int bytes)
+{
+    uint8_t * GF256_RESTRICT x1 = reinterpret_cast<uint8_t *>(vx);
+    const uint8_t * GF256_RESTRICT y1 = reinterpret_cast<const uint8_t *>(vy);
+
+    while (bytes >= 256)
+    {
+        const __m512i v0 = _mm512_xor_si512(_mm512_load_si512(x1), _mm512_load_si512(y1));
+        const __m512i v1 = _mm512_xor_si512(_mm512_load_si512(x1 + 64), _mm512_load_si512(y1 + 64));
+        const __m512i v2 = _mm512_xor_si512(_mm512_load_si512(x1 + 128), _mm512_load_si512(y1 + 128));
+        const __m512i v3 = _mm512_xor_si512(_mm512_load_si512(x1 + 192), _mm512_load_si512(y1 + 192));
+        _mm512_store_si512(x1, v0);
+        _mm512_store_si512(x1 + 64, v1);
+        _mm512_store_si512(x1 + 128, v2);
+        _mm512_store_si512(x1 + 192, v3);
+
+        bytes -= 256, x1 += 256, y1 += 256;
+    }
+
+    while (bytes > 0)
+    {
+        _mm512_store_si512(x1, _mm512_xor_si512(_mm512_load_si512(x1), _mm512_load_si512(y1)));
+        bytes -= 64, x1 += 64, y1 += 64;
+    }
+}
+
+static GF256_TARGET_AVX512 void gf256_add2_mem_avx512_a64(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                                                           const void * GF256_RESTRICT vy, int bytes)
+{
+    uint8_t * GF256_RESTRICT z1 = reinterpret_cast<uint8_t *>(vz);
+    const uint8_t * GF256_RESTRICT x1 = reinterpret_cast<const uint8_t *>(vx);
+    const uint8_t * GF256_RESTRICT y1 = reinterpret_cast<const uint8_t *>(vy);
+
+    while (bytes > 0)
+    {
+        const __m512i z0 = _mm512_ternarylogic_epi64(
+            _mm512_load_si512(z1), _mm512_load_si512(x1), _mm512_load_si512(y1), 0x96);
+        _mm512_store_si512(z1, z0);
+        bytes -= 64, x1 += 64, y1 += 64, z1 += 64;
+    }
+}
+
+static GF256_TARGET_AVX512 void gf256_addset_mem_avx512_a64(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                                                             const void * GF256_RESTRICT vy, int bytes)
+{
+    uint8_t * GF256_RESTRICT z1 = reinterpret_cast<uint8_t *>(vz);
+    const uint8_t * GF256_RESTRICT x1 = reinterpret_cast<const uint8_t *>(vx);
+    const uint8_t * GF256_RESTRICT y1 = reinterpret_cast<const uint8_t *>(vy);
+
+    while (bytes > 0)
+    {
+        _mm512_store_si512(z1, _mm512_xor_si512(_mm512_load_si512(x1), _mm512_load_si512(y1)));
+        bytes -= 64, x1 += 64, y1 += 64, z1 += 64;
+    }
+}
+
+static GF256_TARGET_AVX512 void gf256_mul_mem_avx512_a64(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx, uint8_t y, int bytes)
+{
+    uint8_t * GF256_RESTRICT z1 = reinterpret_cast<uint8_t *>(vz);
+    const uint8_t * GF256_RESTRICT x1 = reinterpret_cast<const uint8_t *>(vx);
+
+    const __m512i table_lo_y = _mm512_broadcast_i32x4(_mm_loadu_si128(GF256Ctx.MM128.TABLE_LO_Y + y));
+    const __m512i table_hi_y = _mm512_broadcast_i32x4(_mm_loadu_si128(GF256Ctx.MM128.TABLE_HI_Y + y));
+    const __m512i clr_mask = _mm512_set1_epi8(0x0f);
+
+    while (bytes > 0)
+    {
+        _mm512_store_si512(z1, gf256_mul_avx512(_mm512_load_si512(x1), table_lo_y, table_hi_y, clr_mask));
+        bytes -= 64, x1 += 64, z1 += 64;
+    }
+}
+
+static GF256_TARGET_AVX512 void gf256_muladd_mem_avx512_a64(void * GF256_RESTRICT vz, uint8_t y, const void * GF256_RESTRICT vx, int bytes)
+{
+    uint8_t * GF256_RESTRICT z1 = reinterpret_cast<uint8_t *>(vz);
+    const uint8_t * GF256_RESTRICT x1 = reinterpret_cast<const uint8_t *>(vx);
+
+    const __m512i table_lo_y = _mm512_broadcast_i32x4(_mm_loadu_si128(GF256Ctx.MM128.TABLE_LO_Y + y));
+    const __m512i table_hi_y = _mm512_broadcast_i32x4(_mm_loadu_si128(GF256Ctx.MM128.TABLE_HI_Y + y));
+    const __m512i clr_mask = _mm512_set1_epi8(0x0f);
+
+    while (bytes >= 128)
+    {
+        const __m512i p0 = gf256_mul_avx512(_mm512_load_si512(x1), table_lo_y, table_hi_y, clr_mask);
+        const __m512i p1 = gf256_mul_avx512(_mm512_load_si512(x1 + 64), table_lo_y, table_hi_y, clr_mask);
+        _mm512_store_si512(z1, _mm512_xor_si512(p0, _mm512_load_si512(z1)));
+        _mm512_store_si512(z1 + 64, _mm512_xor_si512(p1, _mm512_load_si512(z1 + 64)));
+        bytes -= 128, x1 += 128, z1 += 128;
+    }
+
+    if (bytes > 0)
+    {
+        const __m512i p0 = gf256_mul_avx512(_mm512_load_si512(x1), table_lo_y, table_hi_y, clr_mask);
+        _mm512_store_si512(z1, _mm512_xor_si512(p0, _mm512_load_si512(z1)));
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC diagnostic pop
+#endif
+
+#endif // GF256_TRY_AVX512
+
+#endif // GF256_TARGET_MOBILE
+
+
 //------------------------------------------------------------------------------
 // Context Object
 
@@ -584,12 +1225,7 @@ static void gf256_mul_mem_init()
         _mm_storeu_si128(GF256Ctx.MM128.TABLE_HI_Y + y, table_hi);
 # ifdef GF256_TRY_AVX2
         if (CpuHasAVX2)
-        {
-            const GF256_M256 table_lo2 = _mm256_broadcastsi128_si256(table_lo);
-            const GF256_M256 table_hi2 = _mm256_broadcastsi128_si256(table_hi);
-            _mm256_storeu_si256(GF256Ctx.MM256.TABLE_LO_Y + y, table_lo2);
-            _mm256_storeu_si256(GF256Ctx.MM256.TABLE_HI_Y + y, table_hi2);
-        }
+            gf256_mul_mem_init_avx2(y, table_lo, table_hi);
 # endif // GF256_TRY_AVX2
 #endif // GF256_TARGET_MOBILE
     }
@@ -619,6 +1255,8 @@ static bool IsExpectedEndian()
     return 0x01020304 == type.IntValue;
 }
 
+static void gf256_select_kernels();
+
 extern "C" int gf256_init_(int version)
 {
     if (version != GF256_VERSION)
@@ -639,6 +1277,7 @@ extern "C" int gf256_init_(int version)
     gf256_inv_init();
     gf256_sqr_init();
     gf256_mul_mem_init();
+    gf256_select_kernels();
 
     if (!gf256_self_test())
         return -3; // Self-test failed (perhaps untested configuration)
@@ -647,11 +1286,52 @@ extern "C" int gf256_init_(int version)
 }
 
 
+extern "C" int gf256_get_isa()
+{
+#if !defined(GF256_TARGET_MOBILE)
+# if defined(GF256_TRY_AVX512)
+    if (CpuHasAVX512)
+        return GF256_ISA_AVX512;
+# endif // GF256_TRY_AVX512
+# if defined(GF256_TRY_AVX2)
+    if (CpuHasAVX2)
+        return GF256_ISA_AVX2;
+# endif // GF256_TRY_AVX2
+    if (CpuHasSSSE3)
+        return GF256_ISA_SSSE3;
+#elif defined(GF256_TRY_NEON)
+    if (CpuHasNeon)
+        return GF256_ISA_NEON;
+#endif // GF256_TARGET_MOBILE
+    return GF256_ISA_GENERIC;
+}
+
+extern "C" int gf256_set_isa(int isa)
+{
+#if !defined(GF256_TARGET_MOBILE)
+    // Only ever narrow the detected feature set.  The AVX2 tables are filled
+    // in during init if the CPU supports it, so raising it back is safe.
+    CpuHasSSSE3 = CpuDetectedSSSE3 && (isa >= GF256_ISA_SSSE3);
+# if defined(GF256_TRY_AVX2)
+    CpuHasAVX2 = CpuDetectedAVX2 && (isa >= GF256_ISA_AVX2);
+# endif // GF256_TRY_AVX2
+# if defined(GF256_TRY_AVX512)
+    CpuHasAVX512 = CpuDetectedAVX512 && (isa >= GF256_ISA_AVX512);
+# endif // GF256_TRY_AVX512
+#else // GF256_TARGET_MOBILE
+    (void)isa; // NEON selection is fixed at init time
+#endif // GF256_TARGET_MOBILE
+
+    gf256_select_kernels();
+    return gf256_get_isa();
+}
+
+
 //------------------------------------------------------------------------------
-// Operations
+// Generic Operations
 
-extern "C" void gf256_add_mem(void * GF256_RESTRICT vx,
-                              const void * GF256_RESTRICT vy, int bytes)
+static void gf256_add_mem_generic(void * GF256_RESTRICT vx,
+                                  const void * GF256_RESTRICT vy, int bytes)
 {
     GF256_M128 * GF256_RESTRICT x16 = reinterpret_cast<GF256_M128 *>(vx);
     const GF256_M128 * GF256_RESTRICT y16 = reinterpret_cast<const GF256_M128 *>(vy);
@@ -707,54 +1387,8 @@ extern "C" void gf256_add_mem(void * GF256_RESTRICT vx,
         bytes -= (count * 8);
     }
 #else // GF256_TARGET_MOBILE
-# if defined(GF256_TRY_AVX2)
-    if (CpuHasAVX2)
     {
-        GF256_M256 * GF256_RESTRICT x32 = reinterpret_cast<GF256_M256 *>(x16);
-        const GF256_M256 * GF256_RESTRICT y32 = reinterpret_cast<const GF256_M256 *>(y16);
-
-        while (bytes >= 128)
-        {
-            GF256_M256 x0 = _mm256_loadu_si256(x32);
-            GF256_M256 y0 = _mm256_loadu_si256(y32);
-            x0 = _mm256_xor_si256(x0, y0);
-            GF256_M256 x1 = _mm256_loadu_si256(x32 + 1);
-            GF256_M256 y1 = _mm256_loadu_si256(y32 + 1);
-            x1 = _mm256_xor_si256(x1, y1);
-            GF256_M256 x2 = _mm256_loadu_si256(x32 + 2);
-            GF256_M256 y2 = _mm256_loadu_si256(y32 + 2);
-            x2 = _mm256_xor_si256(x2, y2);
-            GF256_M256 x3 = _mm256_loadu_si256(x32 + 3);
-            GF256_M256 y3 = _mm256_loadu_si256(y32 + 3);
-            x3 = _mm256_xor_si256(x3, y3);
-
-            _mm256_storeu_si256(x32, x0);
-            _mm256_storeu_si256(x32 + 1, x1);
-            _mm256_storeu_si256(x32 + 2, x2);
-            _mm256_storeu_si256(x32 + 3, x3);
-
-            bytes -= 128, x32 += 4, y32 += 4;
-        }
-
-        // Handle multiples of 32 bytes
-        while (bytes >= 32)
-        {
-            // x[i] = x[i] xor y[i]
-            _mm256_storeu_si256(x32,
-                _mm256_xor_si256(
-                    _mm256_loadu_si256(x32),
-                    _mm256_loadu_si256(y32)));
-
-            bytes -= 32, ++x32, ++y32;
-        }
-
-        x16 = reinterpret_cast<GF256_M128 *>(x32);
-        y16 = reinterpret_cast<const GF256_M128 *>(y32);
-    }
-    else
-# endif // GF256_TRY_AVX2
-    {
-        while (bytes >= 64)
+        while (bytes >= 64)
         {
             GF256_M128 x0 = _mm_loadu_si128(x16);
             GF256_M128 y0 = _mm_loadu_si128(y16);
@@ -826,8 +1460,8 @@ extern "C" void gf256_add_mem(void * GF256_RESTRICT vx,
     }
 }
 
-extern "C" void gf256_add2_mem(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
-                               const void * GF256_RESTRICT vy, int bytes)
+static void gf256_add2_mem_generic(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                                   const void * GF256_RESTRICT vy, int bytes)
 {
     GF256_M128 * GF256_RESTRICT z16 = reinterpret_cast<GF256_M128*>(vz);
     const GF256_M128 * GF256_RESTRICT x16 = reinterpret_cast<const GF256_M128*>(vx);
@@ -870,30 +1504,6 @@ extern "C" void gf256_add2_mem(void * GF256_RESTRICT vz, const void * GF256_REST
         bytes -= (count * 8);
     }
 #else // GF256_TARGET_MOBILE
-# if defined(GF256_TRY_AVX2)
-    if (CpuHasAVX2)
-    {
-        GF256_M256 * GF256_RESTRICT z32 = reinterpret_cast<GF256_M256 *>(z16);
-        const GF256_M256 * GF256_RESTRICT x32 = reinterpret_cast<const GF256_M256 *>(x16);
-        const GF256_M256 * GF256_RESTRICT y32 = reinterpret_cast<const GF256_M256 *>(y16);
-
-        const unsigned count = bytes / 32;
-        for (unsigned i = 0; i < count; ++i)
-        {
-            _mm256_storeu_si256(z32 + i,
-                _mm256_xor_si256(
-                    _mm256_loadu_si256(z32 + i),
-                    _mm256_xor_si256(
-                        _mm256_loadu_si256(x32 + i),
-                        _mm256_loadu_si256(y32 + i))));
-        }
-
-        bytes -= count * 32;
-        z16 = reinterpret_cast<GF256_M128 *>(z32 + count);
-        x16 = reinterpret_cast<const GF256_M128 *>(x32 + count);
-        y16 = reinterpret_cast<const GF256_M128 *>(y32 + count);
-    }
-# endif // GF256_TRY_AVX2
 
     // Handle multiples of 16 bytes
     while (bytes >= 16)
@@ -946,8 +1556,8 @@ extern "C" void gf256_add2_mem(void * GF256_RESTRICT vz, const void * GF256_REST
     }
 }
 
-extern "C" void gf256_addset_mem(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
-                                 const void * GF256_RESTRICT vy, int bytes)
+static void gf256_addset_mem_generic(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                                     const void * GF256_RESTRICT vy, int bytes)
 {
     GF256_M128 * GF256_RESTRICT z16 = reinterpret_cast<GF256_M128*>(vz);
     const GF256_M128 * GF256_RESTRICT x16 = reinterpret_cast<const GF256_M128*>(vx);
@@ -1007,29 +1617,6 @@ extern "C" void gf256_addset_mem(void * GF256_RESTRICT vz, const void * GF256_RE
         bytes -= (count * 8);
     }
 #else // GF256_TARGET_MOBILE
-# if defined(GF256_TRY_AVX2)
-    if (CpuHasAVX2)
-    {
-        GF256_M256 * GF256_RESTRICT z32 = reinterpret_cast<GF256_M256 *>(z16);
-        const GF256_M256 * GF256_RESTRICT x32 = reinterpret_cast<const GF256_M256 *>(x16);
-        const GF256_M256 * GF256_RESTRICT y32 = reinterpret_cast<const GF256_M256 *>(y16);
-
-        const unsigned count = bytes / 32;
-        for (unsigned i = 0; i < count; ++i)
-        {
-            _mm256_storeu_si256(z32 + i,
-                _mm256_xor_si256(
-                    _mm256_loadu_si256(x32 + i),
-                    _mm256_loadu_si256(y32 + i)));
-        }
-
-        bytes -= count * 32;
-        z16 = reinterpret_cast<GF256_M128 *>(z32 + count);
-        x16 = reinterpret_cast<const GF256_M128 *>(x32 + count);
-        y16 = reinterpret_cast<const GF256_M128 *>(y32 + count);
-    }
-    else
-# endif // GF256_TRY_AVX2
     {
         // Handle multiples of 64 bytes
         while (bytes >= 64)
@@ -1101,18 +1688,8 @@ extern "C" void gf256_addset_mem(void * GF256_RESTRICT vz, const void * GF256_RE
     }
 }
 
-extern "C" void gf256_mul_mem(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx, uint8_t y, int bytes)
+static void gf256_mul_mem_generic(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx, uint8_t y, int bytes)
 {
-    // Use a single if-statement to handle special cases
-    if (y <= 1)
-    {
-        if (y == 0)
-            memset(vz, 0, bytes);
-        else if (vz != vx)
-            memcpy(vz, vx, bytes);
-        return;
-    }
-
     GF256_M128 * GF256_RESTRICT z16 = reinterpret_cast<GF256_M128 *>(vz);
     const GF256_M128 * GF256_RESTRICT x16 = reinterpret_cast<const GF256_M128 *>(vx);
 
@@ -1143,64 +1720,7 @@ extern "C" void gf256_mul_mem(void * GF256_RESTRICT vz, const void * GF256_RESTR
         } while (bytes >= 16);
     }
 #endif
-#else
-# if defined(GF256_TRY_AVX2)
-    if (bytes >= 32 && CpuHasAVX2)
-    {
-        // Partial product tables; see above
-        const GF256_M256 table_lo_y = _mm256_loadu_si256(GF256Ctx.MM256.TABLE_LO_Y + y);
-        const GF256_M256 table_hi_y = _mm256_loadu_si256(GF256Ctx.MM256.TABLE_HI_Y + y);
-
-        // clr_mask = 0x0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f
-        const GF256_M256 clr_mask = _mm256_set1_epi8(0x0f);
-
-        GF256_M256 * GF256_RESTRICT z32 = reinterpret_cast<GF256_M256 *>(vz);
-        const GF256_M256 * GF256_RESTRICT x32 = reinterpret_cast<const GF256_M256 *>(vx);
-
-        // Handle multiples of 32 bytes
-        do
-        {
-            // See above comments for details
-            GF256_M256 x0 = _mm256_loadu_si256(x32);
-            GF256_M256 l0 = _mm256_and_si256(x0, clr_mask);
-            x0 = _mm256_srli_epi64(x0, 4);
-            GF256_M256 h0 = _mm256_and_si256(x0, clr_mask);
-            l0 = _mm256_shuffle_epi8(table_lo_y, l0);
-            h0 = _mm256_shuffle_epi8(table_hi_y, h0);
-            _mm256_storeu_si256(z32, _mm256_xor_si256(l0, h0));
-
-            bytes -= 32, ++x32, ++z32;
-        } while (bytes >= 32);
-
-        z16 = reinterpret_cast<GF256_M128 *>(z32);
-        x16 = reinterpret_cast<const GF256_M128 *>(x32);
-    }
-# endif // GF256_TRY_AVX2
-    if (bytes >= 16 && CpuHasSSSE3)
-    {
-        // Partial product tables; see above
-        const GF256_M128 table_lo_y = _mm_loadu_si128(GF256Ctx.MM128.TABLE_LO_Y + y);
-        const GF256_M128 table_hi_y = _mm_loadu_si128(GF256Ctx.MM128.TABLE_HI_Y + y);
-
-        // clr_mask = 0x0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f
-        const GF256_M128 clr_mask = _mm_set1_epi8(0x0f);
-
-        // Handle multiples of 16 bytes
-        do
-        {
-            // See above comments for details
-            GF256_M128 x0 = _mm_loadu_si128(x16);
-            GF256_M128 l0 = _mm_and_si128(x0, clr_mask);
-            x0 = _mm_srli_epi64(x0, 4);
-            GF256_M128 h0 = _mm_and_si128(x0, clr_mask);
-            l0 = _mm_shuffle_epi8(table_lo_y, l0);
-            h0 = _mm_shuffle_epi8(table_hi_y, h0);
-            _mm_storeu_si128(z16, _mm_xor_si128(l0, h0));
-
-            bytes -= 16, ++x16, ++z16;
-        } while (bytes >= 16);
-    }
-#endif
+#endif // GF256_TARGET_MOBILE
 
     uint8_t * GF256_RESTRICT z1 = reinterpret_cast<uint8_t*>(z16);
     const uint8_t * GF256_RESTRICT x1 = reinterpret_cast<const uint8_t*>(x16);
@@ -1265,17 +1785,9 @@ extern "C" void gf256_mul_mem(void * GF256_RESTRICT vz, const void * GF256_RESTR
     }
 }
 
-extern "C" void gf256_muladd_mem(void * GF256_RESTRICT vz, uint8_t y,
-                                 const void * GF256_RESTRICT vx, int bytes)
+static void gf256_muladd_mem_generic(void * GF256_RESTRICT vz, uint8_t y,
+                                     const void * GF256_RESTRICT vx, int bytes)
 {
-    // Use a single if-statement to handle special cases
-    if (y <= 1)
-    {
-        if (y == 1)
-            gf256_add_mem(vz, vx, bytes);
-        return;
-    }
-
     GF256_M128 * GF256_RESTRICT z16 = reinterpret_cast<GF256_M128 *>(vz);
     const GF256_M128 * GF256_RESTRICT x16 = reinterpret_cast<const GF256_M128 *>(vx);
 
@@ -1309,126 +1821,6 @@ extern "C" void gf256_muladd_mem(void * GF256_RESTRICT vz, uint8_t y,
         } while (bytes >= 16);
     }
 #endif
-#else // GF256_TARGET_MOBILE
-# if defined(GF256_TRY_AVX2)
-    if (bytes >= 32 && CpuHasAVX2)
-    {
-        // Partial product tables; see above
-        const GF256_M256 table_lo_y = _mm256_loadu_si256(GF256Ctx.MM256.TABLE_LO_Y + y);
-        const GF256_M256 table_hi_y = _mm256_loadu_si256(GF256Ctx.MM256.TABLE_HI_Y + y);
-
-        // clr_mask = 0x0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f
-        const GF256_M256 clr_mask = _mm256_set1_epi8(0x0f);
-
-        GF256_M256 * GF256_RESTRICT z32 = reinterpret_cast<GF256_M256 *>(z16);
-        const GF256_M256 * GF256_RESTRICT x32 = reinterpret_cast<const GF256_M256 *>(x16);
-
-        // On my Reed Solomon codec, the encoder unit test runs in 640 usec without and 550 usec with the optimization (86% of the original time)
-        const unsigned count = bytes / 64;
-        for (unsigned i = 0; i < count; ++i)
-        {
-            // See above comments for details
-            GF256_M256 x0 = _mm256_loadu_si256(x32 + i * 2);
-            GF256_M256 l0 = _mm256_and_si256(x0, clr_mask);
-            x0 = _mm256_srli_epi64(x0, 4);
-            const GF256_M256 z0 = _mm256_loadu_si256(z32 + i * 2);
-            GF256_M256 h0 = _mm256_and_si256(x0, clr_mask);
-            l0 = _mm256_shuffle_epi8(table_lo_y, l0);
-            h0 = _mm256_shuffle_epi8(table_hi_y, h0);
-            const GF256_M256 p0 = _mm256_xor_si256(l0, h0);
-            _mm256_storeu_si256(z32 + i * 2, _mm256_xor_si256(p0, z0));
-
-            GF256_M256 x1 = _mm256_loadu_si256(x32 + i * 2 + 1);
-            GF256_M256 l1 = _mm256_and_si256(x1, clr_mask);
-            x1 = _mm256_srli_epi64(x1, 4);
-            const GF256_M256 z1 = _mm256_loadu_si256(z32 + i * 2 + 1);
-            GF256_M256 h1 = _mm256_and_si256(x1, clr_mask);
-            l1 = _mm256_shuffle_epi8(table_lo_y, l1);
-            h1 = _mm256_shuffle_epi8(table_hi_y, h1);
-            const GF256_M256 p1 = _mm256_xor_si256(l1, h1);
-            _mm256_storeu_si256(z32 + i * 2 + 1, _mm256_xor_si256(p1, z1));
-        }
-        bytes -= count * 64;
-        z32 += count * 2;
-        x32 += count * 2;
-
-        if (bytes >= 32)
-        {
-            GF256_M256 x0 = _mm256_loadu_si256(x32);
-            GF256_M256 l0 = _mm256_and_si256(x0, clr_mask);
-            x0 = _mm256_srli_epi64(x0, 4);
-            GF256_M256 h0 = _mm256_and_si256(x0, clr_mask);
-            l0 = _mm256_shuffle_epi8(table_lo_y, l0);
-            h0 = _mm256_shuffle_epi8(table_hi_y, h0);
-            const GF256_M256 p0 = _mm256_xor_si256(l0, h0);
-            const GF256_M256 z0 = _mm256_loadu_si256(z32);
-            _mm256_storeu_si256(z32, _mm256_xor_si256(p0, z0));
-
-            bytes -= 32;
-            z32++;
-            x32++;
-        }
-
-        z16 = reinterpret_cast<GF256_M128 *>(z32);
-        x16 = reinterpret_cast<const GF256_M128 *>(x32);
-    }
-# endif // GF256_TRY_AVX2
-    if (bytes >= 16 && CpuHasSSSE3)
-    {
-        // Partial product tables; see above
-        const GF256_M128 table_lo_y = _mm_loadu_si128(GF256Ctx.MM128.TABLE_LO_Y + y);
-        const GF256_M128 table_hi_y = _mm_loadu_si128(GF256Ctx.MM128.TABLE_HI_Y + y);
-
-        // clr_mask = 0x0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f0f
-        const GF256_M128 clr_mask = _mm_set1_epi8(0x0f);
-
-        // This unroll seems to provide about 7% speed boost when AVX2 is disabled
-        while (bytes >= 32)
-        {
-            bytes -= 32;
-
-            GF256_M128 x1 = _mm_loadu_si128(x16 + 1);
-            GF256_M128 l1 = _mm_and_si128(x1, clr_mask);
-            x1 = _mm_srli_epi64(x1, 4);
-            GF256_M128 h1 = _mm_and_si128(x1, clr_mask);
-            l1 = _mm_shuffle_epi8(table_lo_y, l1);
-            h1 = _mm_shuffle_epi8(table_hi_y, h1);
-            const GF256_M128 z1 = _mm_loadu_si128(z16 + 1);
-
-            GF256_M128 x0 = _mm_loadu_si128(x16);
-            GF256_M128 l0 = _mm_and_si128(x0, clr_mask);
-            x0 = _mm_srli_epi64(x0, 4);
-            GF256_M128 h0 = _mm_and_si128(x0, clr_mask);
-            l0 = _mm_shuffle_epi8(table_lo_y, l0);
-            h0 = _mm_shuffle_epi8(table_hi_y, h0);
-            const GF256_M128 z0 = _mm_loadu_si128(z16);
-
-            const GF256_M128 p1 = _mm_xor_si128(l1, h1);
-            _mm_storeu_si128(z16 + 1, _mm_xor_si128(p1, z1));
-
-            const GF256_M128 p0 = _mm_xor_si128(l0, h0);
-            _mm_storeu_si128(z16, _mm_xor_si128(p0, z0));
-
-            x16 += 2, z16 += 2;
-        }
-
-        // Handle multiples of 16 bytes
-        while (bytes >= 16)
-        {
-            // See above comments for details
-            GF256_M128 x0 = _mm_loadu_si128(x16);
-            GF256_M128 l0 = _mm_and_si128(x0, clr_mask);
-            x0 = _mm_srli_epi64(x0, 4);
-            GF256_M128 h0 = _mm_and_si128(x0, clr_mask);
-            l0 = _mm_shuffle_epi8(table_lo_y, l0);
-            h0 = _mm_shuffle_epi8(table_hi_y, h0);
-            const GF256_M128 p0 = _mm_xor_si128(l0, h0);
-            const GF256_M128 z0 = _mm_loadu_si128(z16);
-            _mm_storeu_si128(z16, _mm_xor_si128(p0, z0));
-
-            bytes -= 16, ++x16, ++z16;
-        }
-    }
 #endif // GF256_TARGET_MOBILE
 
     uint8_t * GF256_RESTRICT z1 = reinterpret_cast<uint8_t*>(z16);
@@ -1494,6 +1886,364 @@ extern "C" void gf256_muladd_mem(void * GF256_RESTRICT vz, uint8_t y,
     }
 }
 
+
+//------------------------------------------------------------------------------
+// Kernel Table
+
+/*
+    The exported bulk operations call through a table of function pointers
+    that is filled in once by gf256_select_kernels() during gf256_init() and
+    again by gf256_set_isa(), rather than testing the CpuHas* flags on every
+    call.  Each entry finishes the whole buffer by itself.
+
+    The *X32 entries are for lengths that are a multiple of 32 bytes and go
+    straight to the vector loops without the remainder handling.  The AVX-512
+    functions already finish with a single masked vector, so they serve both.
+
+    The *A64 entries also require 64-byte aligned pointers and a multiple of
+    64 bytes.  AVX-512 has aligned kernels for them; the narrower paths reuse
+    the *X32 entries, since no vector crosses a cache line either way.
+*/
+
+#if !defined(GF256_TARGET_MOBILE)
+
+static GF256_TARGET_SSSE3 void gf256_mul_mem_ssse3(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx, uint8_t y, int bytes)
+{
+    const int done = gf256_mul_mem_ssse3_loop(vz, vx, y, bytes);
+    if (done < bytes)
+        gf256_mul_mem_generic(gf256_advance(vz, done), gf256_advance(vx, done), y, bytes - done);
+}
+
+static GF256_TARGET_SSSE3 void gf256_muladd_mem_ssse3(void * GF256_RESTRICT vz, uint8_t y, const void * GF256_RESTRICT vx, int bytes)
+{
+    const int done = gf256_muladd_mem_ssse3_loop(vz, y, vx, bytes);
+    if (done < bytes)
+        gf256_muladd_mem_generic(gf256_advance(vz, done), y, gf256_advance(vx, done), bytes - done);
+}
+
+static GF256_TARGET_SSSE3 void gf256_mul_mem_ssse3_x32(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx, uint8_t y, int bytes)
+{
+    gf256_mul_mem_ssse3_loop(vz, vx, y, bytes);
+}
+
+static GF256_TARGET_SSSE3 void gf256_muladd_mem_ssse3_x32(void * GF256_RESTRICT vz, uint8_t y, const void * GF256_RESTRICT vx, int bytes)
+{
+    gf256_muladd_mem_ssse3_loop(vz, y, vx, bytes);
+}
+
+#ifdef GF256_TRY_AVX2
+
+static GF256_TARGET_AVX2 void gf256_add_mem_avx2(void * GF256_RESTRICT vx, const void * GF256_RESTRICT vy, int bytes)
+{
+    const int done = gf256_add_mem_avx2_loop(vx, vy, bytes);
+    if (done < bytes)
+        gf256_add_mem_generic(gf256_advance(vx, done), gf256_advance(vy, done), bytes - done);
+}
+
+static GF256_TARGET_AVX2 void gf256_add2_mem_avx2(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                                                   const void * GF256_RESTRICT vy, int bytes)
+{
+    const int done = gf256_add2_mem_avx2_loop(vz, vx, vy, bytes);
+    if (done < bytes)
+        gf256_add2_mem_generic(gf256_advance(vz, done), gf256_advance(vx, done), gf256_advance(vy, done), bytes - done);
+}
+
+static GF256_TARGET_AVX2 void gf256_addset_mem_avx2(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                                                     const void * GF256_RESTRICT vy, int bytes)
+{
+    const int done = gf256_addset_mem_avx2_loop(vz, vx, vy, bytes);
+    if (done < bytes)
+        gf256_addset_mem_generic(gf256_advance(vz, done), gf256_advance(vx, done), gf256_advance(vy, done), bytes - done);
+}
+
+// The multiply remainder may still hold one 16-byte vector for SSSE3
+
+static GF256_TARGET_AVX2 void gf256_mul_mem_avx2(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx, uint8_t y, int bytes)
+{
+    const int done = gf256_mul_mem_avx2_loop(vz, vx, y, bytes);
+    if (done < bytes)
+        gf256_mul_mem_ssse3(gf256_advance(vz, done), gf256_advance(vx, done), y, bytes - done);
+}
+
+static GF256_TARGET_AVX2 void gf256_muladd_mem_avx2(void * GF256_RESTRICT vz, uint8_t y, const void * GF256_RESTRICT vx, int bytes)
+{
+    const int done = gf256_muladd_mem_avx2_loop(vz, y, vx, bytes);
+    if (done < bytes)
+        gf256_muladd_mem_ssse3(gf256_advance(vz, done), y, gf256_advance(vx, done), bytes - done);
+}
+
+static GF256_TARGET_AVX2 void gf256_add_mem_avx2_x32(void * GF256_RESTRICT vx, const void * GF256_RESTRICT vy, int bytes)
+{
+    gf256_add_mem_avx2_loop(vx, vy, bytes);
+}
+
+static GF256_TARGET_AVX2 void gf256_add2_mem_avx2_x32(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                                                       const void * GF256_RESTRICT vy, int bytes)
+{
+    gf256_add2_mem_avx2_loop(vz, vx, vy, bytes);
+}
+
+static GF256_TARGET_AVX2 void gf256_addset_mem_avx2_x32(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                                                         const void * GF256_RESTRICT vy, int bytes)
+{
+    gf256_addset_mem_avx2_loop(vz, vx, vy, bytes);
+}
+
+static GF256_TARGET_AVX2 void gf256_mul_mem_avx2_x32(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx, uint8_t y, int bytes)
+{
+    gf256_mul_mem_avx2_loop(vz, vx, y, bytes);
+}
+
+static GF256_TARGET_AVX2 void gf256_muladd_mem_avx2_x32(void * GF256_RESTRICT vz, uint8_t y, const void * GF256_RESTRICT vx, int bytes)
+{
+    gf256_muladd_mem_avx2_loop(vz, y, vx, bytes);
+}
+
+#endif // GF256_TRY_AVX2
+
+#endif // GF256_TARGET_MOBILE
+
+typedef void (*gf256_add_mem_t)(void * GF256_RESTRICT vx, const void * GF256_RESTRICT vy, int bytes);
+typedef void (*gf256_add2_mem_t)(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                                 const void * GF256_RESTRICT vy, int bytes);
+typedef void (*gf256_mul_mem_t)(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx, uint8_t y, int bytes);
+typedef void (*gf256_muladd_mem_t)(void * GF256_RESTRICT vz, uint8_t y, const void * GF256_RESTRICT vx, int bytes);
+
+struct gf256_kernels
+{
+    gf256_add_mem_t AddMem, AddMemX32;
+    gf256_add2_mem_t Add2Mem, Add2MemX32;
+    gf256_add2_mem_t AddsetMem, AddsetMemX32;
+    gf256_mul_mem_t MulMem, MulMemX32;
+    gf256_muladd_mem_t MuladdMem, MuladdMemX32;
+
+    gf256_add_mem_t AddMemA64;
+    gf256_add2_mem_t Add2MemA64, AddsetMemA64;
+    gf256_mul_mem_t MulMemA64;
+    gf256_muladd_mem_t MuladdMemA64;
+};
+
+// Generic kernels are safe to call before gf256_init() selects the others
+static gf256_kernels GF256Kernels = {
+    gf256_add_mem_generic, gf256_add_mem_generic,
+    gf256_add2_mem_generic, gf256_add2_mem_generic,
+    gf256_addset_mem_generic, gf256_addset_mem_generic,
+    gf256_mul_mem_generic, gf256_mul_mem_generic,
+    gf256_muladd_mem_generic, gf256_muladd_mem_generic,
+    gf256_add_mem_generic, gf256_add2_mem_generic, gf256_addset_mem_generic,
+    gf256_mul_mem_generic, gf256_muladd_mem_generic
+};
+
+// Fill in the kernel table from the CpuHas* flags
+static void gf256_select_kernels()
+{
+    gf256_kernels kernels = {
+        gf256_add_mem_generic, gf256_add_mem_generic,
+        gf256_add2_mem_generic, gf256_add2_mem_generic,
+        gf256_addset_mem_generic, gf256_addset_mem_generic,
+        gf256_mul_mem_generic, gf256_mul_mem_generic,
+        gf256_muladd_mem_generic, gf256_muladd_mem_generic,
+        gf256_add_mem_generic, gf256_add2_mem_generic, gf256_addset_mem_generic,
+        gf256_mul_mem_generic, gf256_muladd_mem_generic
+    };
+
+#if !defined(GF256_TARGET_MOBILE)
+    if (CpuHasSSSE3)
+    {
+        kernels.MulMem = gf256_mul_mem_ssse3;
+        kernels.MulMemX32 = gf256_mul_mem_ssse3_x32;
+        kernels.MuladdMem = gf256_muladd_mem_ssse3;
+        kernels.MuladdMemX32 = gf256_muladd_mem_ssse3_x32;
+    }
+# if defined(GF256_TRY_AVX2)
+    if (CpuHasAVX2)
+    {
+        kernels.AddMem = gf256_add_mem_avx2;
+        kernels.AddMemX32 = gf256_add_mem_avx2_x32;
+        kernels.Add2Mem = gf256_add2_mem_avx2;
+        kernels.Add2MemX32 = gf256_add2_mem_avx2_x32;
+        kernels.AddsetMem = gf256_addset_mem_avx2;
+        kernels.AddsetMemX32 = gf256_addset_mem_avx2_x32;
+        kernels.MulMem = gf256_mul_mem_avx2;
+        kernels.MulMemX32 = gf256_mul_mem_avx2_x32;
+        kernels.MuladdMem = gf256_muladd_mem_avx2;
+        kernels.MuladdMemX32 = gf256_muladd_mem_avx2_x32;
+    }
+# endif // GF256_TRY_AVX2
+# if defined(GF256_TRY_AVX512)
+    if (CpuHasAVX512)
+    {
+        kernels.AddMem = kernels.AddMemX32 = gf256_add_mem_avx512;
+        kernels.Add2Mem = kernels.Add2MemX32 = gf256_add2_mem_avx512;
+        kernels.AddsetMem = kernels.AddsetMemX32 = gf256_addset_mem_avx512;
+        kernels.MulMem = kernels.MulMemX32 = gf256_mul_mem_avx512;
+        kernels.MuladdMem = kernels.MuladdMemX32 = gf256_muladd_mem_avx512;
+    }
+# endif // GF256_TRY_AVX512
+#endif // GF256_TARGET_MOBILE
+
+    kernels.AddMemA64 = kernels.AddMemX32;
+    kernels.Add2MemA64 = kernels.Add2MemX32;
+    kernels.AddsetMemA64 = kernels.AddsetMemX32;
+    kernels.MulMemA64 = kernels.MulMemX32;
+    kernels.MuladdMemA64 = kernels.MuladdMemX32;
+
+#if defined(GF256_TRY_AVX512)
+    if (CpuHasAVX512)
+    {
+        kernels.AddMemA64 = gf256_add_mem_avx512_a64;
+        kernels.Add2MemA64 = gf256_add2_mem_avx512_a64;
+        kernels.AddsetMemA64 = gf256_addset_mem_avx512_a64;
+        kernels.MulMemA64 = gf256_mul_mem_avx512_a64;
+        kernels.MuladdMemA64 = gf256_muladd_mem_avx512_a64;
+    }
+#endif // GF256_TRY_AVX512
+
+    GF256Kernels = kernels;
+}
+
+
+//------------------------------------------------------------------------------
+// Exported Operations
+
+extern "C" void gf256_add_mem(void * GF256_RESTRICT vx,
+                              const void * GF256_RESTRICT vy, int bytes)
+{
+    GF256Kernels.AddMem(vx, vy, bytes);
+}
+
+extern "C" void gf256_add2_mem(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                               const void * GF256_RESTRICT vy, int bytes)
+{
+    GF256Kernels.Add2Mem(vz, vx, vy, bytes);
+}
+
+extern "C" void gf256_addset_mem(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                                 const void * GF256_RESTRICT vy, int bytes)
+{
+    GF256Kernels.AddsetMem(vz, vx, vy, bytes);
+}
+
+extern "C" void gf256_mul_mem(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx, uint8_t y, int bytes)
+{
+    // Use a single if-statement to handle special cases
+    if (y <= 1)
+    {
+        if (y == 0)
+            memset(vz, 0, bytes);
+        else if (vz != vx)
+            memcpy(vz, vx, bytes);
+        return;
+    }
+
+    GF256Kernels.MulMem(vz, vx, y, bytes);
+}
+
+extern "C" void gf256_muladd_mem(void * GF256_RESTRICT vz, uint8_t y,
+                                 const void * GF256_RESTRICT vx, int bytes)
+{
+    // Use a single if-statement to handle special cases
+    if (y <= 1)
+    {
+        if (y == 1)
+            GF256Kernels.AddMem(vz, vx, bytes);
+        return;
+    }
+
+    GF256Kernels.MuladdMem(vz, y, vx, bytes);
+}
+
+extern "C" void gf256_add_mem_x32(void * GF256_RESTRICT vx,
+                                  const void * GF256_RESTRICT vy, int bytes)
+{
+    GF256Kernels.AddMemX32(vx, vy, bytes);
+}
+
+extern "C" void gf256_add2_mem_x32(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                                   const void * GF256_RESTRICT vy, int bytes)
+{
+    GF256Kernels.Add2MemX32(vz, vx, vy, bytes);
+}
+
+extern "C" void gf256_addset_mem_x32(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                                     const void * GF256_RESTRICT vy, int bytes)
+{
+    GF256Kernels.AddsetMemX32(vz, vx, vy, bytes);
+}
+
+extern "C" void gf256_mul_mem_x32(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx, uint8_t y, int bytes)
+{
+    if (y <= 1)
+    {
+        if (y == 0)
+            memset(vz, 0, bytes);
+        else if (vz != vx)
+            memcpy(vz, vx, bytes);
+        return;
+    }
+
+    GF256Kernels.MulMemX32(vz, vx, y, bytes);
+}
+
+extern "C" void gf256_muladd_mem_x32(void * GF256_RESTRICT vz, uint8_t y,
+                                     const void * GF256_RESTRICT vx, int bytes)
+{
+    if (y <= 1)
+    {
+        if (y == 1)
+            GF256Kernels.AddMemX32(vz, vx, bytes);
+        return;
+    }
+
+    GF256Kernels.MuladdMemX32(vz, y, vx, bytes);
+}
+
+extern "C" void gf256_add_mem_a64(void * GF256_RESTRICT vx,
+                                  const void * GF256_RESTRICT vy, int bytes)
+{
+    GF256Kernels.AddMemA64(vx, vy, bytes);
+}
+
+extern "C" void gf256_add2_mem_a64(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                                   const void * GF256_RESTRICT vy, int bytes)
+{
+    GF256Kernels.Add2MemA64(vz, vx, vy, bytes);
+}
+
+extern "C" void gf256_addset_mem_a64(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                                     const void * GF256_RESTRICT vy, int bytes)
+{
+    GF256Kernels.AddsetMemA64(vz, vx, vy, bytes);
+}
+
+extern "C" void gf256_mul_mem_a64(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx, uint8_t y, int bytes)
+{
+    if (y <= 1)
+    {
+        if (y == 0)
+            memset(vz, 0, bytes);
+        else if (vz != vx)
+            memcpy(vz, vx, bytes);
+        return;
+    }
+
+    GF256Kernels.MulMemA64(vz, vx, y, bytes);
+}
+
+extern "C" void gf256_muladd_mem_a64(void * GF256_RESTRICT vz, uint8_t y,
+                                     const void * GF256_RESTRICT vx, int bytes)
+{
+    if (y <= 1)
+    {
+        if (y == 1)
+            GF256Kernels.AddMemA64(vz, vx, bytes);
+        return;
+    }
+
+    GF256Kernels.MuladdMemA64(vz, y, vx, bytes);
+}
+
+
 extern "C" void gf256_memswap(void * GF256_RESTRICT vx, void * GF256_RESTRICT vy, int bytes)
 {
 #if defined(GF256_TARGET_MOBILE)
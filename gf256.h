@@ -57,7 +57,13 @@
     #define GF256_TARGET_MOBILE
 #endif // ANDROID
 
-#if defined(__AVX2__) || (defined (_MSC_VER) && _MSC_VER >= 1900)
+// The wider x86 kernels are compiled with per-function target attributes
+// and selected at runtime, so they do not need -mavx2 or -march flags
+#if !defined(GF256_TARGET_MOBILE) && defined(__GNUC__)
+    #define GF256_TRY_AVX512 /* 512-bit, AVX-512F + AVX-512BW */
+#endif
+
+#if (!defined(GF256_TARGET_MOBILE) && defined(__GNUC__)) || defined(__AVX2__) || (defined (_MSC_VER) && _MSC_VER >= 1900)
     #define GF256_TRY_AVX2 /* 256-bit */
     #include <immintrin.h>
     #define GF256_ALIGN_BYTES 32
@@ -69,6 +75,7 @@
     // Note: MSVC currently only supports SSSE3 but not AVX2
     #include <tmmintrin.h> // SSSE3: _mm_shuffle_epi8
     #include <emmintrin.h> // SSE2
+    #include <immintrin.h> // AVX2, AVX-512
 #endif // GF256_TARGET_MOBILE
 
 #if defined(HAVE_ARM_NEON_H)
@@ -201,6 +208,35 @@ extern int gf256_init_(int version);
 #define gf256_init() gf256_init_(GF256_VERSION)
 
 
+//------------------------------------------------------------------------------
+// Instruction Set Selection
+
+/// Bulk memory operation code paths.
+/// GENERIC is the fallback path: on x86 the XOR operations still use SSE2
+/// but multiplication is done with 8-bit table lookups.
+#define GF256_ISA_GENERIC 0
+#define GF256_ISA_SSSE3   1
+#define GF256_ISA_AVX2    2
+#define GF256_ISA_NEON    3
+#define GF256_ISA_AVX512  4
+
+/// Returns the GF256_ISA_* path currently used by the bulk memory operations
+extern int gf256_get_isa();
+
+/**
+    Limit the bulk memory operations to the given GF256_ISA_* path or lower.
+
+    This is intended for benchmarking and testing the slower code paths.
+    It can never enable instructions the CPU does not support, and passing
+    GF256_ISA_AVX512 restores the detected feature set.  On mobile targets the
+    selection is fixed at init time and this call has no effect.
+
+    Must be called after gf256_init() and not while other threads are using
+    the library.  Returns the path that is in effect after the call.
+*/
+extern int gf256_set_isa(int isa);
+
+
 //------------------------------------------------------------------------------
 // Math Operations
 
@@ -269,6 +305,61 @@ static GF256_FORCE_INLINE void gf256_div_mem(void * GF256_RESTRICT vz,
 }
 
 
+//------------------------------------------------------------------------------
+// Bulk Memory Math Operations: 32-Byte Multiples
+
+/*
+    Same as the operations above, but the caller guarantees that bytes is a
+    multiple of 32 (zero is allowed).  The vector kernels are called directly
+    without the code that handles a partial final vector.
+
+    Passing any other length is undefined: the final bytes may be skipped.
+*/
+
+extern void gf256_add_mem_x32(void * GF256_RESTRICT vx,
+                              const void * GF256_RESTRICT vy, int bytes);
+
+extern void gf256_add2_mem_x32(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                               const void * GF256_RESTRICT vy, int bytes);
+
+extern void gf256_addset_mem_x32(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                                 const void * GF256_RESTRICT vy, int bytes);
+
+extern void gf256_mul_mem_x32(void * GF256_RESTRICT vz,
+                              const void * GF256_RESTRICT vx, uint8_t y, int bytes);
+
+extern void gf256_muladd_mem_x32(void * GF256_RESTRICT vz, uint8_t y,
+                                 const void * GF256_RESTRICT vx, int bytes);
+
+
+//------------------------------------------------------------------------------
+// Bulk Memory Math Operations: Aligned Cache Lines
+
+/*
+    Same as the operations above, but every pointer must be aligned to 64
+    bytes and bytes must be a multiple of 64 (zero is allowed), as for the
+    buffers from longhair_alloc_blocks().  Every vector is then one whole
+    cache line, and the AVX-512 path uses aligned loads with no tail code.
+
+    Passing anything else is undefined and may fault.
+*/
+
+extern void gf256_add_mem_a64(void * GF256_RESTRICT vx,
+                              const void * GF256_RESTRICT vy, int bytes);
+
+extern void gf256_add2_mem_a64(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                               const void * GF256_RESTRICT vy, int bytes);
+
+extern void gf256_addset_mem_a64(void * GF256_RESTRICT vz, const void * GF256_RESTRICT vx,
+                                 const void * GF256_RESTRICT vy, int bytes);
+
+extern void gf256_mul_mem_a64(void * GF256_RESTRICT vz,
+                              const void * GF256_RESTRICT vx, uint8_t y, int bytes);
+
+extern void gf256_muladd_mem_a64(void * GF256_RESTRICT vz, uint8_t y,
+                                 const void * GF256_RESTRICT vx, int bytes);
+
+
 //------------------------------------------------------------------------------
 // Misc Operations
 
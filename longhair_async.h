@@ -0,0 +1,205 @@
+/** \file
+    \brief Longhair: Coroutine Awaitables for the Worker Pool
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+/**
+    Awaitable encode/decode for C++20 coroutines
+
+    Inside a coroutine, co_await longhair::EncodeAsync() or DecodeAsync()
+    runs the job on a WorkerPool and resumes the coroutine when it is done,
+    so a large encode does not hold up the thread running the event loop:
+
+        longhair::EncodeJob job;
+        job.K = k, job.M = m, job.BlockBytes = bytes;
+        job.DataPtrs = dataPtrs;
+        job.Recovery = recovery;
+        int result = co_await longhair::EncodeAsync(pool, job);
+
+    Small jobs are not worth a trip to another thread: a job with at most
+    InlineBytes of original data runs right away on the calling thread and
+    the coroutine does not suspend at all.
+
+    By default the coroutine resumes on the worker thread that ran the job.
+    To get back onto the event loop instead, set AsyncOptions::Resume to a
+    function that posts the coroutine handle to it.
+
+    Only available when the compiler supports coroutines (-std=c++20).
+*/
+
+#include "longhair_pool.h"
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+    #define LONGHAIR_HAS_COROUTINES
+#endif
+#endif
+
+#ifdef LONGHAIR_HAS_COROUTINES
+
+#include <coroutine>
+
+namespace longhair {
+
+
+//------------------------------------------------------------------------------
+// Options
+
+/// Default inline threshold: a few network packets worth of data
+static const int kDefaultInlineBytes = 16 * 1024;
+
+/// Resumes a suspended coroutine.  Called on a worker thread
+typedef std::function<void(std::coroutine_handle<> handle)> ResumeT;
+
+struct AsyncOptions
+{
+    /// Jobs with at most this many bytes of original data (K * BlockBytes)
+    /// run inline on the calling thread.  0 = always use the pool
+    int InlineBytes = kDefaultInlineBytes;
+
+    /// Empty = resume on the worker thread
+    ResumeT Resume;
+};
+
+/// Per-thread workspace for jobs that run inline
+inline CauchyWorkspace* GetInlineWorkspace()
+{
+    struct Holder
+    {
+        CauchyWorkspace* Workspace = cauchy_256_workspace_create();
+        ~Holder()
+        {
+            cauchy_256_workspace_free(Workspace);
+        }
+    };
+    thread_local Holder holder;
+    return holder.Workspace;
+}
+
+
+//------------------------------------------------------------------------------
+// CodecAwaitable
+
+/// Awaitable returned by EncodeAsync() and DecodeAsync().  co_await gives
+/// the codec return value: 0 on success
+class CodecAwaitable
+{
+public:
+    CodecAwaitable(WorkerPool& pool, const EncodeJob& job, const AsyncOptions& options)
+        : Pool(pool)
+        , IsEncode(true)
+        , Encode(job)
+        , Options(options)
+    {
+    }
+
+    CodecAwaitable(WorkerPool& pool, const DecodeJob& job, const AsyncOptions& options)
+        : Pool(pool)
+        , IsEncode(false)
+        , Decode(job)
+        , Options(options)
+    {
+    }
+
+    /// Runs small jobs, and every job if the pool is not started, inline
+    bool await_ready()
+    {
+        const int k = IsEncode ? Encode.K : Decode.K;
+        const int blockBytes = IsEncode ? Encode.BlockBytes : Decode.BlockBytes;
+
+        if (Pool.GetThreadCount() > 0 && (int64_t)k * blockBytes > Options.InlineBytes)
+            return false;
+
+        CauchyWorkspace* workspace = GetInlineWorkspace();
+        if (IsEncode)
+            Result = cauchy_256_encode_ws(workspace, Encode.K, Encode.M, Encode.DataPtrs, Encode.Recovery, Encode.BlockBytes);
+        else
+            Result = cauchy_256_decode_ws(workspace, Decode.K, Decode.M, Decode.Blocks, Decode.BlockBytes);
+        return true;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        // The coroutine may resume, and destroy this object, on another
+        // thread before Encode()/Decode() returns or while Resume is still
+        // running, so the completion keeps its own copy of Resume
+        CompletionT completion = [this, handle, resume = Options.Resume](int result) {
+            Result = result;
+            if (resume)
+                resume(handle);
+            else
+                handle.resume();
+        };
+
+        if (IsEncode)
+            Pool.Encode(Encode, std::move(completion));
+        else
+            Pool.Decode(Decode, std::move(completion));
+    }
+
+    int await_resume() const
+    {
+        return Result;
+    }
+
+protected:
+    WorkerPool& Pool;
+    bool IsEncode;
+    EncodeJob Encode;
+    DecodeJob Decode;
+    AsyncOptions Options;
+    int Result = -1;
+};
+
+
+//------------------------------------------------------------------------------
+// API
+
+/// co_await EncodeAsync(pool, job) encodes on the pool and gives the
+/// cauchy_256_encode() return value.  The job memory must stay valid until
+/// the coroutine resumes
+inline CodecAwaitable EncodeAsync(WorkerPool& pool, const EncodeJob& job,
+    const AsyncOptions& options = AsyncOptions())
+{
+    return CodecAwaitable(pool, job, options);
+}
+
+/// co_await DecodeAsync(pool, job) decodes on the pool and gives the
+/// cauchy_256_decode() return value.  The job memory must stay valid until
+/// the coroutine resumes
+inline CodecAwaitable DecodeAsync(WorkerPool& pool, const DecodeJob& job,
+    const AsyncOptions& options = AsyncOptions())
+{
+    return CodecAwaitable(pool, job, options);
+}
+
+
+} // namespace longhair
+
+#endif // LONGHAIR_HAS_COROUTINES
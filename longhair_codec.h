@@ -0,0 +1,368 @@
+/** \file
+    \brief Longhair: C++ Encoder and Decoder
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+/**
+    C++ interface to the codec
+
+    longhair::Encoder and longhair::Decoder wrap cauchy_256_encode_ws() and
+    cauchy_256_decode_ws().  Each one owns a CauchyWorkspace reserved for
+    its parameters and fixed-size pointer/Block tables, so after
+    Initialize() no call allocates, and the code does the same work as the
+    best hand-written use of the C API.
+
+    Buffers are passed as spans of bytes and never copied: the encoder
+    reads the data where it is and writes recovery data straight into the
+    caller's buffer, and the decoder repairs the blocks it was given in
+    place.  The objects are move-only, so the workspace changes hands
+    instead of being duplicated.
+
+    Example:
+
+        longhair::Encoder encoder;
+        encoder.Initialize(k, m, blockBytes);
+        encoder.Encode(data, recovery);   // k * blockBytes -> m * blockBytes
+
+        longhair::Decoder decoder;
+        decoder.Initialize(k, m, blockBytes);
+        for (each received block)
+            decoder.Add(row, block);      // stops at k blocks
+        if (decoder.Decode())
+            use decoder.GetOriginal(0) .. decoder.GetOriginal(k - 1);
+
+    Uses std::span with C++20, or a minimal span with the same interface
+    with C++17.
+*/
+
+#if __cplusplus < 201703L && !(defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+    #error "longhair_codec.h requires C++17 or newer"
+#endif
+
+#include "cauchy_256.h"
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#if defined(__has_include)
+#if __has_include(<span>) && __cplusplus >= 202002L
+    #include <span>
+    #define LONGHAIR_HAS_STD_SPAN
+#endif
+#endif
+
+namespace longhair {
+
+
+//------------------------------------------------------------------------------
+// Span
+
+#ifdef LONGHAIR_HAS_STD_SPAN
+
+template<typename T> using Span = std::span<T>;
+
+#else // LONGHAIR_HAS_STD_SPAN
+
+/// Subset of std::span for C++17
+template<typename T> class Span
+{
+public:
+    constexpr Span() noexcept = default;
+    constexpr Span(T* data, size_t size) noexcept
+        : Data(data)
+        , Size(size)
+    {
+    }
+    template<typename U, typename = typename std::enable_if<
+        std::is_convertible<decltype(std::declval<U&>().data()), T*>::value>::type>
+    constexpr Span(U& container) noexcept
+        : Data(container.data())
+        , Size(container.size())
+    {
+    }
+    template<typename U, typename = typename std::enable_if<
+        std::is_convertible<U*, T*>::value>::type>
+    constexpr Span(const Span<U>& other) noexcept
+        : Data(other.data())
+        , Size(other.size())
+    {
+    }
+
+    constexpr T* data() const noexcept { return Data; }
+    constexpr size_t size() const noexcept { return Size; }
+    constexpr bool empty() const noexcept { return Size == 0; }
+    constexpr T& operator[](size_t i) const noexcept { return Data[i]; }
+    constexpr T* begin() const noexcept { return Data; }
+    constexpr T* end() const noexcept { return Data + Size; }
+    constexpr Span subspan(size_t offset, size_t count) const noexcept
+    {
+        return Span(Data + offset, count);
+    }
+
+protected:
+    T* Data = nullptr;
+    size_t Size = 0;
+};
+
+#endif // LONGHAIR_HAS_STD_SPAN
+
+typedef Span<const std::byte> ConstBytes;
+typedef Span<std::byte> MutableBytes;
+
+
+//------------------------------------------------------------------------------
+// Workspace
+
+/// Move-only owner of a CauchyWorkspace
+class Workspace
+{
+public:
+    Workspace() = default;
+    ~Workspace()
+    {
+        cauchy_256_workspace_free(Handle);
+    }
+
+    Workspace(Workspace&& other) noexcept
+        : Handle(std::exchange(other.Handle, nullptr))
+    {
+    }
+    Workspace& operator=(Workspace&& other) noexcept
+    {
+        std::swap(Handle, other.Handle);
+        return *this;
+    }
+    Workspace(const Workspace&) = delete;
+    Workspace& operator=(const Workspace&) = delete;
+
+    /// Create the workspace if needed and grow it to fit the parameters.
+    /// Returns false if out of memory
+    bool Reserve(int k, int m, int blockBytes)
+    {
+        if (!Handle)
+            Handle = cauchy_256_workspace_create();
+        return Handle && cauchy_256_workspace_reserve(Handle, k, m, blockBytes) == 0;
+    }
+
+    CauchyWorkspace* Get() const
+    {
+        return Handle;
+    }
+
+protected:
+    CauchyWorkspace* Handle = nullptr;
+};
+
+/// Returns true if the code parameters are usable
+inline bool IsValidCode(int k, int m, int blockBytes)
+{
+    return k > 0 && m > 0 && k + m <= 256 && blockBytes > 0 && blockBytes % 8 == 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Encoder
+
+class Encoder
+{
+public:
+    Encoder() = default;
+    Encoder(Encoder&&) noexcept = default;
+    Encoder& operator=(Encoder&&) noexcept = default;
+    Encoder(const Encoder&) = delete;
+    Encoder& operator=(const Encoder&) = delete;
+
+    /// Set the code parameters and reserve the workspace.
+    /// cauchy_256_init() must have been called.
+    /// Returns false on invalid parameters or out of memory
+    bool Initialize(int k, int m, int blockBytes)
+    {
+        if (!IsValidCode(k, m, blockBytes) || !Scratch.Reserve(k, m, blockBytes))
+            return false;
+        K = k, M = m, BlockBytes = blockBytes;
+        return true;
+    }
+
+    /// Encode k blocks stored end to end in data (k * BlockBytes) into m
+    /// recovery blocks stored end to end in recovery (m * BlockBytes).
+    /// Returns false if the sizes do not match or the encoder failed
+    bool Encode(ConstBytes data, MutableBytes recovery)
+    {
+        if (K == 0 || data.size() != (size_t)K * BlockBytes)
+            return false;
+        for (int ii = 0; ii < K; ++ii)
+            DataPtrs[ii] = reinterpret_cast<const unsigned char*>(data.data()) + (size_t)ii * BlockBytes;
+        return EncodePtrs(recovery);
+    }
+
+    /// Encode k separate blocks of BlockBytes each
+    bool Encode(Span<const ConstBytes> blocks, MutableBytes recovery)
+    {
+        if (K == 0 || blocks.size() != (size_t)K)
+            return false;
+        for (int ii = 0; ii < K; ++ii)
+        {
+            if (blocks[ii].size() != (size_t)BlockBytes)
+                return false;
+            DataPtrs[ii] = reinterpret_cast<const unsigned char*>(blocks[ii].data());
+        }
+        return EncodePtrs(recovery);
+    }
+
+    int GetK() const { return K; }
+    int GetM() const { return M; }
+    int GetBlockBytes() const { return BlockBytes; }
+
+protected:
+    int K = 0, M = 0, BlockBytes = 0;
+    Workspace Scratch;
+    const unsigned char* DataPtrs[256];
+
+    bool EncodePtrs(MutableBytes recovery)
+    {
+        if (recovery.size() != (size_t)M * BlockBytes)
+            return false;
+        return 0 == cauchy_256_encode_ws(Scratch.Get(), K, M, DataPtrs, recovery.data(), BlockBytes);
+    }
+};
+
+
+//------------------------------------------------------------------------------
+// Decoder
+
+class Decoder
+{
+public:
+    Decoder() = default;
+    Decoder(Decoder&&) noexcept = default;
+    Decoder& operator=(Decoder&&) noexcept = default;
+    Decoder(const Decoder&) = delete;
+    Decoder& operator=(const Decoder&) = delete;
+
+    /// Set the code parameters and reserve the workspace.
+    /// cauchy_256_init() must have been called.
+    /// Returns false on invalid parameters or out of memory
+    bool Initialize(int k, int m, int blockBytes)
+    {
+        if (!IsValidCode(k, m, blockBytes) || !Scratch.Reserve(k, m, blockBytes))
+            return false;
+        K = k, M = m, BlockBytes = blockBytes;
+        Reset();
+        return true;
+    }
+
+    /// Forget the blocks added so far, to start on the next stripe
+    void Reset()
+    {
+        Count = 0;
+        Decoded = false;
+        for (unsigned ii = 0; ii < 256; ++ii)
+            RowSlot[ii] = kNoSlot;
+    }
+
+    /// Add a received block: row < k for original data, k + i for the i'th
+    /// recovery block.  The buffer is borrowed, not copied, and is
+    /// overwritten with original data by Decode().  Returns false if the
+    /// row is out of range, already added, the size is wrong, or k blocks
+    /// are already in
+    bool Add(unsigned row, MutableBytes block)
+    {
+        if (K == 0 || Decoded || Count >= (unsigned)K || row >= (unsigned)(K + M) ||
+            RowSlot[row] != kNoSlot || block.size() != (size_t)BlockBytes)
+            return false;
+        RowSlot[row] = (unsigned char)Count;
+        Blocks[Count].data = reinterpret_cast<unsigned char*>(block.data());
+        Blocks[Count].row = (unsigned char)row;
+        ++Count;
+        return true;
+    }
+
+    /// Returns true once k blocks have been added
+    bool IsReady() const
+    {
+        return K > 0 && Count == (unsigned)K;
+    }
+
+    /// Recover the missing originals in place.  Returns false if fewer
+    /// than k blocks were added or the decoder failed
+    bool Decode()
+    {
+        if (Decoded)
+            return true;
+        if (!IsReady())
+            return false;
+
+        bool needDecode = false;
+        for (unsigned ii = 0; ii < Count; ++ii)
+            needDecode |= Blocks[ii].row >= K;
+        if (needDecode && 0 != cauchy_256_decode_ws(Scratch.Get(), K, M, Blocks, BlockBytes))
+            return false;
+
+        // Recovery blocks now hold the original of their updated row
+        for (unsigned ii = 0; ii < 256; ++ii)
+            RowSlot[ii] = kNoSlot;
+        for (unsigned ii = 0; ii < Count; ++ii)
+            RowSlot[Blocks[ii].row] = (unsigned char)ii;
+
+        Decoded = true;
+        return true;
+    }
+
+    /// Original block for a row < k after Decode(), or before it for an
+    /// original that was added.  Empty if not available
+    MutableBytes GetOriginal(unsigned row) const
+    {
+        if (row >= (unsigned)K || RowSlot[row] == kNoSlot)
+            return MutableBytes();
+        const Block& block = Blocks[RowSlot[row]];
+        if (block.row != row)
+            return MutableBytes();
+        return MutableBytes(reinterpret_cast<std::byte*>(block.data), (size_t)BlockBytes);
+    }
+
+    int GetK() const { return K; }
+    int GetM() const { return M; }
+    int GetBlockBytes() const { return BlockBytes; }
+
+protected:
+    static const unsigned char kNoSlot = 0xff;
+
+    int K = 0, M = 0, BlockBytes = 0;
+    Workspace Scratch;
+    unsigned Count = 0;
+    bool Decoded = false;
+    Block Blocks[256];
+
+    /// Index into Blocks for each row, or kNoSlot
+    unsigned char RowSlot[256];
+};
+
+
+} // namespace longhair
@@ -0,0 +1,299 @@
+/** \file
+    \brief Longhair: Generation Manager
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "longhair_generation.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace longhair {
+
+
+//------------------------------------------------------------------------------
+// BlockPool
+
+BlockPool::~BlockPool()
+{
+    FreeSlabs();
+}
+
+bool BlockPool::Initialize(int blockBytes, unsigned blocksPerSlab, unsigned maxBlocks)
+{
+    if (blockBytes <= 0 || blocksPerSlab == 0)
+        return false;
+
+    FreeSlabs();
+
+    // Round up so every block in the slab stays aligned
+    Stride = ((size_t)blockBytes + kAlignment - 1) & ~(size_t)(kAlignment - 1);
+    BlocksPerSlab = blocksPerSlab;
+    MaxBlocks = maxBlocks;
+    return true;
+}
+
+uint8_t* BlockPool::Allocate()
+{
+    if (!FreeList && !AddSlab())
+        return nullptr;
+
+    FreeNode* node = FreeList;
+    FreeList = node->Next;
+    ++UsedCount;
+    return reinterpret_cast<uint8_t*>(node);
+}
+
+void BlockPool::Free(uint8_t* block)
+{
+    if (!block)
+        return;
+
+    FreeNode* node = reinterpret_cast<FreeNode*>(block);
+    node->Next = FreeList;
+    FreeList = node;
+    --UsedCount;
+}
+
+bool BlockPool::Reserve(unsigned count)
+{
+    while (Capacity < count)
+        if (!AddSlab())
+            return false;
+    return true;
+}
+
+bool BlockPool::AddSlab()
+{
+    if (Stride == 0)
+        return false;
+
+    unsigned count = BlocksPerSlab;
+    if (MaxBlocks > 0)
+    {
+        if (Capacity >= MaxBlocks)
+            return false;
+        if (count > MaxBlocks - Capacity)
+            count = MaxBlocks - Capacity;
+    }
+
+    void* slab = malloc(Stride * count + kAlignment - 1);
+    if (!slab)
+        return false;
+    Slabs.push_back(slab);
+
+    uint8_t* block = reinterpret_cast<uint8_t*>(
+        ((uintptr_t)slab + kAlignment - 1) & ~(uintptr_t)(kAlignment - 1));
+
+    // Push in reverse so blocks are handed out in address order
+    block += Stride * count;
+    for (unsigned ii = 0; ii < count; ++ii)
+    {
+        block -= Stride;
+        FreeNode* node = reinterpret_cast<FreeNode*>(block);
+        node->Next = FreeList;
+        FreeList = node;
+    }
+
+    Capacity += count;
+    return true;
+}
+
+void BlockPool::FreeSlabs()
+{
+    for (void* slab : Slabs)
+        free(slab);
+    Slabs.clear();
+    FreeList = nullptr;
+    UsedCount = 0;
+    Capacity = 0;
+}
+
+
+//------------------------------------------------------------------------------
+// GenerationManager
+
+GenerationManager::~GenerationManager()
+{
+    // Buffers are owned by the pool
+    cauchy_256_workspace_free(Workspace);
+}
+
+bool GenerationManager::Initialize(const GenerationManagerSettings& settings, DeliverT deliver)
+{
+    const SessionSettings& session = settings.Session;
+    // Room for the interleaved group being received and the one before it
+    if (!session.IsValid() || settings.MaxGenerations < 2 * session.Interleave ||
+        settings.MaxGenerations > 0x80000000u || !deliver)
+    {
+        return false;
+    }
+
+    Settings = settings;
+
+    // Generations that share a slot must stay MaxGenerations apart when the
+    // 32-bit generation wraps, so the slot count has to divide 2^32
+    Settings.MaxGenerations = 1;
+    while (Settings.MaxGenerations < settings.MaxGenerations)
+        Settings.MaxGenerations *= 2;
+
+    if (Settings.MaxBuffers == 0)
+        Settings.MaxBuffers = Settings.MaxGenerations * session.K;
+
+    Deliver = deliver;
+    Release = [this](uint8_t* buffer) {
+        Pool.Free(buffer);
+    };
+
+    Slots.clear();
+    Slots.resize(Settings.MaxGenerations);
+    for (Slot& slot : Slots)
+        slot.State.Initialize(session);
+    OldestIndex = NewestIndex = kNone;
+    ReceivingCount = 0;
+    HaveNewest = false;
+
+    if (!Pool.Initialize(session.BlockBytes, 64, Settings.MaxBuffers) ||
+        !Pool.Reserve(settings.ReserveBuffers))
+    {
+        return false;
+    }
+
+    if (!Workspace)
+        Workspace = cauchy_256_workspace_create();
+    if (!Workspace)
+        return false;
+    return 0 == cauchy_256_workspace_reserve(Workspace, session.K, session.M, session.BlockBytes);
+}
+
+bool GenerationManager::OnPacket(uint32_t generation, unsigned row, uint8_t* buffer, uint64_t nowMsec)
+{
+    const SessionSettings& session = Settings.Session;
+    if (!Workspace || !buffer || row >= (unsigned)(session.K + session.M))
+        return false;
+
+    if (!HaveNewest || IsGenerationNewer(generation, NewestGeneration))
+    {
+        NewestGeneration = generation;
+        HaveNewest = true;
+    }
+    else if (NewestGeneration - generation >= Settings.MaxGenerations)
+    {
+        // Too far behind to have a slot
+        Pool.Free(buffer);
+        return true;
+    }
+
+    const int index = (int)(generation % Settings.MaxGenerations);
+    Slot& slot = Slots[index];
+    GenerationState& state = slot.State;
+
+    if (!slot.Used || state.Generation != generation)
+    {
+        // Slot holds an older generation (newer ones were rejected above)
+        if (state.Receiving)
+            Abandon(index);
+
+        state.Start(generation);
+        slot.Used = true;
+        slot.StartMsec = nowMsec;
+        Link(index);
+    }
+    else if (state.Complete || !state.Receiving || state.HasRow(row))
+    {
+        // Already recovered, expired or duplicate
+        Pool.Free(buffer);
+        return true;
+    }
+
+    if (state.Add(session, row, buffer, Deliver))
+    {
+        Unlink(index);
+        state.Recover(session, Workspace, Deliver, Release);
+        ++RecoveredGenerations;
+    }
+
+    return true;
+}
+
+bool GenerationManager::OnPacketCopy(uint32_t generation, unsigned row, const uint8_t* data, uint64_t nowMsec)
+{
+    const SessionSettings& session = Settings.Session;
+    if (!data || row >= (unsigned)(session.K + session.M))
+        return false;
+
+    uint8_t* buffer = Pool.Allocate();
+    if (!buffer)
+        return false;
+    memcpy(buffer, data, session.BlockBytes);
+
+    return OnPacket(generation, row, buffer, nowMsec);
+}
+
+void GenerationManager::Expire(uint64_t nowMsec, uint64_t timeoutMsec)
+{
+    while (OldestIndex != kNone && nowMsec - Slots[OldestIndex].StartMsec > timeoutMsec)
+        Abandon(OldestIndex);
+}
+
+void GenerationManager::Link(int index)
+{
+    Slot& slot = Slots[index];
+    slot.Prev = NewestIndex;
+    slot.Next = kNone;
+    if (NewestIndex != kNone)
+        Slots[NewestIndex].Next = index;
+    else
+        OldestIndex = index;
+    NewestIndex = index;
+    ++ReceivingCount;
+}
+
+void GenerationManager::Unlink(int index)
+{
+    Slot& slot = Slots[index];
+    if (slot.Prev != kNone)
+        Slots[slot.Prev].Next = slot.Next;
+    else
+        OldestIndex = slot.Next;
+    if (slot.Next != kNone)
+        Slots[slot.Next].Prev = slot.Prev;
+    else
+        NewestIndex = slot.Prev;
+    slot.Prev = slot.Next = kNone;
+    --ReceivingCount;
+}
+
+void GenerationManager::Abandon(int index)
+{
+    Unlink(index);
+    Slots[index].State.Abandon(Release);
+    ++LostGenerations;
+}
+
+
+} // namespace longhair
@@ -0,0 +1,249 @@
+/** \file
+    \brief Longhair: Generation Manager
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+/**
+    Many concurrent generations
+
+    A receiver on a lossy path has many generations in flight at once: late
+    recovery packets for one overlap the originals of the next few.
+    GenerationManager keeps a fixed table of generation slots and a
+    BlockPool of packet buffers, so memory is bounded by the settings and
+    nothing is allocated once the pool has been filled.
+
+    + Slot lookup is generation % MaxGenerations, so it is O(1).  A packet
+      for a generation more than MaxGenerations behind the newest is dropped.
+    + Recovered generations release their buffers to the pool right away.
+      The slot remembers the generation so late packets for it are dropped.
+    + Generations still receiving are kept in start order, so Expire()
+      only looks at the ones that are actually stale.
+
+    Receive packets straight into buffers from AllocateBuffer() to avoid
+    copies.  Every buffer passed to OnPacket() goes back to the pool.
+*/
+
+#include "longhair_session.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace longhair {
+
+
+//------------------------------------------------------------------------------
+// BlockPool
+
+/**
+    Slab allocator for equal-sized block buffers.
+
+    Blocks are aligned to kAlignment bytes and carved out of slabs of
+    BlocksPerSlab blocks.  Free blocks are kept on an intrusive free list,
+    so Allocate() and Free() are O(1) and only a new slab allocates.
+*/
+class BlockPool
+{
+public:
+    static const unsigned kAlignment = 64;
+
+    BlockPool() = default;
+    ~BlockPool();
+
+    // The slabs are owned by the pool
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+
+    /// maxBlocks = 0 for no limit.  Returns false on invalid parameters
+    bool Initialize(int blockBytes, unsigned blocksPerSlab = 64, unsigned maxBlocks = 0);
+
+    /// Returns null if the limit is reached or out of memory
+    uint8_t* Allocate();
+
+    /// Return a block from Allocate()
+    void Free(uint8_t* block);
+
+    /// Add slabs until at least `count` blocks exist.  Returns false if
+    /// that would exceed the limit or out of memory
+    bool Reserve(unsigned count);
+
+    /// Blocks handed out and not yet freed
+    unsigned GetUsedCount() const
+    {
+        return UsedCount;
+    }
+
+    /// Blocks in all slabs
+    unsigned GetCapacity() const
+    {
+        return Capacity;
+    }
+
+protected:
+    struct FreeNode
+    {
+        FreeNode* Next;
+    };
+
+    size_t Stride = 0;
+    unsigned BlocksPerSlab = 0;
+    unsigned MaxBlocks = 0;
+
+    std::vector<void*> Slabs;
+    FreeNode* FreeList = nullptr;
+    unsigned UsedCount = 0;
+    unsigned Capacity = 0;
+
+    bool AddSlab();
+    void FreeSlabs();
+};
+
+
+//------------------------------------------------------------------------------
+// GenerationManager
+
+struct GenerationManagerSettings
+{
+    SessionSettings Session;
+
+    /// Generation slots.  Generations further than this behind the newest
+    /// one received are dropped.  At least 2 * Session.Interleave, and
+    /// rounded up to a power of two
+    unsigned MaxGenerations = 64;
+
+    /// Limit on pooled buffers.  0 = MaxGenerations * K, enough to hold a
+    /// full table plus the packets being received
+    unsigned MaxBuffers = 0;
+
+    /// Buffers to allocate up front
+    unsigned ReserveBuffers = 0;
+};
+
+class GenerationManager
+{
+public:
+    GenerationManager() = default;
+    ~GenerationManager();
+
+    // The release callback captures this
+    GenerationManager(const GenerationManager&) = delete;
+    GenerationManager& operator=(const GenerationManager&) = delete;
+
+    /// Returns false if the settings are invalid or out of memory
+    bool Initialize(const GenerationManagerSettings& settings, DeliverT deliver);
+
+    /// Get a buffer of BlockBytes to receive a packet into.
+    /// Returns null if the buffer limit is reached: call Expire()
+    uint8_t* AllocateBuffer()
+    {
+        return Pool.Allocate();
+    }
+
+    /// Return a buffer that was not passed to OnPacket()
+    void FreeBuffer(uint8_t* buffer)
+    {
+        Pool.Free(buffer);
+    }
+
+    /// Process a packet received into a buffer from AllocateBuffer().
+    /// The buffer always goes back to the pool.  nowMsec is used to expire
+    /// stale generations.  Returns false if the packet is invalid
+    bool OnPacket(uint32_t generation, unsigned row, uint8_t* buffer, uint64_t nowMsec);
+
+    /// Same as OnPacket() but copies the data into a pooled buffer first.
+    /// Returns false if the packet is invalid or no buffer is available
+    bool OnPacketCopy(uint32_t generation, unsigned row, const uint8_t* data, uint64_t nowMsec);
+
+    /// Abandon generations that started receiving more than timeoutMsec ago
+    void Expire(uint64_t nowMsec, uint64_t timeoutMsec);
+
+    /// Generations currently receiving
+    unsigned GetReceivingCount() const
+    {
+        return ReceivingCount;
+    }
+
+    uint64_t GetRecoveredGenerations() const
+    {
+        return RecoveredGenerations;
+    }
+
+    /// Generations abandoned by Expire() or pushed out by newer ones
+    uint64_t GetLostGenerations() const
+    {
+        return LostGenerations;
+    }
+
+    const BlockPool& GetPool() const
+    {
+        return Pool;
+    }
+
+protected:
+    static const int kNone = -1;
+
+    struct Slot
+    {
+        GenerationState State;
+
+        /// Set once the slot has held a generation
+        bool Used = false;
+
+        uint64_t StartMsec = 0;
+
+        /// Links in the list of receiving generations, oldest first
+        int Prev = kNone;
+        int Next = kNone;
+    };
+
+    GenerationManagerSettings Settings;
+    DeliverT Deliver;
+    ReleaseT Release;
+    CauchyWorkspace* Workspace = nullptr;
+    BlockPool Pool;
+
+    std::vector<Slot> Slots;
+    int OldestIndex = kNone;
+    int NewestIndex = kNone;
+    unsigned ReceivingCount = 0;
+
+    bool HaveNewest = false;
+    uint32_t NewestGeneration = 0;
+
+    uint64_t RecoveredGenerations = 0;
+    uint64_t LostGenerations = 0;
+
+
+    void Link(int index);
+    void Unlink(int index);
+    void Abandon(int index);
+};
+
+
+} // namespace longhair
@@ -0,0 +1,370 @@
+/** \file
+    \brief Longhair: Pipelined Stream Encoder
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "longhair_pipeline.h"
+
+#include <chrono>
+#include <string.h>
+
+namespace longhair {
+
+
+//------------------------------------------------------------------------------
+// Waiting
+
+/// Microseconds on a monotonic clock, for the stage counters
+static uint64_t GetUsec()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// Waits between polls of an empty ring: spin briefly, then yield, then
+/// sleep so that a stage blocked on slow I/O does not burn a core
+static void Backoff(unsigned& polls)
+{
+    ++polls;
+    if (polls < 64)
+        return;
+    if (polls < 1024)
+        std::this_thread::yield();
+    else
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+}
+
+/// Accumulates the time from the first failed poll until the stage can run
+class WaitTimer
+{
+public:
+    explicit WaitTimer(std::atomic<uint64_t>& total)
+        : Total(total)
+    {
+    }
+
+    void OnEmpty()
+    {
+        if (Polls == 0)
+            Start = GetUsec();
+        Backoff(Polls);
+    }
+
+    void OnReady()
+    {
+        if (Polls != 0)
+        {
+            Total.fetch_add(GetUsec() - Start, std::memory_order_relaxed);
+            Polls = 0;
+        }
+    }
+
+protected:
+    std::atomic<uint64_t>& Total;
+    uint64_t Start = 0;
+    unsigned Polls = 0;
+};
+
+
+//------------------------------------------------------------------------------
+// PipelineStats
+
+const char* PipelineStats::GetSlowestStage() const
+{
+    const char* slowest = "fill";
+    double capacity = Fill.GetCapacityMBPS();
+
+    if (Encode.BusyUsec > 0 && (capacity <= 0. || Encode.GetCapacityMBPS() < capacity))
+    {
+        slowest = "encode";
+        capacity = Encode.GetCapacityMBPS();
+    }
+    if (Drain.BusyUsec > 0 && (capacity <= 0. || Drain.GetCapacityMBPS() < capacity))
+        slowest = "drain";
+
+    return slowest;
+}
+
+
+//------------------------------------------------------------------------------
+// StreamPipeline
+
+void StreamPipeline::StageCounters::Reset(unsigned threads)
+{
+    Stripes.store(0, std::memory_order_relaxed);
+    Bytes.store(0, std::memory_order_relaxed);
+    BusyUsec.store(0, std::memory_order_relaxed);
+    WaitUsec.store(0, std::memory_order_relaxed);
+    Threads = threads;
+}
+
+void StreamPipeline::StageCounters::Snapshot(PipelineStageStats& stats) const
+{
+    stats.Threads = Threads;
+    stats.Stripes = Stripes.load(std::memory_order_relaxed);
+    stats.Bytes = Bytes.load(std::memory_order_relaxed);
+    stats.BusyUsec = BusyUsec.load(std::memory_order_relaxed);
+    stats.WaitUsec = WaitUsec.load(std::memory_order_relaxed);
+}
+
+bool StreamPipeline::Start(const PipelineSettings& settings, PipelineFillT fill, PipelineDrainT drain)
+{
+    if (!Threads.empty() || !fill || !drain)
+        return false;
+    if (settings.K <= 0 || settings.M <= 0 || settings.K + settings.M > 256 ||
+        settings.BlockBytes <= 0 || settings.BlockBytes % 8 != 0)
+        return false;
+
+    Settings = settings;
+    if (Settings.Depth < 2)
+        Settings.Depth = 2;
+    if (Settings.EncoderThreads == 0)
+    {
+        const unsigned hardwareThreads = std::thread::hardware_concurrency();
+        Settings.EncoderThreads = hardwareThreads > 3 ? hardwareThreads - 2 : 1;
+    }
+
+    Fill = fill;
+    Drain = drain;
+
+    const size_t dataBytes = (size_t)Settings.K * Settings.BlockBytes;
+    const size_t stripeBytes = (size_t)(Settings.K + Settings.M) * Settings.BlockBytes;
+    Memory.reset(new (std::nothrow) uint8_t[stripeBytes * Settings.Depth]);
+    if (!Memory)
+        return false;
+
+    Stripes.clear();
+    Stripes.resize(Settings.Depth);
+    FreeRing.Initialize(Settings.Depth);
+    FilledRing.Initialize(Settings.Depth);
+    EncodedRing.Initialize(Settings.Depth);
+
+    for (unsigned ii = 0; ii < Settings.Depth; ++ii)
+    {
+        Stripe& stripe = Stripes[ii];
+        stripe.Data = Memory.get() + stripeBytes * ii;
+        stripe.Recovery = stripe.Data + dataBytes;
+        stripe.DataPtrs.resize(Settings.K);
+        for (int jj = 0; jj < Settings.K; ++jj)
+            stripe.DataPtrs[jj] = stripe.Data + (size_t)jj * Settings.BlockBytes;
+        FreeRing.TryPush(ii);
+    }
+
+    StripeCount = 0;
+    StreamEnded = false;
+    Aborted = false;
+    Failed = false;
+    FillCounters.Reset(1);
+    EncodeCounters.Reset(Settings.EncoderThreads);
+    DrainCounters.Reset(1);
+
+    Threads.emplace_back(&StreamPipeline::FillLoop, this);
+    for (unsigned ii = 0; ii < Settings.EncoderThreads; ++ii)
+        Threads.emplace_back(&StreamPipeline::EncodeLoop, this);
+    Threads.emplace_back(&StreamPipeline::DrainLoop, this);
+
+    return true;
+}
+
+bool StreamPipeline::Wait()
+{
+    for (std::thread& thread : Threads)
+        thread.join();
+    Threads.clear();
+    return !Failed;
+}
+
+void StreamPipeline::Stop()
+{
+    Aborted = true;
+    Wait();
+}
+
+PipelineStats StreamPipeline::GetStats() const
+{
+    PipelineStats stats;
+    FillCounters.Snapshot(stats.Fill);
+    EncodeCounters.Snapshot(stats.Encode);
+    DrainCounters.Snapshot(stats.Drain);
+    return stats;
+}
+
+void StreamPipeline::Fail()
+{
+    Failed = true;
+    Aborted = true;
+}
+
+void StreamPipeline::FillLoop()
+{
+    const unsigned maxBytes = (unsigned)Settings.K * Settings.BlockBytes;
+    WaitTimer waitTimer(FillCounters.WaitUsec);
+    uint64_t sequence = 0;
+
+    while (!Aborted)
+    {
+        unsigned index;
+        if (!FreeRing.TryPop(index))
+        {
+            waitTimer.OnEmpty();
+            continue;
+        }
+        waitTimer.OnReady();
+
+        Stripe& stripe = Stripes[index];
+        const uint64_t t0 = GetUsec();
+        unsigned bytes = 0;
+        if (!Fill(stripe.Data, maxBytes, bytes) || bytes > maxBytes)
+        {
+            Fail();
+            break;
+        }
+        FillCounters.BusyUsec.fetch_add(GetUsec() - t0, std::memory_order_relaxed);
+
+        // An empty read ends the stream without another stripe
+        if (bytes == 0)
+            break;
+
+        memset(stripe.Data + bytes, 0, maxBytes - bytes);
+        stripe.Sequence = sequence++;
+        stripe.Bytes = bytes;
+        FillCounters.Stripes.fetch_add(1, std::memory_order_relaxed);
+        FillCounters.Bytes.fetch_add(bytes, std::memory_order_relaxed);
+
+        // Cannot be full: the rings hold every stripe buffer
+        FilledRing.TryPush(index);
+
+        if (bytes < maxBytes)
+            break;
+    }
+
+    StripeCount.store(sequence, std::memory_order_relaxed);
+    StreamEnded.store(true, std::memory_order_release);
+}
+
+void StreamPipeline::EncodeLoop()
+{
+    CauchyWorkspace* workspace = cauchy_256_workspace_create();
+    if (!workspace || cauchy_256_workspace_reserve(workspace, Settings.K, Settings.M, Settings.BlockBytes))
+    {
+        cauchy_256_workspace_free(workspace);
+        Fail();
+        return;
+    }
+
+    WaitTimer waitTimer(EncodeCounters.WaitUsec);
+
+    while (!Aborted)
+    {
+        unsigned index;
+        if (!FilledRing.TryPop(index))
+        {
+            // Pop again after seeing the end, since the fill thread pushes
+            // its last stripe before setting StreamEnded
+            if (!StreamEnded.load(std::memory_order_acquire))
+            {
+                waitTimer.OnEmpty();
+                continue;
+            }
+            if (!FilledRing.TryPop(index))
+                break;
+        }
+        waitTimer.OnReady();
+
+        Stripe& stripe = Stripes[index];
+        const uint64_t t0 = GetUsec();
+        const int result = cauchy_256_encode_ws(workspace, Settings.K, Settings.M,
+            stripe.DataPtrs.data(), stripe.Recovery, Settings.BlockBytes);
+        EncodeCounters.BusyUsec.fetch_add(GetUsec() - t0, std::memory_order_relaxed);
+
+        if (result != 0)
+        {
+            Fail();
+            break;
+        }
+        EncodeCounters.Stripes.fetch_add(1, std::memory_order_relaxed);
+        EncodeCounters.Bytes.fetch_add(stripe.Bytes, std::memory_order_relaxed);
+
+        EncodedRing.TryPush(index);
+    }
+
+    cauchy_256_workspace_free(workspace);
+}
+
+void StreamPipeline::DrainLoop()
+{
+    // Stripe buffers are filled in the order they come back on FreeRing,
+    // which is stream order, so stripe n is always in buffer n % Depth.
+    // Encoders can finish out of order, so hold stripes until their turn
+    std::vector<bool> ready(Settings.Depth, false);
+    WaitTimer waitTimer(DrainCounters.WaitUsec);
+    uint64_t nextSequence = 0;
+
+    while (!Aborted)
+    {
+        unsigned index;
+        while (EncodedRing.TryPop(index))
+            ready[index] = true;
+
+        const unsigned nextIndex = (unsigned)(nextSequence % Settings.Depth);
+        if (!ready[nextIndex])
+        {
+            if (StreamEnded.load(std::memory_order_acquire) &&
+                nextSequence >= StripeCount.load(std::memory_order_relaxed))
+                break;
+            waitTimer.OnEmpty();
+            continue;
+        }
+        waitTimer.OnReady();
+
+        Stripe& stripe = Stripes[nextIndex];
+        PipelineStripe output;
+        output.Sequence = stripe.Sequence;
+        output.Data = stripe.Data;
+        output.Bytes = stripe.Bytes;
+        output.Recovery = stripe.Recovery;
+
+        const uint64_t t0 = GetUsec();
+        const bool success = Drain(output);
+        DrainCounters.BusyUsec.fetch_add(GetUsec() - t0, std::memory_order_relaxed);
+
+        if (!success)
+        {
+            Fail();
+            break;
+        }
+        DrainCounters.Stripes.fetch_add(1, std::memory_order_relaxed);
+        DrainCounters.Bytes.fetch_add(stripe.Bytes, std::memory_order_relaxed);
+
+        ready[nextIndex] = false;
+        ++nextSequence;
+        FreeRing.TryPush(nextIndex);
+    }
+}
+
+
+} // namespace longhair
@@ -0,0 +1,382 @@
+/** \file
+    \brief Longhair: Pipelined Stream Encoder
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+/**
+    Pipelined encoder for sequential streams
+
+    A byte stream is cut into stripes of k * BlockBytes.  Instead of filling
+    a stripe, encoding it and writing it out one after the other, the three
+    stages run on their own threads with Depth stripe buffers between them:
+
+        fill thread --> encoder threads --> drain thread
+             ^                                   |
+             +-------- free stripe buffers ------+
+
+    The stages hand stripe buffers to each other through bounded lock-free
+    rings, so while stripe n is being encoded, stripe n+1 is being filled
+    and stripe n-1 is being written out.  Stripes reach the drain callback
+    in stream order even with several encoder threads.
+
+    Each stage counts the time it spends working and the time it spends
+    waiting for the previous one, so GetStats() shows which stage is the
+    bottleneck.
+
+    Example:
+
+        longhair::StreamPipeline pipeline;
+        longhair::PipelineSettings settings;
+        settings.K = 32, settings.M = 8, settings.BlockBytes = 4096;
+
+        pipeline.Start(settings,
+            [&](uint8_t* data, unsigned maxBytes, unsigned& bytes) {
+                bytes = (unsigned)fread(data, 1, maxBytes, input);
+                return !ferror(input);
+            },
+            [&](const longhair::PipelineStripe& stripe) {
+                return Send(stripe);
+            });
+        bool success = pipeline.Wait();
+*/
+
+#include "cauchy_256.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace longhair {
+
+
+//------------------------------------------------------------------------------
+// Lock-free rings
+
+/// Bounded single-producer single-consumer ring
+template<typename T> class SpscRing
+{
+public:
+    /// Capacity is rounded up to a power of two
+    void Initialize(unsigned capacity)
+    {
+        unsigned size = 1;
+        while (size < capacity)
+            size *= 2;
+        Slots.reset(new T[size]);
+        Mask = size - 1;
+        Head.store(0, std::memory_order_relaxed);
+        Tail.store(0, std::memory_order_relaxed);
+    }
+
+    /// Returns false if the ring is full
+    bool TryPush(const T& value)
+    {
+        const uint64_t tail = Tail.load(std::memory_order_relaxed);
+        if (tail - Head.load(std::memory_order_acquire) > Mask)
+            return false;
+        Slots[tail & Mask] = value;
+        Tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Returns false if the ring is empty
+    bool TryPop(T& value)
+    {
+        const uint64_t head = Head.load(std::memory_order_relaxed);
+        if (head == Tail.load(std::memory_order_acquire))
+            return false;
+        value = Slots[head & Mask];
+        Head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+protected:
+    std::unique_ptr<T[]> Slots;
+    uint64_t Mask = 0;
+
+    /// Producer and consumer indices on their own cache lines
+    alignas(64) std::atomic<uint64_t> Tail{ 0 };
+    alignas(64) std::atomic<uint64_t> Head{ 0 };
+};
+
+/// Bounded multi-producer multi-consumer ring.
+/// Each cell carries a sequence number that says whether it is ready to be
+/// written or read on the current lap (D. Vyukov's bounded queue)
+template<typename T> class MpmcRing
+{
+public:
+    /// Capacity is rounded up to a power of two
+    void Initialize(unsigned capacity)
+    {
+        unsigned size = 1;
+        while (size < capacity)
+            size *= 2;
+        Cells.reset(new Cell[size]);
+        for (unsigned ii = 0; ii < size; ++ii)
+            Cells[ii].Sequence.store(ii, std::memory_order_relaxed);
+        Mask = size - 1;
+        Head.store(0, std::memory_order_relaxed);
+        Tail.store(0, std::memory_order_relaxed);
+    }
+
+    /// Returns false if the ring is full
+    bool TryPush(const T& value)
+    {
+        uint64_t tail = Tail.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell& cell = Cells[tail & Mask];
+            const uint64_t sequence = cell.Sequence.load(std::memory_order_acquire);
+            const int64_t delta = (int64_t)(sequence - tail);
+            if (delta == 0)
+            {
+                if (Tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+                {
+                    cell.Value = value;
+                    cell.Sequence.store(tail + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (delta < 0)
+                return false;
+            else
+                tail = Tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    /// Returns false if the ring is empty
+    bool TryPop(T& value)
+    {
+        uint64_t head = Head.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell& cell = Cells[head & Mask];
+            const uint64_t sequence = cell.Sequence.load(std::memory_order_acquire);
+            const int64_t delta = (int64_t)(sequence - (head + 1));
+            if (delta == 0)
+            {
+                if (Head.compare_exchange_weak(head, head + 1, std::memory_order_relaxed))
+                {
+                    value = cell.Value;
+                    cell.Sequence.store(head + Mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (delta < 0)
+                return false;
+            else
+                head = Head.load(std::memory_order_relaxed);
+        }
+    }
+
+protected:
+    struct Cell
+    {
+        std::atomic<uint64_t> Sequence{ 0 };
+        T Value;
+    };
+
+    std::unique_ptr<Cell[]> Cells;
+    uint64_t Mask = 0;
+
+    alignas(64) std::atomic<uint64_t> Tail{ 0 };
+    alignas(64) std::atomic<uint64_t> Head{ 0 };
+};
+
+
+//------------------------------------------------------------------------------
+// Stage Statistics
+
+/// Counters for one pipeline stage
+struct PipelineStageStats
+{
+    /// Threads running the stage
+    unsigned Threads = 0;
+
+    /// Stripes and stream bytes through the stage
+    uint64_t Stripes = 0;
+    uint64_t Bytes = 0;
+
+    /// Time spent in the stage work (the callback or the encoder), summed
+    /// over the stage threads
+    uint64_t BusyUsec = 0;
+
+    /// Time spent waiting for input or for room in the next ring
+    uint64_t WaitUsec = 0;
+
+    /// Throughput the stage could sustain if it never had to wait
+    double GetCapacityMBPS() const
+    {
+        if (BusyUsec == 0)
+            return 0.;
+        return Bytes * (double)Threads / (double)BusyUsec;
+    }
+};
+
+struct PipelineStats
+{
+    PipelineStageStats Fill;
+    PipelineStageStats Encode;
+    PipelineStageStats Drain;
+
+    /// Name of the stage with the lowest capacity: "fill", "encode" or "drain"
+    const char* GetSlowestStage() const;
+};
+
+
+//------------------------------------------------------------------------------
+// StreamPipeline
+
+struct PipelineSettings
+{
+    /// Code parameters
+    int K = 0;
+    int M = 0;
+
+    /// Bytes per block.  Must be a multiple of 8
+    int BlockBytes = 0;
+
+    /// Stripe buffers shared by the stages.  At least 2 (double buffering);
+    /// more lets the stages absorb jitter in each other
+    unsigned Depth = 4;
+
+    /// Encoder threads.  0 = one per hardware thread, less the fill and
+    /// drain threads
+    unsigned EncoderThreads = 1;
+};
+
+/// A stripe handed to the drain callback
+struct PipelineStripe
+{
+    /// Stripe number in the stream, from 0
+    uint64_t Sequence = 0;
+
+    /// K * BlockBytes bytes of data, zero-padded past Bytes
+    const uint8_t* Data = nullptr;
+
+    /// Stream bytes in the stripe.  Less than K * BlockBytes only for the
+    /// last stripe
+    unsigned Bytes = 0;
+
+    /// M * BlockBytes bytes of recovery data
+    const uint8_t* Recovery = nullptr;
+};
+
+/// Fill up to maxBytes of the next stripe and set bytes to the amount
+/// written.  Setting fewer than maxBytes ends the stream after this stripe.
+/// Return false on error to stop the pipeline.  Called on the fill thread
+typedef std::function<bool(uint8_t* data, unsigned maxBytes, unsigned& bytes)> PipelineFillT;
+
+/// Consume an encoded stripe.  The buffers are reused once this returns.
+/// Return false on error to stop the pipeline.  Called on the drain thread
+typedef std::function<bool(const PipelineStripe& stripe)> PipelineDrainT;
+
+class StreamPipeline
+{
+public:
+    ~StreamPipeline()
+    {
+        Stop();
+    }
+
+    /// Allocate the stripe buffers and start the threads.
+    /// cauchy_256_init() must have been called.
+    /// Returns false on invalid settings, out of memory, or if running
+    bool Start(const PipelineSettings& settings, PipelineFillT fill, PipelineDrainT drain);
+
+    /// Wait for the stream to end.  Returns false if a callback or the
+    /// encoder failed
+    bool Wait();
+
+    /// Stop early, dropping stripes that have not been drained
+    void Stop();
+
+    /// Snapshot of the stage counters.  Safe to call while running
+    PipelineStats GetStats() const;
+
+protected:
+    struct Stripe
+    {
+        uint64_t Sequence = 0;
+        unsigned Bytes = 0;
+        uint8_t* Data = nullptr;
+        uint8_t* Recovery = nullptr;
+        std::vector<const unsigned char*> DataPtrs;
+    };
+
+    struct StageCounters
+    {
+        alignas(64) std::atomic<uint64_t> Stripes{ 0 };
+        std::atomic<uint64_t> Bytes{ 0 };
+        std::atomic<uint64_t> BusyUsec{ 0 };
+        std::atomic<uint64_t> WaitUsec{ 0 };
+        unsigned Threads = 0;
+
+        void Reset(unsigned threads);
+        void Snapshot(PipelineStageStats& stats) const;
+    };
+
+    PipelineSettings Settings;
+    PipelineFillT Fill;
+    PipelineDrainT Drain;
+
+    /// One allocation for all stripe data and recovery blocks
+    std::unique_ptr<uint8_t[]> Memory;
+    std::vector<Stripe> Stripes;
+
+    /// Stripe indices: drain -> fill, fill -> encoders, encoders -> drain
+    SpscRing<unsigned> FreeRing;
+    MpmcRing<unsigned> FilledRing;
+    MpmcRing<unsigned> EncodedRing;
+
+    /// Number of stripes in the stream once the fill thread has seen the end
+    std::atomic<uint64_t> StripeCount{ 0 };
+    std::atomic<bool> StreamEnded{ false };
+
+    /// Set when a stage fails or on Stop()
+    std::atomic<bool> Aborted{ false };
+    std::atomic<bool> Failed{ false };
+
+    StageCounters FillCounters;
+    StageCounters EncodeCounters;
+    StageCounters DrainCounters;
+
+    std::vector<std::thread> Threads;
+
+
+    void FillLoop();
+    void EncodeLoop();
+    void DrainLoop();
+    void Fail();
+};
+
+
+} // namespace longhair
@@ -0,0 +1,296 @@
+/** \file
+    \brief Longhair: Worker Pool
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "longhair_pool.h"
+
+namespace longhair {
+
+
+//------------------------------------------------------------------------------
+// WorkerPool::JobRing
+
+void WorkerPool::JobRing::Reserve(unsigned slots)
+{
+    unsigned capacity = 1;
+    while (capacity < slots)
+        capacity *= 2;
+    if (capacity <= Slots.size())
+        return;
+
+    // Unroll the ring into the new slots starting at zero
+    std::vector<Job> grown(capacity);
+    const unsigned mask = (unsigned)Slots.size() - 1;
+    for (unsigned ii = 0; ii < Count; ++ii)
+        grown[ii] = std::move(Slots[(Head + ii) & mask]);
+    Slots.swap(grown);
+    Head = 0;
+}
+
+void WorkerPool::JobRing::PushBack(Job& job)
+{
+    if (Count >= Slots.size())
+        Reserve(Slots.empty() ? 1 : (unsigned)Slots.size() * 2);
+    const unsigned mask = (unsigned)Slots.size() - 1;
+    Slots[(Head + Count) & mask] = std::move(job);
+    ++Count;
+}
+
+void WorkerPool::JobRing::PopFront(Job& job)
+{
+    const unsigned mask = (unsigned)Slots.size() - 1;
+    job = std::move(Slots[Head]);
+    Slots[Head].Completion = nullptr;
+    Head = (Head + 1) & mask;
+    --Count;
+}
+
+void WorkerPool::JobRing::PopBack(Job& job)
+{
+    const unsigned mask = (unsigned)Slots.size() - 1;
+    --Count;
+    Job& slot = Slots[(Head + Count) & mask];
+    job = std::move(slot);
+    slot.Completion = nullptr;
+}
+
+
+//------------------------------------------------------------------------------
+// WorkerPool
+
+bool WorkerPool::Start(const PoolSettings& settings)
+{
+    if (!Workers.empty())
+        return false;
+
+    unsigned threadCount = settings.ThreadCount;
+    if (threadCount == 0)
+        threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0)
+        threadCount = 1;
+
+    Terminated = false;
+
+    for (unsigned ii = 0; ii < threadCount; ++ii)
+    {
+        std::unique_ptr<Worker> worker(new Worker);
+        worker->Workspace = cauchy_256_workspace_create();
+        if (!worker->Workspace)
+        {
+            Stop();
+            return false;
+        }
+        if (settings.MaxK > 0 && settings.MaxM > 0 && settings.MaxBlockBytes > 0 &&
+            0 != cauchy_256_workspace_reserve(worker->Workspace, settings.MaxK, settings.MaxM, settings.MaxBlockBytes))
+        {
+            cauchy_256_workspace_free(worker->Workspace);
+            Stop();
+            return false;
+        }
+        worker->Queue.Reserve(settings.QueueSlots);
+        Workers.push_back(std::move(worker));
+    }
+
+    // Start threads after the worker list is complete, since they steal from each other
+    for (unsigned ii = 0; ii < threadCount; ++ii)
+        Workers[ii]->Thread = std::thread(&WorkerPool::WorkerLoop, this, ii);
+
+    return true;
+}
+
+void WorkerPool::Stop()
+{
+    if (Workers.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> locker(SleepLock);
+        Terminated = true;
+    }
+    WakeCondition.notify_all();
+
+    for (std::unique_ptr<Worker>& worker : Workers)
+    {
+        if (worker->Thread.joinable())
+            worker->Thread.join();
+        cauchy_256_workspace_free(worker->Workspace);
+    }
+    Workers.clear();
+}
+
+void WorkerPool::Encode(const EncodeJob& encode, CompletionT completion)
+{
+    Job job;
+    job.IsEncode = true;
+    job.Encode = encode;
+    job.Completion = std::move(completion);
+    Submit(job);
+}
+
+void WorkerPool::Decode(const DecodeJob& decode, CompletionT completion)
+{
+    Job job;
+    job.IsEncode = false;
+    job.Decode = decode;
+    job.Completion = std::move(completion);
+    Submit(job);
+}
+
+std::future<int> WorkerPool::Encode(const EncodeJob& job)
+{
+    std::shared_ptr<std::promise<int>> promise = std::make_shared<std::promise<int>>();
+    std::future<int> future = promise->get_future();
+    Encode(job, [promise](int result) {
+        promise->set_value(result);
+    });
+    return future;
+}
+
+std::future<int> WorkerPool::Decode(const DecodeJob& job)
+{
+    std::shared_ptr<std::promise<int>> promise = std::make_shared<std::promise<int>>();
+    std::future<int> future = promise->get_future();
+    Decode(job, [promise](int result) {
+        promise->set_value(result);
+    });
+    return future;
+}
+
+void WorkerPool::WaitIdle()
+{
+    std::unique_lock<std::mutex> locker(SleepLock);
+    IdleCondition.wait(locker, [this]() {
+        return Pending.load() == 0;
+    });
+}
+
+void WorkerPool::Submit(Job& job)
+{
+    if (Workers.empty())
+    {
+        RunJob(nullptr, job);
+        return;
+    }
+
+    Pending.fetch_add(1);
+
+    Queued.fetch_add(1);
+
+    Worker* worker = Workers[NextQueue.fetch_add(1) % Workers.size()].get();
+    {
+        std::lock_guard<std::mutex> locker(worker->QueueLock);
+        worker->Queue.PushBack(job);
+    }
+
+    // A sleeping worker checks Queued while holding SleepLock, so taking the
+    // lock here means it is either already waiting or will see the new job
+    if (Sleeping.load() > 0)
+    {
+        {
+            std::lock_guard<std::mutex> locker(SleepLock);
+        }
+        WakeCondition.notify_one();
+    }
+}
+
+bool WorkerPool::TryTakeJob(unsigned index, Job& job)
+{
+    const unsigned count = (unsigned)Workers.size();
+
+    // Oldest job from our own queue first, then the newest from the others
+    for (unsigned offset = 0; offset < count; ++offset)
+    {
+        Worker* worker = Workers[(index + offset) % count].get();
+        std::lock_guard<std::mutex> locker(worker->QueueLock);
+        if (worker->Queue.IsEmpty())
+            continue;
+
+        if (offset == 0)
+            worker->Queue.PopFront(job);
+        else
+            worker->Queue.PopBack(job);
+        Queued.fetch_sub(1);
+        return true;
+    }
+
+    return false;
+}
+
+void WorkerPool::RunJob(CauchyWorkspace* workspace, Job& job)
+{
+    int result;
+    if (job.IsEncode)
+    {
+        const EncodeJob& e = job.Encode;
+        result = cauchy_256_encode_ws(workspace, e.K, e.M, e.DataPtrs, e.Recovery, e.BlockBytes);
+    }
+    else
+    {
+        const DecodeJob& d = job.Decode;
+        result = cauchy_256_decode_ws(workspace, d.K, d.M, d.Blocks, d.BlockBytes);
+    }
+
+    if (job.Completion)
+        job.Completion(result);
+}
+
+void WorkerPool::WorkerLoop(unsigned index)
+{
+    CauchyWorkspace* workspace = Workers[index]->Workspace;
+    Job job;
+
+    for (;;)
+    {
+        if (TryTakeJob(index, job))
+        {
+            RunJob(workspace, job);
+            job.Completion = nullptr;
+
+            if (Pending.fetch_sub(1) == 1)
+            {
+                std::lock_guard<std::mutex> locker(SleepLock);
+                IdleCondition.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> locker(SleepLock);
+        Sleeping.fetch_add(1);
+        WakeCondition.wait(locker, [this]() {
+            return Queued.load() > 0 || Terminated;
+        });
+        Sleeping.fetch_sub(1);
+
+        // Queues are drained before stopping
+        if (Terminated && Queued.load() == 0)
+            break;
+    }
+}
+
+
+} // namespace longhair
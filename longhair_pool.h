@@ -0,0 +1,232 @@
+/** \file
+    \brief Longhair: Worker Pool
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+/**
+    Worker pool for stripe-parallel coding
+
+    Batch jobs that encode or decode many independent stripes can hand them
+    to a WorkerPool instead of managing their own threads.  Each worker owns
+    a CauchyWorkspace, so jobs do not allocate once the workspaces have
+    grown to (or been reserved for) the largest parameters in use.
+
+    Each worker has its own job queue.  Submissions are spread round-robin
+    over the queues, and a worker whose queue is empty steals from the back
+    of the others, so uneven job sizes still keep every core busy.  The only
+    shared locks are per queue, plus one for putting idle workers to sleep.
+
+    Queues are rings of job slots preallocated at Start() (QueueSlots per
+    worker).  They only grow, by doubling, if more jobs are outstanding than
+    that, so a steady workload submits without allocating.  Two exceptions:
+    a CompletionT whose captures do not fit in std::function's small buffer
+    (two pointers with the common standard libraries) is heap allocated,
+    and the std::future overloads allocate the shared promise state.
+
+    Example:
+
+        longhair::WorkerPool pool;
+        longhair::PoolSettings settings;
+        settings.MaxK = 64, settings.MaxM = 16, settings.MaxBlockBytes = 4096;
+        pool.Start(settings);
+
+        for (each stripe)
+        {
+            longhair::EncodeJob job;
+            job.K = 64, job.M = 16, job.BlockBytes = 4096;
+            job.DataPtrs = stripe.DataPtrs;
+            job.Recovery = stripe.Recovery;
+            pool.Encode(job, [&stripe](int result) { ... });
+        }
+        pool.WaitIdle();
+*/
+
+#include "cauchy_256.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace longhair {
+
+
+//------------------------------------------------------------------------------
+// Jobs
+
+/// Called on the worker thread when a job finishes, with the codec return
+/// value: 0 on success
+typedef std::function<void(int result)> CompletionT;
+
+/// Arguments for cauchy_256_encode().  The pointed-to memory must stay valid
+/// until the job completes
+struct EncodeJob
+{
+    int K = 0;
+    int M = 0;
+    const unsigned char** DataPtrs = nullptr;
+    void* Recovery = nullptr;
+    int BlockBytes = 0;
+};
+
+/// Arguments for cauchy_256_decode().  The pointed-to memory must stay valid
+/// until the job completes
+struct DecodeJob
+{
+    int K = 0;
+    int M = 0;
+    Block* Blocks = nullptr;
+    int BlockBytes = 0;
+};
+
+
+//------------------------------------------------------------------------------
+// WorkerPool
+
+struct PoolSettings
+{
+    /// Number of worker threads.  0 = one per hardware thread
+    unsigned ThreadCount = 0;
+
+    /// Largest parameters to reserve each workspace for.  0 = grow on demand
+    int MaxK = 0;
+    int MaxM = 0;
+    int MaxBlockBytes = 0;
+
+    /// Job slots preallocated per worker queue.  Rounded up to a power of
+    /// two; a queue doubles if it fills up
+    unsigned QueueSlots = 64;
+};
+
+class WorkerPool
+{
+public:
+    ~WorkerPool()
+    {
+        Stop();
+    }
+
+    /// Start the workers.  cauchy_256_init() must have been called.
+    /// Returns false if already started, the Max* parameters are invalid
+    /// or out of memory
+    bool Start(const PoolSettings& settings = PoolSettings());
+
+    /// Finish all queued jobs and stop the workers
+    void Stop();
+
+    /// Queue a job.  The completion is called on a worker thread.
+    /// If the pool is not started the job runs on the calling thread
+    void Encode(const EncodeJob& job, CompletionT completion);
+    void Decode(const DecodeJob& job, CompletionT completion);
+
+    /// Queue a job and get its result through a future
+    std::future<int> Encode(const EncodeJob& job);
+    std::future<int> Decode(const DecodeJob& job);
+
+    /// Block until every queued job has completed
+    void WaitIdle();
+
+    unsigned GetThreadCount() const
+    {
+        return (unsigned)Workers.size();
+    }
+
+protected:
+    struct Job
+    {
+        bool IsEncode = true;
+        EncodeJob Encode;
+        DecodeJob Decode;
+        CompletionT Completion;
+    };
+
+    /// Double-ended ring of job slots.  Capacity is a power of two
+    class JobRing
+    {
+    public:
+        void Reserve(unsigned slots);
+
+        bool IsEmpty() const
+        {
+            return Count == 0;
+        }
+
+        void PushBack(Job& job);
+        void PopFront(Job& job);
+        void PopBack(Job& job);
+
+    protected:
+        std::vector<Job> Slots;
+        unsigned Head = 0;
+        unsigned Count = 0;
+    };
+
+    struct Worker
+    {
+        /// Protects Queue
+        std::mutex QueueLock;
+        JobRing Queue;
+
+        CauchyWorkspace* Workspace = nullptr;
+        std::thread Thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> Workers;
+
+    /// Round-robin queue for the next submission
+    std::atomic<unsigned> NextQueue{ 0 };
+
+    /// Jobs waiting in a queue
+    std::atomic<int> Queued{ 0 };
+
+    /// Jobs queued or running
+    std::atomic<int> Pending{ 0 };
+
+    /// Workers waiting for jobs
+    std::atomic<int> Sleeping{ 0 };
+
+    /// Protects Terminated and the condition variables
+    std::mutex SleepLock;
+    std::condition_variable WakeCondition;
+    std::condition_variable IdleCondition;
+    bool Terminated = false;
+
+
+    void Submit(Job& job);
+    bool TryTakeJob(unsigned index, Job& job);
+    void RunJob(CauchyWorkspace* workspace, Job& job);
+    void WorkerLoop(unsigned index);
+};
+
+
+} // namespace longhair
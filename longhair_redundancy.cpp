@@ -0,0 +1,177 @@
+/** \file
+    \brief Longhair: Adaptive Redundancy
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "longhair_redundancy.h"
+
+#include <math.h>
+
+namespace longhair {
+
+
+//------------------------------------------------------------------------------
+// Loss model
+
+double BinomialTail(int n, int m, double p)
+{
+    if (m >= n)
+        return 0.;
+    if (p <= 0.)
+        return 0.;
+    if (p >= 1.)
+        return 1.;
+
+    // Sum the probabilities of losing 0..m and take the complement.
+    // Terms are built up in the log domain to avoid underflow for large n
+    const double logP = log(p);
+    const double logQ = log1p(-p);
+    double logTerm = n * logQ;
+    double sum = 0.;
+
+    for (int i = 0; i <= m; ++i)
+    {
+        sum += exp(logTerm);
+        logTerm += log((double)(n - i) / (i + 1)) + logP - logQ;
+    }
+
+    const double tail = 1. - sum;
+    return tail > 0. ? tail : 0.;
+}
+
+
+//------------------------------------------------------------------------------
+// RedundancyController
+
+/// Weight of each interval in the moving average loss rate
+static const double kLossGain = 0.125;
+
+bool RedundancyController::Initialize(const RedundancySettings& settings)
+{
+    if (!settings.IsValid())
+        return false;
+
+    Settings = settings;
+    if (Settings.MaxM > 256 - Settings.K)
+        Settings.MaxM = 256 - Settings.K;
+
+    LossRate.Reset();
+    BurstLength.Reset();
+    IntervalCount = 0;
+    IntervalLost = 0;
+    IntervalBurst = 0;
+    Run = 0;
+    SmoothedLoss = 0.;
+    Intervals = 0;
+    LastM = Settings.MinM;
+    CpuLimited = false;
+    return true;
+}
+
+void RedundancyController::OnPacket(uint64_t nowMsec, bool lost)
+{
+    if (lost)
+    {
+        ++IntervalLost;
+        if (++Run > IntervalBurst)
+            IntervalBurst = Run;
+    }
+    else
+        Run = 0;
+
+    // One interval per generation so the rate is measured at the scale
+    // that decides whether a generation is recovered
+    if (++IntervalCount >= (unsigned)(Settings.K + LastM))
+        OnReport(nowMsec, IntervalCount, IntervalLost, IntervalBurst);
+}
+
+void RedundancyController::OnReport(uint64_t nowMsec, unsigned count, unsigned lost, unsigned maxBurst)
+{
+    IntervalCount = 0;
+    IntervalLost = 0;
+    IntervalBurst = 0;
+    if (count == 0 || lost > count)
+        return;
+
+    // A single generation is too few packets to estimate the rate, so the
+    // filter tracks the maximum of a moving average instead
+    const double rate = lost / (double)count;
+    if (Intervals == 0)
+        SmoothedLoss = rate;
+    else
+        SmoothedLoss += (rate - SmoothedLoss) * kLossGain;
+    ++Intervals;
+
+    LossRate.Update(SmoothedLoss, nowMsec, Settings.WindowMsec);
+
+    // Zero samples let an old burst expire from the window
+    BurstLength.Update(maxBurst, nowMsec, Settings.WindowMsec);
+}
+
+int RedundancyController::RecommendM(CauchyCost* cost)
+{
+    int m = Settings.MinM;
+
+    if (Intervals > 0)
+    {
+        // Smallest m that meets the target under independent loss
+        const double p = LossRate.GetBest();
+        while (m < Settings.MaxM && BinomialTail(Settings.K + m, m, p) > Settings.TargetFailureRate)
+            ++m;
+
+        // Cover the longest recent burst, spread over the interleaved
+        // generations, including one still in progress
+        unsigned burst = BurstLength.GetBest();
+        if (burst < IntervalBurst)
+            burst = IntervalBurst;
+        const int burstM = (int)((burst + Settings.Interleave - 1) / Settings.Interleave);
+        if (m < burstM)
+            m = burstM < Settings.MaxM ? burstM : Settings.MaxM;
+    }
+
+    // Stay within the CPU budget, but never go below MinM
+    CpuLimited = false;
+    CauchyCost predicted = {};
+    cauchy_256_encode_cost(Settings.K, m, Settings.BlockBytes, &predicted);
+    if (Settings.MaxEncodeCycles > 0.)
+    {
+        while (m > Settings.MinM && predicted.cycles > Settings.MaxEncodeCycles)
+        {
+            --m;
+            cauchy_256_encode_cost(Settings.K, m, Settings.BlockBytes, &predicted);
+            CpuLimited = true;
+        }
+    }
+
+    if (cost)
+        *cost = predicted;
+    LastM = m;
+    return m;
+}
+
+
+} // namespace longhair
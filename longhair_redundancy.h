@@ -0,0 +1,174 @@
+/** \file
+    \brief Longhair: Adaptive Redundancy
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+/**
+    Adaptive redundancy controller
+
+    Picks the number of recovery blocks m for each generation from recent
+    loss statistics, so that only as much parity is sent (and encoded) as
+    current conditions need.
+
+    Feed it the fate of each packet in send order, from the receiver or
+    from its loss reports.  The loss rate, averaged over the last few
+    generation-sized intervals, and the longest loss burst of each interval
+    go into windowed maximum filters (siamese::WindowedMinMax), so a bad
+    stretch raises m quickly and m comes back down once the window has
+    passed without one.
+
+    The recommended m is the smallest for which a generation of K + m
+    packets fails (loses more than m) with probability below the target,
+    assuming independent losses at the windowed maximum rate.  It is then
+    raised to cover the longest recent burst, divided by the interleave
+    depth, and finally capped so that the predicted encode cost from
+    cauchy_256_encode_cost() stays within the CPU budget if one is set.
+
+    The codec matrix depends on m, so when m changes between generations
+    the receiver has to learn the m of each generation, for example from a
+    field in the packet header.
+*/
+
+#include "cauchy_256.h"
+#include "SiameseTools.h"
+
+namespace longhair {
+
+
+//------------------------------------------------------------------------------
+// Settings
+
+struct RedundancySettings
+{
+    /// Original blocks per generation: 1..255
+    int K = 0;
+
+    /// Bytes per block, used for the encode cost
+    int BlockBytes = 0;
+
+    /// Range of m to recommend.  MaxM is clamped to 256 - K
+    int MinM = 1;
+    int MaxM = 32;
+
+    /// Generations interleaved together, see SessionSettings::Interleave
+    unsigned Interleave = 1;
+
+    /// Target probability that a generation cannot be recovered
+    double TargetFailureRate = 0.0001;
+
+    /// Length of the windowed maximum filters in milliseconds
+    uint64_t WindowMsec = 10000;
+
+    /// Encode budget per generation in siamese::GetCycles() ticks.  0 = none
+    double MaxEncodeCycles = 0.;
+
+    bool IsValid() const
+    {
+        return K > 0 && K < 256 && BlockBytes > 0 && BlockBytes % 8 == 0 &&
+            MinM > 0 && MinM <= MaxM && K + MinM <= 256 &&
+            Interleave > 0 && TargetFailureRate > 0. && TargetFailureRate < 1. &&
+            WindowMsec > 0 && MaxEncodeCycles >= 0.;
+    }
+};
+
+/// Probability that more than m of n packets are lost, with each lost
+/// independently with probability p
+double BinomialTail(int n, int m, double p);
+
+
+//------------------------------------------------------------------------------
+// RedundancyController
+
+class RedundancyController
+{
+public:
+    /// Returns false if the settings are invalid
+    bool Initialize(const RedundancySettings& settings);
+
+    /// Record whether the next packet in send order was lost
+    void OnPacket(uint64_t nowMsec, bool lost);
+
+    /// Record a loss report covering `count` packets, `lost` of them lost
+    /// with the longest run of losses `maxBurst`
+    void OnReport(uint64_t nowMsec, unsigned count, unsigned lost, unsigned maxBurst);
+
+    /**
+        Recommended recovery blocks for the next generation.
+
+        Returns MinM until the first interval has been measured.  Also fills
+        in the predicted encode cost of the recommendation if `cost` is not
+        null.
+    */
+    int RecommendM(CauchyCost* cost = nullptr);
+
+    /// Windowed maximum of the average loss rate: 0..1
+    double GetLossRate() const
+    {
+        return LossRate.GetBest();
+    }
+
+    /// Windowed maximum of the loss burst length in packets
+    unsigned GetBurstLength() const
+    {
+        return BurstLength.GetBest();
+    }
+
+    /// Returns true if the last recommendation was lowered by the CPU budget
+    bool IsCpuLimited() const
+    {
+        return CpuLimited;
+    }
+
+protected:
+    RedundancySettings Settings;
+
+    siamese::WindowedMinMax<double, siamese::WindowedMaxCompare<double>> LossRate;
+    siamese::WindowedMinMax<unsigned, siamese::WindowedMaxCompare<unsigned>> BurstLength;
+
+    /// Current interval
+    unsigned IntervalCount = 0;
+    unsigned IntervalLost = 0;
+
+    /// Current run of losses and the longest in this interval
+    unsigned Run = 0;
+    unsigned IntervalBurst = 0;
+
+    /// Moving average of the interval loss rates
+    double SmoothedLoss = 0.;
+
+    /// Intervals measured so far
+    uint64_t Intervals = 0;
+
+    /// Last recommendation, which sets the interval length
+    int LastM = 0;
+    bool CpuLimited = false;
+};
+
+
+} // namespace longhair
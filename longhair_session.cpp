@@ -0,0 +1,248 @@
+/** \file
+    \brief Longhair: Packet FEC Session
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "longhair_session.h"
+
+#include <string.h>
+
+namespace longhair {
+
+
+//------------------------------------------------------------------------------
+// Sender
+
+Sender::~Sender()
+{
+    cauchy_256_workspace_free(Workspace);
+}
+
+bool Sender::Initialize(const SessionSettings& settings, SendT send)
+{
+    if (!settings.IsValid() || !send)
+        return false;
+
+    Settings = settings;
+    SendPacket = send;
+    Generation = 0;
+    Count = 0;
+    DataPtrs.resize((size_t)settings.K * settings.Interleave);
+    Recovery.resize((size_t)settings.M * settings.BlockBytes * settings.Interleave);
+
+    if (!Workspace)
+        Workspace = cauchy_256_workspace_create();
+    if (!Workspace)
+        return false;
+    return 0 == cauchy_256_workspace_reserve(Workspace, settings.K, settings.M, settings.BlockBytes);
+}
+
+bool Sender::Send(const uint8_t* data)
+{
+    if (!Workspace || !data)
+        return false;
+
+    const int depth = (int)Settings.Interleave;
+    const int offset = Count % depth;
+    const int row = Count / depth;
+
+    DataPtrs[offset * Settings.K + row] = data;
+    SendPacket(Generation + offset, (unsigned)row, data, Settings.BlockBytes);
+
+    if (++Count < Settings.K * depth)
+        return true;
+
+    const size_t recoveryBytes = (size_t)Settings.M * Settings.BlockBytes;
+    bool success = true;
+
+    for (int ii = 0; ii < depth; ++ii)
+    {
+        const int result = cauchy_256_encode_ws(Workspace, Settings.K, Settings.M,
+            &DataPtrs[ii * Settings.K], &Recovery[ii * recoveryBytes], Settings.BlockBytes);
+        success &= result == 0;
+    }
+
+    // Recovery rows round-robin across the group
+    if (success)
+    {
+        for (int jj = 0; jj < Settings.M; ++jj)
+        {
+            for (int ii = 0; ii < depth; ++ii)
+            {
+                const uint8_t* block = &Recovery[ii * recoveryBytes + (size_t)jj * Settings.BlockBytes];
+                SendPacket(Generation + ii, (unsigned)(Settings.K + jj), block, Settings.BlockBytes);
+            }
+        }
+    }
+
+    Generation += depth;
+    Count = 0;
+    return success;
+}
+
+
+//------------------------------------------------------------------------------
+// GenerationState
+
+void GenerationState::Start(uint32_t generation)
+{
+    Generation = generation;
+    Receiving = true;
+    Complete = false;
+    OriginalCount = 0;
+    RecoveryCount = 0;
+    memset(Received, 0, sizeof(Received));
+}
+
+bool GenerationState::Add(const SessionSettings& settings, unsigned row, uint8_t* buffer, const DeliverT& deliver)
+{
+    Received[row / 64] |= (uint64_t)1 << (row % 64);
+
+    if (row < (unsigned)settings.K)
+    {
+        Block& block = Blocks[OriginalCount++];
+        block.data = buffer;
+        block.row = (unsigned char)row;
+        deliver(Generation, row, buffer, settings.BlockBytes);
+    }
+    else
+    {
+        Block& block = Blocks[settings.K - 1 - RecoveryCount++];
+        block.data = buffer;
+        block.row = (unsigned char)row;
+    }
+
+    return OriginalCount + RecoveryCount >= settings.K;
+}
+
+bool GenerationState::Recover(const SessionSettings& settings, CauchyWorkspace* workspace,
+    const DeliverT& deliver, const ReleaseT& release)
+{
+    bool success = true;
+
+    if (RecoveryCount > 0)
+    {
+        // Blocks are full, so this only fails for invalid settings
+        success = 0 == cauchy_256_decode_ws(workspace, settings.K, settings.M, &Blocks[0], settings.BlockBytes);
+        if (success)
+        {
+            for (int ii = settings.K - RecoveryCount; ii < settings.K; ++ii)
+                deliver(Generation, Blocks[ii].row, Blocks[ii].data, settings.BlockBytes);
+        }
+    }
+
+    ReleaseHeld(release);
+    Receiving = false;
+    Complete = true;
+    return success;
+}
+
+void GenerationState::Abandon(const ReleaseT& release)
+{
+    ReleaseHeld(release);
+    Receiving = false;
+}
+
+void GenerationState::ReleaseHeld(const ReleaseT& release)
+{
+    const int k = (int)Blocks.size();
+    for (int ii = 0; ii < OriginalCount; ++ii)
+        release(Blocks[ii].data);
+    for (int ii = 0; ii < RecoveryCount; ++ii)
+        release(Blocks[k - 1 - ii].data);
+
+    OriginalCount = 0;
+    RecoveryCount = 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Receiver
+
+Receiver::~Receiver()
+{
+    Reset();
+    cauchy_256_workspace_free(Workspace);
+}
+
+bool Receiver::Initialize(const SessionSettings& settings, DeliverT deliver, ReleaseT release)
+{
+    // Interleaved streams need a receiver that holds several generations
+    if (!settings.IsValid() || settings.Interleave != 1 || !deliver || !release)
+        return false;
+
+    Reset();
+
+    Settings = settings;
+    Deliver = deliver;
+    Release = release;
+    State.Initialize(settings);
+
+    if (!Workspace)
+        Workspace = cauchy_256_workspace_create();
+    if (!Workspace)
+        return false;
+    return 0 == cauchy_256_workspace_reserve(Workspace, settings.K, settings.M, settings.BlockBytes);
+}
+
+bool Receiver::OnPacket(uint32_t generation, unsigned row, uint8_t* buffer)
+{
+    if (!Workspace || !buffer || row >= (unsigned)(Settings.K + Settings.M))
+        return false;
+
+    if (!Active || IsGenerationNewer(generation, State.Generation))
+    {
+        if (State.Receiving)
+        {
+            State.Abandon(Release);
+            ++LostGenerations;
+        }
+        State.Start(generation);
+        Active = true;
+    }
+    else if (generation != State.Generation || State.Complete || State.HasRow(row))
+    {
+        // Older generation, already recovered, or duplicate
+        Release(buffer);
+        return true;
+    }
+
+    if (State.Add(Settings, row, buffer, Deliver))
+        State.Recover(Settings, Workspace, Deliver, Release);
+
+    return true;
+}
+
+void Receiver::Reset()
+{
+    if (State.Receiving)
+        State.Abandon(Release);
+    Active = false;
+}
+
+
+} // namespace longhair
@@ -0,0 +1,285 @@
+/** \file
+    \brief Longhair: Packet FEC Session
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+/**
+    Packet FEC session layer
+
+    Sender and Receiver wrap the codec for the usual packet erasure setup:
+    the stream is cut into generations of K original blocks, each followed
+    by M recovery blocks, and every packet carries (generation, row).
+
+    Sender emits each original as soon as it is provided and the recovery
+    rows once the generation is complete.  The originals are not copied.
+
+    Receiver takes packets by (generation, row, pointer) and keeps pointers
+    into the caller's buffers instead of copying.  Originals are delivered
+    immediately.  When K distinct rows of a generation have arrived the
+    missing originals are decoded in place inside the recovery packets and
+    delivered, and then every buffer of the generation is handed back
+    through the release callback.
+
+    Interleaving: With SessionSettings::Interleave = D > 1 the sender works
+    on D generations at once.  The i'th original of the stream goes to
+    generation (i % D) of the group as row (i / D), and once the group is
+    full the recovery rows are sent round-robin across the D generations.
+    A burst of B lost packets then costs each generation about B / D rows,
+    so bursts longer than M can be recovered without raising M.  Originals
+    are still sent as soon as they are provided.  On the receive side the
+    (generation, row) in each packet is all that is needed, so there is no
+    reordering or copying: use GenerationManager, which holds many
+    generations at once, and OriginalStreamIndex() to put the delivered
+    originals back in stream order.
+*/
+
+#include "cauchy_256.h"
+
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+namespace longhair {
+
+
+//------------------------------------------------------------------------------
+// Settings
+
+struct SessionSettings
+{
+    /// Original blocks per generation: 1..255
+    int K = 0;
+
+    /// Recovery blocks per generation: 1..256-K
+    int M = 0;
+
+    /// Bytes per block, a multiple of 8
+    int BlockBytes = 0;
+
+    /// Generations interleaved together in the send order.  1 = off.
+    /// A power of two up to 256, so that interleaved groups still start on
+    /// a multiple of Interleave after the generation counter wraps
+    unsigned Interleave = 1;
+
+    bool IsValid() const
+    {
+        return K > 0 && M > 0 && K + M <= 256 && BlockBytes > 0 && BlockBytes % 8 == 0 &&
+            Interleave > 0 && Interleave <= 256 && (Interleave & (Interleave - 1)) == 0;
+    }
+};
+
+/// Position in the sender's input stream of original `row` of `generation`.
+/// Stream positions count modulo 2^32 * K, and wrap with the generation
+inline uint64_t OriginalStreamIndex(const SessionSettings& settings, uint32_t generation, unsigned row)
+{
+    const unsigned depth = settings.Interleave;
+    const uint64_t group = generation / depth;
+    return group * depth * settings.K + (uint64_t)row * depth + generation % depth;
+}
+
+/// Inverse of OriginalStreamIndex(): the generation and row that the
+/// original at `index` (modulo 2^32 * K) is sent in
+inline void OriginalFromStreamIndex(const SessionSettings& settings, uint64_t index,
+    uint32_t& generation, unsigned& row)
+{
+    const uint64_t depth = settings.Interleave;
+    const uint64_t groupSize = depth * settings.K;
+    const uint64_t offset = index % groupSize;
+    generation = (uint32_t)(index / groupSize * depth + offset % depth);
+    row = (unsigned)(offset / depth);
+}
+
+/// Returns true if generation a is newer than b, allowing for wrap-around
+inline bool IsGenerationNewer(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) > 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Sender
+
+/// Called for each packet to transmit.  Rows below K are originals and the
+/// rest are recovery blocks.  The data is only valid during the call
+typedef std::function<void(uint32_t generation, unsigned row, const uint8_t* data, int bytes)> SendT;
+
+class Sender
+{
+public:
+    ~Sender();
+
+    /// Returns false if the settings are invalid or out of memory
+    bool Initialize(const SessionSettings& settings, SendT send);
+
+    /// Send the next original block.  It is sent right away, and the
+    /// pointer must stay valid until the generation's recovery rows have
+    /// been sent: by the K'th call, or K * Interleave with interleaving.
+    /// Returns false if not initialized or the encoder failed
+    bool Send(const uint8_t* data);
+
+    /// Generation that the next Send() belongs to
+    uint32_t GetGeneration() const
+    {
+        return Generation + Count % Settings.Interleave;
+    }
+
+protected:
+    SessionSettings Settings;
+    SendT SendPacket;
+    CauchyWorkspace* Workspace = nullptr;
+
+    /// First generation of the current interleaved group
+    uint32_t Generation = 0;
+
+    /// Originals sent in the current group
+    int Count = 0;
+
+    /// Original pointers for each generation of the group: K per generation
+    std::vector<const uint8_t*> DataPtrs;
+
+    /// Recovery blocks for the current group, reused every group
+    std::vector<uint8_t> Recovery;
+};
+
+
+//------------------------------------------------------------------------------
+// Receiver
+
+/// Called with each original block: received ones right away, recovered
+/// ones after decoding.  The data stays valid until its buffer is released
+typedef std::function<void(uint32_t generation, unsigned row, const uint8_t* data, int bytes)> DeliverT;
+
+/// Called when the receiver no longer needs a buffer passed to OnPacket()
+typedef std::function<void(uint8_t* buffer)> ReleaseT;
+
+/**
+    Block slots for one generation being received.
+
+    Originals fill in from the front and recovery blocks from the back, so
+    after decoding the recovered originals are at the end.  Shared by
+    Receiver and GenerationManager.
+*/
+class GenerationState
+{
+public:
+    uint32_t Generation = 0;
+
+    /// Holding buffers and waiting for more rows
+    bool Receiving = false;
+
+    /// Finished: all originals delivered.  Later packets are released
+    bool Complete = false;
+
+    /// Size the block slots.  Must be called before Start()
+    void Initialize(const SessionSettings& settings)
+    {
+        Blocks.resize(settings.K);
+    }
+
+    void Start(uint32_t generation);
+
+    /// Returns true if a buffer for this row is already held
+    bool HasRow(unsigned row) const
+    {
+        return (Received[row / 64] >> (row % 64)) & 1;
+    }
+
+    /// Hold the buffer and deliver it if it is an original.  Returns true
+    /// once K rows are held and Recover() can be called
+    bool Add(const SessionSettings& settings, unsigned row, uint8_t* buffer, const DeliverT& deliver);
+
+    /// Decode, deliver the recovered originals and release every buffer.
+    /// Returns false if the decoder failed
+    bool Recover(const SessionSettings& settings, CauchyWorkspace* workspace,
+        const DeliverT& deliver, const ReleaseT& release);
+
+    /// Release every held buffer and stop receiving
+    void Abandon(const ReleaseT& release);
+
+protected:
+    std::vector<Block> Blocks;
+    int OriginalCount = 0;
+    int RecoveryCount = 0;
+
+    /// Bitfield of rows held
+    uint64_t Received[4] = {};
+
+    void ReleaseHeld(const ReleaseT& release);
+};
+
+class Receiver
+{
+public:
+    ~Receiver();
+
+    /// Returns false if the settings are invalid, interleaved (use
+    /// GenerationManager) or out of memory
+    bool Initialize(const SessionSettings& settings, DeliverT deliver, ReleaseT release);
+
+    /**
+        Process a received packet.
+
+        The receiver takes ownership of the buffer and hands it back through
+        the release callback, possibly before this returns (duplicates,
+        packets for finished or older generations).  Recovery packets are
+        overwritten in place by decoding, so the buffer must be writable
+        and BlockBytes long.
+
+        A packet for a newer generation abandons the current one if it has
+        not been recovered yet.
+
+        Returns false if the packet is invalid, and the caller keeps the buffer.
+    */
+    bool OnPacket(uint32_t generation, unsigned row, uint8_t* buffer);
+
+    /// Release all buffers and forget the current generation
+    void Reset();
+
+    /// Number of generations that were abandoned before they could be recovered
+    uint64_t GetLostGenerations() const
+    {
+        return LostGenerations;
+    }
+
+protected:
+    SessionSettings Settings;
+    DeliverT Deliver;
+    ReleaseT Release;
+    CauchyWorkspace* Workspace = nullptr;
+
+    /// Started at least one generation
+    bool Active = false;
+
+    GenerationState State;
+
+    uint64_t LostGenerations = 0;
+};
+
+
+} // namespace longhair
@@ -0,0 +1,442 @@
+/** \file
+    \brief Longhair: Sliding-Window FEC
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "longhair_window.h"
+#include "gf256.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace longhair {
+
+
+//------------------------------------------------------------------------------
+// Coefficients
+
+uint8_t WindowCoefficient(uint32_t repairId, uint32_t sequence)
+{
+    // X and Y are drawn from disjoint halves of the field so X + Y != 0.
+    // Repairs over the same window with ids that differ mod 128 form a
+    // Cauchy matrix, so any K of them recover K losses.  That does not
+    // hold in general: X repeats every 128 repairs and sources s and s + 128
+    // share Y, so partly overlapping repairs can be linearly dependent.
+    // InsertRow() drops those
+    const uint8_t x = (uint8_t)(128 + (repairId & 127));
+    const uint8_t y = (uint8_t)(sequence & 127);
+    return gf256_inv(gf256_add(x, y));
+}
+
+/// Returns true if sequence a is newer than b, allowing for wrap-around
+static inline bool IsSequenceNewer(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) > 0;
+}
+
+
+//------------------------------------------------------------------------------
+// WindowEncoder
+
+bool WindowEncoder::Initialize(const WindowSettings& settings)
+{
+    if (!settings.IsValid() || 0 != gf256_init())
+        return false;
+
+    Settings = settings;
+    History.resize((size_t)settings.WindowSize * settings.BlockBytes);
+    NextSequence = 0;
+    NextRepairId = 0;
+    Count = 0;
+    return true;
+}
+
+uint32_t WindowEncoder::AddSource(const uint8_t* data)
+{
+    const uint32_t sequence = NextSequence++;
+    if (!History.empty())
+    {
+        memcpy(&History[(size_t)(sequence % Settings.WindowSize) * Settings.BlockBytes],
+            data, Settings.BlockBytes);
+        if (Count < Settings.WindowSize)
+            ++Count;
+    }
+    return sequence;
+}
+
+bool WindowEncoder::GenerateRepair(uint8_t* repair, WindowRepair& header)
+{
+    if (Count == 0 || !repair)
+        return false;
+
+    header.FirstSequence = NextSequence - Count;
+    header.Count = Count;
+    header.RepairId = NextRepairId++;
+
+    for (unsigned ii = 0; ii < Count; ++ii)
+    {
+        const uint32_t sequence = header.FirstSequence + ii;
+        const uint8_t* source = &History[(size_t)(sequence % Settings.WindowSize) * Settings.BlockBytes];
+        const uint8_t coeff = WindowCoefficient(header.RepairId, sequence);
+
+        if (ii == 0)
+            gf256_mul_mem(repair, source, coeff, Settings.BlockBytes);
+        else
+            gf256_muladd_mem(repair, coeff, source, Settings.BlockBytes);
+    }
+
+    return true;
+}
+
+
+//------------------------------------------------------------------------------
+// WindowDecoder
+
+bool WindowDecoder::Initialize(const WindowSettings& settings, WindowDeliverT deliver)
+{
+    if (!settings.IsValid() || !deliver || 0 != gf256_init())
+        return false;
+
+    Settings = settings;
+    Deliver = deliver;
+
+    HistorySize = 1;
+    while (HistorySize < 2 * settings.WindowSize)
+        HistorySize *= 2;
+    HistoryMask = HistorySize - 1;
+
+    Sources.resize((size_t)HistorySize * settings.BlockBytes);
+    Known.resize(HistorySize);
+    Rows.resize(HistorySize);
+    RowCoeffs.resize((size_t)HistorySize * HistorySize);
+    RowData.resize((size_t)HistorySize * settings.BlockBytes);
+    PivotRow.resize(HistorySize);
+
+    Reset();
+    return true;
+}
+
+void WindowDecoder::Reset()
+{
+    Started = false;
+    std::fill(Known.begin(), Known.end(), (uint8_t)0);
+    std::fill(PivotRow.begin(), PivotRow.end(), -1);
+    for (Row& row : Rows)
+        row.Used = false;
+}
+
+void WindowDecoder::Start(uint32_t sequence)
+{
+    if (Started)
+        return;
+    Started = true;
+    Base = sequence;
+    Newest = sequence - 1;
+}
+
+void WindowDecoder::Advance(uint32_t sequence)
+{
+    if (!IsSequenceNewer(sequence, Newest))
+        return;
+    Newest = sequence;
+
+    const uint32_t newBase = Newest - HistorySize + 1;
+    if (!IsSequenceNewer(newBase, Base))
+        return;
+
+    // After a long gap every slot expires and the rest were never seen
+    const uint32_t gap = newBase - Base;
+    if (gap > HistorySize)
+    {
+        for (unsigned ii = 0; ii < HistorySize; ++ii)
+            ExpireSlot(Base + ii);
+        LostCount += gap - HistorySize;
+    }
+    else
+    {
+        for (uint32_t ii = 0; ii < gap; ++ii)
+            ExpireSlot(Base + ii);
+    }
+
+    Base = newBase;
+
+    // Rows have no coefficients left below Base: unknown sources freed
+    // their rows and known ones were eliminated.  Keep every row's bounds
+    // inside the history so that a reused slot is never read as the
+    // sequence that used to be in it
+    for (Row& r : Rows)
+        if (r.Used && IsSequenceNewer(Base, r.Lo))
+            r.Lo = Base;
+}
+
+void WindowDecoder::ExpireSlot(uint32_t sequence)
+{
+    const unsigned column = sequence & HistoryMask;
+
+    if (Known[column])
+    {
+        Known[column] = 0;
+        return;
+    }
+
+    ++LostCount;
+
+    // Rows that still involve this source can no longer be solved
+    for (int ii = 0; ii < (int)HistorySize; ++ii)
+        if (Rows[ii].Used && GetCoeffs(ii)[column] != 0)
+            FreeRow(ii);
+}
+
+void WindowDecoder::FreeRow(int row)
+{
+    Row& r = Rows[row];
+    if (!r.Used)
+        return;
+    r.Used = false;
+    PivotRow[r.Pivot & HistoryMask] = -1;
+}
+
+bool WindowDecoder::OnSource(uint32_t sequence, const uint8_t* data)
+{
+    if (!Deliver || !data)
+        return false;
+
+    Start(sequence);
+
+    if (IsSequenceNewer(Base, sequence) || (!IsSequenceNewer(sequence, Newest) && Known[sequence & HistoryMask]))
+        return true;
+
+    Advance(sequence);
+    AddKnown(sequence, data, false);
+    DeliverSolved();
+    return true;
+}
+
+void WindowDecoder::AddKnown(uint32_t sequence, const uint8_t* data, bool recovered)
+{
+    const unsigned column = sequence & HistoryMask;
+    uint8_t* source = GetSource(sequence);
+
+    if (source != data)
+        memcpy(source, data, Settings.BlockBytes);
+    Known[column] = 1;
+
+    if (recovered)
+        ++RecoveredCount;
+    Deliver(sequence, source, Settings.BlockBytes);
+
+    // Solved rows are freed before this, so only a received source can be
+    // in use as a pivot here
+    int repivot = -1;
+
+    for (int ii = 0; ii < (int)HistorySize; ++ii)
+    {
+        uint8_t* coeffs = GetCoeffs(ii);
+        const uint8_t coeff = coeffs[column];
+        if (!Rows[ii].Used || coeff == 0)
+            continue;
+
+        gf256_muladd_mem(GetData(ii), coeff, source, Settings.BlockBytes);
+        coeffs[column] = 0;
+
+        if (Rows[ii].Pivot == sequence)
+        {
+            PivotRow[column] = -1;
+            repivot = ii;
+        }
+    }
+
+    if (repivot >= 0)
+        InsertRow(repivot);
+}
+
+bool WindowDecoder::OnRepair(const WindowRepair& header, const uint8_t* data)
+{
+    if (!Deliver || !data || header.Count == 0 || header.Count > Settings.WindowSize)
+        return false;
+
+    const uint32_t last = header.FirstSequence + header.Count - 1;
+
+    Start(header.FirstSequence);
+
+    // Covers sources that have already left the history
+    if (IsSequenceNewer(Base, header.FirstSequence))
+        return true;
+
+    Advance(last);
+
+    int row = -1;
+    for (int ii = 0; ii < (int)HistorySize; ++ii)
+    {
+        if (!Rows[ii].Used)
+        {
+            row = ii;
+            break;
+        }
+    }
+
+    // Every unknown source already has a row
+    if (row < 0)
+        return true;
+
+    uint8_t* coeffs = GetCoeffs(row);
+    uint8_t* rowData = GetData(row);
+    memset(coeffs, 0, HistorySize);
+    memcpy(rowData, data, Settings.BlockBytes);
+
+    bool any = false;
+    for (unsigned ii = 0; ii < header.Count; ++ii)
+    {
+        const uint32_t sequence = header.FirstSequence + ii;
+        const unsigned column = sequence & HistoryMask;
+        const uint8_t coeff = WindowCoefficient(header.RepairId, sequence);
+
+        if (Known[column])
+            gf256_muladd_mem(rowData, coeff, GetSource(sequence), Settings.BlockBytes);
+        else
+        {
+            coeffs[column] = coeff;
+            any = true;
+        }
+    }
+
+    // Nothing missing
+    if (!any)
+        return true;
+
+    Row& r = Rows[row];
+    r.Used = true;
+    r.Lo = header.FirstSequence;
+    r.Hi = last;
+    r.Pivot = Base - 1;
+
+    InsertRow(row);
+    DeliverSolved();
+    return true;
+}
+
+void WindowDecoder::InsertRow(int row)
+{
+    Row& r = Rows[row];
+    uint8_t* coeffs = GetCoeffs(row);
+    uint8_t* rowData = GetData(row);
+
+    // Eliminate the pivots of the other rows.  This only brings in columns
+    // that are not pivots, so one pass is enough
+    for (uint32_t sequence = r.Lo; !IsSequenceNewer(sequence, r.Hi); ++sequence)
+    {
+        const unsigned column = sequence & HistoryMask;
+        const uint8_t coeff = coeffs[column];
+        const int other = PivotRow[column];
+        if (coeff == 0 || other < 0 || other == row)
+            continue;
+
+        const uint8_t* otherCoeffs = GetCoeffs(other);
+        const uint8_t factor = gf256_div(coeff, otherCoeffs[column]);
+        gf256_muladd_mem(coeffs, factor, otherCoeffs, HistorySize);
+        gf256_muladd_mem(rowData, factor, GetData(other), Settings.BlockBytes);
+
+        if (IsSequenceNewer(r.Lo, Rows[other].Lo))
+            r.Lo = Rows[other].Lo;
+        if (IsSequenceNewer(Rows[other].Hi, r.Hi))
+            r.Hi = Rows[other].Hi;
+    }
+
+    // Tighten the bounds
+    while (!IsSequenceNewer(r.Lo, r.Hi) && coeffs[r.Lo & HistoryMask] == 0)
+        ++r.Lo;
+    if (IsSequenceNewer(r.Lo, r.Hi))
+    {
+        // Linearly dependent on the rows we have
+        r.Used = false;
+        return;
+    }
+    while (coeffs[r.Hi & HistoryMask] == 0)
+        --r.Hi;
+
+    // Pivot on the oldest source so it is solved first.  The row is not
+    // normalized: the pivot coefficient is divided out when it is solved
+    r.Pivot = r.Lo;
+    const unsigned pivotColumn = r.Pivot & HistoryMask;
+    const uint8_t pivotCoeff = coeffs[pivotColumn];
+    PivotRow[pivotColumn] = row;
+
+    // Eliminate the new pivot from the other rows
+    for (int ii = 0; ii < (int)HistorySize; ++ii)
+    {
+        if (ii == row || !Rows[ii].Used)
+            continue;
+        uint8_t* otherCoeffs = GetCoeffs(ii);
+        const uint8_t coeff = otherCoeffs[pivotColumn];
+        if (coeff == 0)
+            continue;
+
+        const uint8_t factor = gf256_div(coeff, pivotCoeff);
+        gf256_muladd_mem(otherCoeffs, factor, coeffs, HistorySize);
+        gf256_muladd_mem(GetData(ii), factor, rowData, Settings.BlockBytes);
+
+        Row& o = Rows[ii];
+        if (IsSequenceNewer(o.Lo, r.Lo))
+            o.Lo = r.Lo;
+        if (IsSequenceNewer(r.Hi, o.Hi))
+            o.Hi = r.Hi;
+    }
+}
+
+void WindowDecoder::DeliverSolved()
+{
+    // Solving one row never changes the others since its pivot is already
+    // zero in them, so a single pass finds everything
+    for (int ii = 0; ii < (int)HistorySize; ++ii)
+    {
+        Row& r = Rows[ii];
+        if (!r.Used)
+            continue;
+
+        const uint8_t* coeffs = GetCoeffs(ii);
+        bool solved = true;
+        for (uint32_t sequence = r.Lo; !IsSequenceNewer(sequence, r.Hi); ++sequence)
+        {
+            if (sequence != r.Pivot && coeffs[sequence & HistoryMask] != 0)
+            {
+                solved = false;
+                break;
+            }
+        }
+        if (!solved)
+            continue;
+
+        FreeRow(ii);
+
+        uint8_t* source = GetSource(r.Pivot);
+        gf256_div_mem(source, GetData(ii), coeffs[r.Pivot & HistoryMask], Settings.BlockBytes);
+        AddKnown(r.Pivot, source, true);
+    }
+}
+
+
+} // namespace longhair
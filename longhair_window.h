@@ -0,0 +1,265 @@
+/** \file
+    \brief Longhair: Sliding-Window FEC
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+/**
+    Sliding-window (convolutional) packet FEC
+
+    The block session layer can only recover a lost original once enough
+    rows of its whole generation have arrived, so the recovery latency grows
+    with K.  In window mode there are no generations: every source packet
+    gets a sequence number, and each repair packet is a combination of the
+    last W source packets sent.  The receiver solves incrementally as
+    packets arrive, so a lost packet is recovered as soon as enough repair
+    packets covering it are in, at most W source packets later.
+
+    Repair coefficients come from a Cauchy matrix over GF(256): the repair
+    with id r multiplies source s by 1 / (X(r) + Y(s)) with
+    X(r) = 128 + r % 128 and Y(s) = s % 128, so W is at most 128.  Since X
+    and Y repeat, repairs whose windows only partly overlap are not
+    guaranteed to be independent, and a dependent one is simply unused.
+
+    WindowEncoder keeps a copy of the last W sources.  The caller sends each
+    source packet with its sequence number, and every so often calls
+    GenerateRepair() and sends the repair with its WindowRepair header.
+
+    WindowDecoder copies the packets it is given and keeps the last 2W
+    sources (rounded up to a power of two) along with the unsolved repair
+    rows in reduced row echelon form.  Originals are delivered as they
+    arrive and recovered ones as soon as they are solved, which can be out
+    of order.  Sources that drop out of the history unsolved are counted
+    as lost.
+*/
+
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace longhair {
+
+
+//------------------------------------------------------------------------------
+// Settings
+
+/// Largest supported window
+static const unsigned kMaxWindowSize = 128;
+
+struct WindowSettings
+{
+    /// Source packets covered by each repair packet: 1..kMaxWindowSize
+    unsigned WindowSize = 0;
+
+    /// Bytes per packet
+    int BlockBytes = 0;
+
+    bool IsValid() const
+    {
+        return WindowSize > 0 && WindowSize <= kMaxWindowSize && BlockBytes > 0;
+    }
+};
+
+/// Header carried by each repair packet
+struct WindowRepair
+{
+    /// Sequence number of the first source covered
+    uint32_t FirstSequence = 0;
+
+    /// Number of sources covered: 1..WindowSize
+    unsigned Count = 0;
+
+    /// Selects the coefficients
+    uint32_t RepairId = 0;
+};
+
+/// Cauchy coefficient applied to source `sequence` in repair `repairId`
+uint8_t WindowCoefficient(uint32_t repairId, uint32_t sequence);
+
+
+//------------------------------------------------------------------------------
+// WindowEncoder
+
+class WindowEncoder
+{
+public:
+    /// Returns false if the settings are invalid or gf256_init() failed
+    bool Initialize(const WindowSettings& settings);
+
+    /// Remember the next source packet and return its sequence number.
+    /// The data is copied
+    uint32_t AddSource(const uint8_t* data);
+
+    /**
+        Write a repair packet covering the last WindowSize sources (or all
+        of them if fewer have been added) into `repair`, which must be
+        BlockBytes long.
+
+        Returns false if not initialized or no sources have been added.
+    */
+    bool GenerateRepair(uint8_t* repair, WindowRepair& header);
+
+    /// Sequence number the next AddSource() will return
+    uint32_t GetNextSequence() const
+    {
+        return NextSequence;
+    }
+
+protected:
+    WindowSettings Settings;
+
+    /// Last WindowSize sources, indexed by sequence % WindowSize
+    std::vector<uint8_t> History;
+
+    uint32_t NextSequence = 0;
+    uint32_t NextRepairId = 0;
+
+    /// Sources added, saturating at WindowSize
+    unsigned Count = 0;
+};
+
+
+//------------------------------------------------------------------------------
+// WindowDecoder
+
+/// Called with each source packet, received or recovered.  The data is only
+/// valid during the call
+typedef std::function<void(uint32_t sequence, const uint8_t* data, int bytes)> WindowDeliverT;
+
+class WindowDecoder
+{
+public:
+    /// Returns false if the settings are invalid or gf256_init() failed
+    bool Initialize(const WindowSettings& settings, WindowDeliverT deliver);
+
+    /// Process a source packet.  Duplicates and packets that are older
+    /// than the history are ignored.  Returns false if not initialized
+    bool OnSource(uint32_t sequence, const uint8_t* data);
+
+    /// Process a repair packet.  Returns false if the header is invalid
+    bool OnRepair(const WindowRepair& header, const uint8_t* data);
+
+    /// Forget all sources and rows
+    void Reset();
+
+    /// Sources recovered from repair packets
+    uint64_t GetRecoveredCount() const
+    {
+        return RecoveredCount;
+    }
+
+    /// Sources that left the history without being received or recovered
+    uint64_t GetLostCount() const
+    {
+        return LostCount;
+    }
+
+protected:
+    WindowSettings Settings;
+    WindowDeliverT Deliver;
+
+    /// Sources kept: a power of two at least 2 * WindowSize
+    unsigned HistorySize = 0;
+    unsigned HistoryMask = 0;
+
+    /// Seen a packet since Reset()
+    bool Started = false;
+
+    /// Oldest and newest sequence numbers in the history
+    uint32_t Base = 0;
+    uint32_t Newest = 0;
+
+    /// Source data and state, indexed by sequence & HistoryMask
+    std::vector<uint8_t> Sources;
+    std::vector<uint8_t> Known;
+
+    /**
+        Unsolved repair rows, up to HistorySize of them.
+
+        Each row is a coefficient per history slot and the combined data.
+        Every row has a pivot column that is zero in all the other rows,
+        and received sources are eliminated from all rows.
+    */
+    struct Row
+    {
+        bool Used = false;
+
+        /// Sequence numbers bounding the nonzero coefficients
+        uint32_t Lo = 0, Hi = 0;
+
+        /// Pivot sequence number
+        uint32_t Pivot = 0;
+    };
+    std::vector<Row> Rows;
+    std::vector<uint8_t> RowCoeffs;
+    std::vector<uint8_t> RowData;
+
+    /// Row pivoting on each history slot, or -1
+    std::vector<int> PivotRow;
+
+    uint64_t RecoveredCount = 0;
+    uint64_t LostCount = 0;
+
+    uint8_t* GetSource(uint32_t sequence)
+    {
+        return &Sources[(size_t)(sequence & HistoryMask) * Settings.BlockBytes];
+    }
+    uint8_t* GetCoeffs(int row)
+    {
+        return &RowCoeffs[(size_t)row * HistorySize];
+    }
+    uint8_t* GetData(int row)
+    {
+        return &RowData[(size_t)row * Settings.BlockBytes];
+    }
+
+    /// Start tracking from the given sequence number on the first packet
+    void Start(uint32_t sequence);
+
+    /// Move the history forward so that it ends at `sequence`
+    void Advance(uint32_t sequence);
+
+    /// Drop a slot leaving the history, and any row that uses it
+    void ExpireSlot(uint32_t sequence);
+
+    /// Store and deliver a source, and eliminate it from all rows
+    void AddKnown(uint32_t sequence, const uint8_t* data, bool recovered);
+
+    /// Reduce a new or changed row against the pivots, choose its pivot and
+    /// eliminate that from the other rows.  Frees the row if it is redundant
+    void InsertRow(int row);
+
+    /// Deliver every row that has been reduced to a single source
+    void DeliverSolved();
+
+    void FreeRow(int row);
+};
+
+
+} // namespace longhair
@@ -0,0 +1,192 @@
+/** \file
+    \brief Longhair: Packet Wire Header
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+/**
+    Packet wire header
+
+    A fixed 16-byte header for FEC packets, followed directly by the block:
+
+        Offset  Size  Field
+             0     1  Version (kWireVersion)
+             1     1  K: original blocks in the generation (1..255)
+             2     1  M: recovery blocks in the generation (1..256-K)
+             3     1  Row: 0..K-1 originals, K..K+M-1 recovery blocks
+             4     4  Generation
+             8     4  OriginalBytes: data in the generation before padding
+            12     2  BlockBytes: payload bytes, a multiple of 8
+            14     1  Flags (kWireFlag*)
+            15     1  Reserved, zero
+
+    Multi-byte fields are little-endian.
+
+    The header is a multiple of 16 bytes, so a packet buffer aligned to 16
+    bytes (BlockPool buffers are aligned to 64) gives a payload aligned for
+    the SIMD paths.  The codec splits each block into eight rows of
+    BlockBytes / 8, so those stay 8-byte aligned too.
+
+    OriginalBytes lets the receiver trim the zero padding that filled out
+    the last original blocks of a short generation, including originals it
+    recovered.  It works the same for every packet of the generation, so
+    any one packet is enough.
+
+    The helpers read and write the bytes in place with no alignment
+    requirement, so they work directly on receive buffers.  To receive
+    straight into GenerationManager buffers, scatter the header into its
+    own 16 bytes and the payload into the pool buffer (two iovecs).
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace longhair {
+
+
+//------------------------------------------------------------------------------
+// Format
+
+static const unsigned kWireHeaderBytes = 16;
+static const uint8_t kWireVersion = 1;
+
+/// Last packets of the stream: no more generations follow
+static const uint8_t kWireFlagEndOfStream = 1;
+
+struct WireHeader
+{
+    uint8_t K = 0;
+    uint8_t M = 0;
+    uint8_t Row = 0;
+    uint8_t Flags = 0;
+    uint32_t Generation = 0;
+    uint32_t OriginalBytes = 0;
+    uint16_t BlockBytes = 0;
+
+    bool IsOriginal() const
+    {
+        return Row < K;
+    }
+
+    bool IsValid() const
+    {
+        return K > 0 && M > 0 && K + M <= 256 && Row < K + M &&
+            BlockBytes > 0 && BlockBytes % 8 == 0 &&
+            OriginalBytes <= (uint32_t)K * BlockBytes;
+    }
+};
+
+/// Bytes of a packet carrying a block of the given size
+inline size_t WirePacketBytes(int blockBytes)
+{
+    return kWireHeaderBytes + (size_t)blockBytes;
+}
+
+
+//------------------------------------------------------------------------------
+// Build
+
+/// Write the header into the first kWireHeaderBytes of `packet` and return
+/// the payload location just after it
+inline uint8_t* WriteWireHeader(uint8_t* packet, const WireHeader& header)
+{
+    packet[0] = kWireVersion;
+    packet[1] = header.K;
+    packet[2] = header.M;
+    packet[3] = header.Row;
+    packet[4] = (uint8_t)header.Generation;
+    packet[5] = (uint8_t)(header.Generation >> 8);
+    packet[6] = (uint8_t)(header.Generation >> 16);
+    packet[7] = (uint8_t)(header.Generation >> 24);
+    packet[8] = (uint8_t)header.OriginalBytes;
+    packet[9] = (uint8_t)(header.OriginalBytes >> 8);
+    packet[10] = (uint8_t)(header.OriginalBytes >> 16);
+    packet[11] = (uint8_t)(header.OriginalBytes >> 24);
+    packet[12] = (uint8_t)header.BlockBytes;
+    packet[13] = (uint8_t)(header.BlockBytes >> 8);
+    packet[14] = header.Flags;
+    packet[15] = 0;
+    return packet + kWireHeaderBytes;
+}
+
+
+//------------------------------------------------------------------------------
+// Parse
+
+/// Read a header from the first kWireHeaderBytes of `data`.  Returns false
+/// if the version is unknown, the reserved byte is set or the fields are
+/// inconsistent
+inline bool ReadWireHeader(const uint8_t* data, WireHeader& header)
+{
+    // A nonzero reserved byte is from a newer format this version cannot read
+    if (data[0] != kWireVersion || data[15] != 0)
+        return false;
+
+    header.K = data[1];
+    header.M = data[2];
+    header.Row = data[3];
+    header.Generation = (uint32_t)data[4] | ((uint32_t)data[5] << 8) |
+        ((uint32_t)data[6] << 16) | ((uint32_t)data[7] << 24);
+    header.OriginalBytes = (uint32_t)data[8] | ((uint32_t)data[9] << 8) |
+        ((uint32_t)data[10] << 16) | ((uint32_t)data[11] << 24);
+    header.BlockBytes = (uint16_t)(data[12] | (data[13] << 8));
+    header.Flags = data[14];
+
+    return header.IsValid();
+}
+
+/**
+    Parse a whole packet of `bytes` in place.
+
+    On success fills in the header and points `payload` at the block inside
+    the packet, without copying.  Returns false if the header is invalid or
+    the packet length does not match BlockBytes.
+*/
+inline bool ParseWirePacket(const uint8_t* packet, size_t bytes, WireHeader& header, const uint8_t*& payload)
+{
+    if (bytes < kWireHeaderBytes || !ReadWireHeader(packet, header) ||
+        bytes != WirePacketBytes(header.BlockBytes))
+        return false;
+
+    payload = packet + kWireHeaderBytes;
+    return true;
+}
+
+/// Bytes of real data in original `row`, after trimming the padding.
+/// 0 for rows that are entirely padding
+inline int WireOriginalBytes(const WireHeader& header, unsigned row)
+{
+    const uint64_t start = (uint64_t)row * header.BlockBytes;
+    if (start >= header.OriginalBytes)
+        return 0;
+    const uint64_t remaining = header.OriginalBytes - start;
+    return remaining < header.BlockBytes ? (int)remaining : (int)header.BlockBytes;
+}
+
+
+} // namespace longhair
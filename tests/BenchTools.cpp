@@ -0,0 +1,506 @@
+/** \file
+    \brief Longhair Benchmarks: Tools
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "BenchTools.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if !defined(_WIN32)
+    #include <unistd.h> // sysconf
+#endif
+
+#if defined(__linux__)
+    #include <cerrno>
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+#endif
+
+namespace bench {
+
+
+//------------------------------------------------------------------------------
+// Timing
+
+static double m_CyclesPerUsec = 0.;
+
+double GetCyclesPerUsec()
+{
+    if (m_CyclesPerUsec > 0.)
+        return m_CyclesPerUsec;
+
+    // Spin for ~50 msec and compare the two clocks
+    const uint64_t t0 = siamese::GetTimeUsec();
+    const uint64_t c0 = siamese::GetCycles();
+    uint64_t t1;
+    do {
+        t1 = siamese::GetTimeUsec();
+    } while (t1 - t0 < 50000);
+    const uint64_t c1 = siamese::GetCycles();
+
+    m_CyclesPerUsec = (double)(c1 - c0) / (double)(t1 - t0);
+    if (m_CyclesPerUsec <= 0.)
+        m_CyclesPerUsec = 1.;
+    return m_CyclesPerUsec;
+}
+
+
+//------------------------------------------------------------------------------
+// System
+
+CacheSizes GetCacheSizes()
+{
+    CacheSizes sizes;
+
+#if defined(_SC_LEVEL1_DCACHE_SIZE)
+    const long l1 = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+    const long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    const long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    sizes.L1 = l1 > 0 ? (uint64_t)l1 : 0;
+    sizes.L2 = l2 > 0 ? (uint64_t)l2 : 0;
+    sizes.L3 = l3 > 0 ? (uint64_t)l3 : 0;
+#endif // _SC_LEVEL1_DCACHE_SIZE
+
+#if defined(__linux__)
+    // Fall back to sysfs when libc does not know
+    for (int index = 0; index < 8 && (!sizes.L1 || !sizes.L2 || !sizes.L3); ++index)
+    {
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/level", index);
+        FILE* file = fopen(path, "r");
+        if (!file)
+            break;
+        int level = 0;
+        const bool gotLevel = fscanf(file, "%d", &level) == 1;
+        fclose(file);
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/type", index);
+        file = fopen(path, "r");
+        char type[32] = {};
+        const bool gotType = file && fscanf(file, "%31s", type) == 1;
+        if (file)
+            fclose(file);
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", index);
+        file = fopen(path, "r");
+        unsigned long kb = 0;
+        const bool gotSize = file && fscanf(file, "%luK", &kb) == 1;
+        if (file)
+            fclose(file);
+
+        if (!gotLevel || !gotType || !gotSize || 0 == strcmp(type, "Instruction"))
+            continue;
+
+        uint64_t* target = level == 1 ? &sizes.L1 : level == 2 ? &sizes.L2 : level == 3 ? &sizes.L3 : nullptr;
+        if (target && !*target)
+            *target = (uint64_t)kb * 1024;
+    }
+#endif // __linux__
+
+    return sizes;
+}
+
+
+//------------------------------------------------------------------------------
+// Performance Counters
+
+#if defined(__linux__)
+
+static int OpenPerfEvent(uint32_t type, uint64_t config, int groupFd)
+{
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = groupFd < 0 ? 1 : 0; // Members follow the leader
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (int fd : Fds)
+        if (fd >= 0)
+            close(fd);
+}
+
+bool PerfCounters::Open()
+{
+    static const uint64_t kL1DReadMiss = PERF_COUNT_HW_CACHE_L1D |
+        (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+    const struct {
+        uint32_t Type;
+        uint64_t Config;
+    } events[(int)PerfEvent::Count] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HW_CACHE, kL1DReadMiss },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+    };
+
+    int lastErrno = 0;
+    for (int ii = 0; ii < (int)PerfEvent::Count; ++ii)
+    {
+        if (Fds[ii] >= 0)
+            continue;
+        Fds[ii] = OpenPerfEvent(events[ii].Type, events[ii].Config, Leader);
+        if (Fds[ii] < 0)
+            lastErrno = errno;
+        else if (Leader < 0)
+            Leader = Fds[ii];
+    }
+
+    if (Leader >= 0)
+    {
+        ErrorText = nullptr;
+        return true;
+    }
+
+    switch (lastErrno)
+    {
+    case ENOENT:
+    case EOPNOTSUPP: ErrorText = "no hardware counters (virtual machine?)"; break;
+    case EACCES:
+    case EPERM: ErrorText = "permission denied (see /proc/sys/kernel/perf_event_paranoid)"; break;
+    case ENOSYS: ErrorText = "perf_event_open() not supported by the kernel"; break;
+    default: ErrorText = "perf_event_open() failed"; break;
+    }
+    return false;
+}
+
+void PerfCounters::Reset()
+{
+    if (Leader >= 0)
+        ioctl(Leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+}
+
+void PerfCounters::Start()
+{
+    if (Leader >= 0)
+        ioctl(Leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void PerfCounters::Stop()
+{
+    if (Leader >= 0)
+        ioctl(Leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+}
+
+uint64_t PerfCounters::Read(PerfEvent event) const
+{
+    const int fd = Fds[(int)event];
+    if (fd < 0)
+        return 0;
+
+    // Value, time enabled, time running
+    uint64_t values[3];
+    if (read(fd, values, sizeof(values)) != (ssize_t)sizeof(values) || values[2] == 0)
+        return 0;
+    if (values[2] >= values[1])
+        return values[0];
+    return (uint64_t)((double)values[0] * values[1] / values[2]);
+}
+
+#else // __linux__
+
+PerfCounters::~PerfCounters()
+{
+}
+
+bool PerfCounters::Open()
+{
+    ErrorText = "only supported on Linux";
+    return false;
+}
+
+void PerfCounters::Reset()
+{
+}
+
+void PerfCounters::Start()
+{
+}
+
+void PerfCounters::Stop()
+{
+}
+
+uint64_t PerfCounters::Read(PerfEvent) const
+{
+    return 0;
+}
+
+#endif // __linux__
+
+
+//------------------------------------------------------------------------------
+// Statistics
+
+double Percentile(const std::vector<uint64_t>& sorted, double fraction)
+{
+    if (sorted.empty())
+        return 0.;
+    size_t index = (size_t)(fraction * (double)(sorted.size() - 1) + 0.5);
+    if (index >= sorted.size())
+        index = sorted.size() - 1;
+    return (double)sorted[index];
+}
+
+SampleSummary Summarize(std::vector<uint64_t>& samples)
+{
+    SampleSummary summary;
+    if (samples.empty())
+        return summary;
+
+    std::sort(samples.begin(), samples.end());
+
+    double sum = 0.;
+    for (uint64_t sample : samples)
+        sum += (double)sample;
+
+    summary.Count = samples.size();
+    summary.Min = (double)samples.front();
+    summary.Max = (double)samples.back();
+    summary.Mean = sum / (double)samples.size();
+    summary.Median = Percentile(samples, 0.5);
+    summary.P99 = Percentile(samples, 0.99);
+    summary.P999 = Percentile(samples, 0.999);
+    return summary;
+}
+
+
+//------------------------------------------------------------------------------
+// Loss Models
+
+GilbertElliottLoss::GilbertElliottLoss(uint64_t seed, double p, double r, double goodLoss, double badLoss)
+    : P(p)
+    , R(r)
+    , GoodLoss(goodLoss)
+    , BadLoss(badLoss)
+{
+    Prng.Seed(seed);
+}
+
+bool GilbertElliottLoss::NextLost()
+{
+    if (Bad)
+        Bad = NextUnit() >= R;
+    else
+        Bad = NextUnit() < P;
+
+    return NextUnit() < (Bad ? BadLoss : GoodLoss);
+}
+
+double GilbertElliottLoss::SteadyStateLoss() const
+{
+    if (P + R <= 0.)
+        return GoodLoss;
+    return (R * GoodLoss + P * BadLoss) / (P + R);
+}
+
+bool TraceLoss::Load(const char* path)
+{
+    Trace.clear();
+    Position = 0;
+
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return false;
+
+    int c;
+    while ((c = fgetc(file)) != EOF)
+    {
+        if (c == '0' || c == '1')
+            Trace.push_back((uint8_t)(c - '0'));
+    }
+    fclose(file);
+
+    return !Trace.empty();
+}
+
+bool TraceLoss::NextLost()
+{
+    const bool lost = Trace[Position] != 0;
+    if (++Position >= Trace.size())
+        Position = 0;
+    return lost;
+}
+
+
+//------------------------------------------------------------------------------
+// Command line
+
+bool ParseList(const char* text, std::vector<int>& values)
+{
+    values.clear();
+    if (!text || !*text)
+        return false;
+
+    const char* p = text;
+    for (;;)
+    {
+        char* end = nullptr;
+        const long first = strtol(p, &end, 10);
+        if (end == p)
+            return false;
+        long last = first, step = 1;
+        p = end;
+
+        if (*p == '-')
+        {
+            last = strtol(p + 1, &end, 10);
+            if (end == p + 1)
+                return false;
+            p = end;
+
+            if (*p == ':')
+            {
+                step = strtol(p + 1, &end, 10);
+                if (end == p + 1 || step <= 0)
+                    return false;
+                p = end;
+            }
+        }
+
+        if (last < first)
+            return false;
+        for (long value = first; value <= last; value += step)
+            values.push_back((int)value);
+
+        if (*p == '\0')
+            break;
+        if (*p != ',')
+            return false;
+        ++p;
+    }
+
+    return true;
+}
+
+
+//------------------------------------------------------------------------------
+// Report
+
+static bool IsNumber(const std::string& text)
+{
+    if (text.empty())
+        return false;
+    char* end = nullptr;
+    strtod(text.c_str(), &end);
+    return end && *end == '\0';
+}
+
+static const unsigned kMinColumnWidth = 10;
+
+void Report::Columns(const std::vector<std::string>& names)
+{
+    Names = names;
+
+    switch (Format)
+    {
+    case ReportFormat::Table:
+        for (const std::string& name : Names)
+        {
+            const unsigned width = std::max(kMinColumnWidth, (unsigned)name.size() + 2);
+            printf("%*s", (int)width, name.c_str());
+        }
+        printf("\n");
+        break;
+    case ReportFormat::CSV:
+        for (size_t ii = 0; ii < Names.size(); ++ii)
+            printf("%s%s", ii ? "," : "", Names[ii].c_str());
+        printf("\n");
+        break;
+    case ReportFormat::JSON:
+        printf("[\n");
+        break;
+    }
+
+    Started = true;
+    fflush(stdout);
+}
+
+void Report::Row(const std::vector<std::string>& values)
+{
+    switch (Format)
+    {
+    case ReportFormat::Table:
+        for (size_t ii = 0; ii < values.size() && ii < Names.size(); ++ii)
+        {
+            const unsigned width = std::max(kMinColumnWidth, (unsigned)Names[ii].size() + 2);
+            printf("%*s", (int)width, values[ii].c_str());
+        }
+        printf("\n");
+        break;
+    case ReportFormat::CSV:
+        for (size_t ii = 0; ii < values.size(); ++ii)
+            printf("%s%s", ii ? "," : "", values[ii].c_str());
+        printf("\n");
+        break;
+    case ReportFormat::JSON:
+        printf("%s  {", RowCount ? ",\n" : "");
+        for (size_t ii = 0; ii < values.size() && ii < Names.size(); ++ii)
+        {
+            if (IsNumber(values[ii]))
+                printf("%s\"%s\": %s", ii ? ", " : "", Names[ii].c_str(), values[ii].c_str());
+            else
+                printf("%s\"%s\": \"%s\"", ii ? ", " : "", Names[ii].c_str(), values[ii].c_str());
+        }
+        printf("}");
+        break;
+    }
+
+    ++RowCount;
+    fflush(stdout);
+}
+
+void Report::End()
+{
+    if (Format == ReportFormat::JSON && Started)
+        printf("%s]\n", RowCount ? "\n" : "");
+    fflush(stdout);
+}
+
+std::string Fixed(double value, int digits)
+{
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+    return buffer;
+}
+
+
+} // namespace bench
@@ -0,0 +1,275 @@
+/** \file
+    \brief Longhair Benchmarks: Tools
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+/**
+    Tools shared by the benchmark executables:
+
+    + Cycle counter calibration
+    + Cache size detection
+    + Hardware performance counters (Linux perf_event)
+    + Sample statistics (median/p99)
+    + Packet loss models
+    + Command-line list parsing
+    + Table/CSV/JSON report output
+*/
+
+#include "../SiameseTools.h"
+
+#include <string>
+#include <vector>
+
+namespace bench {
+
+
+//------------------------------------------------------------------------------
+// Timing
+
+/// Returns the number of siamese::GetCycles() ticks per microsecond.
+/// Measured once against GetTimeUsec() and cached.
+double GetCyclesPerUsec();
+
+/// Convert cycle counter ticks to microseconds
+inline double CyclesToUsec(double cycles)
+{
+    return cycles / GetCyclesPerUsec();
+}
+
+
+//------------------------------------------------------------------------------
+// System
+
+/// Data cache sizes in bytes.  Zero if unknown
+struct CacheSizes
+{
+    uint64_t L1 = 0;
+    uint64_t L2 = 0;
+    uint64_t L3 = 0;
+};
+
+/// Query the data cache sizes of the current CPU
+CacheSizes GetCacheSizes();
+
+
+//------------------------------------------------------------------------------
+// Performance Counters
+
+enum class PerfEvent
+{
+    Instructions, ///< Instructions retired
+    Cycles,       ///< Core clock cycles (not the TSC)
+    L1DMisses,    ///< L1 data cache read misses
+    BranchMisses, ///< Mispredicted branches
+
+    Count
+};
+
+/**
+    Hardware performance counters for the calling thread, user mode only.
+
+    Counting is switched on and off with Start()/Stop() so that only the code
+    between them is measured, and accumulates until Reset().  Uses
+    perf_event_open() on Linux.  Elsewhere, or when the kernel does not allow
+    it (no PMU in a VM, perf_event_paranoid), Open() fails and the benchmark
+    runs without counters.
+*/
+class PerfCounters
+{
+public:
+    ~PerfCounters();
+
+    /// Open as many of the events as possible.  Returns false if none are
+    /// available, and Error() gives the reason
+    bool Open();
+
+    /// Returns true if the event is being counted
+    bool Has(PerfEvent event) const
+    {
+        return Fds[(int)event] >= 0;
+    }
+
+    void Reset();
+    void Start();
+    void Stop();
+
+    /// Count since Reset(), scaled up if the kernel had to multiplex the
+    /// counters.  Returns 0 if the event is not available
+    uint64_t Read(PerfEvent event) const;
+
+    const char* Error() const
+    {
+        return ErrorText;
+    }
+
+protected:
+    int Fds[(int)PerfEvent::Count] = { -1, -1, -1, -1 };
+
+    /// Group leader: First open event
+    int Leader = -1;
+
+    const char* ErrorText = "not opened";
+};
+
+
+//------------------------------------------------------------------------------
+// Statistics
+
+/// Summary of a set of timing samples
+struct SampleSummary
+{
+    uint64_t Count = 0;
+    double Min = 0.;
+    double Mean = 0.;
+    double Median = 0.;
+    double P99 = 0.;
+    double P999 = 0.;
+    double Max = 0.;
+};
+
+/// Summarize the samples.  The input is sorted in place
+SampleSummary Summarize(std::vector<uint64_t>& samples);
+
+/// Returns the value at the given fraction (0..1) of sorted samples
+double Percentile(const std::vector<uint64_t>& sorted, double fraction);
+
+
+//------------------------------------------------------------------------------
+// Loss Models
+
+/// Packet loss process.  Each call decides whether the next packet is lost
+class LossModel
+{
+public:
+    virtual ~LossModel() = default;
+    virtual bool NextLost() = 0;
+};
+
+/**
+    Two-state Gilbert-Elliott burst loss model.
+
+    In the Good state packets are lost with probability GoodLoss and in the
+    Bad state with probability BadLoss.  Before each packet the model moves
+    Good -> Bad with probability P and Bad -> Good with probability R, so the
+    mean burst length is about 1/R packets and the steady-state loss rate is
+    (R * GoodLoss + P * BadLoss) / (P + R).
+*/
+class GilbertElliottLoss : public LossModel
+{
+public:
+    GilbertElliottLoss(uint64_t seed, double p, double r, double goodLoss = 0., double badLoss = 1.);
+
+    bool NextLost() override;
+
+    /// Expected long-run loss rate
+    double SteadyStateLoss() const;
+
+protected:
+    siamese::PCGRandom Prng;
+    double P, R, GoodLoss, BadLoss;
+    bool Bad = false;
+
+    /// Uniform in [0, 1)
+    double NextUnit()
+    {
+        return Prng.Next() / 4294967296.;
+    }
+};
+
+/// Replays a recorded loss trace, wrapping around at the end
+class TraceLoss : public LossModel
+{
+public:
+    /// Load a trace file of '0' (received) and '1' (lost) characters.
+    /// Any other characters are ignored.  Returns false on error or if empty
+    bool Load(const char* path);
+
+    bool NextLost() override;
+
+    size_t Size() const
+    {
+        return Trace.size();
+    }
+
+protected:
+    std::vector<uint8_t> Trace;
+    size_t Position = 0;
+};
+
+
+//------------------------------------------------------------------------------
+// Command line
+
+/// Parse a list like "4", "1-8", "1-64:8" or "2,5,9-12" into values.
+/// Returns false if the list is malformed
+bool ParseList(const char* text, std::vector<int>& values);
+
+
+//------------------------------------------------------------------------------
+// Report
+
+enum class ReportFormat
+{
+    Table,
+    CSV,
+    JSON
+};
+
+/// Writes rows of named columns to stdout as an aligned table, CSV or JSON.
+/// JSON output is an array of objects with one object per row
+class Report
+{
+public:
+    explicit Report(ReportFormat format = ReportFormat::Table)
+        : Format(format)
+    {
+    }
+
+    /// Set the column names.  Must be called before the first Row()
+    void Columns(const std::vector<std::string>& names);
+
+    /// Write one row.  Values are pre-formatted strings, one per column.
+    /// Values that parse as numbers are written unquoted in JSON
+    void Row(const std::vector<std::string>& values);
+
+    /// Finish the output (closes the JSON array)
+    void End();
+
+protected:
+    ReportFormat Format;
+    std::vector<std::string> Names;
+    bool Started = false;
+    unsigned RowCount = 0;
+};
+
+/// Format a number with the given digits after the decimal point
+std::string Fixed(double value, int digits);
+
+
+} // namespace bench
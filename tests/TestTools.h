@@ -0,0 +1,122 @@
+/** \file
+    \brief Longhair Tests: Tools
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+/**
+    Helpers shared by the unit test executables:
+
+    + TEST_CHECK() assertion that counts failures and keeps going
+    + Random buffer fill
+    + Serial reference encode
+
+    Each test executable returns non-zero if any check failed, so they can
+    be run from ctest.
+*/
+
+#include "../cauchy_256.h"
+#include "../SiameseTools.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+namespace test {
+
+
+//------------------------------------------------------------------------------
+// Checks
+
+/// Number of failed TEST_CHECK()s in this executable
+inline int& FailureCount()
+{
+    static int count = 0;
+    return count;
+}
+
+#define TEST_CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            printf("FAILED: %s (%s:%d)\n", #cond, __FILE__, __LINE__); \
+            ++test::FailureCount(); \
+        } \
+    } while (false)
+
+/// Print a summary and return the process exit code
+inline int Finish(const char* name)
+{
+    if (FailureCount() != 0)
+    {
+        printf("%s: %d checks failed\n", name, FailureCount());
+        return 1;
+    }
+    printf("%s: all tests passed\n", name);
+    return 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Data
+
+inline void FillRandom(siamese::PCGRandom& prng, uint8_t* data, size_t bytes)
+{
+    for (size_t ii = 0; ii < bytes; ++ii)
+        data[ii] = (uint8_t)prng.Next();
+}
+
+/// Contiguous original blocks with pointers to each
+struct Stripe
+{
+    int K = 0, M = 0, BlockBytes = 0;
+    std::vector<uint8_t> Data;
+    std::vector<const uint8_t*> DataPtrs;
+
+    /// Recovery from the serial cauchy_256_encode()
+    std::vector<uint8_t> Expected;
+
+    void Initialize(siamese::PCGRandom& prng, int k, int m, int blockBytes)
+    {
+        K = k, M = m, BlockBytes = blockBytes;
+        Data.resize((size_t)k * blockBytes);
+        FillRandom(prng, Data.data(), Data.size());
+        DataPtrs.resize(k);
+        for (int ii = 0; ii < k; ++ii)
+            DataPtrs[ii] = &Data[(size_t)ii * blockBytes];
+        Expected.resize((size_t)m * blockBytes);
+        TEST_CHECK(0 == cauchy_256_encode(k, m, DataPtrs.data(), Expected.data(), blockBytes));
+    }
+
+    const uint8_t* GetOriginal(int row) const
+    {
+        return &Data[(size_t)row * BlockBytes];
+    }
+};
+
+
+} // namespace test
@@ -0,0 +1,1168 @@
+/** \file
+    \brief Longhair Benchmark
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+    Encoder/decoder benchmark.
+
+    Unlike the unit tester, each configuration is run through a number of
+    untimed warmup calls followed by many timed repetitions.  Each call is
+    timed individually with the cycle counter so that the median and tail
+    latency can be reported instead of a single noisy sample.
+
+    Example:
+        longhair_bench -k 29 -m 1-14 -b 1296 -r 2000 --csv
+        longhair_bench -k 29 -m 8 --ge 0.01,0.3 -g 100000
+        longhair_bench -k 64 -m 8 -b 8192 --cold pool
+        longhair_bench -k 29 -m 4 --threads all
+*/
+
+#include "../cauchy_256.h"
+#include "../SiameseTools.h"
+#include "BenchTools.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #include <emmintrin.h> // _mm_clflush
+    #define BENCH_HAS_CLFLUSH
+#endif
+
+
+//------------------------------------------------------------------------------
+// Settings
+
+/// Cache state of the buffers at the start of each timed call
+enum class CacheMode
+{
+    Hot,   ///< Same buffers every call
+    Pool,  ///< Cycle through a pool of buffers larger than the LLC
+    Flush  ///< clflush the buffers before every call
+};
+
+struct BenchSettings
+{
+    vector<int> K = { 29 };
+    vector<int> M = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14 };
+    vector<int> Bytes = { 1296 };
+
+    /// Empty means erase as many originals as there are recovery blocks
+    vector<int> Erasures;
+
+    int Warmup = 10;
+    int Repetitions = 1000;
+    uint64_t Seed = 0;
+
+    /// Use the _ex API to report where decode time goes
+    bool Phases = false;
+
+    /// Fit the cost model constants to the measurements
+    bool Calibrate = false;
+
+    /// Read hardware performance counters around each call
+    bool Counters = false;
+
+    CacheMode Cache = CacheMode::Hot;
+
+    /// Thread scaling mode: Thread counts to run
+    vector<int> Threads;
+
+    /// Loss mode: Gilbert-Elliott parameters "p,r[,good_loss,bad_loss]"
+    const char* GilbertElliott = nullptr;
+
+    /// Loss mode: Trace file of '0'/'1' per packet
+    const char* TraceFile = nullptr;
+
+    /// Loss mode: Number of generations (k + m packets each) per configuration
+    int Generations = 10000;
+    bench::ReportFormat Format = bench::ReportFormat::Table;
+};
+
+static void Usage(const char* argv0)
+{
+    printf("Usage: %s [options]\n", argv0);
+    printf("  -k <list>      Original block counts (default 29)\n");
+    printf("  -m <list>      Recovery block counts (default 1-14)\n");
+    printf("  -b <list>      Bytes per block, multiples of 8 (default 1296)\n");
+    printf("  -e <list>      Erasure counts (default: min(k, m))\n");
+    printf("  -w <count>     Untimed warmup calls per configuration (default 10)\n");
+    printf("  -r <count>     Timed repetitions per configuration (default 1000)\n");
+    printf("  -s <seed>      PRNG seed (default 0)\n");
+    printf("  --phases       Add per-phase decode timing and XOR counts (cauchy_256_*_ex)\n");
+    printf("  --counters     Add instructions/byte, IPC, L1D misses/byte and branch misses (Linux)\n");
+    printf("  --cold <mode>  Cold-cache timing: 'pool' cycles through buffers 2x the LLC size,\n");
+    printf("                 'flush' evicts the buffers with clflush before each call (x86)\n");
+    printf("  --calibrate    Fit cauchy_256_set_cost_model() constants to the results\n");
+    printf("  --ge <p,r[,good,bad]>  Loss mode: Gilbert-Elliott bursty loss.  p = P(good->bad),\n");
+    printf("                 r = P(bad->good), loss probability in each state (default 0,1)\n");
+    printf("  --trace <file> Loss mode: replay a trace of '0' (received) / '1' (lost) packets\n");
+    printf("  -g <count>     Loss mode: generations per configuration (default 10000)\n");
+    printf("  --threads <list|all>  Thread scaling mode: aggregate throughput with N threads\n");
+    printf("                 each coding an independent stripe ('all' = 1 to core count)\n");
+    printf("  --csv          Write CSV output\n");
+    printf("  --json         Write JSON output\n");
+    printf("Lists may be single values, ranges or both: 4  1-8  1-64:8  2,5,9-12\n");
+}
+
+static bool ParseSettings(int argc, char** argv, BenchSettings& settings)
+{
+    for (int ii = 1; ii < argc; ++ii)
+    {
+        const char* arg = argv[ii];
+        const char* value = (ii + 1 < argc) ? argv[ii + 1] : nullptr;
+
+        if (!strcmp(arg, "--csv"))
+            settings.Format = bench::ReportFormat::CSV;
+        else if (!strcmp(arg, "--json"))
+            settings.Format = bench::ReportFormat::JSON;
+        else if (!strcmp(arg, "--phases"))
+            settings.Phases = true;
+        else if (!strcmp(arg, "--calibrate"))
+            settings.Calibrate = true;
+        else if (!strcmp(arg, "--counters"))
+            settings.Counters = true;
+        else if (!strcmp(arg, "--cold") && value && !strcmp(value, "pool"))
+            settings.Cache = CacheMode::Pool, ++ii;
+#if defined(BENCH_HAS_CLFLUSH)
+        else if (!strcmp(arg, "--cold") && value && !strcmp(value, "flush"))
+            settings.Cache = CacheMode::Flush, ++ii;
+#endif
+        else if (!strcmp(arg, "--ge") && value)
+            settings.GilbertElliott = argv[++ii];
+        else if (!strcmp(arg, "--trace") && value)
+            settings.TraceFile = argv[++ii];
+        else if (!strcmp(arg, "--threads") && value && !strcmp(value, "all"))
+        {
+            const int cores = (int)std::thread::hardware_concurrency();
+            settings.Threads.clear();
+            for (int count = 1; count <= (cores > 0 ? cores : 1); ++count)
+                settings.Threads.push_back(count);
+            ++ii;
+        }
+        else if (!strcmp(arg, "--threads") && value && bench::ParseList(value, settings.Threads))
+            ++ii;
+        else if (!strcmp(arg, "-g") && value)
+            settings.Generations = atoi(argv[++ii]);
+        else if (!strcmp(arg, "-k") && value && bench::ParseList(value, settings.K))
+            ++ii;
+        else if (!strcmp(arg, "-m") && value && bench::ParseList(value, settings.M))
+            ++ii;
+        else if (!strcmp(arg, "-b") && value && bench::ParseList(value, settings.Bytes))
+            ++ii;
+        else if (!strcmp(arg, "-e") && value && bench::ParseList(value, settings.Erasures))
+            ++ii;
+        else if (!strcmp(arg, "-w") && value)
+            settings.Warmup = atoi(argv[++ii]);
+        else if (!strcmp(arg, "-r") && value)
+            settings.Repetitions = atoi(argv[++ii]);
+        else if (!strcmp(arg, "-s") && value)
+            settings.Seed = strtoull(argv[++ii], nullptr, 10);
+        else
+            return false;
+    }
+
+    for (int bytes : settings.Bytes)
+        if (bytes <= 0 || bytes % 8 != 0)
+            return false;
+
+    for (int threads : settings.Threads)
+        if (threads <= 0)
+            return false;
+
+    return settings.Repetitions > 0 && settings.Warmup >= 0 && settings.Generations > 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Benchmark
+
+struct BenchResult
+{
+    bench::SampleSummary Encode;
+    bench::SampleSummary Decode;
+    bool Corrupted = false;
+
+    /// Sums over the timed repetitions when Phases is set
+    CauchyStats EncodeStats;
+    CauchyStats DecodeStats;
+
+    /// Sums over the timed repetitions when counters are open
+    uint64_t EncodeCounts[(int)bench::PerfEvent::Count] = {};
+    uint64_t DecodeCounts[(int)bench::PerfEvent::Count] = {};
+};
+
+static void ReadCounters(bench::PerfCounters* counters, uint64_t* counts)
+{
+    for (int ii = 0; ii < (int)bench::PerfEvent::Count; ++ii)
+        counts[ii] = counters->Read((bench::PerfEvent)ii);
+}
+
+static void AccumulateStats(CauchyStats& sum, const CauchyStats& stats)
+{
+    for (int ii = 0; ii < CAUCHY_256_PHASE_COUNT; ++ii)
+    {
+        sum.phase[ii].cycles += stats.phase[ii].cycles;
+        sum.phase[ii].xor_ops += stats.phase[ii].xor_ops;
+        sum.phase[ii].bytes += stats.phase[ii].bytes;
+    }
+    sum.total_cycles += stats.total_cycles;
+    sum.enabled = stats.enabled;
+    sum.windowed = stats.windowed;
+}
+
+// Pick `count` distinct rows from [0, k) uniformly at random
+static void PickErasures(siamese::PCGRandom& prng, int k, int count, uint8_t* rows)
+{
+    uint8_t deck[256];
+    for (int ii = 0; ii < k; ++ii)
+        deck[ii] = (uint8_t)ii;
+    for (int ii = 0; ii < count; ++ii)
+    {
+        const int jj = ii + (int)(prng.Next() % (uint32_t)(k - ii));
+        const uint8_t t = deck[ii];
+        deck[ii] = deck[jj];
+        deck[jj] = t;
+        rows[ii] = deck[ii];
+    }
+}
+
+/// Buffers for one encode/decode
+struct BufferSet
+{
+    vector<uint8_t> Data;
+    vector<uint8_t> Recovery;
+
+    /// Copies of the recovery blocks handed to the decoder
+    vector<uint8_t> Scratch;
+
+    vector<Block> Blocks;
+    const uint8_t* DataPtrs[256];
+
+    void Allocate(siamese::PCGRandom& prng, int k, int m, int bytes)
+    {
+        Data.resize((size_t)bytes * k);
+        Recovery.resize((size_t)bytes * m);
+        Scratch.resize((size_t)bytes * m);
+        Blocks.resize(k);
+        for (int ii = 0; ii < k; ++ii)
+            DataPtrs[ii] = &Data[(size_t)ii * bytes];
+        for (size_t ii = 0; ii < Data.size(); ++ii)
+            Data[ii] = (uint8_t)prng.Next();
+    }
+
+    /// Erase random originals and fill in with the first recovery blocks
+    void PrepareDecode(siamese::PCGRandom& prng, int k, int bytes, int erasures)
+    {
+        uint8_t erased[256];
+        bool is_erased[256];
+
+        PickErasures(prng, k, erasures, erased);
+        for (int jj = 0; jj < k; ++jj)
+            is_erased[jj] = false;
+        for (int jj = 0; jj < erasures; ++jj)
+            is_erased[erased[jj]] = true;
+
+        // Originals at the front, recovery blocks filling in at the end
+        int count = 0;
+        for (int jj = 0; jj < k; ++jj)
+        {
+            if (!is_erased[jj])
+            {
+                Blocks[count].data = &Data[(size_t)jj * bytes];
+                Blocks[count].row = (uint8_t)jj;
+                ++count;
+            }
+        }
+        memcpy(&Scratch[0], &Recovery[0], (size_t)bytes * erasures);
+        for (int jj = 0; jj < erasures; ++jj, ++count)
+        {
+            Blocks[count].data = &Scratch[(size_t)jj * bytes];
+            Blocks[count].row = (uint8_t)(k + jj);
+        }
+    }
+
+    bool VerifyDecode(int k, int bytes, int erasures) const
+    {
+        for (int jj = k - erasures; jj < k; ++jj)
+        {
+            const int row = Blocks[jj].row;
+            if (row >= k || 0 != memcmp(Blocks[jj].data, DataPtrs[row], bytes))
+                return false;
+        }
+        return true;
+    }
+};
+
+/// Evict a buffer from every level of the cache hierarchy
+static void FlushBuffer(const void* buffer, size_t bytes)
+{
+#if defined(BENCH_HAS_CLFLUSH)
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(buffer);
+    for (size_t offset = 0; offset < bytes; offset += 64)
+        _mm_clflush(data + offset);
+    if (bytes > 0)
+        _mm_clflush(data + bytes - 1);
+    _mm_mfence();
+#else
+    (void)buffer;
+    (void)bytes;
+#endif
+}
+
+/// Number of buffer sets to cycle through so each call misses the cache
+static int ColdPoolSize(int k, int m, int bytes)
+{
+    const bench::CacheSizes caches = bench::GetCacheSizes();
+    uint64_t llc = caches.L3 ? caches.L3 : caches.L2;
+    if (!llc)
+        llc = 64 * 1024 * 1024; // Unknown: assume a large LLC
+
+    // Twice the LLC so that a set is long gone by the time it comes around
+    const uint64_t setBytes = (uint64_t)bytes * (k + 2 * m);
+    uint64_t count = (2 * llc + setBytes - 1) / setBytes;
+    if (count < 2)
+        count = 2;
+    return (int)count;
+}
+
+static BenchResult RunConfiguration(
+    const BenchSettings& settings,
+    siamese::PCGRandom& prng,
+    bench::PerfCounters* counters,
+    int k, int m, int bytes, int erasures)
+{
+    BenchResult result;
+    memset(&result.EncodeStats, 0, sizeof(result.EncodeStats));
+    memset(&result.DecodeStats, 0, sizeof(result.DecodeStats));
+    CauchyStats stats;
+    CauchyStats* statsPtr = settings.Phases ? &stats : nullptr;
+
+    const bool pool = settings.Cache == CacheMode::Pool;
+    const bool flush = settings.Cache == CacheMode::Flush;
+
+    vector<BufferSet> sets(pool ? ColdPoolSize(k, m, bytes) : 1);
+    for (BufferSet& set : sets)
+        set.Allocate(prng, k, m, bytes);
+    const int setCount = (int)sets.size();
+
+    // Encoder:
+
+    for (int ii = 0; ii < settings.Warmup; ++ii)
+    {
+        BufferSet& set = sets[ii % setCount];
+        cauchy_256_encode(k, m, set.DataPtrs, &set.Recovery[0], bytes);
+    }
+
+    vector<uint64_t> samples(settings.Repetitions);
+    if (counters)
+        counters->Reset();
+    for (int ii = 0; ii < settings.Repetitions; ++ii)
+    {
+        BufferSet& set = sets[ii % setCount];
+        if (flush)
+        {
+            FlushBuffer(&set.Data[0], set.Data.size());
+            FlushBuffer(&set.Recovery[0], set.Recovery.size());
+        }
+
+        if (counters)
+            counters->Start();
+        const uint64_t t0 = siamese::GetCycles();
+        cauchy_256_encode_ex(k, m, set.DataPtrs, &set.Recovery[0], bytes, statsPtr);
+        const uint64_t t1 = siamese::GetCycles();
+        if (counters)
+            counters->Stop();
+        samples[ii] = t1 - t0;
+        if (statsPtr)
+            AccumulateStats(result.EncodeStats, stats);
+    }
+    result.Encode = bench::Summarize(samples);
+    if (counters)
+        ReadCounters(counters, result.EncodeCounts);
+
+    // Decoder:
+
+    // Every set needs recovery data to decode from
+    for (int ii = std::max(settings.Warmup, settings.Repetitions); ii < setCount; ++ii)
+        cauchy_256_encode(k, m, sets[ii].DataPtrs, &sets[ii].Recovery[0], bytes);
+
+    if (counters)
+        counters->Reset();
+
+    // Sets are prepared a whole pool at a time and then decoded in the same
+    // order, so with a cold pool each set is evicted before its decode
+    for (int ii = -settings.Warmup; ii < settings.Repetitions; )
+    {
+        for (BufferSet& set : sets)
+            set.PrepareDecode(prng, k, bytes, erasures);
+
+        for (int jj = 0; jj < setCount && ii < settings.Repetitions; ++jj, ++ii)
+        {
+            BufferSet& set = sets[jj];
+            if (flush)
+            {
+                FlushBuffer(&set.Data[0], set.Data.size());
+                FlushBuffer(&set.Scratch[0], set.Scratch.size());
+            }
+
+            // Warmup calls are not counted
+            if (counters && ii >= 0)
+                counters->Start();
+            const uint64_t t0 = siamese::GetCycles();
+            const int decodeResult = cauchy_256_decode_ex(k, m, &set.Blocks[0], bytes, statsPtr);
+            const uint64_t t1 = siamese::GetCycles();
+            if (counters && ii >= 0)
+                counters->Stop();
+
+            if (decodeResult != 0 || !set.VerifyDecode(k, bytes, erasures))
+                result.Corrupted = true;
+
+            if (ii >= 0)
+            {
+                samples[ii] = t1 - t0;
+                if (statsPtr)
+                    AccumulateStats(result.DecodeStats, stats);
+            }
+        }
+    }
+    result.Decode = bench::Summarize(samples);
+    if (counters)
+        ReadCounters(counters, result.DecodeCounts);
+
+    return result;
+}
+
+
+//------------------------------------------------------------------------------
+// Loss Mode
+
+/*
+    Instead of erasing a fixed number of originals, each configuration sends
+    a stream of generations (k originals followed by m recovery packets)
+    through a loss model.  Whenever originals are lost and enough packets
+    arrive, the receiver decodes with the originals it has plus the recovery
+    packets that actually arrived.  Decode latency is reported per erasure
+    count so the switch between the bit-by-bit and windowed decoder shows up
+    directly, along with the overall distribution.
+*/
+
+static bench::LossModel* CreateLossModel(const BenchSettings& settings)
+{
+    if (settings.TraceFile)
+    {
+        bench::TraceLoss* trace = new bench::TraceLoss;
+        if (!trace->Load(settings.TraceFile))
+        {
+            printf("Unable to load loss trace: %s\n", settings.TraceFile);
+            delete trace;
+            return nullptr;
+        }
+        return trace;
+    }
+
+    double p = 0., r = 1., good = 0., bad = 1.;
+    const int count = sscanf(settings.GilbertElliott, "%lf,%lf,%lf,%lf", &p, &r, &good, &bad);
+    if (count < 2 || p < 0. || p > 1. || r <= 0. || r > 1.)
+    {
+        printf("Invalid Gilbert-Elliott parameters: %s\n", settings.GilbertElliott);
+        return nullptr;
+    }
+    return new bench::GilbertElliottLoss(settings.Seed, p, r, good, bad);
+}
+
+static int RunLossMode(const BenchSettings& settings, double cycles_per_usec)
+{
+    FILE* notes = (settings.Format == bench::ReportFormat::Table) ? stdout : stderr;
+
+    bench::Report report(settings.Format);
+    report.Columns({
+        "k", "m", "bytes", "erasures", "decodes", "windowed",
+        "dec_p50_usec", "dec_p99_usec", "dec_p999_usec", "dec_MBps"
+    });
+
+    siamese::PCGRandom prng;
+    prng.Seed(settings.Seed);
+
+    int failures = 0;
+    vector<string> summaries;
+
+    for (int k : settings.K)
+    {
+        for (int m : settings.M)
+        {
+            if (k < 1 || m < 1 || k + m > 256)
+                continue;
+
+            for (int bytes : settings.Bytes)
+            {
+                // Same loss sequence for every configuration
+                bench::LossModel* loss = CreateLossModel(settings);
+                if (!loss)
+                    return 1;
+
+                vector<uint8_t> data((size_t)bytes * k);
+                vector<uint8_t> recovery((size_t)bytes * m);
+                vector<uint8_t> scratch((size_t)bytes * m);
+                vector<Block> blocks(k);
+                const uint8_t* data_ptrs[256];
+                for (int ii = 0; ii < k; ++ii)
+                    data_ptrs[ii] = &data[(size_t)ii * bytes];
+                for (size_t ii = 0; ii < data.size(); ++ii)
+                    data[ii] = (uint8_t)prng.Next();
+
+                // Decode samples indexed by erasure count
+                vector<vector<uint64_t>> byErasures(m + 1);
+                vector<uint64_t> all, encodes;
+                uint64_t lostPackets = 0, clean = 0, unrecoverable = 0;
+                bool lost[512];
+
+                for (int gen = 0; gen < settings.Generations; ++gen)
+                {
+                    const uint64_t e0 = siamese::GetCycles();
+                    cauchy_256_encode(k, m, data_ptrs, &recovery[0], bytes);
+                    const uint64_t e1 = siamese::GetCycles();
+                    encodes.push_back(e1 - e0);
+
+                    int lostOriginals = 0, receivedRecovery = 0;
+                    for (int ii = 0; ii < k + m; ++ii)
+                    {
+                        lost[ii] = loss->NextLost();
+                        lostPackets += lost[ii];
+                        if (ii < k)
+                            lostOriginals += lost[ii];
+                        else
+                            receivedRecovery += !lost[ii];
+                    }
+
+                    if (lostOriginals == 0)
+                    {
+                        ++clean;
+                        continue;
+                    }
+                    if (receivedRecovery < lostOriginals)
+                    {
+                        ++unrecoverable;
+                        continue;
+                    }
+
+                    // Received originals first, then the recovery packets that arrived
+                    int count = 0;
+                    for (int ii = 0; ii < k; ++ii)
+                    {
+                        if (!lost[ii])
+                        {
+                            blocks[count].data = &data[(size_t)ii * bytes];
+                            blocks[count].row = (uint8_t)ii;
+                            ++count;
+                        }
+                    }
+                    for (int ii = 0; ii < m && count < k; ++ii)
+                    {
+                        if (lost[k + ii])
+                            continue;
+                        uint8_t* copy = &scratch[(size_t)(count - (k - lostOriginals)) * bytes];
+                        memcpy(copy, &recovery[(size_t)ii * bytes], bytes);
+                        blocks[count].data = copy;
+                        blocks[count].row = (uint8_t)(k + ii);
+                        ++count;
+                    }
+
+                    const uint64_t t0 = siamese::GetCycles();
+                    const int decodeResult = cauchy_256_decode(k, m, &blocks[0], bytes);
+                    const uint64_t t1 = siamese::GetCycles();
+
+                    bool corrupted = decodeResult != 0;
+                    for (int ii = k - lostOriginals; ii < k; ++ii)
+                    {
+                        const int row = blocks[ii].row;
+                        if (row >= k || 0 != memcmp(blocks[ii].data, data_ptrs[row], bytes))
+                            corrupted = true;
+                    }
+                    if (corrupted)
+                    {
+                        printf("Decode failed or corrupted data for k=%d m=%d bytes=%d erasures=%d\n",
+                            k, m, bytes, lostOriginals);
+                        ++failures;
+                    }
+
+                    byErasures[lostOriginals].push_back(t1 - t0);
+                    all.push_back(t1 - t0);
+                }
+
+                delete loss;
+
+                const double data_bytes = (double)k * bytes;
+                auto addRow = [&](const string& erasures, vector<uint64_t>& samples, const string& windowed) {
+                    const bench::SampleSummary summary = bench::Summarize(samples);
+                    const double usec = summary.Median / cycles_per_usec;
+                    report.Row({
+                        to_string(k), to_string(m), to_string(bytes), erasures,
+                        to_string(samples.size()), windowed,
+                        bench::Fixed(usec, 3),
+                        bench::Fixed(summary.P99 / cycles_per_usec, 3),
+                        bench::Fixed(summary.P999 / cycles_per_usec, 3),
+                        bench::Fixed(usec > 0. ? data_bytes / usec : 0., 1)
+                    });
+                };
+
+                int firstWindowed = 0;
+                uint64_t windowedDecodes = 0;
+                for (int e = 1; e <= m; ++e)
+                {
+                    CauchyCost cost;
+                    const bool windowed = 0 == cauchy_256_decode_cost(k, m, e, bytes, &cost) && cost.windowed;
+                    if (windowed && !firstWindowed)
+                        firstWindowed = e;
+                    if (byErasures[e].empty())
+                        continue;
+                    if (windowed)
+                        windowedDecodes += byErasures[e].size();
+                    addRow(to_string(e), byErasures[e], windowed ? "1" : "0");
+                }
+                if (!all.empty())
+                {
+                    addRow("all", all, bench::Fixed((double)windowedDecodes / all.size(), 2));
+                }
+
+                const double gens = settings.Generations;
+                const bench::SampleSummary enc = bench::Summarize(encodes);
+                char line[512];
+                snprintf(line, sizeof(line),
+                    "# k=%d m=%d bytes=%d: %d generations, packet loss %.2f%%, clean %.2f%%, recovered %.2f%%, "
+                    "unrecoverable %.2f%%, encode p50 %.3f usec, windowed decode: %s\n",
+                    k, m, bytes, settings.Generations,
+                    100. * lostPackets / (gens * (k + m)),
+                    100. * clean / gens,
+                    100. * all.size() / gens,
+                    100. * unrecoverable / gens,
+                    enc.Median / cycles_per_usec,
+                    firstWindowed ? ("from " + to_string(firstWindowed) + " erasures").c_str() : "never");
+                summaries.push_back(line);
+            }
+        }
+    }
+
+    report.End();
+
+    fprintf(notes, "\n");
+    for (const string& summary : summaries)
+        fputs(summary.c_str(), notes);
+
+    return failures ? 1 : 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Thread Scaling Mode
+
+/*
+    Each thread encodes and decodes its own independent stripe, the way a
+    server runs one codec per core.  All threads are released together and
+    run the same number of calls.  A thread's throughput is its bytes over
+    the cycles spent inside codec calls, so decode setup is not counted.
+    Efficiency compares the aggregate against N times the 1-thread rate:
+    it drops as the threads saturate memory bandwidth or share cache lines.
+*/
+
+struct ThreadResult
+{
+    uint64_t EncodeCycles = 0;
+    uint64_t DecodeCycles = 0;
+    bool Corrupted = false;
+};
+
+static void ThreadScalingWorker(
+    const BenchSettings& settings,
+    int index, int k, int m, int bytes, int erasures,
+    std::atomic<int>& ready,
+    const std::atomic<bool>& go,
+    ThreadResult& result)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(settings.Seed, index);
+
+    // Allocated on this thread so the pages are local to its core
+    BufferSet set;
+    set.Allocate(prng, k, m, bytes);
+    for (int ii = 0; ii < settings.Warmup; ++ii)
+        cauchy_256_encode(k, m, set.DataPtrs, &set.Recovery[0], bytes);
+
+    ready.fetch_add(1);
+    while (!go.load())
+        std::this_thread::yield();
+
+    for (int ii = 0; ii < settings.Repetitions; ++ii)
+    {
+        const uint64_t t0 = siamese::GetCycles();
+        cauchy_256_encode(k, m, set.DataPtrs, &set.Recovery[0], bytes);
+        const uint64_t t1 = siamese::GetCycles();
+        result.EncodeCycles += t1 - t0;
+    }
+
+    for (int ii = 0; ii < settings.Repetitions; ++ii)
+    {
+        set.PrepareDecode(prng, k, bytes, erasures);
+
+        const uint64_t t0 = siamese::GetCycles();
+        const int decodeResult = cauchy_256_decode(k, m, &set.Blocks[0], bytes);
+        const uint64_t t1 = siamese::GetCycles();
+        result.DecodeCycles += t1 - t0;
+
+        if (decodeResult != 0 || !set.VerifyDecode(k, bytes, erasures))
+            result.Corrupted = true;
+    }
+}
+
+/// Aggregate MB/s for encode and decode with the given number of threads
+static bool RunThreads(
+    const BenchSettings& settings,
+    int threadCount, int k, int m, int bytes, int erasures,
+    double cycles_per_usec,
+    double& encodeMBps, double& decodeMBps)
+{
+    vector<ThreadResult> results(threadCount);
+    vector<std::thread> threads;
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false);
+
+    for (int ii = 0; ii < threadCount; ++ii)
+    {
+        threads.emplace_back(ThreadScalingWorker, std::cref(settings),
+            ii, k, m, bytes, erasures, std::ref(ready), std::cref(go), std::ref(results[ii]));
+    }
+    while (ready.load() < threadCount)
+        std::this_thread::yield();
+    go.store(true);
+    for (std::thread& thread : threads)
+        thread.join();
+
+    const double thread_bytes = (double)k * bytes * settings.Repetitions;
+    bool corrupted = false;
+    encodeMBps = decodeMBps = 0.;
+    for (const ThreadResult& result : results)
+    {
+        corrupted |= result.Corrupted;
+        if (result.EncodeCycles > 0)
+            encodeMBps += thread_bytes * cycles_per_usec / result.EncodeCycles;
+        if (result.DecodeCycles > 0)
+            decodeMBps += thread_bytes * cycles_per_usec / result.DecodeCycles;
+    }
+    return !corrupted;
+}
+
+static int RunThreadMode(const BenchSettings& settings, double cycles_per_usec)
+{
+    if (settings.Format == bench::ReportFormat::Table)
+    {
+        printf("Longhair thread scaling: %d calls per thread, %u hardware threads\n\n",
+            settings.Repetitions, std::thread::hardware_concurrency());
+    }
+
+    bench::Report report(settings.Format);
+    report.Columns({
+        "k", "m", "bytes", "erasures", "threads",
+        "enc_GBps", "enc_eff", "dec_GBps", "dec_eff"
+    });
+
+    int failures = 0;
+
+    for (int k : settings.K)
+    {
+        for (int m : settings.M)
+        {
+            if (k < 1 || m < 1 || k + m > 256)
+                continue;
+
+            vector<int> erasure_list = settings.Erasures;
+            if (erasure_list.empty())
+                erasure_list.push_back(k < m ? k : m);
+
+            for (int bytes : settings.Bytes)
+            {
+                for (int erasures : erasure_list)
+                {
+                    if (erasures < 0 || erasures > m || erasures > k)
+                        continue;
+
+                    // Single-thread baseline for the efficiency columns
+                    double baseEncode = 0., baseDecode = 0.;
+
+                    for (int threadCount : settings.Threads)
+                    {
+                        double encodeMBps, decodeMBps;
+                        if (!RunThreads(settings, threadCount, k, m, bytes, erasures,
+                            cycles_per_usec, encodeMBps, decodeMBps))
+                        {
+                            printf("Decode failed or corrupted data for k=%d m=%d bytes=%d erasures=%d threads=%d\n",
+                                k, m, bytes, erasures, threadCount);
+                            ++failures;
+                        }
+
+                        if (baseEncode <= 0.)
+                        {
+                            if (threadCount == 1)
+                                baseEncode = encodeMBps, baseDecode = decodeMBps;
+                            else
+                                RunThreads(settings, 1, k, m, bytes, erasures,
+                                    cycles_per_usec, baseEncode, baseDecode);
+                        }
+
+                        report.Row({
+                            to_string(k), to_string(m), to_string(bytes), to_string(erasures),
+                            to_string(threadCount),
+                            bench::Fixed(encodeMBps / 1000., 3),
+                            bench::Fixed(baseEncode > 0. ? encodeMBps / (baseEncode * threadCount) : 0., 3),
+                            bench::Fixed(decodeMBps / 1000., 3),
+                            bench::Fixed(baseDecode > 0. ? decodeMBps / (baseDecode * threadCount) : 0., 3)
+                        });
+                    }
+                }
+            }
+        }
+    }
+
+    report.End();
+    return failures ? 1 : 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Cost Model Calibration
+
+/// One measured call with its predicted work
+struct CostSample
+{
+    int K, M, BlockBytes;
+    double XorOps;
+    double Bytes;
+    double Cycles;
+};
+
+/// Fewer distinct (k, m, bytes) configurations than this cannot separate
+/// the per-op and per-byte costs reliably
+static const int kMinCalibrationConfigs = 4;
+
+/// Count the distinct (k, m, bytes) configurations among the samples
+static int CountCostConfigs(const vector<CostSample>& samples)
+{
+    vector<uint64_t> keys;
+    for (const CostSample& sample : samples)
+        keys.push_back(((uint64_t)sample.K << 40) | ((uint64_t)sample.M << 32) | (uint32_t)sample.BlockBytes);
+    sort(keys.begin(), keys.end());
+    return (int)(unique(keys.begin(), keys.end()) - keys.begin());
+}
+
+/**
+    Fit cycles = a * xor_ops + b * bytes by least squares on relative error,
+    so that small fast configurations count as much as large slow ones.
+
+    Both constants are constrained to be non-negative: if the unconstrained
+    solution makes one of them negative, it is clamped to zero and the other
+    is refit alone.  Returns false if the system is degenerate.
+*/
+static bool FitCostModel(const vector<CostSample>& samples, double& a, double& b)
+{
+    double sxx = 0., sxy = 0., syy = 0., sxc = 0., syc = 0.;
+    for (const CostSample& sample : samples)
+    {
+        if (sample.Cycles <= 0.)
+            continue;
+        const double w = 1. / (sample.Cycles * sample.Cycles);
+        sxx += w * sample.XorOps * sample.XorOps;
+        sxy += w * sample.XorOps * sample.Bytes;
+        syy += w * sample.Bytes * sample.Bytes;
+        sxc += w * sample.XorOps * sample.Cycles;
+        syc += w * sample.Bytes * sample.Cycles;
+    }
+
+    const double det = sxx * syy - sxy * sxy;
+    if (det == 0.)
+        return false;
+    a = (sxc * syy - syc * sxy) / det;
+    b = (syc * sxx - sxc * sxy) / det;
+
+    // Active set for two variables: at most one clamp is needed, since
+    // sxc and syc are positive for positive work and cycles
+    if (a < 0.)
+    {
+        a = 0.;
+        b = syc / syy;
+    }
+    else if (b < 0.)
+    {
+        b = 0.;
+        a = sxc / sxx;
+    }
+    return a >= 0. && b >= 0.;
+}
+
+static void ReportCalibration(const vector<CostSample>& encodes, const vector<CostSample>& decodes)
+{
+    vector<CostSample> all = encodes;
+    all.insert(all.end(), decodes.begin(), decodes.end());
+
+    const int configs = CountCostConfigs(all);
+    double a = 0., b = 0.;
+    if (configs < kMinCalibrationConfigs || !FitCostModel(all, a, b))
+    {
+        printf("\nCalibration needs a wider range of configurations (have %d distinct k/m/bytes, need %d)\n",
+            configs, kMinCalibrationConfigs);
+        return;
+    }
+    if (0 != cauchy_256_set_cost_model(a, b))
+    {
+        printf("\nCalibration produced an invalid cost model\n");
+        return;
+    }
+
+    // Mean absolute relative error of the fitted model
+    auto error = [a, b](const vector<CostSample>& samples) {
+        double sum = 0.;
+        for (const CostSample& sample : samples)
+            sum += fabs(a * sample.XorOps + b * sample.Bytes - sample.Cycles) / sample.Cycles;
+        return samples.empty() ? 0. : 100. * sum / samples.size();
+    };
+
+    printf("\nCost model fit over %d configurations: mean error %.1f%% encode, %.1f%% decode\n",
+        (int)encodes.size(), error(encodes), error(decodes));
+    printf("    cauchy_256_set_cost_model(%.4f, %.6f);\n", a, b);
+}
+
+
+//------------------------------------------------------------------------------
+// Entrypoint
+
+/// Counter columns for one operation.  Unavailable counters are written as "-"
+static void AppendCounterColumns(
+    vector<string>& row,
+    bench::PerfCounters* counters,
+    const uint64_t* counts,
+    double data_bytes,
+    int repetitions)
+{
+    using bench::PerfEvent;
+    auto has = [counters](PerfEvent event) {
+        return counters && counters->Has(event);
+    };
+    const double instructions = (double)counts[(int)PerfEvent::Instructions];
+    const double cycles = (double)counts[(int)PerfEvent::Cycles];
+    const double total_bytes = data_bytes * repetitions;
+
+    row.push_back(has(PerfEvent::Instructions) ? bench::Fixed(instructions / total_bytes, 3) : "-");
+    row.push_back(has(PerfEvent::Instructions) && has(PerfEvent::Cycles) && cycles > 0. ?
+        bench::Fixed(instructions / cycles, 2) : "-");
+    row.push_back(has(PerfEvent::L1DMisses) ?
+        bench::Fixed(counts[(int)PerfEvent::L1DMisses] / total_bytes, 4) : "-");
+    row.push_back(has(PerfEvent::BranchMisses) ?
+        bench::Fixed((double)counts[(int)PerfEvent::BranchMisses] / repetitions, 1) : "-");
+}
+
+int main(int argc, char** argv)
+{
+    BenchSettings settings;
+    if (!ParseSettings(argc, argv, settings))
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    if (cauchy_256_init())
+    {
+        printf("Wrong static library\n");
+        return 1;
+    }
+
+    if (settings.Phases)
+    {
+        // Check the library was built with LONGHAIR_STATS
+        const uint8_t block[8] = {};
+        const uint8_t* ptrs[1] = { block };
+        uint8_t out[8];
+        CauchyStats stats;
+        cauchy_256_encode_ex(1, 1, ptrs, out, 8, &stats);
+        if (!stats.enabled)
+        {
+            printf("--phases requires the library to be built with -DLONGHAIR_STATS=ON\n");
+            return 1;
+        }
+    }
+
+    // Columns are still written without counters so the layout is the same
+    bench::PerfCounters perf;
+    bench::PerfCounters* counters = nullptr;
+    if (settings.Counters)
+    {
+        if (perf.Open())
+            counters = &perf;
+        else
+            fprintf(stderr, "Performance counters unavailable: %s\n", perf.Error());
+    }
+
+    const double cycles_per_usec = bench::GetCyclesPerUsec();
+
+    if (settings.GilbertElliott || settings.TraceFile)
+        return RunLossMode(settings, cycles_per_usec);
+    if (!settings.Threads.empty())
+        return RunThreadMode(settings, cycles_per_usec);
+
+    siamese::PCGRandom prng;
+    prng.Seed(settings.Seed);
+
+    if (settings.Format == bench::ReportFormat::Table)
+    {
+        static const char* const kCacheModeNames[] = {
+            "hot cache", "cold cache (buffer pool 2x LLC)", "cold cache (clflush)"
+        };
+        printf("Longhair benchmark: %d warmup + %d timed calls per configuration, %s, %.1f cycles/usec\n\n",
+            settings.Warmup, settings.Repetitions, kCacheModeNames[(int)settings.Cache], cycles_per_usec);
+    }
+
+    bench::Report report(settings.Format);
+    vector<string> columns = {
+        "k", "m", "bytes", "erasures",
+        "enc_med_usec", "enc_p99_usec", "enc_MBps", "enc_cpb",
+        "dec_med_usec", "dec_p99_usec", "dec_MBps", "dec_cpb"
+    };
+    if (settings.Phases)
+    {
+        // Mean usec per decode phase, then mean XOR counts
+        columns.insert(columns.end(), {
+            "windowed", "dec_setup", "dec_sort", "dec_orig", "dec_bitmat", "dec_elim", "dec_subst",
+            "dec_xors", "enc_xors"
+        });
+    }
+    if (settings.Counters)
+    {
+        // Per data byte, except IPC and branch misses per call
+        columns.insert(columns.end(), {
+            "enc_insn_B", "enc_ipc", "enc_l1dm_B", "enc_brmiss",
+            "dec_insn_B", "dec_ipc", "dec_l1dm_B", "dec_brmiss"
+        });
+    }
+    report.Columns(columns);
+
+    int failures = 0;
+    vector<CostSample> encodeSamples, decodeSamples;
+
+    for (int k : settings.K)
+    {
+        for (int m : settings.M)
+        {
+            if (k < 1 || m < 1 || k + m > 256)
+                continue;
+
+            vector<int> erasure_list = settings.Erasures;
+            if (erasure_list.empty())
+                erasure_list.push_back(k < m ? k : m);
+
+            for (int bytes : settings.Bytes)
+            {
+                for (int erasures : erasure_list)
+                {
+                    if (erasures < 0 || erasures > m || erasures > k)
+                        continue;
+
+                    const BenchResult result = RunConfiguration(settings, prng, counters, k, m, bytes, erasures);
+                    if (result.Corrupted)
+                    {
+                        printf("Decode failed or corrupted data for k=%d m=%d bytes=%d erasures=%d\n",
+                            k, m, bytes, erasures);
+                        ++failures;
+                    }
+
+                    const double data_bytes = (double)k * bytes;
+                    const double enc_usec = result.Encode.Median / cycles_per_usec;
+                    const double dec_usec = result.Decode.Median / cycles_per_usec;
+
+                    vector<string> row = {
+                        to_string(k), to_string(m), to_string(bytes), to_string(erasures),
+                        bench::Fixed(enc_usec, 3),
+                        bench::Fixed(result.Encode.P99 / cycles_per_usec, 3),
+                        bench::Fixed(enc_usec > 0. ? data_bytes / enc_usec : 0., 1),
+                        bench::Fixed(result.Encode.Median / data_bytes, 3),
+                        bench::Fixed(dec_usec, 3),
+                        bench::Fixed(result.Decode.P99 / cycles_per_usec, 3),
+                        bench::Fixed(dec_usec > 0. ? data_bytes / dec_usec : 0., 1),
+                        bench::Fixed(result.Decode.Median / data_bytes, 3)
+                    };
+
+                    if (settings.Phases)
+                    {
+                        const CauchyStats& dec = result.DecodeStats;
+                        const double reps = settings.Repetitions;
+                        row.push_back(to_string(dec.windowed));
+                        static const int kDecodePhases[] = {
+                            CAUCHY_256_PHASE_SETUP, CAUCHY_256_PHASE_SORT, CAUCHY_256_PHASE_ORIGINAL,
+                            CAUCHY_256_PHASE_BITMATRIX, CAUCHY_256_PHASE_ELIMINATION, CAUCHY_256_PHASE_SUBSTITUTION
+                        };
+                        uint64_t dec_xors = 0;
+                        for (int phase : kDecodePhases)
+                        {
+                            row.push_back(bench::Fixed(dec.phase[phase].cycles / reps / cycles_per_usec, 3));
+                            dec_xors += dec.phase[phase].xor_ops;
+                        }
+                        row.push_back(bench::Fixed(dec_xors / reps, 1));
+                        row.push_back(bench::Fixed(result.EncodeStats.phase[CAUCHY_256_PHASE_ENCODE].xor_ops / reps, 1));
+                    }
+
+                    if (settings.Counters)
+                    {
+                        AppendCounterColumns(row, counters, result.EncodeCounts, data_bytes, settings.Repetitions);
+                        AppendCounterColumns(row, counters, result.DecodeCounts, data_bytes, settings.Repetitions);
+                    }
+
+                    report.Row(row);
+
+                    if (settings.Calibrate)
+                    {
+                        CauchyCost cost;
+                        if (0 == cauchy_256_encode_cost(k, m, bytes, &cost))
+                            encodeSamples.push_back({ k, m, bytes, (double)cost.xor_ops, (double)cost.bytes, result.Encode.Median });
+                        if (erasures > 0 && 0 == cauchy_256_decode_cost(k, m, erasures, bytes, &cost))
+                            decodeSamples.push_back({ k, m, bytes, (double)cost.xor_ops, (double)cost.bytes, result.Decode.Median });
+                    }
+                }
+            }
+        }
+    }
+
+    report.End();
+
+    if (settings.Calibrate)
+        ReportCalibration(encodeSamples, decodeSamples);
+
+    return failures ? 1 : 0;
+}
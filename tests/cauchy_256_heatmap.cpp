@@ -0,0 +1,429 @@
+/** \file
+    \brief Longhair Benchmark: Heat Map
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+    Heat map sweep.
+
+    Measures encode and worst-case decode throughput for every (k, m) cell
+    with k + m <= 256 and writes one CSV row per cell.  Cells are handed out
+    to one worker per core, most expensive first, so the full grid finishes
+    in a fraction of the serial time.  Rows are flushed as they complete and
+    --resume skips the cells already in the output file, so an interrupted
+    sweep can be continued.
+
+    Running several workers at once shares memory bandwidth and lowers the
+    turbo clock, so use -j 1 when the absolute numbers matter more than the
+    shape of the map.  docs/heatmap.gnu plots the output.
+
+    Example:
+        longhair_heatmap -o heatmap.csv
+        longhair_heatmap -k 1-64 -m 1-32 -b 4096 -o small.csv
+*/
+
+#include "../cauchy_256.h"
+#include "../SiameseTools.h"
+#include "BenchTools.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+using namespace std;
+
+
+//------------------------------------------------------------------------------
+// Settings
+
+struct HeatMapSettings
+{
+    /// Empty means all values allowed by k + m <= 256
+    vector<int> K;
+    vector<int> M;
+
+    int Bytes = 1296;
+    int Warmup = 2;
+    int Repetitions = 20;
+    int Threads = 0; ///< 0 = one per core
+    uint64_t Seed = 0;
+    const char* Output = "heatmap.csv";
+    bool Resume = false;
+};
+
+static void Usage(const char* argv0)
+{
+    printf("Usage: %s [options]\n", argv0);
+    printf("  -k <list>      Original block counts (default 1-255)\n");
+    printf("  -m <list>      Recovery block counts (default 1-255, limited to k + m <= 256)\n");
+    printf("  -b <bytes>     Bytes per block, a multiple of 8 (default 1296)\n");
+    printf("  -w <count>     Untimed warmup calls per cell (default 2)\n");
+    printf("  -r <count>     Timed calls per cell, the median is recorded (default 20)\n");
+    printf("  -j <threads>   Worker threads (default: one per core)\n");
+    printf("  -s <seed>      PRNG seed (default 0)\n");
+    printf("  -o <file>      Output CSV file (default heatmap.csv)\n");
+    printf("  --resume       Keep the rows already in the output file and skip those cells\n");
+    printf("Lists may be single values, ranges or both: 4  1-8  1-64:8  2,5,9-12\n");
+}
+
+static bool ParseSettings(int argc, char** argv, HeatMapSettings& settings)
+{
+    for (int ii = 1; ii < argc; ++ii)
+    {
+        const char* arg = argv[ii];
+        const char* value = (ii + 1 < argc) ? argv[ii + 1] : nullptr;
+
+        if (!strcmp(arg, "--resume"))
+            settings.Resume = true;
+        else if (!strcmp(arg, "-k") && value && bench::ParseList(value, settings.K))
+            ++ii;
+        else if (!strcmp(arg, "-m") && value && bench::ParseList(value, settings.M))
+            ++ii;
+        else if (!strcmp(arg, "-b") && value)
+            settings.Bytes = atoi(argv[++ii]);
+        else if (!strcmp(arg, "-w") && value)
+            settings.Warmup = atoi(argv[++ii]);
+        else if (!strcmp(arg, "-r") && value)
+            settings.Repetitions = atoi(argv[++ii]);
+        else if (!strcmp(arg, "-j") && value)
+            settings.Threads = atoi(argv[++ii]);
+        else if (!strcmp(arg, "-s") && value)
+            settings.Seed = strtoull(argv[++ii], nullptr, 10);
+        else if (!strcmp(arg, "-o") && value)
+            settings.Output = argv[++ii];
+        else
+            return false;
+    }
+
+    return settings.Bytes > 0 && settings.Bytes % 8 == 0 &&
+        settings.Repetitions > 0 && settings.Warmup >= 0 && settings.Threads >= 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Cells
+
+struct Cell
+{
+    int K, M;
+
+    /// Predicted cycles for one encode and one decode, for scheduling
+    double Cost;
+};
+
+static vector<Cell> ListCells(const HeatMapSettings& settings, const set<pair<int, int>>& done)
+{
+    vector<Cell> cells;
+    for (int k = 1; k < 256; ++k)
+    {
+        if (!settings.K.empty() && find(settings.K.begin(), settings.K.end(), k) == settings.K.end())
+            continue;
+
+        for (int m = 1; k + m <= 256; ++m)
+        {
+            if (!settings.M.empty() && find(settings.M.begin(), settings.M.end(), m) == settings.M.end())
+                continue;
+            if (done.count(make_pair(k, m)))
+                continue;
+
+            Cell cell = { k, m, 0. };
+            CauchyCost cost;
+            if (0 == cauchy_256_encode_cost(k, m, settings.Bytes, &cost))
+                cell.Cost += cost.cycles;
+            if (0 == cauchy_256_decode_cost(k, m, min(k, m), settings.Bytes, &cost))
+                cell.Cost += cost.cycles;
+            cells.push_back(cell);
+        }
+    }
+
+    // Longest first so the workers finish together
+    sort(cells.begin(), cells.end(), [](const Cell& a, const Cell& b) {
+        return a.Cost > b.Cost;
+    });
+    return cells;
+}
+
+/// Read the (k, m) cells of an earlier run.  Returns false if the file is missing
+static bool LoadDoneCells(const char* path, set<pair<int, int>>& done)
+{
+    FILE* file = fopen(path, "r");
+    if (!file)
+        return false;
+
+    char line[512];
+    while (fgets(line, sizeof(line), file))
+    {
+        int k, m;
+        if (line[0] != '#' && sscanf(line, "%d,%d,", &k, &m) == 2)
+            done.insert(make_pair(k, m));
+    }
+    fclose(file);
+    return true;
+}
+
+
+//------------------------------------------------------------------------------
+// Workers
+
+struct CellResult
+{
+    double EncodeCycles = 0.;
+    double DecodeCycles = 0.;
+    bool Corrupted = false;
+};
+
+static CellResult MeasureCell(
+    const HeatMapSettings& settings,
+    siamese::PCGRandom& prng,
+    int k, int m)
+{
+    const int bytes = settings.Bytes;
+    const int erasures = min(k, m);
+
+    vector<uint8_t> data((size_t)bytes * k);
+    vector<uint8_t> recovery((size_t)bytes * m);
+    vector<uint8_t> scratch((size_t)bytes * erasures);
+    vector<Block> blocks(k);
+    const uint8_t* data_ptrs[256];
+    for (int ii = 0; ii < k; ++ii)
+        data_ptrs[ii] = &data[(size_t)ii * bytes];
+    for (size_t ii = 0; ii < data.size(); ++ii)
+        data[ii] = (uint8_t)prng.Next();
+
+    CellResult result;
+    vector<uint64_t> samples;
+
+    for (int ii = -settings.Warmup; ii < settings.Repetitions; ++ii)
+    {
+        const uint64_t t0 = siamese::GetCycles();
+        cauchy_256_encode(k, m, data_ptrs, &recovery[0], bytes);
+        const uint64_t t1 = siamese::GetCycles();
+        if (ii >= 0)
+            samples.push_back(t1 - t0);
+    }
+    result.EncodeCycles = bench::Summarize(samples).Median;
+    samples.clear();
+
+    for (int ii = -settings.Warmup; ii < settings.Repetitions; ++ii)
+    {
+        // Lose the first originals and replace them with recovery blocks
+        memcpy(&scratch[0], &recovery[0], scratch.size());
+        for (int jj = 0; jj < erasures; ++jj)
+        {
+            blocks[jj].data = &scratch[(size_t)jj * bytes];
+            blocks[jj].row = (uint8_t)(k + jj);
+        }
+        for (int jj = erasures; jj < k; ++jj)
+        {
+            blocks[jj].data = &data[(size_t)jj * bytes];
+            blocks[jj].row = (uint8_t)jj;
+        }
+
+        const uint64_t t0 = siamese::GetCycles();
+        const int decodeResult = cauchy_256_decode(k, m, &blocks[0], bytes);
+        const uint64_t t1 = siamese::GetCycles();
+        if (ii >= 0)
+            samples.push_back(t1 - t0);
+
+        for (int jj = 0; jj < erasures; ++jj)
+        {
+            const int row = blocks[jj].row;
+            if (decodeResult != 0 || row >= k ||
+                0 != memcmp(blocks[jj].data, data_ptrs[row], bytes))
+            {
+                result.Corrupted = true;
+            }
+        }
+    }
+    result.DecodeCycles = bench::Summarize(samples).Median;
+
+    return result;
+}
+
+struct SweepState
+{
+    const HeatMapSettings* Settings;
+    const vector<Cell>* Cells;
+    double CyclesPerUsec;
+
+    std::atomic<size_t> NextCell;
+
+    /// Protects Output and the counters below
+    std::mutex Lock;
+    FILE* Output;
+    size_t Completed;
+    int Failures;
+    uint64_t StartUsec;
+};
+
+static void SweepWorker(SweepState& state, int index)
+{
+    const HeatMapSettings& settings = *state.Settings;
+    siamese::PCGRandom prng;
+    prng.Seed(settings.Seed, index);
+
+    for (;;)
+    {
+        const size_t cellIndex = state.NextCell.fetch_add(1);
+        if (cellIndex >= state.Cells->size())
+            break;
+        const Cell& cell = (*state.Cells)[cellIndex];
+
+        const CellResult result = MeasureCell(settings, prng, cell.K, cell.M);
+
+        const double data_bytes = (double)cell.K * settings.Bytes;
+        const double enc_usec = result.EncodeCycles / state.CyclesPerUsec;
+        const double dec_usec = result.DecodeCycles / state.CyclesPerUsec;
+
+        std::lock_guard<std::mutex> locker(state.Lock);
+
+        if (result.Corrupted)
+        {
+            fprintf(stderr, "Decode failed or corrupted data for k=%d m=%d\n", cell.K, cell.M);
+            ++state.Failures;
+        }
+
+        fprintf(state.Output, "%d,%d,%d,%d,%.3f,%.1f,%.3f,%.1f\n",
+            cell.K, cell.M, settings.Bytes, min(cell.K, cell.M),
+            enc_usec, enc_usec > 0. ? data_bytes / enc_usec : 0.,
+            dec_usec, dec_usec > 0. ? data_bytes / dec_usec : 0.);
+        fflush(state.Output);
+
+        // Progress roughly every 1%
+        ++state.Completed;
+        const size_t total = state.Cells->size();
+        if (state.Completed == total || state.Completed % (total / 100 + 1) == 0)
+        {
+            const double elapsed = (siamese::GetTimeUsec() - state.StartUsec) / 1000000.;
+            fprintf(stderr, "\r%zu / %zu cells (%.0f%%), %.0f seconds",
+                state.Completed, total, 100. * state.Completed / total, elapsed);
+        }
+    }
+}
+
+
+//------------------------------------------------------------------------------
+// Entrypoint
+
+/// CPU model string for the output header, so maps from different machines
+/// can be told apart
+static string GetCpuName()
+{
+#if defined(__linux__)
+    FILE* file = fopen("/proc/cpuinfo", "r");
+    if (file)
+    {
+        char line[256];
+        while (fgets(line, sizeof(line), file))
+        {
+            const char* colon = strchr(line, ':');
+            if (colon && !strncmp(line, "model name", 10))
+            {
+                string name(colon + 1);
+                while (!name.empty() && (name.back() == '\n' || name.back() == ' '))
+                    name.pop_back();
+                while (!name.empty() && name.front() == ' ')
+                    name.erase(name.begin());
+                fclose(file);
+                return name;
+            }
+        }
+        fclose(file);
+    }
+#endif // __linux__
+    return "unknown";
+}
+
+int main(int argc, char** argv)
+{
+    HeatMapSettings settings;
+    if (!ParseSettings(argc, argv, settings))
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    if (cauchy_256_init())
+    {
+        printf("Wrong static library\n");
+        return 1;
+    }
+
+    set<pair<int, int>> done;
+    const bool appending = settings.Resume && LoadDoneCells(settings.Output, done);
+
+    const vector<Cell> cells = ListCells(settings, done);
+
+    int threadCount = settings.Threads;
+    if (threadCount <= 0)
+        threadCount = max(1, (int)std::thread::hardware_concurrency());
+
+    SweepState state;
+    state.Settings = &settings;
+    state.Cells = &cells;
+    state.CyclesPerUsec = bench::GetCyclesPerUsec();
+    state.NextCell = 0;
+    state.Completed = 0;
+    state.Failures = 0;
+    state.Output = fopen(settings.Output, appending ? "a" : "w");
+    if (!state.Output)
+    {
+        printf("Unable to open %s\n", settings.Output);
+        return 1;
+    }
+
+    if (!appending)
+    {
+        fprintf(state.Output, "# cpu: %s\n", GetCpuName().c_str());
+        fprintf(state.Output, "# threads: %d, repetitions: %d, worst-case erasures, median times\n",
+            threadCount, settings.Repetitions);
+        fprintf(state.Output, "k,m,bytes,erasures,enc_usec,enc_MBps,dec_usec,dec_MBps\n");
+        fflush(state.Output);
+    }
+
+    fprintf(stderr, "Measuring %zu cells (%zu already done) with %d threads into %s\n",
+        cells.size(), done.size(), threadCount, settings.Output);
+
+    state.StartUsec = siamese::GetTimeUsec();
+    vector<std::thread> threads;
+    for (int ii = 0; ii < threadCount; ++ii)
+        threads.emplace_back(SweepWorker, std::ref(state), ii);
+    for (std::thread& thread : threads)
+        thread.join();
+
+    fprintf(stderr, "\n");
+    fclose(state.Output);
+
+    return state.Failures ? 1 : 0;
+}
@@ -1,5 +1,4 @@
 #include <iostream>
-#include <fstream>
 #include <vector>
 using namespace std;
 
@@ -222,8 +221,6 @@ int main() {
     siamese::PCGRandom prng;
     prng.Seed(siamese::GetTimeUsec());
 
-	uint8_t heat_map[256 * 256] = { 0 };
-
 	for (unsigned block_count = 1; block_count < 256; ++block_count) {
 #ifdef CAT_REASONABLE_RECOVERY_COUNT
 		for (unsigned recovery_block_count = 1; recovery_block_count <= (block_count / 2) && recovery_block_count < (256 - block_count); ++recovery_block_count) {
@@ -245,8 +242,6 @@ int main() {
 				data_ptrs[ii] = &data[ii * block_bytes];
 			}
 
-            uint64_t sum_encode = 0;
-
 			unsigned erasures_count;
 #ifdef CAT_WORST_CASE_BENCHMARK
             erasures_count = recovery_block_count;
@@ -279,7 +274,6 @@ int main() {
 
                 const uint64_t t1 = siamese::GetTimeUsec();
 				const uint64_t encode_time = t1 - t0;
-				sum_encode += encode_time;
 
                 if (encode_time == 0) {
                     cout << "Encoded k=" << block_count << " data blocks with m=" << recovery_block_count
@@ -344,52 +338,7 @@ int main() {
                 }
 			}
 
-            if (erasures_count == 0) {
-                continue;
-            }
-            uint64_t avg_encode = sum_encode / erasures_count;
-            unsigned speed;
-            if (avg_encode == 0) {
-                speed = 10000;
-            }
-            else {
-                speed = (unsigned)((uint64_t)block_bytes * block_count / avg_encode);
-            }
-
-			uint8_t map_value = 0;
-
-			if (speed < 10) {
-				map_value = 1;
-			} else if (speed < 50) {
-				map_value = 2;
-			} else if (speed < 100) {
-				map_value = 3;
-			} else if (speed < 200) {
-				map_value = 4;
-			} else if (speed < 300) {
-				map_value = 5;
-			} else if (speed < 400) {
-				map_value = 6;
-			} else if (speed < 500) {
-				map_value = 7;
-			} else {
-				map_value = 8;
-			}
-
-			heat_map[block_count * 256 + recovery_block_count] = map_value;
-		}
-	}
-
-	ofstream file;
-	file.open("../docs/heatmap.txt");
-
-	for (int ii = 0; ii < 256; ++ii) {
-		for (int jj = 0; jj < 256; ++jj) {
-			uint8_t map_value = heat_map[ii * 256 + jj];
-
-			file << (int)map_value << " ";
 		}
-		file << endl;
 	}
 
 	return 0;
@@ -0,0 +1,463 @@
+/** \file
+    \brief Longhair Benchmark: GF(256) Kernels
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*
+    Microbenchmark for the bulk GF(256) memory operations the codec is built
+    on.  Each kernel is run over a sweep of buffer sizes (8 bytes to 16 MB by
+    default) for every instruction set path the CPU supports, forcing the
+    path with gf256_set_isa().  Throughput is reported in GB/s of output.
+
+    After each sweep the throughput curve is scanned for drops ("knees") and
+    each one is labelled with the cache level the working set outgrew, so a
+    regression in a kernel can be told apart from a change in the machine.
+
+    Example:
+        longhair_gf256_bench --max 1048576 -a 0,1,8 --csv
+*/
+
+#include "../gf256.h"
+#include "../SiameseTools.h"
+#include "BenchTools.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+using namespace std;
+
+
+//------------------------------------------------------------------------------
+// Kernels
+
+struct KernelBuffers
+{
+    uint8_t* X;
+    uint8_t* Y;
+    uint8_t* Z;
+};
+
+struct Kernel
+{
+    const char* Name;
+
+    /// Number of buffers of `bytes` touched by one call
+    int BufferCount;
+
+    void (*Run)(const KernelBuffers& buffers, int bytes);
+};
+
+static void RunAdd(const KernelBuffers& b, int bytes)
+{
+    gf256_add_mem(b.X, b.Y, bytes);
+}
+
+static void RunAdd2(const KernelBuffers& b, int bytes)
+{
+    gf256_add2_mem(b.Z, b.X, b.Y, bytes);
+}
+
+static void RunAddSet(const KernelBuffers& b, int bytes)
+{
+    gf256_addset_mem(b.Z, b.X, b.Y, bytes);
+}
+
+static void RunMul(const KernelBuffers& b, int bytes)
+{
+    gf256_mul_mem(b.Z, b.X, 0x8e, bytes);
+}
+
+static void RunMulAdd(const KernelBuffers& b, int bytes)
+{
+    gf256_muladd_mem(b.Z, 0x8e, b.X, bytes);
+}
+
+static const Kernel kKernels[] = {
+    { "add",    2, RunAdd },
+    { "add2",   3, RunAdd2 },
+    { "addset", 3, RunAddSet },
+    { "mul",    2, RunMul },
+    { "muladd", 2, RunMulAdd },
+};
+static const int kKernelCount = (int)(sizeof(kKernels) / sizeof(kKernels[0]));
+
+static const char* IsaName(int isa)
+{
+    switch (isa)
+    {
+    case GF256_ISA_GENERIC: return "generic";
+    case GF256_ISA_SSSE3: return "ssse3";
+    case GF256_ISA_AVX2: return "avx2";
+    case GF256_ISA_NEON: return "neon";
+    case GF256_ISA_AVX512: return "avx512";
+    default: break;
+    }
+    return "unknown";
+}
+
+
+//------------------------------------------------------------------------------
+// Settings
+
+struct BenchSettings
+{
+    int MinBytes = 8;
+    int MaxBytes = 16 * 1024 * 1024;
+
+    /// Byte offsets from a 64-byte aligned address
+    vector<int> Offsets = { 0 };
+
+    /// Empty means all kernels
+    vector<string> Kernels;
+
+    /// Empty means every path the CPU supports
+    vector<int> Isas;
+
+    int Trials = 7;
+
+    /// Minimum duration of one timed trial
+    int TrialUsec = 200;
+
+    bench::ReportFormat Format = bench::ReportFormat::Table;
+};
+
+static void Usage(const char* argv0)
+{
+    printf("Usage: %s [options]\n", argv0);
+    printf("  --min <bytes>  Smallest buffer size (default 8)\n");
+    printf("  --max <bytes>  Largest buffer size, doubling from --min (default 16777216)\n");
+    printf("  -a <list>      Byte offsets from 64-byte alignment (default 0)\n");
+    printf("  -k <name>      Only run this kernel; may repeat (add add2 addset mul muladd)\n");
+    printf("  -i <list>      ISA paths: 0=generic 1=ssse3 2=avx2 (default: all supported)\n");
+    printf("  -t <count>     Timed trials per point, median is reported (default 7)\n");
+    printf("  -u <usec>      Minimum duration of each trial (default 200)\n");
+    printf("  --csv          Write CSV output\n");
+    printf("  --json         Write JSON output\n");
+}
+
+static bool ParseSettings(int argc, char** argv, BenchSettings& settings)
+{
+    for (int ii = 1; ii < argc; ++ii)
+    {
+        const char* arg = argv[ii];
+        const char* value = (ii + 1 < argc) ? argv[ii + 1] : nullptr;
+
+        if (!strcmp(arg, "--csv"))
+            settings.Format = bench::ReportFormat::CSV;
+        else if (!strcmp(arg, "--json"))
+            settings.Format = bench::ReportFormat::JSON;
+        else if (!strcmp(arg, "--min") && value)
+            settings.MinBytes = atoi(argv[++ii]);
+        else if (!strcmp(arg, "--max") && value)
+            settings.MaxBytes = atoi(argv[++ii]);
+        else if (!strcmp(arg, "-a") && value && bench::ParseList(value, settings.Offsets))
+            ++ii;
+        else if (!strcmp(arg, "-i") && value && bench::ParseList(value, settings.Isas))
+            ++ii;
+        else if (!strcmp(arg, "-k") && value)
+            settings.Kernels.push_back(argv[++ii]);
+        else if (!strcmp(arg, "-t") && value)
+            settings.Trials = atoi(argv[++ii]);
+        else if (!strcmp(arg, "-u") && value)
+            settings.TrialUsec = atoi(argv[++ii]);
+        else
+            return false;
+    }
+
+    for (int offset : settings.Offsets)
+        if (offset < 0 || offset >= 64)
+            return false;
+
+    return settings.MinBytes > 0 &&
+        settings.MaxBytes >= settings.MinBytes &&
+        settings.Trials > 0 &&
+        settings.TrialUsec > 0;
+}
+
+static bool KernelSelected(const BenchSettings& settings, const char* name)
+{
+    if (settings.Kernels.empty())
+        return true;
+    for (const string& selected : settings.Kernels)
+        if (selected == name)
+            return true;
+    return false;
+}
+
+
+//------------------------------------------------------------------------------
+// Measurement
+
+/// One point on a throughput curve
+struct Point
+{
+    int Bytes;
+    uint64_t WorkingSet;
+    double GBps;
+};
+
+static double MeasureGBps(
+    const BenchSettings& settings,
+    const Kernel& kernel,
+    const KernelBuffers& buffers,
+    int bytes,
+    double cycles_per_usec)
+{
+    // Size the batch so that one trial lasts at least TrialUsec
+    kernel.Run(buffers, bytes);
+    uint64_t iterations = 1;
+    for (;;)
+    {
+        const uint64_t t0 = siamese::GetCycles();
+        for (uint64_t ii = 0; ii < iterations; ++ii)
+            kernel.Run(buffers, bytes);
+        const uint64_t t1 = siamese::GetCycles();
+        if ((double)(t1 - t0) >= settings.TrialUsec * cycles_per_usec)
+            break;
+        iterations *= 2;
+    }
+
+    vector<uint64_t> samples(settings.Trials);
+    for (int trial = 0; trial < settings.Trials; ++trial)
+    {
+        const uint64_t t0 = siamese::GetCycles();
+        for (uint64_t ii = 0; ii < iterations; ++ii)
+            kernel.Run(buffers, bytes);
+        const uint64_t t1 = siamese::GetCycles();
+        samples[trial] = t1 - t0;
+    }
+    const bench::SampleSummary summary = bench::Summarize(samples);
+
+    const double usec = summary.Median / cycles_per_usec;
+    if (usec <= 0.)
+        return 0.;
+    // bytes/usec = MB/s
+    return (double)bytes * (double)iterations / usec / 1000.;
+}
+
+
+//------------------------------------------------------------------------------
+// Knee Detection
+
+/// Throughput must fall below this fraction of the previous level's peak
+static const double kKneeDropRatio = 0.8;
+
+static const int kLevelCount = 4;
+static const char* const kLevelNames[kLevelCount] = { "L1", "L2", "L3", "DRAM" };
+
+/// Returns the index into kLevelNames of the smallest cache holding the
+/// working set, or -1 if the cache sizes are unknown
+static int CacheLevel(const bench::CacheSizes& caches, uint64_t workingSet)
+{
+    if (!caches.L1 || !caches.L2)
+        return -1;
+    if (workingSet <= caches.L1)
+        return 0;
+    if (workingSet <= caches.L2)
+        return 1;
+    if (caches.L3 && workingSet <= caches.L3)
+        return 2;
+    return 3;
+}
+
+/**
+    Scan a throughput curve for knees.
+
+    Small buffers are dominated by call overhead, so the points are grouped
+    by the cache level that holds their working set and the best throughput
+    of each group is taken as that level's plateau.  A knee is reported where
+    the plateau of one level falls below kKneeDropRatio of the level before.
+    Comparing plateaus rather than neighbouring points keeps timer noise from
+    showing up as knees.
+*/
+static void FindKnees(
+    const char* kernelName,
+    const char* isaName,
+    int offset,
+    const bench::CacheSizes& caches,
+    const vector<Point>& curve,
+    vector<string>& knees)
+{
+    double peak[kLevelCount] = {};
+    int firstBytes[kLevelCount] = {};
+
+    for (const Point& point : curve)
+    {
+        const int level = CacheLevel(caches, point.WorkingSet);
+        if (level < 0)
+            return;
+        if (!firstBytes[level])
+            firstBytes[level] = point.Bytes;
+        if (point.GBps > peak[level])
+            peak[level] = point.GBps;
+    }
+
+    int previous = -1;
+    for (int level = 0; level < kLevelCount; ++level)
+    {
+        if (peak[level] <= 0.)
+            continue;
+
+        if (previous >= 0 && peak[level] < peak[previous] * kKneeDropRatio)
+        {
+            char line[256];
+            snprintf(line, sizeof(line),
+                "# knee: %s/%s offset %d: %s -> %s at %d bytes: %.2f -> %.2f GB/s\n",
+                kernelName, isaName, offset,
+                kLevelNames[previous], kLevelNames[level], firstBytes[level],
+                peak[previous], peak[level]);
+            knees.push_back(line);
+        }
+
+        previous = level;
+    }
+}
+
+
+//------------------------------------------------------------------------------
+// Entrypoint
+
+int main(int argc, char** argv)
+{
+    BenchSettings settings;
+    if (!ParseSettings(argc, argv, settings))
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    if (gf256_init())
+    {
+        printf("Failed to initialize gf256\n");
+        return 1;
+    }
+
+    const int detectedIsa = gf256_get_isa();
+
+    vector<int> isas = settings.Isas;
+    if (isas.empty())
+    {
+#if defined(GF256_TARGET_MOBILE)
+        isas.push_back(detectedIsa);
+#else
+        for (int isa = GF256_ISA_GENERIC; isa <= detectedIsa; ++isa)
+            isas.push_back(isa);
+#endif
+    }
+
+    const double cycles_per_usec = bench::GetCyclesPerUsec();
+    const bench::CacheSizes caches = bench::GetCacheSizes();
+
+    // Annotations go to stderr for CSV/JSON so stdout stays machine-readable
+    FILE* notes = (settings.Format == bench::ReportFormat::Table) ? stdout : stderr;
+
+    fprintf(notes, "# gf256 benchmark: detected %s, L1 %u KB, L2 %u KB, L3 %u KB, %.1f cycles/usec\n",
+        IsaName(detectedIsa),
+        (unsigned)(caches.L1 / 1024), (unsigned)(caches.L2 / 1024), (unsigned)(caches.L3 / 1024),
+        cycles_per_usec);
+
+    // Allocate the largest buffers once, with room for the offset
+    const size_t allocated = (size_t)settings.MaxBytes + 128;
+    vector<uint8_t> storage(allocated * 3);
+    siamese::PCGRandom prng;
+    prng.Seed(0);
+    for (size_t ii = 0; ii < storage.size(); ++ii)
+        storage[ii] = (uint8_t)prng.Next();
+
+    uint8_t* aligned[3];
+    for (int ii = 0; ii < 3; ++ii)
+    {
+        uint8_t* base = &storage[allocated * ii];
+        aligned[ii] = base + ((64 - ((uintptr_t)base % 64)) % 64);
+    }
+
+    bench::Report report(settings.Format);
+    report.Columns({ "kernel", "isa", "offset", "bytes", "working_set", "GBps" });
+
+    vector<string> knees;
+
+    for (int kk = 0; kk < kKernelCount; ++kk)
+    {
+        const Kernel& kernel = kKernels[kk];
+        if (!KernelSelected(settings, kernel.Name))
+            continue;
+
+        for (int isa : isas)
+        {
+            const int actualIsa = gf256_set_isa(isa);
+            if (actualIsa != isa)
+                continue; // Not supported on this CPU
+
+            for (int offset : settings.Offsets)
+            {
+                const KernelBuffers buffers = {
+                    aligned[0] + offset,
+                    aligned[1] + offset,
+                    aligned[2] + offset
+                };
+
+                vector<Point> curve;
+
+                for (int64_t bytes = settings.MinBytes; bytes <= settings.MaxBytes; bytes *= 2)
+                {
+                    Point point;
+                    point.Bytes = (int)bytes;
+                    point.WorkingSet = (uint64_t)bytes * kernel.BufferCount;
+                    point.GBps = MeasureGBps(settings, kernel, buffers, point.Bytes, cycles_per_usec);
+                    curve.push_back(point);
+
+                    report.Row({
+                        kernel.Name,
+                        IsaName(actualIsa),
+                        to_string(offset),
+                        to_string(point.Bytes),
+                        to_string(point.WorkingSet),
+                        bench::Fixed(point.GBps, 2)
+                    });
+                }
+
+                FindKnees(kernel.Name, IsaName(actualIsa), offset, caches, curve, knees);
+            }
+        }
+    }
+
+    gf256_set_isa(GF256_ISA_AVX512);
+
+    report.End();
+
+    // Printed after the report so they do not break up the table
+    fprintf(notes, "\n");
+    for (const string& knee : knees)
+        fputs(knee.c_str(), notes);
+    if (knees.empty())
+        fprintf(notes, "# no knees found\n");
+
+    return 0;
+}
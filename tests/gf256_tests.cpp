@@ -0,0 +1,548 @@
+/** \file
+    \brief Longhair Tests: GF(256) Kernels
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+    The bulk GF(256) operations pick a SIMD path at runtime, so a portable
+    build runs whichever one the CPU has.  For every path gf256_set_isa()
+    can select here, each operation is checked against the generic path
+    over a range of lengths, misalignments and multipliers, through the
+    plain, *_x32 and *_a64 entry points, and the codec is run end to end
+    on both unaligned buffers and ones from longhair_alloc_blocks().
+    Paths the CPU lacks are reported as skipped.
+*/
+
+#include "TestTools.h"
+#include "../gf256.h"
+
+#include <string.h>
+#include <vector>
+
+
+//------------------------------------------------------------------------------
+// ISA Paths
+
+static const char* IsaName(int isa)
+{
+    switch (isa)
+    {
+    case GF256_ISA_GENERIC: return "generic";
+    case GF256_ISA_SSSE3: return "ssse3";
+    case GF256_ISA_AVX2: return "avx2";
+    case GF256_ISA_NEON: return "neon";
+    case GF256_ISA_AVX512: return "avx512";
+    default: break;
+    }
+    return "unknown";
+}
+
+/// Paths that gf256_set_isa() can select on this CPU.  Prints the rest
+static std::vector<int> GetIsas()
+{
+    std::vector<int> isas;
+    for (int isa = GF256_ISA_GENERIC; isa <= GF256_ISA_AVX512; ++isa)
+    {
+        const int actual = gf256_set_isa(isa);
+        if (actual == isa)
+            isas.push_back(isa);
+        else
+            printf("SKIPPED: %s is not available (gets %s)\n", IsaName(isa), IsaName(actual));
+    }
+    gf256_set_isa(GF256_ISA_AVX512);
+    return isas;
+}
+
+
+//------------------------------------------------------------------------------
+// Operations
+
+enum Op
+{
+    OpAdd,      // z[] += x[]
+    OpAdd2,     // z[] += x[] + y[]
+    OpAddset,   // z[] = x[] + y[]
+    OpMul,      // z[] = x[] * c
+    OpMuladd,   // z[] += x[] * c
+    OpCount
+};
+
+static const char* kOpNames[OpCount] = { "add", "add2", "addset", "mul", "muladd" };
+
+enum Entry
+{
+    EntryPlain, // gf256_*_mem()
+    EntryX32,   // gf256_*_mem_x32(): multiples of 32 bytes
+    EntryA64,   // gf256_*_mem_a64(): 64-byte aligned multiples of 64 bytes
+    EntryCount
+};
+
+static const char* kEntryNames[EntryCount] = { "", "_x32", "_a64" };
+
+/// Longest operation and largest misalignment tested
+static const int kMaxBytes = 4096 + 64;
+static const int kMaxOffset = 63;
+static const size_t kBufferBytes = kMaxBytes + kMaxOffset + 64;
+
+struct Case
+{
+    Op Operation = OpAdd;
+    Entry Entrypoint = EntryPlain;
+    int Bytes = 0;
+    uint8_t Coeff = 0;
+
+    /// Offset of z, x and y from a 64-byte boundary
+    unsigned Offsets[3] = { 0, 0, 0 };
+};
+
+/// z, x and y as aligned blocks, each with room for the offset and
+/// trailing bytes that must not be touched
+class Buffers
+{
+public:
+    Buffers()
+        : Stride(longhair_block_stride((int)kBufferBytes))
+        , Data(longhair_alloc_blocks(3, (int)kBufferBytes))
+    {
+    }
+    Buffers(const Buffers& other)
+        : Buffers()
+    {
+        memcpy(Data, other.Data, GetBytes());
+    }
+    ~Buffers()
+    {
+        longhair_free_blocks(Data);
+    }
+    Buffers& operator=(const Buffers&) = delete;
+
+    bool operator==(const Buffers& other) const
+    {
+        return 0 == memcmp(Data, other.Data, GetBytes());
+    }
+
+    void Fill(siamese::PCGRandom& prng)
+    {
+        test::FillRandom(prng, Data, GetBytes());
+    }
+
+    uint8_t* Get(int index, unsigned offset)
+    {
+        return Data + (size_t)index * Stride + offset;
+    }
+
+protected:
+    int Stride;
+    uint8_t* Data;
+
+    size_t GetBytes() const
+    {
+        return (size_t)3 * Stride;
+    }
+};
+
+static void Call(const Case& c, Buffers& buffers)
+{
+    uint8_t* z = buffers.Get(0, c.Offsets[0]);
+    const uint8_t* x = buffers.Get(1, c.Offsets[1]);
+    const uint8_t* y = buffers.Get(2, c.Offsets[2]);
+
+    if (c.Entrypoint == EntryA64)
+    {
+        switch (c.Operation)
+        {
+        case OpAdd: gf256_add_mem_a64(z, x, c.Bytes); break;
+        case OpAdd2: gf256_add2_mem_a64(z, x, y, c.Bytes); break;
+        case OpAddset: gf256_addset_mem_a64(z, x, y, c.Bytes); break;
+        case OpMul: gf256_mul_mem_a64(z, x, c.Coeff, c.Bytes); break;
+        case OpMuladd: gf256_muladd_mem_a64(z, c.Coeff, x, c.Bytes); break;
+        default: break;
+        }
+        return;
+    }
+
+    if (c.Entrypoint == EntryX32)
+    {
+        switch (c.Operation)
+        {
+        case OpAdd: gf256_add_mem_x32(z, x, c.Bytes); break;
+        case OpAdd2: gf256_add2_mem_x32(z, x, y, c.Bytes); break;
+        case OpAddset: gf256_addset_mem_x32(z, x, y, c.Bytes); break;
+        case OpMul: gf256_mul_mem_x32(z, x, c.Coeff, c.Bytes); break;
+        case OpMuladd: gf256_muladd_mem_x32(z, c.Coeff, x, c.Bytes); break;
+        default: break;
+        }
+        return;
+    }
+
+    switch (c.Operation)
+    {
+    case OpAdd: gf256_add_mem(z, x, c.Bytes); break;
+    case OpAdd2: gf256_add2_mem(z, x, y, c.Bytes); break;
+    case OpAddset: gf256_addset_mem(z, x, y, c.Bytes); break;
+    case OpMul: gf256_mul_mem(z, x, c.Coeff, c.Bytes); break;
+    case OpMuladd: gf256_muladd_mem(z, c.Coeff, x, c.Bytes); break;
+    default: break;
+    }
+}
+
+/// Byte at a time with the scalar gf256_mul(), to check the generic path
+static void CallScalar(const Case& c, Buffers& buffers)
+{
+    uint8_t* z = buffers.Get(0, c.Offsets[0]);
+    const uint8_t* x = buffers.Get(1, c.Offsets[1]);
+    const uint8_t* y = buffers.Get(2, c.Offsets[2]);
+
+    for (int ii = 0; ii < c.Bytes; ++ii)
+    {
+        switch (c.Operation)
+        {
+        case OpAdd: z[ii] ^= x[ii]; break;
+        case OpAdd2: z[ii] ^= x[ii] ^ y[ii]; break;
+        case OpAddset: z[ii] = x[ii] ^ y[ii]; break;
+        case OpMul: z[ii] = gf256_mul(x[ii], c.Coeff); break;
+        case OpMuladd: z[ii] ^= gf256_mul(x[ii], c.Coeff); break;
+        default: break;
+        }
+    }
+}
+
+/// Run the case on the given path and the plain entry point on the generic
+/// path from the same random buffers, and compare every byte of all three
+static void CheckCase(siamese::PCGRandom& prng, int isa, const Case& c)
+{
+    Buffers initial;
+    initial.Fill(prng);
+
+    Buffers expected = initial;
+    if (isa == GF256_ISA_GENERIC && c.Entrypoint == EntryPlain)
+        CallScalar(c, expected);
+    else
+    {
+        Case reference = c;
+        reference.Entrypoint = EntryPlain;
+        gf256_set_isa(GF256_ISA_GENERIC);
+        Call(reference, expected);
+        gf256_set_isa(isa);
+    }
+
+    Buffers actual = initial;
+    Call(c, actual);
+
+    if (!(actual == expected))
+    {
+        printf("FAILED: %s%s on %s: %d bytes, c = %u, offsets %u %u %u\n",
+            kOpNames[c.Operation], kEntryNames[c.Entrypoint], IsaName(isa), c.Bytes, c.Coeff,
+            c.Offsets[0], c.Offsets[1], c.Offsets[2]);
+        ++test::FailureCount();
+    }
+}
+
+/// Lengths around every vector size, and a spread of longer ones.
+/// Multiples of 32 or 64 only for the *_x32 and *_a64 entry points
+static std::vector<int> GetLengths(siamese::PCGRandom& prng, Entry entry)
+{
+    std::vector<int> lengths;
+    if (entry != EntryPlain)
+    {
+        const int step = entry == EntryX32 ? 32 : 64;
+        for (int bytes = 0; bytes <= kMaxBytes; bytes += step)
+            lengths.push_back(bytes);
+        return lengths;
+    }
+    for (int bytes = 0; bytes <= 320; ++bytes)
+        lengths.push_back(bytes);
+    for (int base = 512; base <= 4096; base *= 2)
+        for (int delta = -33; delta <= 33; ++delta)
+            lengths.push_back(base + delta);
+    for (int ii = 0; ii < 64; ++ii)
+        lengths.push_back((int)(prng.Next() % (kMaxBytes + 1)));
+    return lengths;
+}
+
+/// Multipliers 0 and 1 take shortcuts, so test them as well as random ones
+static uint8_t GetCoeff(siamese::PCGRandom& prng, int which)
+{
+    if (which < 2)
+        return (uint8_t)which;
+    return (uint8_t)(2 + prng.Next() % 254);
+}
+
+
+//------------------------------------------------------------------------------
+// Tests
+
+static void TestOperations(int isa)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(600 + isa);
+
+    gf256_set_isa(isa);
+
+    for (int entry = 0; entry < EntryCount; ++entry)
+    {
+        const std::vector<int> lengths = GetLengths(prng, (Entry)entry);
+
+        for (int op = 0; op < OpCount; ++op)
+        {
+            for (int which = 0; which < 3; ++which)
+            {
+                Case c;
+                c.Operation = (Op)op;
+                c.Entrypoint = (Entry)entry;
+
+                // Random misalignment for each length.  Aligned entry
+                // points start on the first or second cache line
+                for (int bytes : lengths)
+                {
+                    c.Bytes = bytes;
+                    c.Coeff = GetCoeff(prng, which);
+                    for (unsigned& offset : c.Offsets)
+                        offset = entry == EntryA64 ? 64 * (prng.Next() % 2) : prng.Next() % (kMaxOffset + 1);
+                    CheckCase(prng, isa, c);
+                }
+                if (entry == EntryA64)
+                    continue;
+
+                // Every misalignment, the same for all buffers and different
+                for (unsigned offset = 0; offset <= kMaxOffset; ++offset)
+                {
+                    c.Bytes = entry == EntryX32 ? 1024 + 32 * (int)(prng.Next() % 4) : 1000 + (int)(prng.Next() % 100);
+                    c.Coeff = GetCoeff(prng, which);
+                    c.Offsets[0] = c.Offsets[1] = c.Offsets[2] = offset;
+                    CheckCase(prng, isa, c);
+
+                    c.Offsets[1] = (offset + 17) % (kMaxOffset + 1);
+                    c.Offsets[2] = (offset + 40) % (kMaxOffset + 1);
+                    CheckCase(prng, isa, c);
+                }
+            }
+        }
+    }
+
+    gf256_set_isa(GF256_ISA_AVX512);
+}
+
+/// Encode with the path and check the recovery blocks match the generic
+/// path, then lose m originals and decode them
+static void TestCodec(int isa)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(700 + isa);
+
+    const int sizes[][3] = {
+        { 1, 1, 8 }, { 2, 2, 40 }, { 5, 3, 1000 }, { 10, 4, 1296 },
+        { 20, 10, 4104 }, { 64, 32, 512 }, { 128, 128, 64 }, { 200, 56, 24 }
+    };
+
+    for (const auto& size : sizes)
+    {
+        const int k = size[0], m = size[1], blockBytes = size[2];
+
+        // Stripe::Expected comes from the generic path
+        gf256_set_isa(GF256_ISA_GENERIC);
+        test::Stripe stripe;
+        stripe.Initialize(prng, k, m, blockBytes);
+        gf256_set_isa(isa);
+
+        std::vector<uint8_t> recovery((size_t)m * blockBytes);
+        TEST_CHECK(0 == cauchy_256_encode(k, m, stripe.DataPtrs.data(), recovery.data(), blockBytes));
+        TEST_CHECK(recovery == stripe.Expected);
+
+        // Lose the first min(k, m) originals
+        std::vector<uint8_t> originals = stripe.Data;
+        std::vector<Block> blocks(k);
+        for (int ii = 0; ii < k; ++ii)
+        {
+            if (ii < m)
+            {
+                blocks[ii].data = &recovery[(size_t)ii * blockBytes];
+                blocks[ii].row = (unsigned char)(k + ii);
+            }
+            else
+            {
+                blocks[ii].data = &originals[(size_t)ii * blockBytes];
+                blocks[ii].row = (unsigned char)ii;
+            }
+        }
+        TEST_CHECK(0 == cauchy_256_decode(k, m, blocks.data(), blockBytes));
+
+        for (const Block& block : blocks)
+        {
+            TEST_CHECK(block.row < k);
+            if (block.row < k)
+                TEST_CHECK(0 == memcmp(block.data, stripe.GetOriginal(block.row), blockBytes));
+        }
+    }
+
+    gf256_set_isa(GF256_ISA_AVX512);
+}
+
+/// longhair_alloc_blocks() gives zeroed, aligned blocks a whole number of
+/// cache lines apart
+static void TestAlignedBlocks()
+{
+    TEST_CHECK(longhair_block_stride(1) == 64);
+    TEST_CHECK(longhair_block_stride(64) == 64);
+    TEST_CHECK(longhair_block_stride(65) == 128);
+    TEST_CHECK(longhair_block_stride(1000) == 1024);
+    TEST_CHECK(longhair_block_stride(4096) == 4096);
+    TEST_CHECK(longhair_block_stride(0) == 0);
+    TEST_CHECK(longhair_block_stride(-64) == 0);
+    TEST_CHECK(longhair_block_stride(0x7fffffff) == 0);
+
+    TEST_CHECK(longhair_alloc_blocks(0, 64) == nullptr);
+    TEST_CHECK(longhair_alloc_blocks(-1, 64) == nullptr);
+    TEST_CHECK(longhair_alloc_blocks(4, 0) == nullptr);
+    TEST_CHECK(longhair_alloc_blocks(4, -1) == nullptr);
+    longhair_free_blocks(nullptr);
+
+    const int sizes[] = { 1, 8, 63, 64, 65, 100, 512, 1000, 1296, 4096 };
+    for (int blockBytes : sizes)
+    {
+        for (int count = 1; count <= 9; count += 4)
+        {
+            uint8_t* blocks = longhair_alloc_blocks(count, blockBytes);
+            TEST_CHECK(blocks != nullptr);
+            if (!blocks)
+                continue;
+            TEST_CHECK(((uintptr_t)blocks & 63) == 0);
+
+            // Blocks and the padding after each one start out zero
+            const int stride = longhair_block_stride(blockBytes);
+            TEST_CHECK(stride % 64 == 0 && stride >= blockBytes && stride < blockBytes + 64);
+            bool zero = true;
+            for (size_t ii = 0; ii < (size_t)count * stride; ++ii)
+                zero &= blocks[ii] == 0;
+            TEST_CHECK(zero);
+
+            // The whole span is writable
+            memset(blocks, 0xff, (size_t)count * stride);
+            longhair_free_blocks(blocks);
+        }
+    }
+}
+
+/// Encode and decode with 64-byte aligned blocks whose size is a multiple
+/// of 512, which take the *_a64 kernels in the codec, and check the results
+/// match the same data in unaligned buffers
+static void TestAlignedCodec(int isa)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(800 + isa);
+
+    const int sizes[][3] = {
+        { 1, 1, 512 }, { 4, 2, 512 }, { 10, 4, 1024 }, { 12, 12, 4096 },
+        { 30, 8, 1536 }, { 100, 30, 512 }
+    };
+
+    gf256_set_isa(isa);
+
+    for (const auto& size : sizes)
+    {
+        const int k = size[0], m = size[1], blockBytes = size[2];
+        TEST_CHECK(longhair_block_stride(blockBytes) == blockBytes);
+
+        // Unaligned: 8 bytes past a 64-byte boundary
+        std::vector<uint8_t> unaligned((size_t)(k + m) * blockBytes + 72);
+        uint8_t* unalignedData = unaligned.data() + (64 - ((uintptr_t)unaligned.data() & 63)) % 64 + 8;
+        uint8_t* unalignedRecovery = unalignedData + (size_t)k * blockBytes;
+        test::FillRandom(prng, unalignedData, (size_t)k * blockBytes);
+
+        uint8_t* data = longhair_alloc_blocks(k, blockBytes);
+        uint8_t* recovery = longhair_alloc_blocks(m, blockBytes);
+        TEST_CHECK(data && recovery);
+        if (!data || !recovery)
+        {
+            longhair_free_blocks(data);
+            longhair_free_blocks(recovery);
+            continue;
+        }
+        memcpy(data, unalignedData, (size_t)k * blockBytes);
+
+        std::vector<const uint8_t*> dataPtrs(k), unalignedPtrs(k);
+        for (int ii = 0; ii < k; ++ii)
+        {
+            dataPtrs[ii] = data + (size_t)ii * blockBytes;
+            unalignedPtrs[ii] = unalignedData + (size_t)ii * blockBytes;
+        }
+
+        TEST_CHECK(0 == cauchy_256_encode(k, m, unalignedPtrs.data(), unalignedRecovery, blockBytes));
+        TEST_CHECK(0 == cauchy_256_encode(k, m, dataPtrs.data(), recovery, blockBytes));
+        TEST_CHECK(0 == memcmp(recovery, unalignedRecovery, (size_t)m * blockBytes));
+
+        // Lose the first min(k, m) originals in both and decode in place
+        Block blocks[256], unalignedBlocks[256];
+        for (int ii = 0; ii < k; ++ii)
+        {
+            const bool lost = ii < m;
+            const int offset = (lost ? k + ii : ii) * blockBytes;
+            blocks[ii].data = lost ? recovery + (size_t)ii * blockBytes : data + (size_t)ii * blockBytes;
+            unalignedBlocks[ii].data = unalignedData + offset;
+            blocks[ii].row = unalignedBlocks[ii].row = (unsigned char)(lost ? k + ii : ii);
+        }
+        TEST_CHECK(0 == cauchy_256_decode(k, m, unalignedBlocks, blockBytes));
+        TEST_CHECK(0 == cauchy_256_decode(k, m, blocks, blockBytes));
+
+        for (int ii = 0; ii < k; ++ii)
+        {
+            TEST_CHECK(blocks[ii].row == unalignedBlocks[ii].row);
+            TEST_CHECK(0 == memcmp(blocks[ii].data, unalignedBlocks[ii].data, blockBytes));
+            if (blocks[ii].row < k)
+                TEST_CHECK(0 == memcmp(blocks[ii].data, dataPtrs[blocks[ii].row], blockBytes));
+        }
+
+        longhair_free_blocks(data);
+        longhair_free_blocks(recovery);
+    }
+
+    gf256_set_isa(GF256_ISA_AVX512);
+}
+
+
+int main()
+{
+    if (cauchy_256_init())
+    {
+        printf("cauchy_256_init failed\n");
+        return 1;
+    }
+
+    const std::vector<int> isas = GetIsas();
+    TEST_CHECK(!isas.empty());
+
+    for (int isa : isas)
+    {
+        printf("Testing %s\n", IsaName(isa));
+        TestOperations(isa);
+        TestCodec(isa);
+        TestAlignedCodec(isa);
+    }
+    TestAlignedBlocks();
+
+    return test::Finish("longhair_gf256_tests");
+}
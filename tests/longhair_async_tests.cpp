@@ -0,0 +1,504 @@
+/** \file
+    \brief Longhair Tests: Coroutine Awaitables
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+    Built as C++20, since the rest of the project is C++11 and
+    longhair_async.h is empty without coroutine support
+*/
+
+#include "TestTools.h"
+#include "../longhair_async.h"
+
+#ifndef LONGHAIR_HAS_COROUTINES
+    #error "C++20 build does not have coroutines"
+#endif
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+using namespace longhair;
+
+
+//------------------------------------------------------------------------------
+// Helpers
+
+/// Longest wait for a job.  A coroutine that never resumes fails the test
+/// instead of hanging it
+static const std::chrono::seconds kTimeout(30);
+
+static void FailTimeout(const char* what)
+{
+    printf("FAILED: timed out waiting for %s\n", what);
+    fflush(stdout);
+    _Exit(1);
+}
+
+/// Coroutine that starts right away and frees itself when it returns
+struct Task
+{
+    struct promise_type
+    {
+        Task get_return_object()
+        {
+            return Task();
+        }
+        std::suspend_never initial_suspend() noexcept
+        {
+            return std::suspend_never();
+        }
+        std::suspend_never final_suspend() noexcept
+        {
+            return std::suspend_never();
+        }
+        void return_void()
+        {
+        }
+        void unhandled_exception()
+        {
+            std::terminate();
+        }
+    };
+};
+
+/// What an awaiting coroutine saw
+struct Outcome
+{
+    std::promise<int> Result;
+    std::future<int> Future = Result.get_future();
+
+    /// Thread the coroutine continued on after co_await
+    std::thread::id ResumedOn;
+
+    bool IsDone() const
+    {
+        return Future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    /// Wait for the co_await result
+    int Get()
+    {
+        if (Future.wait_for(kTimeout) != std::future_status::ready)
+            FailTimeout("a coroutine to resume");
+        return Future.get();
+    }
+};
+
+static Task Await(CodecAwaitable awaitable, Outcome& outcome)
+{
+    const int result = co_await awaitable;
+    outcome.ResumedOn = std::this_thread::get_id();
+    outcome.Result.set_value(result);
+}
+
+/// Stands in for an event loop: AsyncOptions::Resume posts handles here
+/// and the test thread resumes them
+class ResumeQueue
+{
+public:
+    AsyncOptions GetOptions(int inlineBytes)
+    {
+        AsyncOptions options;
+        options.InlineBytes = inlineBytes;
+        options.Resume = [this](std::coroutine_handle<> handle) {
+            std::lock_guard<std::mutex> locker(Lock);
+            Handles.push_back(handle);
+            PostedFrom.push_back(std::this_thread::get_id());
+            Condition.notify_all();
+        };
+        return options;
+    }
+
+    /// Wait for a posted handle and resume it on this thread.
+    /// Returns the thread that posted it
+    std::thread::id RunOne()
+    {
+        std::unique_lock<std::mutex> locker(Lock);
+        if (!Condition.wait_for(locker, kTimeout, [this]() { return !Handles.empty(); }))
+            FailTimeout("a posted handle");
+        std::coroutine_handle<> handle = Handles.front();
+        const std::thread::id postedFrom = PostedFrom.front();
+        Handles.pop_front();
+        PostedFrom.pop_front();
+        locker.unlock();
+
+        handle.resume();
+        return postedFrom;
+    }
+
+    unsigned GetPostedCount()
+    {
+        std::lock_guard<std::mutex> locker(Lock);
+        return (unsigned)Handles.size();
+    }
+
+protected:
+    std::mutex Lock;
+    std::condition_variable Condition;
+    std::deque<std::coroutine_handle<>> Handles;
+    std::deque<std::thread::id> PostedFrom;
+};
+
+/// Originals with the first M lost and replaced by recovery rows
+struct LossyStripe
+{
+    test::Stripe Stripe;
+    std::vector<uint8_t> Originals;
+    std::vector<uint8_t> Recovery;
+    std::vector<Block> Blocks;
+
+    void Initialize(siamese::PCGRandom& prng, int k, int m, int blockBytes)
+    {
+        Stripe.Initialize(prng, k, m, blockBytes);
+        Originals = Stripe.Data;
+        Recovery = Stripe.Expected;
+
+        Blocks.resize(k);
+        for (int ii = 0; ii < k; ++ii)
+        {
+            if (ii < m)
+            {
+                Blocks[ii].data = &Recovery[(size_t)ii * blockBytes];
+                Blocks[ii].row = (unsigned char)(k + ii);
+            }
+            else
+            {
+                Blocks[ii].data = &Originals[(size_t)ii * blockBytes];
+                Blocks[ii].row = (unsigned char)ii;
+            }
+        }
+    }
+
+    DecodeJob GetJob()
+    {
+        DecodeJob job;
+        job.K = Stripe.K;
+        job.M = Stripe.M;
+        job.Blocks = Blocks.data();
+        job.BlockBytes = Stripe.BlockBytes;
+        return job;
+    }
+
+    bool IsRecovered() const
+    {
+        for (const Block& block : Blocks)
+            if (block.row >= Stripe.K ||
+                0 != memcmp(block.data, Stripe.GetOriginal(block.row), Stripe.BlockBytes))
+            {
+                return false;
+            }
+        return true;
+    }
+};
+
+static EncodeJob GetEncodeJob(test::Stripe& stripe, std::vector<uint8_t>& recovery)
+{
+    recovery.assign((size_t)stripe.M * stripe.BlockBytes, 0);
+
+    EncodeJob job;
+    job.K = stripe.K;
+    job.M = stripe.M;
+    job.DataPtrs = stripe.DataPtrs.data();
+    job.Recovery = recovery.data();
+    job.BlockBytes = stripe.BlockBytes;
+    return job;
+}
+
+static void StartPool(WorkerPool& pool, unsigned threads)
+{
+    PoolSettings settings;
+    settings.ThreadCount = threads;
+    TEST_CHECK(pool.Start(settings));
+    TEST_CHECK(pool.GetThreadCount() == threads);
+}
+
+
+//------------------------------------------------------------------------------
+// Tests
+
+/// Jobs at or below InlineBytes complete before the call returns, on the
+/// calling thread, and never go through Resume
+static void TestInlineThreshold()
+{
+    siamese::PCGRandom prng;
+    prng.Seed(80);
+
+    WorkerPool pool;
+    StartPool(pool, 2);
+    ResumeQueue queue;
+    const std::thread::id self = std::this_thread::get_id();
+
+    // Default threshold
+    {
+        test::Stripe stripe;
+        stripe.Initialize(prng, 4, 2, 64);
+        std::vector<uint8_t> recovery;
+
+        Outcome outcome;
+        Await(EncodeAsync(pool, GetEncodeJob(stripe, recovery)), outcome);
+        TEST_CHECK(outcome.IsDone());
+        TEST_CHECK(outcome.Get() == 0);
+        TEST_CHECK(outcome.ResumedOn == self);
+        TEST_CHECK(recovery == stripe.Expected);
+    }
+
+    // Exactly at the threshold, with a Resume that must not be used
+    {
+        test::Stripe stripe;
+        stripe.Initialize(prng, 10, 4, 1296);
+        std::vector<uint8_t> recovery;
+
+        Outcome outcome;
+        Await(EncodeAsync(pool, GetEncodeJob(stripe, recovery), queue.GetOptions(10 * 1296)), outcome);
+        TEST_CHECK(outcome.IsDone());
+        TEST_CHECK(outcome.Get() == 0);
+        TEST_CHECK(outcome.ResumedOn == self);
+        TEST_CHECK(recovery == stripe.Expected);
+
+        LossyStripe lossy;
+        lossy.Initialize(prng, 10, 4, 1296);
+
+        Outcome decoded;
+        Await(DecodeAsync(pool, lossy.GetJob(), queue.GetOptions(10 * 1296)), decoded);
+        TEST_CHECK(decoded.IsDone());
+        TEST_CHECK(decoded.Get() == 0);
+        TEST_CHECK(decoded.ResumedOn == self);
+        TEST_CHECK(lossy.IsRecovered());
+        TEST_CHECK(queue.GetPostedCount() == 0);
+    }
+
+    // One byte over the threshold goes to the pool
+    {
+        test::Stripe stripe;
+        stripe.Initialize(prng, 10, 4, 1296);
+        std::vector<uint8_t> recovery;
+
+        AsyncOptions options;
+        options.InlineBytes = 10 * 1296 - 1;
+
+        Outcome outcome;
+        Await(EncodeAsync(pool, GetEncodeJob(stripe, recovery), options), outcome);
+        TEST_CHECK(outcome.Get() == 0);
+        TEST_CHECK(outcome.ResumedOn != self);
+        TEST_CHECK(recovery == stripe.Expected);
+    }
+
+    // Invalid jobs fail inline too
+    {
+        test::Stripe stripe;
+        stripe.Initialize(prng, 4, 2, 64);
+        std::vector<uint8_t> recovery;
+        EncodeJob job = GetEncodeJob(stripe, recovery);
+        job.M = 253;
+
+        Outcome outcome;
+        Await(EncodeAsync(pool, job), outcome);
+        TEST_CHECK(outcome.IsDone());
+        TEST_CHECK(outcome.Get() != 0);
+        TEST_CHECK(outcome.ResumedOn == self);
+    }
+}
+
+/// Without worker threads every job runs inline, however large
+static void TestNoThreads()
+{
+    siamese::PCGRandom prng;
+    prng.Seed(81);
+
+    WorkerPool pool;
+    TEST_CHECK(pool.GetThreadCount() == 0);
+    ResumeQueue queue;
+    const std::thread::id self = std::this_thread::get_id();
+
+    test::Stripe stripe;
+    stripe.Initialize(prng, 64, 8, 4096);
+    std::vector<uint8_t> recovery;
+
+    Outcome outcome;
+    Await(EncodeAsync(pool, GetEncodeJob(stripe, recovery), queue.GetOptions(0)), outcome);
+    TEST_CHECK(outcome.IsDone());
+    TEST_CHECK(outcome.Get() == 0);
+    TEST_CHECK(outcome.ResumedOn == self);
+    TEST_CHECK(recovery == stripe.Expected);
+
+    LossyStripe lossy;
+    lossy.Initialize(prng, 64, 8, 4096);
+
+    Outcome decoded;
+    Await(DecodeAsync(pool, lossy.GetJob(), queue.GetOptions(0)), decoded);
+    TEST_CHECK(decoded.IsDone());
+    TEST_CHECK(decoded.Get() == 0);
+    TEST_CHECK(decoded.ResumedOn == self);
+    TEST_CHECK(lossy.IsRecovered());
+    TEST_CHECK(queue.GetPostedCount() == 0);
+}
+
+/// Without Resume the coroutine continues on the worker that ran the job
+static void TestPool(unsigned threads)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(82 + threads);
+
+    WorkerPool pool;
+    StartPool(pool, threads);
+    const std::thread::id self = std::this_thread::get_id();
+
+    AsyncOptions options;
+    options.InlineBytes = 0;
+
+    static const int kCases = 16;
+    std::vector<test::Stripe> stripes(kCases);
+    std::vector<std::vector<uint8_t>> recovery(kCases);
+    std::vector<LossyStripe> lossy(kCases);
+    std::vector<Outcome> encoded(kCases), decoded(kCases);
+
+    // Several in flight at once
+    for (int ii = 0; ii < kCases; ++ii)
+    {
+        const int k = 1 + (int)(prng.Next() % 64);
+        const int m = 1 + (int)(prng.Next() % 16);
+        const int blockBytes = 8 * (1 + (int)(prng.Next() % 128));
+        stripes[ii].Initialize(prng, k, m, blockBytes);
+        lossy[ii].Initialize(prng, k, m, blockBytes);
+
+        Await(EncodeAsync(pool, GetEncodeJob(stripes[ii], recovery[ii]), options), encoded[ii]);
+        Await(DecodeAsync(pool, lossy[ii].GetJob(), options), decoded[ii]);
+    }
+
+    for (int ii = 0; ii < kCases; ++ii)
+    {
+        TEST_CHECK(encoded[ii].Get() == 0);
+        TEST_CHECK(encoded[ii].ResumedOn != self);
+        TEST_CHECK(recovery[ii] == stripes[ii].Expected);
+
+        TEST_CHECK(decoded[ii].Get() == 0);
+        TEST_CHECK(decoded[ii].ResumedOn != self);
+        TEST_CHECK(lossy[ii].IsRecovered());
+    }
+
+    // Invalid jobs report their error through the pool as well
+    test::Stripe stripe;
+    stripe.Initialize(prng, 4, 2, 64);
+    std::vector<uint8_t> invalidRecovery;
+    EncodeJob job = GetEncodeJob(stripe, invalidRecovery);
+    job.M = 253;
+
+    Outcome outcome;
+    Await(EncodeAsync(pool, job, options), outcome);
+    TEST_CHECK(outcome.Get() != 0);
+    TEST_CHECK(outcome.ResumedOn != self);
+}
+
+/// With Resume the worker posts the handle and the coroutine continues on
+/// the thread that runs it
+static void TestPoolResume()
+{
+    siamese::PCGRandom prng;
+    prng.Seed(90);
+
+    WorkerPool pool;
+    StartPool(pool, 2);
+    ResumeQueue queue;
+    const std::thread::id self = std::this_thread::get_id();
+
+    // Large enough to go to the pool with the default threshold
+    test::Stripe stripe;
+    stripe.Initialize(prng, 32, 8, 1024);
+    std::vector<uint8_t> recovery;
+
+    AsyncOptions options = queue.GetOptions(kDefaultInlineBytes);
+
+    Outcome outcome;
+    Await(EncodeAsync(pool, GetEncodeJob(stripe, recovery), options), outcome);
+    TEST_CHECK(queue.RunOne() != self);
+    TEST_CHECK(outcome.IsDone());
+    TEST_CHECK(outcome.Get() == 0);
+    TEST_CHECK(outcome.ResumedOn == self);
+    TEST_CHECK(recovery == stripe.Expected);
+
+    LossyStripe lossy;
+    lossy.Initialize(prng, 32, 8, 1024);
+
+    Outcome decoded;
+    Await(DecodeAsync(pool, lossy.GetJob(), options), decoded);
+    TEST_CHECK(queue.RunOne() != self);
+    TEST_CHECK(decoded.IsDone());
+    TEST_CHECK(decoded.Get() == 0);
+    TEST_CHECK(decoded.ResumedOn == self);
+    TEST_CHECK(lossy.IsRecovered());
+
+    // Several in flight, resumed in whatever order they finish
+    static const int kCases = 8;
+    std::vector<test::Stripe> stripes(kCases);
+    std::vector<std::vector<uint8_t>> recoveries(kCases);
+    std::vector<Outcome> outcomes(kCases);
+
+    options.InlineBytes = 0;
+    for (int ii = 0; ii < kCases; ++ii)
+    {
+        stripes[ii].Initialize(prng, 1 + ii * 8, 4, 256);
+        Await(EncodeAsync(pool, GetEncodeJob(stripes[ii], recoveries[ii]), options), outcomes[ii]);
+    }
+    for (int ii = 0; ii < kCases; ++ii)
+        TEST_CHECK(queue.RunOne() != self);
+
+    for (int ii = 0; ii < kCases; ++ii)
+    {
+        TEST_CHECK(outcomes[ii].IsDone());
+        TEST_CHECK(outcomes[ii].Get() == 0);
+        TEST_CHECK(outcomes[ii].ResumedOn == self);
+        TEST_CHECK(recoveries[ii] == stripes[ii].Expected);
+    }
+    TEST_CHECK(queue.GetPostedCount() == 0);
+}
+
+
+int main()
+{
+    if (cauchy_256_init())
+    {
+        printf("cauchy_256_init failed\n");
+        return 1;
+    }
+
+    TestInlineThreshold();
+    TestNoThreads();
+    TestPool(1);
+    TestPool(4);
+    TestPoolResume();
+
+    return test::Finish("longhair_async_tests");
+}
@@ -0,0 +1,299 @@
+/** \file
+    \brief Longhair Tests: C++ Codec Interface
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+    Built twice, as C++17 (minimal Span) and as C++20 (std::span), since
+    the rest of the project is C++11 and does not include longhair_codec.h
+*/
+
+#include "TestTools.h"
+#include "../longhair_codec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(LONGHAIR_EXPECT_STD_SPAN) && !defined(LONGHAIR_HAS_STD_SPAN)
+    #error "C++20 build is not using std::span"
+#endif
+
+using namespace longhair;
+
+static_assert(!std::is_copy_constructible<Encoder>::value, "Encoder is move-only");
+static_assert(!std::is_copy_constructible<Decoder>::value, "Decoder is move-only");
+static_assert(std::is_nothrow_move_constructible<Encoder>::value, "Encoder moves");
+static_assert(std::is_nothrow_move_constructible<Decoder>::value, "Decoder moves");
+
+
+//------------------------------------------------------------------------------
+// Helpers
+
+static std::vector<std::byte> ToBytes(const uint8_t* data, size_t bytes)
+{
+    std::vector<std::byte> result(bytes);
+    memcpy(result.data(), data, bytes);
+    return result;
+}
+
+static bool Equal(ConstBytes bytes, const uint8_t* expected, size_t size)
+{
+    return bytes.size() == size && 0 == memcmp(bytes.data(), expected, size);
+}
+
+
+//------------------------------------------------------------------------------
+// Tests
+
+/// Encode with both overloads, lose up to m originals, and decode from the
+/// rest added in random order
+static void TestRoundTrip(int k, int m, int blockBytes, unsigned seed)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(seed);
+
+    test::Stripe stripe;
+    stripe.Initialize(prng, k, m, blockBytes);
+    const size_t recoveryBytes = (size_t)m * blockBytes;
+
+    Encoder encoder;
+    TEST_CHECK(encoder.Initialize(k, m, blockBytes));
+    TEST_CHECK(encoder.GetK() == k && encoder.GetM() == m && encoder.GetBlockBytes() == blockBytes);
+
+    // Contiguous data
+    const std::vector<std::byte> data = ToBytes(stripe.Data.data(), stripe.Data.size());
+    std::vector<std::byte> recovery(recoveryBytes);
+    TEST_CHECK(encoder.Encode(data, recovery));
+    TEST_CHECK(Equal(recovery, stripe.Expected.data(), recoveryBytes));
+
+    // Separate blocks
+    std::vector<ConstBytes> blocks;
+    for (int ii = 0; ii < k; ++ii)
+        blocks.push_back(ConstBytes(&data[(size_t)ii * blockBytes], (size_t)blockBytes));
+    std::vector<std::byte> recovery2(recoveryBytes);
+    TEST_CHECK(encoder.Encode(blocks, recovery2));
+    TEST_CHECK(recovery2 == recovery);
+
+    // Lose `lost` originals: the first ones of a shuffled row order
+    std::vector<unsigned> rows(k);
+    for (int ii = 0; ii < k; ++ii)
+        rows[ii] = (unsigned)ii;
+    for (int ii = k - 1; ii > 0; --ii)
+        std::swap(rows[ii], rows[prng.Next() % (ii + 1)]);
+    const int lost = (int)(prng.Next() % (std::min(k, m) + 1));
+    std::vector<bool> isLost(k, false);
+    for (int ii = 0; ii < lost; ++ii)
+        isLost[rows[ii]] = true;
+
+    // Received buffers, in a shuffled order: the surviving originals and
+    // `lost` recovery blocks
+    std::vector<std::vector<std::byte>> received;
+    std::vector<unsigned> receivedRows;
+    for (int ii = 0; ii < k; ++ii)
+    {
+        if (isLost[ii])
+            continue;
+        received.push_back(ToBytes(stripe.GetOriginal(ii), blockBytes));
+        receivedRows.push_back((unsigned)ii);
+    }
+    for (int ii = 0; ii < lost; ++ii)
+    {
+        const unsigned recoveryRow = (unsigned)(prng.Next() % m);
+        bool duplicate = false;
+        for (unsigned row : receivedRows)
+            duplicate |= row == (unsigned)k + recoveryRow;
+        if (duplicate)
+        {
+            --ii;
+            continue;
+        }
+        received.push_back(ToBytes(&stripe.Expected[(size_t)recoveryRow * blockBytes], blockBytes));
+        receivedRows.push_back((unsigned)k + recoveryRow);
+    }
+    std::vector<unsigned> order(received.size());
+    for (size_t ii = 0; ii < order.size(); ++ii)
+        order[ii] = (unsigned)ii;
+    for (size_t ii = order.size() - 1; ii > 0; --ii)
+        std::swap(order[ii], order[prng.Next() % (ii + 1)]);
+
+    Decoder decoder;
+    TEST_CHECK(decoder.Initialize(k, m, blockBytes));
+    TEST_CHECK(!decoder.Decode());
+    for (unsigned index : order)
+    {
+        TEST_CHECK(!decoder.IsReady());
+        TEST_CHECK(decoder.Add(receivedRows[index], received[index]));
+    }
+    TEST_CHECK(decoder.IsReady());
+
+    // Received originals are available before decoding, lost ones are not
+    for (int ii = 0; ii < k; ++ii)
+    {
+        const MutableBytes original = decoder.GetOriginal(ii);
+        if (isLost[ii])
+            TEST_CHECK(original.empty());
+        else
+            TEST_CHECK(Equal(original, stripe.GetOriginal(ii), blockBytes));
+    }
+
+    TEST_CHECK(decoder.Decode());
+    TEST_CHECK(decoder.Decode());
+
+    // After decoding the lost rows are found in the recovery buffers that
+    // were repaired in place
+    for (int ii = 0; ii < k; ++ii)
+    {
+        const MutableBytes original = decoder.GetOriginal(ii);
+        TEST_CHECK(Equal(original, stripe.GetOriginal(ii), blockBytes));
+
+        bool inRecoveryBuffer = false;
+        for (size_t jj = 0; jj < received.size(); ++jj)
+            if (receivedRows[jj] >= (unsigned)k && original.data() == received[jj].data())
+                inRecoveryBuffer = true;
+        TEST_CHECK(inRecoveryBuffer == isLost[ii]);
+    }
+    TEST_CHECK(decoder.GetOriginal(k).empty());
+}
+
+/// Invalid parameters and blocks are rejected, and the objects move
+static void TestInterface()
+{
+    siamese::PCGRandom prng;
+    prng.Seed(60);
+
+    Encoder encoder;
+    std::vector<std::byte> data(4 * 64), recovery(2 * 64);
+    TEST_CHECK(!encoder.Encode(data, recovery));
+    TEST_CHECK(!encoder.Initialize(0, 2, 64));
+    TEST_CHECK(!encoder.Initialize(4, 0, 64));
+    TEST_CHECK(!encoder.Initialize(200, 57, 64));
+    TEST_CHECK(!encoder.Initialize(4, 2, 60));
+    TEST_CHECK(encoder.Initialize(4, 2, 64));
+
+    // Sizes must match exactly
+    std::vector<std::byte> shortData(4 * 64 - 8), longRecovery(3 * 64);
+    TEST_CHECK(!encoder.Encode(shortData, recovery));
+    TEST_CHECK(!encoder.Encode(data, longRecovery));
+    std::vector<ConstBytes> blocks(3, ConstBytes(data.data(), 64));
+    TEST_CHECK(!encoder.Encode(blocks, recovery));
+    blocks.push_back(ConstBytes(data.data(), 56));
+    TEST_CHECK(!encoder.Encode(blocks, recovery));
+    TEST_CHECK(encoder.Encode(data, recovery));
+
+    // A moved encoder keeps working, and the moved-from one can be reused
+    Encoder moved(std::move(encoder));
+    TEST_CHECK(moved.Encode(data, recovery));
+    TEST_CHECK(encoder.Initialize(8, 4, 128));
+    std::vector<std::byte> data8(8 * 128), recovery8(4 * 128);
+    TEST_CHECK(encoder.Encode(data8, recovery8));
+
+    Decoder decoder;
+    std::vector<std::byte> block(64), block2(64), wrongSize(56);
+    TEST_CHECK(!decoder.Add(0, block));
+    TEST_CHECK(decoder.Initialize(4, 2, 64));
+    TEST_CHECK(!decoder.Add(6, block));
+    TEST_CHECK(!decoder.Add(0, wrongSize));
+    TEST_CHECK(decoder.Add(0, block));
+    TEST_CHECK(!decoder.Add(0, block2));
+    TEST_CHECK(decoder.Add(4, block2));
+    TEST_CHECK(decoder.Add(1, block));
+    TEST_CHECK(decoder.Add(2, block));
+    TEST_CHECK(!decoder.Add(3, block));
+
+    // Reset() starts over with the same parameters
+    decoder.Reset();
+    TEST_CHECK(!decoder.IsReady());
+    TEST_CHECK(decoder.GetOriginal(0).empty());
+    TEST_CHECK(decoder.Add(0, block));
+
+    Decoder movedDecoder;
+    movedDecoder = std::move(decoder);
+    TEST_CHECK(movedDecoder.GetK() == 4);
+    TEST_CHECK(!movedDecoder.GetOriginal(0).empty());
+}
+
+/// One Decoder reused for several stripes with Reset()
+static void TestReuse()
+{
+    siamese::PCGRandom prng;
+    prng.Seed(61);
+
+    const int k = 12, m = 4, blockBytes = 256;
+    Decoder decoder;
+    TEST_CHECK(decoder.Initialize(k, m, blockBytes));
+
+    for (int pass = 0; pass < 5; ++pass)
+    {
+        test::Stripe stripe;
+        stripe.Initialize(prng, k, m, blockBytes);
+
+        // Lose originals 0..m-1, receive every recovery block
+        std::vector<std::vector<std::byte>> buffers;
+        for (int ii = m; ii < k; ++ii)
+            buffers.push_back(ToBytes(stripe.GetOriginal(ii), blockBytes));
+        for (int ii = 0; ii < m; ++ii)
+            buffers.push_back(ToBytes(&stripe.Expected[(size_t)ii * blockBytes], blockBytes));
+
+        decoder.Reset();
+        for (int ii = 0; ii < k; ++ii)
+        {
+            const unsigned row = ii < k - m ? (unsigned)(m + ii) : (unsigned)(k + ii - (k - m));
+            TEST_CHECK(decoder.Add(row, buffers[ii]));
+        }
+        TEST_CHECK(decoder.Decode());
+        for (int ii = 0; ii < k; ++ii)
+            TEST_CHECK(Equal(decoder.GetOriginal(ii), stripe.GetOriginal(ii), blockBytes));
+    }
+}
+
+
+//------------------------------------------------------------------------------
+// Entrypoint
+
+int main()
+{
+    if (cauchy_256_init())
+    {
+        printf("cauchy_256_init failed\n");
+        return 1;
+    }
+
+    TestInterface();
+    TestReuse();
+
+    unsigned seed = 70;
+    const int sizes[][3] = {
+        { 1, 1, 8 }, { 1, 4, 64 }, { 2, 1, 16 }, { 4, 2, 64 }, { 10, 4, 1296 },
+        { 32, 8, 512 }, { 100, 20, 64 }, { 200, 56, 8 }, { 255, 1, 16 }
+    };
+    for (const auto& size : sizes)
+        for (int trial = 0; trial < 8; ++trial)
+            TestRoundTrip(size[0], size[1], size[2], ++seed);
+
+    return test::Finish("longhair_codec_tests");
+}
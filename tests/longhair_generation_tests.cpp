@@ -0,0 +1,487 @@
+/** \file
+    \brief Longhair Tests: Generation Manager
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "TestTools.h"
+#include "../longhair_generation.h"
+
+#include <cstring>
+#include <map>
+#include <set>
+#include <type_traits>
+#include <utility>
+
+using namespace longhair;
+
+static_assert(!std::is_copy_constructible<BlockPool>::value, "BlockPool owns its slabs");
+static_assert(!std::is_copy_assignable<BlockPool>::value, "BlockPool owns its slabs");
+static_assert(!std::is_copy_constructible<GenerationManager>::value, "Release captures this");
+static_assert(!std::is_copy_assignable<GenerationManager>::value, "Release captures this");
+
+
+//------------------------------------------------------------------------------
+// Helpers
+
+struct Packet
+{
+    uint32_t Generation;
+    unsigned Row;
+    std::vector<uint8_t> Data;
+};
+
+/// Sender output for `generations` generations of random originals
+struct Stream
+{
+    SessionSettings Settings;
+    std::vector<uint8_t> Input;
+    std::vector<Packet> Packets;
+
+    void Initialize(siamese::PCGRandom& prng, const SessionSettings& settings, int generations)
+    {
+        Settings = settings;
+        const size_t count = (size_t)generations * settings.K;
+        Input.resize(count * settings.BlockBytes);
+        test::FillRandom(prng, Input.data(), Input.size());
+
+        Sender sender;
+        TEST_CHECK(sender.Initialize(settings, [&](uint32_t generation, unsigned row, const uint8_t* data, int bytes) {
+            Packets.push_back({ generation, row, std::vector<uint8_t>(data, data + bytes) });
+        }));
+        for (size_t ii = 0; ii < count; ++ii)
+            TEST_CHECK(sender.Send(&Input[ii * settings.BlockBytes]));
+    }
+
+    const uint8_t* GetOriginal(uint32_t generation, unsigned row) const
+    {
+        return &Input[OriginalStreamIndex(Settings, generation, row) * Settings.BlockBytes];
+    }
+};
+
+/// Deliver callback that checks the data and counts each (generation, row)
+struct DeliveryLog
+{
+    const Stream* Source = nullptr;
+    std::map<std::pair<uint32_t, unsigned>, int> Counts;
+
+    DeliverT GetCallback()
+    {
+        return [this](uint32_t generation, unsigned row, const uint8_t* data, int bytes) {
+            TEST_CHECK(bytes == Source->Settings.BlockBytes);
+            TEST_CHECK(row < (unsigned)Source->Settings.K);
+            TEST_CHECK(0 == memcmp(data, Source->GetOriginal(generation, row), bytes));
+            ++Counts[std::make_pair(generation, row)];
+        };
+    }
+
+    int GetCount(uint32_t generation, unsigned row) const
+    {
+        auto it = Counts.find(std::make_pair(generation, row));
+        return it == Counts.end() ? 0 : it->second;
+    }
+
+    /// Number of originals of the generation delivered.  Checks none twice
+    int GetDelivered(uint32_t generation) const
+    {
+        int delivered = 0;
+        for (unsigned row = 0; row < (unsigned)Source->Settings.K; ++row)
+        {
+            const int count = GetCount(generation, row);
+            TEST_CHECK(count <= 1);
+            delivered += count;
+        }
+        return delivered;
+    }
+};
+
+static void FeedPacket(GenerationManager& manager, const Packet& packet, uint64_t nowMsec)
+{
+    uint8_t* buffer = manager.AllocateBuffer();
+    TEST_CHECK(buffer != nullptr);
+    if (!buffer)
+        return;
+    memcpy(buffer, packet.Data.data(), packet.Data.size());
+    TEST_CHECK(manager.OnPacket(packet.Generation, packet.Row, buffer, nowMsec));
+}
+
+
+//------------------------------------------------------------------------------
+// Tests
+
+static void TestBlockPool()
+{
+    BlockPool pool;
+    TEST_CHECK(pool.Allocate() == nullptr);
+    TEST_CHECK(!pool.Initialize(0));
+    TEST_CHECK(!pool.Initialize(64, 0));
+
+    // 100 bytes round up to a 128 byte stride, three slabs of 4 + 4 + 2
+    const unsigned kLimit = 10;
+    TEST_CHECK(pool.Initialize(100, 4, kLimit));
+    std::vector<uint8_t*> blocks;
+    for (unsigned ii = 0; ii < kLimit; ++ii)
+    {
+        uint8_t* block = pool.Allocate();
+        TEST_CHECK(block != nullptr);
+        TEST_CHECK((uintptr_t)block % BlockPool::kAlignment == 0);
+        memset(block, (int)ii, 100);
+        blocks.push_back(block);
+    }
+    TEST_CHECK(pool.Allocate() == nullptr);
+    TEST_CHECK(pool.GetCapacity() == kLimit);
+    TEST_CHECK(pool.GetUsedCount() == kLimit);
+    TEST_CHECK(blocks[1] == blocks[0] + 128);
+    TEST_CHECK(std::set<uint8_t*>(blocks.begin(), blocks.end()).size() == kLimit);
+
+    // Blocks do not overlap
+    for (unsigned ii = 0; ii < kLimit; ++ii)
+        for (unsigned jj = 0; jj < 100; ++jj)
+            TEST_CHECK(blocks[ii][jj] == (uint8_t)ii);
+
+    // Freed blocks come back last in, first out without a new slab
+    pool.Free(blocks[3]);
+    pool.Free(blocks[7]);
+    TEST_CHECK(pool.GetUsedCount() == kLimit - 2);
+    TEST_CHECK(pool.Allocate() == blocks[7]);
+    TEST_CHECK(pool.Allocate() == blocks[3]);
+    TEST_CHECK(pool.Allocate() == nullptr);
+    TEST_CHECK(pool.GetCapacity() == kLimit);
+
+    // Free(nullptr) is ignored
+    pool.Free(nullptr);
+    TEST_CHECK(pool.GetUsedCount() == kLimit);
+
+    // Everything freed is handed out again, and no other block
+    for (uint8_t* block : blocks)
+        pool.Free(block);
+    TEST_CHECK(pool.GetUsedCount() == 0);
+    std::set<uint8_t*> again;
+    for (unsigned ii = 0; ii < kLimit; ++ii)
+        again.insert(pool.Allocate());
+    TEST_CHECK(again == std::set<uint8_t*>(blocks.begin(), blocks.end()));
+    TEST_CHECK(pool.GetCapacity() == kLimit);
+
+    TEST_CHECK(pool.Reserve(kLimit));
+    TEST_CHECK(!pool.Reserve(kLimit + 1));
+
+    // Initialize() drops the old slabs
+    TEST_CHECK(pool.Initialize(64, 8));
+    TEST_CHECK(pool.GetCapacity() == 0);
+    TEST_CHECK(pool.GetUsedCount() == 0);
+    TEST_CHECK(pool.Reserve(20));
+    TEST_CHECK(pool.GetCapacity() == 24);
+    TEST_CHECK(pool.GetUsedCount() == 0);
+}
+
+static void TestSettings()
+{
+    auto deliver = [](uint32_t, unsigned, const uint8_t*, int) {};
+
+    GenerationManagerSettings settings;
+    settings.Session.K = 4, settings.Session.M = 2, settings.Session.BlockBytes = 64;
+    settings.Session.Interleave = 4;
+    settings.MaxGenerations = 8;
+
+    GenerationManager manager;
+    TEST_CHECK(manager.Initialize(settings, deliver));
+    TEST_CHECK(!manager.Initialize(settings, nullptr));
+
+    // Needs room for two interleaved groups
+    settings.MaxGenerations = 7;
+    TEST_CHECK(!manager.Initialize(settings, deliver));
+    settings.MaxGenerations = 8;
+
+    settings.Session.BlockBytes = 60;
+    TEST_CHECK(!manager.Initialize(settings, deliver));
+    settings.Session.BlockBytes = 64;
+
+    // Out of range rows are rejected and the caller keeps the buffer
+    TEST_CHECK(manager.Initialize(settings, deliver));
+    uint8_t* buffer = manager.AllocateBuffer();
+    TEST_CHECK(!manager.OnPacket(0, 6, buffer, 0));
+    TEST_CHECK(!manager.OnPacket(0, 0, nullptr, 0));
+    TEST_CHECK(manager.GetPool().GetUsedCount() == 1);
+    manager.FreeBuffer(buffer);
+    TEST_CHECK(manager.GetPool().GetUsedCount() == 0);
+}
+
+/// More generations than slots, each needing recovery: generation g and
+/// g + MaxGenerations share a slot
+static void TestSlotReuse()
+{
+    siamese::PCGRandom prng;
+    prng.Seed(20);
+
+    GenerationManagerSettings settings;
+    settings.Session.K = 4, settings.Session.M = 2, settings.Session.BlockBytes = 64;
+    settings.MaxGenerations = 4;
+
+    const int kGenerations = 12;
+    Stream stream;
+    stream.Initialize(prng, settings.Session, kGenerations);
+
+    DeliveryLog log;
+    log.Source = &stream;
+    GenerationManager manager;
+    TEST_CHECK(manager.Initialize(settings, log.GetCallback()));
+
+    // Lose the first original of every generation
+    uint64_t nowMsec = 0;
+    for (const Packet& packet : stream.Packets)
+        if (packet.Row != 0)
+            FeedPacket(manager, packet, ++nowMsec);
+
+    for (uint32_t gen = 0; gen < (uint32_t)kGenerations; ++gen)
+        TEST_CHECK(log.GetDelivered(gen) == settings.Session.K);
+    TEST_CHECK(manager.GetRecoveredGenerations() == (uint64_t)kGenerations);
+    TEST_CHECK(manager.GetLostGenerations() == 0);
+    TEST_CHECK(manager.GetReceivingCount() == 0);
+
+    // Buffers went back to the pool as each generation was recovered
+    TEST_CHECK(manager.GetPool().GetUsedCount() == 0);
+    TEST_CHECK(manager.GetPool().GetCapacity() <= settings.MaxGenerations * (unsigned)settings.Session.K);
+
+    // Late packet for a recovered generation still in the table is dropped
+    FeedPacket(manager, stream.Packets.back(), nowMsec);
+    // Late packet for a generation whose slot was reused is dropped
+    FeedPacket(manager, stream.Packets.front(), nowMsec);
+    TEST_CHECK(manager.GetPool().GetUsedCount() == 0);
+    TEST_CHECK(manager.GetReceivingCount() == 0);
+    TEST_CHECK(log.GetCount(0, 0) == 1);
+    TEST_CHECK(manager.GetRecoveredGenerations() == (uint64_t)kGenerations);
+}
+
+/// A generation still receiving when a newer one needs its slot is lost
+static void TestPushedOut()
+{
+    siamese::PCGRandom prng;
+    prng.Seed(21);
+
+    GenerationManagerSettings settings;
+    settings.Session.K = 4, settings.Session.M = 2, settings.Session.BlockBytes = 64;
+    settings.MaxGenerations = 4;
+
+    Stream stream;
+    stream.Initialize(prng, settings.Session, 5);
+    const unsigned rowsPerGeneration = settings.Session.K + settings.Session.M;
+
+    DeliveryLog log;
+    log.Source = &stream;
+    GenerationManager manager;
+    TEST_CHECK(manager.Initialize(settings, log.GetCallback()));
+
+    // Generation 0 gets K - 1 rows, then generation 4 takes its slot
+    for (unsigned row = 1; row < (unsigned)settings.Session.K; ++row)
+        FeedPacket(manager, stream.Packets[row], 0);
+    TEST_CHECK(manager.GetReceivingCount() == 1);
+    TEST_CHECK(manager.GetPool().GetUsedCount() == (unsigned)settings.Session.K - 1);
+
+    FeedPacket(manager, stream.Packets[4 * rowsPerGeneration], 1);
+    TEST_CHECK(manager.GetLostGenerations() == 1);
+    TEST_CHECK(manager.GetReceivingCount() == 1);
+    TEST_CHECK(manager.GetPool().GetUsedCount() == 1);
+
+    // Generation 0 is now too old for the table
+    FeedPacket(manager, stream.Packets[0], 2);
+    TEST_CHECK(log.GetDelivered(0) == settings.Session.K - 1);
+    TEST_CHECK(manager.GetPool().GetUsedCount() == 1);
+
+    // Generation 1 is not: it is received and recovered normally
+    for (unsigned row = 1; row < rowsPerGeneration; ++row)
+        FeedPacket(manager, stream.Packets[rowsPerGeneration + row], 3);
+    TEST_CHECK(log.GetDelivered(1) == settings.Session.K);
+    TEST_CHECK(manager.GetRecoveredGenerations() == 1);
+    TEST_CHECK(manager.GetPool().GetUsedCount() == 1);
+}
+
+/// Expire() abandons generations oldest first, by when they started
+static void TestExpire()
+{
+    siamese::PCGRandom prng;
+    prng.Seed(22);
+
+    GenerationManagerSettings settings;
+    settings.Session.K = 4, settings.Session.M = 2, settings.Session.BlockBytes = 64;
+    settings.MaxGenerations = 8;
+
+    Stream stream;
+    stream.Initialize(prng, settings.Session, 3);
+    const unsigned rowsPerGeneration = settings.Session.K + settings.Session.M;
+
+    DeliveryLog log;
+    log.Source = &stream;
+    GenerationManager manager;
+    TEST_CHECK(manager.Initialize(settings, log.GetCallback()));
+
+    // One packet each, started at 0, 50 and 100 msec.  Later packets do
+    // not move the start time
+    FeedPacket(manager, stream.Packets[0], 0);
+    FeedPacket(manager, stream.Packets[rowsPerGeneration], 50);
+    FeedPacket(manager, stream.Packets[2 * rowsPerGeneration], 100);
+    FeedPacket(manager, stream.Packets[1], 110);
+    TEST_CHECK(manager.GetReceivingCount() == 3);
+    TEST_CHECK(manager.GetPool().GetUsedCount() == 4);
+
+    manager.Expire(100, 60);
+    TEST_CHECK(manager.GetLostGenerations() == 1);
+    TEST_CHECK(manager.GetReceivingCount() == 2);
+    TEST_CHECK(manager.GetPool().GetUsedCount() == 2);
+
+    manager.Expire(120, 60);
+    TEST_CHECK(manager.GetLostGenerations() == 2);
+    TEST_CHECK(manager.GetReceivingCount() == 1);
+    TEST_CHECK(manager.GetPool().GetUsedCount() == 1);
+
+    // Packets for an expired generation are dropped
+    FeedPacket(manager, stream.Packets[2], 130);
+    TEST_CHECK(log.GetDelivered(0) == 2);
+    TEST_CHECK(manager.GetPool().GetUsedCount() == 1);
+
+    // The one left recovers from its recovery rows
+    for (unsigned row = settings.Session.K; row < rowsPerGeneration; ++row)
+        FeedPacket(manager, stream.Packets[2 * rowsPerGeneration + row], 130);
+    FeedPacket(manager, stream.Packets[2 * rowsPerGeneration + 1], 130);
+    TEST_CHECK(log.GetDelivered(2) == settings.Session.K);
+    TEST_CHECK(manager.GetRecoveredGenerations() == 1);
+    TEST_CHECK(manager.GetReceivingCount() == 0);
+    TEST_CHECK(manager.GetPool().GetUsedCount() == 0);
+
+    // Nothing left to expire
+    manager.Expire(1000, 60);
+    TEST_CHECK(manager.GetLostGenerations() == 2);
+}
+
+/// Generations on both sides of the 32-bit wrap each get their own slot,
+/// also when MaxGenerations is not a power of two
+static void TestGenerationWrap()
+{
+    siamese::PCGRandom prng;
+    prng.Seed(24);
+
+    GenerationManagerSettings settings;
+    settings.Session.K = 4, settings.Session.M = 2, settings.Session.BlockBytes = 64;
+    settings.MaxGenerations = 12;
+
+    // Sent as generations 0..15, received as 2^32 - 8 .. 7
+    const uint32_t kShift = (uint32_t)0 - 8;
+    const int kGenerations = 16;
+    Stream stream;
+    stream.Initialize(prng, settings.Session, kGenerations);
+
+    DeliveryLog log;
+    log.Source = &stream;
+    const DeliverT logged = log.GetCallback();
+    GenerationManager manager;
+    TEST_CHECK(manager.Initialize(settings,
+        [&](uint32_t generation, unsigned row, const uint8_t* data, int bytes) {
+            logged(generation - kShift, row, data, bytes);
+        }));
+
+    // Every generation is receiving at once: none may push another out
+    std::vector<Packet> recovery;
+    for (Packet packet : stream.Packets)
+    {
+        packet.Generation += kShift;
+        if (packet.Row == 0)
+            continue;
+        if (packet.Row >= (unsigned)settings.Session.K)
+            recovery.push_back(packet);
+        else
+            FeedPacket(manager, packet, 0);
+    }
+    TEST_CHECK(manager.GetReceivingCount() == (unsigned)kGenerations);
+    TEST_CHECK(manager.GetLostGenerations() == 0);
+
+    for (const Packet& packet : recovery)
+        FeedPacket(manager, packet, 0);
+    for (uint32_t gen = 0; gen < (uint32_t)kGenerations; ++gen)
+        TEST_CHECK(log.GetDelivered(gen) == settings.Session.K);
+    TEST_CHECK(manager.GetRecoveredGenerations() == (uint64_t)kGenerations);
+    TEST_CHECK(manager.GetLostGenerations() == 0);
+    TEST_CHECK(manager.GetPool().GetUsedCount() == 0);
+}
+
+/// Buffer limit: OnPacketCopy() fails once every buffer is held
+static void TestBufferLimit()
+{
+    siamese::PCGRandom prng;
+    prng.Seed(23);
+
+    GenerationManagerSettings settings;
+    settings.Session.K = 4, settings.Session.M = 2, settings.Session.BlockBytes = 64;
+    settings.MaxGenerations = 8;
+    settings.MaxBuffers = 3;
+    settings.ReserveBuffers = 2;
+
+    Stream stream;
+    stream.Initialize(prng, settings.Session, 4);
+    const unsigned rowsPerGeneration = settings.Session.K + settings.Session.M;
+
+    DeliveryLog log;
+    log.Source = &stream;
+    GenerationManager manager;
+    TEST_CHECK(manager.Initialize(settings, log.GetCallback()));
+    TEST_CHECK(manager.GetPool().GetCapacity() >= 2);
+
+    for (unsigned gen = 0; gen < 3; ++gen)
+    {
+        const Packet& packet = stream.Packets[gen * rowsPerGeneration];
+        TEST_CHECK(manager.OnPacketCopy(packet.Generation, packet.Row, packet.Data.data(), 0));
+    }
+    const Packet& packet = stream.Packets[3 * rowsPerGeneration];
+    TEST_CHECK(!manager.OnPacketCopy(packet.Generation, packet.Row, packet.Data.data(), 0));
+    TEST_CHECK(manager.AllocateBuffer() == nullptr);
+
+    // Expiring frees them up again
+    manager.Expire(100, 10);
+    TEST_CHECK(manager.GetPool().GetUsedCount() == 0);
+    TEST_CHECK(manager.OnPacketCopy(packet.Generation, packet.Row, packet.Data.data(), 100));
+    TEST_CHECK(manager.GetPool().GetCapacity() == 3);
+}
+
+
+//------------------------------------------------------------------------------
+// Entrypoint
+
+int main()
+{
+    if (cauchy_256_init())
+    {
+        printf("cauchy_256_init failed\n");
+        return 1;
+    }
+
+    TestBlockPool();
+    TestSettings();
+    TestSlotReuse();
+    TestPushedOut();
+    TestExpire();
+    TestGenerationWrap();
+    TestBufferLimit();
+
+    return test::Finish("longhair_generation_tests");
+}
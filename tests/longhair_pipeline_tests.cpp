@@ -0,0 +1,250 @@
+/** \file
+    \brief Longhair Tests: Stream Pipeline
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "TestTools.h"
+#include "../longhair_pipeline.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+using namespace longhair;
+
+
+//------------------------------------------------------------------------------
+// Tests
+
+/**
+    Stream `streamBytes` of random data through the pipeline and check
+    that the stripes reach the drain callback in order, with the short
+    last stripe zero-padded, and with recovery blocks that match the
+    serial cauchy_256_encode().
+*/
+static void TestStream(int k, int m, int blockBytes, size_t streamBytes,
+    unsigned depth, unsigned encoderThreads, uint64_t seed)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(seed);
+
+    std::vector<uint8_t> input(streamBytes);
+    test::FillRandom(prng, input.data(), input.size());
+
+    const size_t stripeBytes = (size_t)k * blockBytes;
+    const uint64_t expectedStripes = (streamBytes + stripeBytes - 1) / stripeBytes;
+
+    PipelineSettings settings;
+    settings.K = k, settings.M = m, settings.BlockBytes = blockBytes;
+    settings.Depth = depth;
+    settings.EncoderThreads = encoderThreads;
+
+    size_t offset = 0;
+    uint64_t drained = 0;
+    std::vector<uint8_t> padded(stripeBytes);
+    std::vector<const uint8_t*> dataPtrs(k);
+    std::vector<uint8_t> expected((size_t)m * blockBytes);
+
+    StreamPipeline pipeline;
+    TEST_CHECK(pipeline.Start(settings,
+        [&](uint8_t* data, unsigned maxBytes, unsigned& bytes) {
+            TEST_CHECK(maxBytes == stripeBytes);
+            bytes = (unsigned)std::min((size_t)maxBytes, streamBytes - offset);
+            memcpy(data, &input[offset], bytes);
+            // Leave garbage past the end: the pipeline zero-pads it
+            memset(data + bytes, 0xfe, maxBytes - bytes);
+            offset += bytes;
+            return true;
+        },
+        [&](const PipelineStripe& stripe) {
+            TEST_CHECK(stripe.Sequence == drained);
+            const size_t start = (size_t)stripe.Sequence * stripeBytes;
+            TEST_CHECK(start < streamBytes);
+            if (start >= streamBytes)
+                return false;
+
+            const size_t bytes = std::min(stripeBytes, streamBytes - start);
+            TEST_CHECK(stripe.Bytes == bytes);
+            if (stripe.Bytes != bytes)
+                return false;
+
+            memset(padded.data(), 0, stripeBytes);
+            memcpy(padded.data(), &input[start], bytes);
+            TEST_CHECK(0 == memcmp(stripe.Data, padded.data(), stripeBytes));
+
+            for (int ii = 0; ii < k; ++ii)
+                dataPtrs[ii] = &padded[(size_t)ii * blockBytes];
+            TEST_CHECK(0 == cauchy_256_encode(k, m, dataPtrs.data(), expected.data(), blockBytes));
+            TEST_CHECK(0 == memcmp(stripe.Recovery, expected.data(), expected.size()));
+
+            // Vary the drain time so encoders finish out of order
+            if ((drained % 3) == 0)
+                std::this_thread::yield();
+            ++drained;
+            return true;
+        }));
+    TEST_CHECK(pipeline.Wait());
+
+    TEST_CHECK(drained == expectedStripes);
+    TEST_CHECK(offset == streamBytes);
+
+    const PipelineStats stats = pipeline.GetStats();
+    TEST_CHECK(stats.Fill.Threads == 1);
+    TEST_CHECK(stats.Encode.Threads == encoderThreads);
+    TEST_CHECK(stats.Drain.Threads == 1);
+    TEST_CHECK(stats.Fill.Stripes == expectedStripes);
+    TEST_CHECK(stats.Encode.Stripes == expectedStripes);
+    TEST_CHECK(stats.Drain.Stripes == expectedStripes);
+    TEST_CHECK(stats.Fill.Bytes == streamBytes);
+    TEST_CHECK(stats.Encode.Bytes == streamBytes);
+    TEST_CHECK(stats.Drain.Bytes == streamBytes);
+}
+
+static void TestSettings()
+{
+    auto fill = [](uint8_t*, unsigned, unsigned& bytes) {
+        bytes = 0;
+        return true;
+    };
+    auto drain = [](const PipelineStripe&) {
+        return true;
+    };
+
+    PipelineSettings settings;
+    settings.K = 4, settings.M = 2, settings.BlockBytes = 64;
+
+    StreamPipeline pipeline;
+    TEST_CHECK(!pipeline.Start(settings, nullptr, drain));
+    TEST_CHECK(!pipeline.Start(settings, fill, nullptr));
+
+    PipelineSettings bad = settings;
+    bad.BlockBytes = 60;
+    TEST_CHECK(!pipeline.Start(bad, fill, drain));
+    bad = settings;
+    bad.K = 250, bad.M = 7;
+    TEST_CHECK(!pipeline.Start(bad, fill, drain));
+
+    // Empty stream: nothing is drained
+    TEST_CHECK(pipeline.Start(settings, fill, drain));
+    TEST_CHECK(pipeline.Wait());
+    TEST_CHECK(pipeline.GetStats().Drain.Stripes == 0);
+
+    // Depth is raised to 2, and it can be started again after Wait()
+    settings.Depth = 0;
+    TEST_CHECK(pipeline.Start(settings, fill, drain));
+    TEST_CHECK(pipeline.Wait());
+}
+
+/// A failing callback stops the pipeline and Wait() reports it
+static void TestFailure()
+{
+    PipelineSettings settings;
+    settings.K = 4, settings.M = 2, settings.BlockBytes = 64;
+    settings.Depth = 2;
+    settings.EncoderThreads = 2;
+
+    // Endless stream, drain fails on the third stripe
+    unsigned drained = 0;
+    StreamPipeline pipeline;
+    TEST_CHECK(pipeline.Start(settings,
+        [](uint8_t* data, unsigned maxBytes, unsigned& bytes) {
+            memset(data, 1, maxBytes);
+            bytes = maxBytes;
+            return true;
+        },
+        [&](const PipelineStripe&) {
+            return ++drained < 3;
+        }));
+    TEST_CHECK(!pipeline.Wait());
+    TEST_CHECK(drained == 3);
+
+    // Fill fails on the second stripe
+    unsigned filled = 0;
+    TEST_CHECK(pipeline.Start(settings,
+        [&](uint8_t*, unsigned maxBytes, unsigned& bytes) {
+            bytes = maxBytes;
+            return ++filled < 2;
+        },
+        [](const PipelineStripe&) {
+            return true;
+        }));
+    TEST_CHECK(!pipeline.Wait());
+    TEST_CHECK(pipeline.GetStats().Drain.Stripes <= 1);
+
+    // Stop() ends an endless stream
+    TEST_CHECK(pipeline.Start(settings,
+        [](uint8_t*, unsigned maxBytes, unsigned& bytes) {
+            bytes = maxBytes;
+            return true;
+        },
+        [](const PipelineStripe&) {
+            return true;
+        }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    pipeline.Stop();
+    const PipelineStats stats = pipeline.GetStats();
+    TEST_CHECK(stats.Drain.Stripes <= stats.Fill.Stripes);
+}
+
+
+//------------------------------------------------------------------------------
+// Entrypoint
+
+int main()
+{
+    if (cauchy_256_init())
+    {
+        printf("cauchy_256_init failed\n");
+        return 1;
+    }
+
+    TestSettings();
+
+    const unsigned threadCounts[] = { 1, 2, 4 };
+    const unsigned depths[] = { 2, 3, 8 };
+    uint64_t seed = 50;
+    for (unsigned threads : threadCounts)
+    {
+        for (unsigned depth : depths)
+        {
+            // Whole stripes, ending with an empty read
+            TestStream(8, 4, 256, 40 * 8 * 256, depth, threads, ++seed);
+            // Short last stripe, and one that is a single byte
+            TestStream(8, 4, 256, 40 * 8 * 256 + 1000, depth, threads, ++seed);
+            TestStream(8, 4, 256, 40 * 8 * 256 + 1, depth, threads, ++seed);
+            // Shorter than one stripe
+            TestStream(10, 3, 64, 100, depth, threads, ++seed);
+            // Other code sizes
+            TestStream(1, 1, 8, 333, depth, threads, ++seed);
+            TestStream(30, 20, 1296, 3 * 30 * 1296 - 7, depth, threads, ++seed);
+        }
+    }
+
+    TestFailure();
+
+    return test::Finish("longhair_pipeline_tests");
+}
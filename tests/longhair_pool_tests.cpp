@@ -0,0 +1,346 @@
+/** \file
+    \brief Longhair Tests: Worker Pool
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "TestTools.h"
+#include "../longhair_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+using namespace longhair;
+
+
+//------------------------------------------------------------------------------
+// Helpers
+
+/// A stripe with its own recovery buffer for the pool to fill
+struct EncodeCase
+{
+    test::Stripe Stripe;
+    std::vector<uint8_t> Recovery;
+    int Result = -1;
+
+    EncodeJob GetJob()
+    {
+        Recovery.assign((size_t)Stripe.M * Stripe.BlockBytes, 0);
+        EncodeJob job;
+        job.K = Stripe.K, job.M = Stripe.M, job.BlockBytes = Stripe.BlockBytes;
+        job.DataPtrs = Stripe.DataPtrs.data();
+        job.Recovery = Recovery.data();
+        return job;
+    }
+
+    bool Matches() const
+    {
+        return Result == 0 && Recovery == Stripe.Expected;
+    }
+};
+
+/// A stripe with the first erasures originals replaced by recovery blocks
+struct DecodeCase
+{
+    test::Stripe Stripe;
+    std::vector<uint8_t> Received;
+    std::vector<Block> Blocks;
+    int Result = -1;
+
+    DecodeJob GetJob(siamese::PCGRandom& prng)
+    {
+        const int k = Stripe.K, bytes = Stripe.BlockBytes;
+        const int maxErasures = k < Stripe.M ? k : Stripe.M;
+        const int erasures = 1 + (int)(prng.Next() % maxErasures);
+
+        Received.assign(Stripe.Data.begin(), Stripe.Data.end());
+        Blocks.resize(k);
+        for (int ii = 0; ii < k; ++ii)
+        {
+            Blocks[ii].data = &Received[(size_t)ii * bytes];
+            Blocks[ii].row = (unsigned char)ii;
+            if (ii < erasures)
+            {
+                memcpy(Blocks[ii].data, &Stripe.Expected[(size_t)ii * bytes], bytes);
+                Blocks[ii].row = (unsigned char)(k + ii);
+            }
+        }
+
+        DecodeJob job;
+        job.K = k, job.M = Stripe.M, job.BlockBytes = bytes;
+        job.Blocks = Blocks.data();
+        return job;
+    }
+
+    bool Matches() const
+    {
+        if (Result != 0)
+            return false;
+        for (const Block& block : Blocks)
+            if (0 != memcmp(block.data, Stripe.GetOriginal(block.row), Stripe.BlockBytes))
+                return false;
+        return true;
+    }
+};
+
+static void RandomStripe(siamese::PCGRandom& prng, test::Stripe& stripe)
+{
+    const int k = 1 + (int)(prng.Next() % 48);
+    const int m = 1 + (int)(prng.Next() % 16);
+    const int bytes = 8 * (1 + (int)(prng.Next() % 128));
+    stripe.Initialize(prng, k, m, bytes);
+}
+
+
+//------------------------------------------------------------------------------
+// Tests
+
+/// Pool results match the serial codec, through callbacks and futures
+static void TestMatchesSerial(unsigned threads)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(threads);
+
+    const int kCases = 60;
+    std::vector<EncodeCase> encodes(kCases);
+    std::vector<DecodeCase> decodes(kCases);
+    for (int ii = 0; ii < kCases; ++ii)
+    {
+        RandomStripe(prng, encodes[ii].Stripe);
+        RandomStripe(prng, decodes[ii].Stripe);
+    }
+
+    WorkerPool pool;
+    PoolSettings settings;
+    settings.ThreadCount = threads;
+    settings.QueueSlots = 4; // Small enough that the queues have to grow
+    TEST_CHECK(pool.Start(settings));
+    TEST_CHECK(pool.GetThreadCount() == threads);
+
+    std::vector<std::future<int>> encodeFutures, decodeFutures;
+    std::atomic<int> callbacks{ 0 };
+
+    for (int ii = 0; ii < kCases; ++ii)
+    {
+        EncodeCase& e = encodes[ii];
+        DecodeCase& d = decodes[ii];
+
+        // Alternate between completion callbacks and futures
+        if (ii % 2 == 0)
+        {
+            pool.Encode(e.GetJob(), [&e, &callbacks](int result) {
+                e.Result = result;
+                ++callbacks;
+            });
+            pool.Decode(d.GetJob(prng), [&d, &callbacks](int result) {
+                d.Result = result;
+                ++callbacks;
+            });
+        }
+        else
+        {
+            encodeFutures.push_back(pool.Encode(e.GetJob()));
+            decodeFutures.push_back(pool.Decode(d.GetJob(prng)));
+        }
+    }
+
+    for (int ii = 1, jj = 0; ii < kCases; ii += 2, ++jj)
+    {
+        encodes[ii].Result = encodeFutures[jj].get();
+        decodes[ii].Result = decodeFutures[jj].get();
+    }
+
+    pool.WaitIdle();
+    TEST_CHECK(callbacks.load() == kCases);
+
+    for (int ii = 0; ii < kCases; ++ii)
+    {
+        TEST_CHECK(encodes[ii].Matches());
+        TEST_CHECK(decodes[ii].Matches());
+    }
+
+    pool.Stop();
+    TEST_CHECK(pool.GetThreadCount() == 0);
+}
+
+/// A worker stuck in a completion leaves its queue to be stolen
+static void TestStealing()
+{
+    siamese::PCGRandom prng;
+    prng.Seed(100);
+
+    const int kCases = 16;
+    std::vector<EncodeCase> encodes(kCases);
+    for (EncodeCase& e : encodes)
+        e.Stripe.Initialize(prng, 8, 4, 256);
+
+    WorkerPool pool;
+    PoolSettings settings;
+    settings.ThreadCount = 2;
+    TEST_CHECK(pool.Start(settings));
+
+    // The first job blocks its worker until every other job is done.
+    // Half of the rest were queued behind it, so they only finish if the
+    // other worker steals them
+    std::atomic<int> finished{ 0 };
+    std::promise<void> othersDone;
+    std::shared_future<void> othersDoneFuture = othersDone.get_future().share();
+    std::atomic<bool> timedOut{ false };
+
+    pool.Encode(encodes[0].GetJob(), [&](int result) {
+        encodes[0].Result = result;
+        if (othersDoneFuture.wait_for(std::chrono::seconds(30)) != std::future_status::ready)
+            timedOut = true;
+    });
+    for (int ii = 1; ii < kCases; ++ii)
+    {
+        EncodeCase& e = encodes[ii];
+        pool.Encode(e.GetJob(), [&e, &finished, &othersDone](int result) {
+            e.Result = result;
+            if (++finished == kCases - 1)
+                othersDone.set_value();
+        });
+    }
+
+    pool.WaitIdle();
+    TEST_CHECK(!timedOut.load());
+    TEST_CHECK(finished.load() == kCases - 1);
+    for (const EncodeCase& e : encodes)
+        TEST_CHECK(e.Matches());
+}
+
+/// Stop() finishes every queued job before the workers exit
+static void TestStopDrains()
+{
+    siamese::PCGRandom prng;
+    prng.Seed(200);
+
+    const int kCases = 40;
+    std::vector<EncodeCase> encodes(kCases);
+    for (EncodeCase& e : encodes)
+        RandomStripe(prng, e.Stripe);
+
+    WorkerPool pool;
+    PoolSettings settings;
+    settings.ThreadCount = 2;
+    TEST_CHECK(pool.Start(settings));
+
+    std::atomic<int> completions{ 0 };
+    for (EncodeCase& e : encodes)
+    {
+        pool.Encode(e.GetJob(), [&e, &completions](int result) {
+            e.Result = result;
+            ++completions;
+        });
+    }
+    pool.Stop();
+
+    TEST_CHECK(completions.load() == kCases);
+    for (const EncodeCase& e : encodes)
+        TEST_CHECK(e.Matches());
+
+    // Restartable after Stop()
+    TEST_CHECK(pool.Start(settings));
+    TEST_CHECK(!pool.Start(settings));
+}
+
+/// Without Start() jobs run on the calling thread
+static void TestNotStarted()
+{
+    siamese::PCGRandom prng;
+    prng.Seed(300);
+
+    EncodeCase e;
+    e.Stripe.Initialize(prng, 10, 3, 128);
+
+    WorkerPool pool;
+    std::thread::id ranOn;
+    pool.Encode(e.GetJob(), [&](int result) {
+        e.Result = result;
+        ranOn = std::this_thread::get_id();
+    });
+    TEST_CHECK(ranOn == std::this_thread::get_id());
+    TEST_CHECK(e.Matches());
+
+    std::future<int> future = pool.Encode(e.GetJob());
+    TEST_CHECK(future.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    e.Result = future.get();
+    TEST_CHECK(e.Matches());
+}
+
+/// Start() fails if the workspaces cannot be reserved up front, since jobs
+/// would then allocate on the workers
+static void TestReserve()
+{
+    siamese::PCGRandom prng;
+    prng.Seed(400);
+
+    WorkerPool pool;
+    PoolSettings settings;
+    settings.ThreadCount = 2;
+
+    settings.MaxK = 200, settings.MaxM = 100, settings.MaxBlockBytes = 1024;
+    TEST_CHECK(!pool.Start(settings));
+    TEST_CHECK(pool.GetThreadCount() == 0);
+
+    settings.MaxK = 10, settings.MaxM = 4, settings.MaxBlockBytes = 1001;
+    TEST_CHECK(!pool.Start(settings));
+    TEST_CHECK(pool.GetThreadCount() == 0);
+
+    // Still usable after a failed start
+    settings.MaxK = 64, settings.MaxM = 16, settings.MaxBlockBytes = 4096;
+    TEST_CHECK(pool.Start(settings));
+    TEST_CHECK(pool.GetThreadCount() == 2);
+
+    EncodeCase e;
+    e.Stripe.Initialize(prng, 64, 16, 4096);
+    e.Result = pool.Encode(e.GetJob()).get();
+    TEST_CHECK(e.Matches());
+}
+
+
+
+//------------------------------------------------------------------------------
+// Entrypoint
+
+int main()
+{
+    if (cauchy_256_init())
+    {
+        printf("cauchy_256_init failed\n");
+        return 1;
+    }
+
+    for (unsigned threads = 1; threads <= 4; ++threads)
+        TestMatchesSerial(threads);
+    TestStealing();
+    TestStopDrains();
+    TestNotStarted();
+    TestReserve();
+
+    return test::Finish("longhair_pool_tests");
+}
@@ -0,0 +1,248 @@
+/** \file
+    \brief Longhair Tests: Adaptive Redundancy
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "TestTools.h"
+#include "../longhair_redundancy.h"
+
+#include <cmath>
+
+using namespace longhair;
+
+
+//------------------------------------------------------------------------------
+// Helpers
+
+/// Relative tolerance for results computed in floating point
+static bool IsClose(double actual, double expected)
+{
+    return std::fabs(actual - expected) <= 1e-12 + 1e-6 * std::fabs(expected);
+}
+
+static RedundancySettings MakeSettings(int k)
+{
+    RedundancySettings settings;
+    settings.K = k;
+    settings.BlockBytes = 1024;
+    return settings;
+}
+
+
+//------------------------------------------------------------------------------
+// Tests
+
+/// Exact values worked out with rational arithmetic
+static void TestBinomialTail()
+{
+    TEST_CHECK(BinomialTail(10, 10, 0.5) == 0.);
+    TEST_CHECK(BinomialTail(10, 12, 0.5) == 0.);
+    TEST_CHECK(BinomialTail(10, 2, 0.) == 0.);
+    TEST_CHECK(BinomialTail(10, 2, 1.) == 1.);
+
+    TEST_CHECK(IsClose(BinomialTail(1, 0, 0.3), 0.3));
+    TEST_CHECK(IsClose(BinomialTail(2, 0, 0.5), 0.75));
+    TEST_CHECK(IsClose(BinomialTail(10, 2, 0.1), 0.0701908264));
+    TEST_CHECK(IsClose(BinomialTail(20, 5, 0.5), 1. - 21700. / 1048576.));
+    TEST_CHECK(IsClose(BinomialTail(30, 4, 0.05), 0.015635510128533096));
+
+    // Small tail of a large generation, where the terms would underflow
+    // outside the log domain
+    TEST_CHECK(IsClose(BinomialTail(1000, 10, 0.001), 9.599955185228217e-09));
+
+    // More recovery never hurts
+    for (int m = 0; m < 20; ++m)
+        TEST_CHECK(BinomialTail(40 + m + 1, m + 1, 0.1) <= BinomialTail(40 + m, m, 0.1));
+}
+
+static void TestSettings()
+{
+    RedundancyController controller;
+    RedundancySettings settings = MakeSettings(20);
+    TEST_CHECK(controller.Initialize(settings));
+
+    RedundancySettings bad = settings;
+    bad.K = 0;
+    TEST_CHECK(!controller.Initialize(bad));
+    bad = settings;
+    bad.BlockBytes = 1020;
+    TEST_CHECK(!controller.Initialize(bad));
+    bad = settings;
+    bad.MinM = 8, bad.MaxM = 4;
+    TEST_CHECK(!controller.Initialize(bad));
+    bad = settings;
+    bad.TargetFailureRate = 1.;
+    TEST_CHECK(!controller.Initialize(bad));
+    bad = settings;
+    bad.Interleave = 0;
+    TEST_CHECK(!controller.Initialize(bad));
+}
+
+/// Smallest m with BinomialTail(K + m, m, p) <= 1e-4, worked out exactly
+static void TestLossRate()
+{
+    struct Case
+    {
+        int K;
+        unsigned Count, Lost;
+        int ExpectedM;
+    };
+    const Case cases[] = {
+        { 20, 100, 10, 10 },
+        { 20, 100, 5, 7 },
+        { 100, 100, 2, 9 },
+        { 10, 100, 25, 15 },
+        { 200, 100, 30, 32 }, // MaxM
+    };
+
+    for (const Case& test : cases)
+    {
+        RedundancyController controller;
+        RedundancySettings settings = MakeSettings(test.K);
+        settings.MinM = 2;
+        TEST_CHECK(controller.Initialize(settings));
+
+        // Nothing measured yet
+        TEST_CHECK(controller.RecommendM() == 2);
+
+        controller.OnReport(0, test.Count, test.Lost, 1);
+        TEST_CHECK(IsClose(controller.GetLossRate(), test.Lost / (double)test.Count));
+        TEST_CHECK(controller.RecommendM() == test.ExpectedM);
+        TEST_CHECK(!controller.IsCpuLimited());
+    }
+
+    // No loss stays at MinM
+    RedundancyController controller;
+    RedundancySettings settings = MakeSettings(20);
+    settings.MinM = 3;
+    TEST_CHECK(controller.Initialize(settings));
+    controller.OnReport(0, 100, 0, 0);
+    TEST_CHECK(controller.RecommendM() == 3);
+
+    // MaxM is clamped to 256 - K
+    settings = MakeSettings(250);
+    TEST_CHECK(controller.Initialize(settings));
+    controller.OnReport(0, 100, 30, 1);
+    TEST_CHECK(controller.RecommendM() == 6);
+}
+
+static void TestBurst()
+{
+    RedundancyController controller;
+    RedundancySettings settings = MakeSettings(20);
+    TEST_CHECK(controller.Initialize(settings));
+
+    // 5% loss needs 7, a burst of 12 needs 12
+    controller.OnReport(0, 100, 5, 12);
+    TEST_CHECK(controller.GetBurstLength() == 12);
+    TEST_CHECK(controller.RecommendM() == 12);
+
+    // Interleaving 4 deep spreads it to 3 per generation
+    settings.Interleave = 4;
+    TEST_CHECK(controller.Initialize(settings));
+    controller.OnReport(0, 100, 5, 12);
+    TEST_CHECK(controller.RecommendM() == 7);
+
+    // Once the window has passed without a burst it no longer counts
+    settings.Interleave = 1;
+    TEST_CHECK(controller.Initialize(settings));
+    controller.OnReport(0, 100, 5, 12);
+    for (uint64_t now = 1000; now <= 3 * settings.WindowMsec; now += 1000)
+        controller.OnReport(now, 100, 0, 0);
+    TEST_CHECK(controller.GetBurstLength() == 0);
+    TEST_CHECK(controller.GetLossRate() < 0.05);
+    TEST_CHECK(controller.RecommendM() < 7);
+}
+
+/// OnPacket() measures one generation of K + m packets at a time
+static void TestOnPacket()
+{
+    RedundancyController controller;
+    RedundancySettings settings = MakeSettings(10);
+    settings.MinM = 2;
+    TEST_CHECK(controller.Initialize(settings));
+    TEST_CHECK(controller.RecommendM() == 2);
+
+    // 12 packets with a run of 3 lost
+    for (int ii = 0; ii < 12; ++ii)
+        controller.OnPacket(0, ii >= 3 && ii < 6);
+    TEST_CHECK(IsClose(controller.GetLossRate(), 0.25));
+    TEST_CHECK(controller.GetBurstLength() == 3);
+    TEST_CHECK(controller.RecommendM() == 15);
+
+    // A burst still in progress counts before its interval ends
+    for (int ii = 0; ii < 20; ++ii)
+        controller.OnPacket(1, true);
+    TEST_CHECK(controller.RecommendM() == 20);
+}
+
+/// The CPU budget lowers m to the largest that fits, but not below MinM
+static void TestCpuBudget()
+{
+    RedundancyController controller;
+    RedundancySettings settings = MakeSettings(20);
+
+    CauchyCost budget = {};
+    TEST_CHECK(0 == cauchy_256_encode_cost(settings.K, 5, settings.BlockBytes, &budget));
+    settings.MaxEncodeCycles = budget.cycles;
+    TEST_CHECK(controller.Initialize(settings));
+
+    // 10% loss wants 10
+    controller.OnReport(0, 100, 10, 1);
+    CauchyCost cost = {};
+    TEST_CHECK(controller.RecommendM(&cost) == 5);
+    TEST_CHECK(controller.IsCpuLimited());
+    TEST_CHECK(cost.cycles == budget.cycles);
+
+    settings.MinM = 8;
+    TEST_CHECK(controller.Initialize(settings));
+    controller.OnReport(0, 100, 10, 1);
+    TEST_CHECK(controller.RecommendM() == 8);
+    TEST_CHECK(controller.IsCpuLimited());
+}
+
+
+//------------------------------------------------------------------------------
+// Entrypoint
+
+int main()
+{
+    if (cauchy_256_init())
+    {
+        printf("cauchy_256_init failed\n");
+        return 1;
+    }
+
+    TestBinomialTail();
+    TestSettings();
+    TestLossRate();
+    TestBurst();
+    TestOnPacket();
+    TestCpuBudget();
+
+    return test::Finish("longhair_redundancy_tests");
+}
@@ -0,0 +1,393 @@
+/** \file
+    \brief Longhair Tests: Session Sender and Receiver
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "TestTools.h"
+#include "../longhair_session.h"
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <set>
+#include <utility>
+
+using namespace longhair;
+
+
+//------------------------------------------------------------------------------
+// Helpers
+
+/// Receive buffers handed out to the Receiver and returned by its release
+/// callback.  Flags buffers released twice or never returned
+class BufferPool
+{
+public:
+    explicit BufferPool(int blockBytes)
+        : BlockBytes(blockBytes)
+    {
+    }
+
+    uint8_t* Allocate()
+    {
+        uint8_t* buffer;
+        if (Free.empty())
+        {
+            Storage.emplace_back(new uint8_t[BlockBytes]);
+            buffer = Storage.back().get();
+        }
+        else
+        {
+            buffer = Free.back();
+            Free.pop_back();
+            ++Reused;
+        }
+        Held.insert(buffer);
+        return buffer;
+    }
+
+    void Release(uint8_t* buffer)
+    {
+        TEST_CHECK(Held.erase(buffer) == 1);
+        Free.push_back(buffer);
+    }
+
+    int BlockBytes;
+    std::vector<std::unique_ptr<uint8_t[]>> Storage;
+    std::vector<uint8_t*> Free;
+    std::set<uint8_t*> Held;
+    unsigned Reused = 0;
+};
+
+struct Packet
+{
+    uint32_t Generation;
+    unsigned Row;
+    std::vector<uint8_t> Data;
+};
+
+
+//------------------------------------------------------------------------------
+// Tests
+
+/// Send generations through a lossy channel and check every delivered
+/// original against the input
+static void TestRoundTrip(int k, int m, int blockBytes, unsigned seed)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(seed);
+
+    SessionSettings settings;
+    settings.K = k, settings.M = m, settings.BlockBytes = blockBytes;
+
+    std::vector<Packet> packets;
+    Sender sender;
+    TEST_CHECK(sender.Initialize(settings, [&](uint32_t generation, unsigned row, const uint8_t* data, int bytes) {
+        TEST_CHECK(bytes == blockBytes);
+        packets.push_back({ generation, row, std::vector<uint8_t>(data, data + bytes) });
+    }));
+
+    const int kGenerations = 40;
+    std::vector<uint8_t> input((size_t)kGenerations * k * blockBytes);
+    test::FillRandom(prng, input.data(), input.size());
+    for (int ii = 0; ii < kGenerations * k; ++ii)
+    {
+        TEST_CHECK(sender.GetGeneration() == (uint32_t)(ii / k));
+        TEST_CHECK(sender.Send(&input[(size_t)ii * blockBytes]));
+    }
+    TEST_CHECK(packets.size() == (size_t)kGenerations * (k + m));
+
+    BufferPool pool(blockBytes);
+    std::map<std::pair<uint32_t, unsigned>, int> delivered;
+
+    Receiver receiver;
+    TEST_CHECK(receiver.Initialize(settings,
+        [&](uint32_t generation, unsigned row, const uint8_t* data, int bytes) {
+            TEST_CHECK(bytes == blockBytes);
+            TEST_CHECK(row < (unsigned)k);
+            TEST_CHECK(generation < (uint32_t)kGenerations);
+            if (row < (unsigned)k && generation < (uint32_t)kGenerations)
+            {
+                const size_t index = (size_t)generation * k + row;
+                TEST_CHECK(0 == memcmp(data, &input[index * blockBytes], blockBytes));
+            }
+            ++delivered[std::make_pair(generation, row)];
+        },
+        [&](uint8_t* buffer) {
+            pool.Release(buffer);
+        }));
+
+    // Lose up to M packets per generation, and more than M for a few
+    std::vector<int> lossCount(kGenerations, 0);
+    std::vector<bool> overloaded(kGenerations, false);
+    // Not the last one: Reset() abandons it without counting it lost
+    for (int gen = 0; gen < kGenerations - 1; ++gen)
+        overloaded[gen] = (prng.Next() % 8) == 0;
+
+    for (size_t ii = 0; ii < packets.size(); ++ii)
+    {
+        const Packet& packet = packets[ii];
+        const int gen = (int)packet.Generation;
+        const int limit = overloaded[gen] ? m + 1 : m;
+        if (lossCount[gen] < limit && (prng.Next() % 3) == 0)
+        {
+            ++lossCount[gen];
+            continue;
+        }
+
+        uint8_t* buffer = pool.Allocate();
+        memcpy(buffer, packet.Data.data(), blockBytes);
+        TEST_CHECK(receiver.OnPacket(packet.Generation, packet.Row, buffer));
+
+        // Duplicate of the same packet is released right away or held once
+        if ((prng.Next() % 16) == 0)
+        {
+            uint8_t* dup = pool.Allocate();
+            memcpy(dup, packet.Data.data(), blockBytes);
+            TEST_CHECK(receiver.OnPacket(packet.Generation, packet.Row, dup));
+        }
+    }
+    receiver.Reset();
+
+    // Every buffer came back exactly once, and they were recycled
+    TEST_CHECK(pool.Held.empty());
+    TEST_CHECK(pool.Reused > 0);
+
+    // Each original of a recoverable generation was delivered exactly once
+    uint64_t lost = 0;
+    for (int gen = 0; gen < kGenerations; ++gen)
+    {
+        int count = 0;
+        for (int row = 0; row < k; ++row)
+        {
+            auto it = delivered.find(std::make_pair((uint32_t)gen, (unsigned)row));
+            if (it != delivered.end())
+            {
+                TEST_CHECK(it->second == 1);
+                ++count;
+            }
+        }
+        if (lossCount[gen] <= m)
+            TEST_CHECK(count == k);
+        else
+            ++lost;
+    }
+    TEST_CHECK(receiver.GetLostGenerations() == lost);
+}
+
+static void TestSettings()
+{
+    auto send = [](uint32_t, unsigned, const uint8_t*, int) {};
+    auto deliver = [](uint32_t, unsigned, const uint8_t*, int) {};
+    auto release = [](uint8_t*) {};
+
+    SessionSettings settings;
+    settings.K = 10, settings.M = 4, settings.BlockBytes = 64;
+
+    Sender sender;
+    Receiver receiver;
+    TEST_CHECK(sender.Initialize(settings, send));
+    TEST_CHECK(receiver.Initialize(settings, deliver, release));
+
+    // Interleaved streams are for GenerationManager, not Receiver
+    settings.Interleave = 4;
+    TEST_CHECK(sender.Initialize(settings, send));
+    TEST_CHECK(!receiver.Initialize(settings, deliver, release));
+    settings.Interleave = 1;
+
+    SessionSettings bad = settings;
+    bad.BlockBytes = 60;
+    TEST_CHECK(!sender.Initialize(bad, send));
+    TEST_CHECK(!receiver.Initialize(bad, deliver, release));
+    bad = settings;
+    bad.K = 250, bad.M = 7;
+    TEST_CHECK(!sender.Initialize(bad, send));
+    TEST_CHECK(!receiver.Initialize(bad, deliver, release));
+    TEST_CHECK(!sender.Initialize(settings, nullptr));
+    TEST_CHECK(!receiver.Initialize(settings, deliver, nullptr));
+
+    // Out of range rows are rejected and the caller keeps the buffer
+    TEST_CHECK(receiver.Initialize(settings, deliver, release));
+    uint8_t buffer[64] = {};
+    TEST_CHECK(!receiver.OnPacket(0, 14, buffer));
+    TEST_CHECK(!receiver.OnPacket(0, 0, nullptr));
+}
+
+/// Stream index <-> (generation, row) for the Sender's interleaved order,
+/// including where the 32-bit generation counter wraps
+static void TestStreamIndex()
+{
+    const int ks[] = { 1, 3, 10, 255 };
+    const unsigned depths[] = { 1, 2, 4, 8, 256 };
+    for (int k : ks)
+    {
+        for (unsigned depth : depths)
+        {
+            SessionSettings settings;
+            settings.K = k, settings.M = 1, settings.BlockBytes = 8;
+            settings.Interleave = depth;
+
+            // What the Sender sends: originals tagged with their stream index
+            if ((uint64_t)k * depth <= 1024)
+            {
+                const int count = 3 * k * (int)depth;
+                std::vector<uint64_t> input(count);
+                for (int ii = 0; ii < count; ++ii)
+                    input[ii] = (uint64_t)ii;
+
+                Sender sender;
+                int originals = 0;
+                TEST_CHECK(sender.Initialize(settings, [&](uint32_t generation, unsigned row, const uint8_t* data, int) {
+                    if (row >= (unsigned)k)
+                        return;
+                    uint64_t index;
+                    memcpy(&index, data, sizeof(index));
+                    TEST_CHECK(OriginalStreamIndex(settings, generation, row) == index);
+                    ++originals;
+                }));
+                for (int ii = 0; ii < count; ++ii)
+                {
+                    uint32_t generation;
+                    unsigned row;
+                    OriginalFromStreamIndex(settings, (uint64_t)ii, generation, row);
+                    TEST_CHECK(sender.GetGeneration() == generation);
+                    TEST_CHECK(sender.Send(reinterpret_cast<const uint8_t*>(&input[ii])));
+                }
+                TEST_CHECK(originals == count);
+            }
+
+            // Walk the Sender's counters through the wrap: groups keep
+            // starting on a multiple of depth, and stream positions count
+            // modulo 2^32 * K
+            const uint64_t period = ((uint64_t)1 << 32) * (uint64_t)k;
+            const uint64_t groupSize = (uint64_t)k * depth;
+            uint32_t groupStart = (uint32_t)0 - 2 * depth;
+            uint64_t index = period - 2 * groupSize;
+            for (int group = 0; group < 4; ++group, groupStart += depth)
+            {
+                TEST_CHECK(groupStart % depth == 0);
+                for (uint64_t ii = 0; ii < groupSize; ++ii, ++index)
+                {
+                    const uint32_t expectedGeneration = groupStart + (uint32_t)(ii % depth);
+                    const unsigned expectedRow = (unsigned)(ii / depth);
+
+                    uint32_t generation;
+                    unsigned row;
+                    OriginalFromStreamIndex(settings, index, generation, row);
+                    TEST_CHECK(generation == expectedGeneration);
+                    TEST_CHECK(row == expectedRow);
+                    TEST_CHECK(OriginalStreamIndex(settings, generation, row) == index % period);
+                }
+            }
+        }
+    }
+
+    // The last original before the wrap and the first after it
+    SessionSettings settings;
+    settings.K = 10, settings.M = 1, settings.BlockBytes = 8, settings.Interleave = 4;
+    TEST_CHECK(OriginalStreamIndex(settings, 0xffffffff, 9) == ((uint64_t)10 << 32) - 1);
+    TEST_CHECK(OriginalStreamIndex(settings, 0, 0) == 0);
+
+    // Interleave must divide 2^32
+    settings.Interleave = 3;
+    TEST_CHECK(!settings.IsValid());
+    settings.Interleave = 512;
+    TEST_CHECK(!settings.IsValid());
+}
+
+/// Sender and Receiver keep their workspace across Initialize() calls with
+/// different parameters
+static void TestReinitialize()
+{
+    siamese::PCGRandom prng;
+    prng.Seed(7);
+
+    const int sizes[][3] = { { 4, 2, 64 }, { 60, 20, 512 }, { 8, 3, 1024 } };
+    Sender sender;
+    Receiver receiver;
+    for (const auto& size : sizes)
+    {
+        SessionSettings settings;
+        settings.K = size[0], settings.M = size[1], settings.BlockBytes = size[2];
+
+        std::vector<Packet> packets;
+        TEST_CHECK(sender.Initialize(settings, [&](uint32_t generation, unsigned row, const uint8_t* data, int bytes) {
+            packets.push_back({ generation, row, std::vector<uint8_t>(data, data + bytes) });
+        }));
+        std::vector<uint8_t> input((size_t)settings.K * settings.BlockBytes);
+        test::FillRandom(prng, input.data(), input.size());
+        for (int ii = 0; ii < settings.K; ++ii)
+            TEST_CHECK(sender.Send(&input[(size_t)ii * settings.BlockBytes]));
+
+        BufferPool pool(settings.BlockBytes);
+        int recovered = 0;
+        TEST_CHECK(receiver.Initialize(settings,
+            [&](uint32_t, unsigned row, const uint8_t* data, int bytes) {
+                TEST_CHECK(0 == memcmp(data, &input[(size_t)row * bytes], bytes));
+                ++recovered;
+            },
+            [&](uint8_t* buffer) {
+                pool.Release(buffer);
+            }));
+
+        // Drop the first M originals so all of the recovery rows are needed
+        for (const Packet& packet : packets)
+        {
+            if (packet.Row < (unsigned)settings.M)
+                continue;
+            uint8_t* buffer = pool.Allocate();
+            memcpy(buffer, packet.Data.data(), settings.BlockBytes);
+            TEST_CHECK(receiver.OnPacket(packet.Generation, packet.Row, buffer));
+        }
+        TEST_CHECK(recovered == settings.K);
+        receiver.Reset();
+        TEST_CHECK(pool.Held.empty());
+    }
+}
+
+
+//------------------------------------------------------------------------------
+// Entrypoint
+
+int main()
+{
+    if (cauchy_256_init())
+    {
+        printf("cauchy_256_init failed\n");
+        return 1;
+    }
+
+    TestSettings();
+    TestStreamIndex();
+    TestRoundTrip(1, 1, 8, 10);
+    TestRoundTrip(10, 4, 64, 11);
+    TestRoundTrip(32, 8, 1296, 12);
+    TestRoundTrip(200, 56, 128, 13);
+    TestReinitialize();
+
+    return test::Finish("longhair_session_tests");
+}
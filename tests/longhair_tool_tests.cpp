@@ -0,0 +1,407 @@
+/** \file
+    \brief Longhair Tests: File Striping Tool
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+    Runs the longhair tool (path given on the command line) on files in a
+    temporary directory, and checks the shard format, the checksums and
+    every command against the input and the shards first written.
+*/
+
+#include "TestTools.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+using namespace std;
+
+
+//------------------------------------------------------------------------------
+// Format
+
+static const uint64_t kPageBytes = 4096;
+
+static uint64_t LoadLE(const vector<uint8_t>& data, size_t offset, int bytes)
+{
+    uint64_t value = 0;
+    for (int ii = bytes - 1; ii >= 0; --ii)
+        value = (value << 8) | data[offset + ii];
+    return value;
+}
+
+/// Fields of a shard header, read straight from the bytes
+struct ShardFields
+{
+    uint64_t FileBytes = 0;
+    unsigned K = 0, M = 0, Index = 0, BlockBytes = 0;
+    uint64_t StripeCount = 0, DataOffset = 0;
+
+    /// Returns false if the magic does not match
+    bool Read(const vector<uint8_t>& data, size_t offset = 0)
+    {
+        if (data.size() < offset + kPageBytes || 0 != memcmp(&data[offset], "LHSHARD1", 8))
+            return false;
+        FileBytes = LoadLE(data, offset + 24, 8);
+        K = (unsigned)LoadLE(data, offset + 32, 4);
+        M = (unsigned)LoadLE(data, offset + 36, 4);
+        Index = (unsigned)LoadLE(data, offset + 40, 4);
+        BlockBytes = (unsigned)LoadLE(data, offset + 44, 4);
+        StripeCount = LoadLE(data, offset + 48, 8);
+        DataOffset = LoadLE(data, offset + 56, 8);
+        return true;
+    }
+
+    uint64_t ImageBytes() const
+    {
+        return DataOffset + StripeCount * BlockBytes;
+    }
+};
+
+
+//------------------------------------------------------------------------------
+// Helpers
+
+static string ToolPath;
+static string TempDir;
+
+static string TempPath(const string& name)
+{
+    return TempDir + "/" + name;
+}
+
+static string ShardPath(const string& prefix, unsigned index)
+{
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), ".%03u", index);
+    return prefix + suffix;
+}
+
+/// Run the tool and return its exit code, or -1 if it did not exit
+static int RunTool(const vector<string>& args)
+{
+    printf("+ longhair");
+    for (const string& arg : args)
+        printf(" %s", arg.c_str());
+    printf("\n");
+    fflush(stdout);
+
+    const pid_t pid = fork();
+    if (pid < 0)
+        return -1;
+    if (pid == 0)
+    {
+        vector<char*> argv;
+        argv.push_back(const_cast<char*>(ToolPath.c_str()));
+        for (const string& arg : args)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        argv.push_back(nullptr);
+        execv(ToolPath.c_str(), argv.data());
+        _exit(127);
+    }
+
+    int status = 0;
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status))
+        return -1;
+    return WEXITSTATUS(status);
+}
+
+static bool Exists(const string& path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+static vector<uint8_t> ReadFile(const string& path)
+{
+    vector<uint8_t> data;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return data;
+    uint8_t buffer[65536];
+    size_t bytes;
+    while ((bytes = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.insert(data.end(), buffer, buffer + bytes);
+    fclose(file);
+    return data;
+}
+
+static bool WriteFile(const string& path, const vector<uint8_t>& data)
+{
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    const bool ok = data.empty() || fwrite(data.data(), data.size(), 1, file) == 1;
+    return 0 == fclose(file) && ok;
+}
+
+/// Flip a byte in block `stripe` of the shard image at `imageOffset`
+static void CorruptBlock(const string& path, size_t imageOffset, uint64_t stripe, unsigned at)
+{
+    vector<uint8_t> data = ReadFile(path);
+    ShardFields fields;
+    TEST_CHECK(fields.Read(data, imageOffset));
+    TEST_CHECK(stripe < fields.StripeCount && at < fields.BlockBytes);
+    data[imageOffset + fields.DataOffset + stripe * fields.BlockBytes + at] ^= 0x5a;
+    TEST_CHECK(WriteFile(path, data));
+}
+
+static vector<uint8_t> RandomFile(siamese::PCGRandom& prng, const string& path, size_t bytes)
+{
+    vector<uint8_t> data(bytes);
+    test::FillRandom(prng, data.data(), bytes);
+    TEST_CHECK(WriteFile(path, data));
+    return data;
+}
+
+
+//------------------------------------------------------------------------------
+// Tests
+
+static const unsigned kK = 5, kM = 3, kBlockBytes = 4096;
+
+/// Shards as written by encode, with the header fields checked
+static vector<vector<uint8_t>> EncodeShards(const string& input, const string& prefix, uint64_t fileBytes)
+{
+    TEST_CHECK(0 == RunTool({ "encode", "-k", to_string(kK), "-m", to_string(kM),
+        "-b", to_string(kBlockBytes), "-j", "2", "-o", prefix, input }));
+
+    const uint64_t stripeBytes = (uint64_t)kK * kBlockBytes;
+    const uint64_t stripeCount = (fileBytes + stripeBytes - 1) / stripeBytes;
+
+    vector<vector<uint8_t>> shards(kK + kM);
+    for (unsigned ii = 0; ii < kK + kM; ++ii)
+    {
+        shards[ii] = ReadFile(ShardPath(prefix, ii));
+
+        ShardFields fields;
+        TEST_CHECK(fields.Read(shards[ii]));
+        TEST_CHECK(fields.FileBytes == fileBytes);
+        TEST_CHECK(fields.K == kK && fields.M == kM && fields.Index == ii);
+        TEST_CHECK(fields.BlockBytes == kBlockBytes);
+        TEST_CHECK(fields.StripeCount == stripeCount);
+        TEST_CHECK(fields.DataOffset % kPageBytes == 0 && fields.DataOffset >= 128 + 8 * stripeCount);
+        TEST_CHECK(shards[ii].size() == fields.ImageBytes());
+    }
+    return shards;
+}
+
+/// Shard i holds block i of each stripe
+static void CheckSystematic(const vector<vector<uint8_t>>& shards, const vector<uint8_t>& input)
+{
+    ShardFields fields;
+    TEST_CHECK(fields.Read(shards[0]));
+    for (uint64_t offset = 0; offset < input.size(); offset += kBlockBytes)
+    {
+        const uint64_t block = offset / kBlockBytes;
+        const vector<uint8_t>& shard = shards[block % kK];
+        const size_t bytes = (size_t)min<uint64_t>(kBlockBytes, input.size() - offset);
+        TEST_CHECK(0 == memcmp(&shard[fields.DataOffset + block / kK * kBlockBytes], &input[offset], bytes));
+    }
+}
+
+static void TestShards(siamese::PCGRandom& prng)
+{
+    // A short last stripe, with its last block partly filled
+    const size_t fileBytes = (size_t)kK * kBlockBytes * 7 + kBlockBytes * 2 + 1234;
+    const string input = TempPath("input.bin");
+    const string prefix = TempPath("shard");
+    const vector<uint8_t> data = RandomFile(prng, input, fileBytes);
+
+    const vector<vector<uint8_t>> original = EncodeShards(input, prefix, fileBytes);
+    CheckSystematic(original, data);
+
+    // Lose an original and a recovery shard, and corrupt one block.  Stripe
+    // 3 is left with exactly k good blocks
+    remove(ShardPath(prefix, 1).c_str());
+    remove(ShardPath(prefix, 6).c_str());
+    CorruptBlock(ShardPath(prefix, 3), 0, 3, 100);
+
+    vector<string> present;
+    for (unsigned ii = 0; ii < kK + kM; ++ii)
+        if (ii != 1 && ii != 6)
+            present.push_back(ShardPath(prefix, ii));
+
+    vector<string> args = { "decode", "-j", "2", "-o", TempPath("decoded.bin") };
+    args.insert(args.end(), present.begin(), present.end());
+    TEST_CHECK(0 == RunTool(args));
+    TEST_CHECK(ReadFile(TempPath("decoded.bin")) == data);
+
+    // One more corrupt block in stripe 3 is too many
+    CorruptBlock(ShardPath(prefix, 7), 0, 3, 0);
+    args[4] = TempPath("failed.bin");
+    TEST_CHECK(0 != RunTool(args));
+    TEST_CHECK(WriteFile(ShardPath(prefix, 7), original[7]));
+
+    // Repair recreates the missing shards and fixes the block in place
+    args = { "repair", "-j", "2" };
+    args.insert(args.end(), present.begin(), present.end());
+    TEST_CHECK(0 == RunTool(args));
+    for (unsigned ii = 0; ii < kK + kM; ++ii)
+        TEST_CHECK(ReadFile(ShardPath(prefix, ii)) == original[ii]);
+
+    // Rebuild around a corrupt block, synchronously and with io_uring
+    for (int async = 0; async < 2; ++async)
+    {
+        remove(ShardPath(prefix, 0).c_str());
+        remove(ShardPath(prefix, 7).c_str());
+        CorruptBlock(ShardPath(prefix, 2), 0, 5, kBlockBytes - 1);
+
+        args = { "rebuild", "-q", "3" };
+        if (!async)
+            args.push_back("--sync");
+        for (unsigned ii = 1; ii < kK + kM - 1; ++ii)
+            args.push_back(ShardPath(prefix, ii));
+        TEST_CHECK(0 == RunTool(args));
+
+        TEST_CHECK(ReadFile(ShardPath(prefix, 0)) == original[0]);
+        TEST_CHECK(ReadFile(ShardPath(prefix, 7)) == original[7]);
+        TEST_CHECK(WriteFile(ShardPath(prefix, 2), original[2]));
+    }
+
+    // Nothing to rebuild
+    args = { "rebuild" };
+    for (unsigned ii = 0; ii < kK + kM; ++ii)
+        args.push_back(ShardPath(prefix, ii));
+    TEST_CHECK(0 == RunTool(args));
+
+    // A shard with a damaged header is skipped
+    vector<uint8_t> damaged = original[4];
+    damaged[32] ^= 1;
+    TEST_CHECK(WriteFile(ShardPath(prefix, 4), damaged));
+    remove(ShardPath(prefix, 5).c_str());
+    args = { "decode", "-o", TempPath("decoded2.bin") };
+    for (unsigned ii = 0; ii < kK + kM; ++ii)
+        if (ii != 5)
+            args.push_back(ShardPath(prefix, ii));
+    TEST_CHECK(0 == RunTool(args));
+    TEST_CHECK(ReadFile(TempPath("decoded2.bin")) == data);
+}
+
+static void TestEmpty(siamese::PCGRandom& prng)
+{
+    const string input = TempPath("empty.bin");
+    const string prefix = TempPath("empty");
+    RandomFile(prng, input, 0);
+
+    const vector<vector<uint8_t>> original = EncodeShards(input, prefix, 0);
+    for (const vector<uint8_t>& shard : original)
+        TEST_CHECK(shard.size() == kPageBytes);
+
+    remove(ShardPath(prefix, 2).c_str());
+    vector<string> args = { "decode", "-o", TempPath("empty.out") };
+    for (unsigned ii = 0; ii < kK + kM; ++ii)
+        if (ii != 2)
+            args.push_back(ShardPath(prefix, ii));
+    TEST_CHECK(0 == RunTool(args));
+    TEST_CHECK(Exists(TempPath("empty.out")));
+    TEST_CHECK(ReadFile(TempPath("empty.out")).empty());
+
+    args[0] = "repair";
+    args.erase(args.begin() + 1, args.begin() + 3);
+    TEST_CHECK(0 == RunTool(args));
+    TEST_CHECK(ReadFile(ShardPath(prefix, 2)) == original[2]);
+}
+
+static void TestContainer(siamese::PCGRandom& prng)
+{
+    const size_t fileBytes = (size_t)kK * kBlockBytes * 4 + 777;
+    const string input = TempPath("container.bin");
+    const string container = TempPath("container.lh");
+    const vector<uint8_t> data = RandomFile(prng, input, fileBytes);
+
+    TEST_CHECK(0 == RunTool({ "encode", "-k", to_string(kK), "-m", to_string(kM),
+        "-b", to_string(kBlockBytes), "--container", "-o", container, input }));
+    TEST_CHECK(!Exists(ShardPath(container, 0)));
+
+    const vector<uint8_t> original = ReadFile(container);
+    TEST_CHECK(original.size() >= kPageBytes && 0 == memcmp(original.data(), "LHCONTR1", 8));
+    TEST_CHECK(LoadLE(original, 12, 4) == kK + kM);
+    const uint64_t imageBytes = LoadLE(original, 16, 8);
+    TEST_CHECK(original.size() == kPageBytes + (kK + kM) * imageBytes);
+
+    for (unsigned ii = 0; ii < kK + kM; ++ii)
+    {
+        ShardFields fields;
+        TEST_CHECK(fields.Read(original, (size_t)(kPageBytes + ii * imageBytes)));
+        TEST_CHECK(fields.Index == ii && fields.FileBytes == fileBytes);
+        TEST_CHECK(fields.ImageBytes() == imageBytes);
+    }
+
+    // Corrupt m blocks of the same stripe, and one of another
+    CorruptBlock(container, (size_t)(kPageBytes + 0 * imageBytes), 2, 1);
+    CorruptBlock(container, (size_t)(kPageBytes + 3 * imageBytes), 2, 2);
+    CorruptBlock(container, (size_t)(kPageBytes + 5 * imageBytes), 2, 3);
+    CorruptBlock(container, (size_t)(kPageBytes + 4 * imageBytes), 4, 4);
+
+    TEST_CHECK(0 == RunTool({ "decode", "-o", TempPath("container.out"), container }));
+    TEST_CHECK(ReadFile(TempPath("container.out")) == data);
+
+    TEST_CHECK(0 == RunTool({ "repair", container }));
+    TEST_CHECK(ReadFile(container) == original);
+}
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <path to the longhair tool>\n", argv[0]);
+        return 1;
+    }
+    ToolPath = argv[1];
+
+    const char* tmp = getenv("TMPDIR");
+    string pattern = string(tmp && *tmp ? tmp : "/tmp") + "/longhair_tool_tests.XXXXXX";
+    if (!mkdtemp(&pattern[0]))
+    {
+        printf("Unable to create a temporary directory\n");
+        return 1;
+    }
+    TempDir = pattern;
+
+    siamese::PCGRandom prng;
+    prng.Seed(500);
+
+    TestShards(prng);
+    TestEmpty(prng);
+    TestContainer(prng);
+
+    const int result = test::Finish("longhair_tool_tests");
+
+    // Keep the files for a look if anything failed
+    if (result == 0)
+        TEST_CHECK(0 == system(("rm -rf '" + TempDir + "'").c_str()));
+    else
+        printf("Files left in %s\n", TempDir.c_str());
+    return result;
+}
@@ -0,0 +1,635 @@
+/** \file
+    \brief Longhair Benchmarks: Loopback UDP Pipeline
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+    End-to-end loopback UDP benchmark.
+
+    A sender thread cuts a synthetic stream into generations with
+    longhair::Sender and sends the packets to 127.0.0.1 in batches with
+    sendmmsg().  Loss is injected just before the socket.  A receiver thread
+    reads batches with recvmmsg() straight into GenerationManager buffers
+    (the longhair_wire.h header and the payload are scattered into separate
+    iovecs, so nothing is copied), decodes and checks every delivered
+    original.
+
+    Reports packets/sec, goodput and thread CPU time per GB of delivered
+    originals on each side, along with the share of that CPU time spent in
+    the codec.  The rest is mostly syscalls and the kernel UDP path, so the
+    codec overhead can be compared with the I/O cost of moving the data.
+    Codec time is measured with the cycle counter, so on a machine with
+    fewer than two cores it also counts time the thread was preempted.
+
+    Without --pace the sender runs flat out and can overrun the receive
+    socket buffer.  Those drops show up as socket loss on top of the
+    injected loss.
+
+    Example:
+        longhair_udp_bench -k 32 -m 8 -b 1280 --loss 0.02
+        longhair_udp_bench -k 64 -m 16 --ge 0.01,0.3 -D 4 --pace 200000
+*/
+
+#include "../longhair_generation.h"
+#include "../longhair_session.h"
+#include "../longhair_wire.h"
+#include "../SiameseTools.h"
+#include "BenchTools.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+
+//------------------------------------------------------------------------------
+// Settings
+
+struct UdpSettings
+{
+    int K = 32;
+    int M = 8;
+    int Bytes = 1280;
+    unsigned Interleave = 1;
+    int Generations = 20000;
+
+    /// Packets per sendmmsg()/recvmmsg() call
+    int Batch = 32;
+
+    /// Independent loss probability
+    double Loss = 0.;
+
+    /// Gilbert-Elliott parameters "p,r[,good_loss,bad_loss]"
+    const char* GilbertElliott = nullptr;
+
+    /// Sender rate limit in packets per second.  0 = unlimited
+    double Pace = 0.;
+
+    uint64_t Seed = 0;
+    bench::ReportFormat Format = bench::ReportFormat::Table;
+};
+
+static void Usage(const char* argv0)
+{
+    printf("Usage: %s [options]\n", argv0);
+    printf("  -k <count>     Original blocks per generation (default 32)\n");
+    printf("  -m <count>     Recovery blocks per generation (default 8)\n");
+    printf("  -b <bytes>     Bytes per block, a multiple of 8 (default 1280)\n");
+    printf("  -D <depth>     Generations interleaved, a power of two (default 1)\n");
+    printf("  -g <count>     Generations to send (default 20000)\n");
+    printf("  --batch <n>    Packets per sendmmsg/recvmmsg call (default 32)\n");
+    printf("  --loss <p>     Inject independent loss with probability p\n");
+    printf("  --ge <p,r[,good,bad]>  Inject Gilbert-Elliott bursty loss instead\n");
+    printf("  --pace <pps>   Limit the send rate in packets/second (default unlimited)\n");
+    printf("  -s <seed>      PRNG seed (default 0)\n");
+    printf("  --csv          Write CSV output\n");
+    printf("  --json         Write JSON output\n");
+}
+
+static bool ParseSettings(int argc, char** argv, UdpSettings& settings)
+{
+    for (int ii = 1; ii < argc; ++ii)
+    {
+        const char* arg = argv[ii];
+        const char* value = (ii + 1 < argc) ? argv[ii + 1] : nullptr;
+
+        if (!strcmp(arg, "--csv"))
+            settings.Format = bench::ReportFormat::CSV;
+        else if (!strcmp(arg, "--json"))
+            settings.Format = bench::ReportFormat::JSON;
+        else if (!strcmp(arg, "-k") && value)
+            settings.K = atoi(argv[++ii]);
+        else if (!strcmp(arg, "-m") && value)
+            settings.M = atoi(argv[++ii]);
+        else if (!strcmp(arg, "-b") && value)
+            settings.Bytes = atoi(argv[++ii]);
+        else if (!strcmp(arg, "-D") && value)
+            settings.Interleave = (unsigned)atoi(argv[++ii]);
+        else if (!strcmp(arg, "-g") && value)
+            settings.Generations = atoi(argv[++ii]);
+        else if (!strcmp(arg, "--batch") && value)
+            settings.Batch = atoi(argv[++ii]);
+        else if (!strcmp(arg, "--loss") && value)
+            settings.Loss = atof(argv[++ii]);
+        else if (!strcmp(arg, "--ge") && value)
+            settings.GilbertElliott = argv[++ii];
+        else if (!strcmp(arg, "--pace") && value)
+            settings.Pace = atof(argv[++ii]);
+        else if (!strcmp(arg, "-s") && value)
+            settings.Seed = strtoull(argv[++ii], nullptr, 10);
+        else
+            return false;
+    }
+
+    return settings.Bytes >= 8 && settings.Bytes <= 65000 &&
+        settings.Generations > 0 && settings.Batch > 0 && settings.Batch <= 1024 &&
+        settings.Loss >= 0. && settings.Loss < 1. && settings.Pace >= 0.;
+}
+
+
+//------------------------------------------------------------------------------
+// Tools
+
+/// Packets flagged kWireFlagEndOfStream sent after the data
+static const int kEndMarkers = 8;
+
+/// CPU time used by the calling thread in microseconds
+static uint64_t GetThreadCpuUsec()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/// Stamp the stream index at both ends of an original so the receiver can
+/// check it cheaply
+static void StampOriginal(uint8_t* block, int bytes, uint64_t index)
+{
+    memcpy(block, &index, 8);
+    memcpy(block + bytes - 8, &index, 8);
+}
+
+static bool CheckOriginal(const uint8_t* block, int bytes, uint64_t index)
+{
+    return !memcmp(block, &index, 8) && !memcmp(block + bytes - 8, &index, 8);
+}
+
+
+//------------------------------------------------------------------------------
+// Sender
+
+struct SendResult
+{
+    uint64_t Packets = 0;  ///< Handed to the socket
+    uint64_t Dropped = 0;  ///< Dropped by loss injection
+    uint64_t Calls = 0;    ///< sendmmsg() calls
+    uint64_t CpuUsec = 0;
+    uint64_t CodecCycles = 0;
+    bool Failed = false;
+};
+
+class BatchSender
+{
+public:
+    BatchSender(int fd, int batch)
+        : Fd(fd)
+        , Headers(batch * longhair::kWireHeaderBytes)
+        , Iovecs(batch * 2)
+        , Messages(batch)
+    {
+        for (int ii = 0; ii < batch; ++ii)
+        {
+            memset(&Messages[ii], 0, sizeof(mmsghdr));
+            Messages[ii].msg_hdr.msg_iov = &Iovecs[ii * 2];
+            Messages[ii].msg_hdr.msg_iovlen = 2;
+        }
+    }
+
+    /// Queue a packet.  The data must stay valid until Flush()
+    void Queue(const longhair::WireHeader& header, const uint8_t* data, int bytes)
+    {
+        const int ii = Count++;
+        uint8_t* headerBytes = &Headers[ii * longhair::kWireHeaderBytes];
+        longhair::WriteWireHeader(headerBytes, header);
+        Iovecs[ii * 2].iov_base = headerBytes;
+        Iovecs[ii * 2].iov_len = longhair::kWireHeaderBytes;
+        Iovecs[ii * 2 + 1].iov_base = const_cast<uint8_t*>(data);
+        Iovecs[ii * 2 + 1].iov_len = bytes;
+
+        if (Count >= (int)Messages.size())
+            Flush();
+    }
+
+    void Flush()
+    {
+        const uint64_t t0 = siamese::GetCycles();
+
+        int offset = 0;
+        while (offset < Count)
+        {
+            const int sent = sendmmsg(Fd, &Messages[offset], Count - offset, 0);
+            ++Result.Calls;
+            if (sent <= 0)
+            {
+                if (sent < 0 && errno == EINTR)
+                    continue;
+                Result.Failed = true;
+                break;
+            }
+            offset += sent;
+            Result.Packets += sent;
+        }
+        Count = 0;
+
+        FlushCycles += siamese::GetCycles() - t0;
+    }
+
+    SendResult Result;
+
+    /// Time spent in Flush(), to separate it from the codec
+    uint64_t FlushCycles = 0;
+
+protected:
+    int Fd;
+    int Count = 0;
+    vector<uint8_t> Headers;
+    vector<iovec> Iovecs;
+    vector<mmsghdr> Messages;
+};
+
+static void SendThread(const UdpSettings& settings, const longhair::SessionSettings& session,
+    int fd, bench::LossModel* loss, SendResult& result)
+{
+    const uint64_t cpuStart = GetThreadCpuUsec();
+
+    BatchSender batch(fd, settings.Batch);
+
+    longhair::WireHeader header;
+    header.K = (uint8_t)session.K;
+    header.M = (uint8_t)session.M;
+    header.OriginalBytes = (uint32_t)(session.K * session.BlockBytes);
+    header.BlockBytes = (uint16_t)session.BlockBytes;
+
+    longhair::Sender sender;
+    const bool initialized = sender.Initialize(session,
+        [&](uint32_t generation, unsigned row, const uint8_t* data, int bytes) {
+            if (loss && loss->NextLost())
+            {
+                ++batch.Result.Dropped;
+                return;
+            }
+            header.Generation = generation;
+            header.Row = (uint8_t)row;
+            batch.Queue(header, data, bytes);
+        });
+    if (!initialized)
+    {
+        result.Failed = true;
+        return;
+    }
+
+    // Originals must stay valid until their group's recovery rows are
+    // flushed, so keep two groups of them
+    const int groupSize = settings.K * (int)settings.Interleave;
+    vector<uint8_t> ring((size_t)groupSize * 2 * settings.Bytes);
+    siamese::PCGRandom prng;
+    prng.Seed(settings.Seed);
+    for (uint8_t& byte : ring)
+        byte = (uint8_t)prng.Next();
+
+    const uint64_t total = (uint64_t)settings.Generations * settings.K;
+    const uint64_t startUsec = siamese::GetTimeUsec();
+    uint64_t sendCycles = 0;
+
+    for (uint64_t index = 0; index < total; ++index)
+    {
+        uint8_t* block = &ring[(index % (groupSize * 2)) * settings.Bytes];
+        StampOriginal(block, settings.Bytes, index);
+
+        if (settings.Pace > 0.)
+        {
+            const uint64_t due = startUsec + (uint64_t)(index * (settings.K + settings.M) / (settings.K * settings.Pace) * 1000000.);
+            while (siamese::GetTimeUsec() < due)
+                std::this_thread::yield();
+        }
+
+        const uint64_t t0 = siamese::GetCycles();
+        if (!sender.Send(block))
+            result.Failed = true;
+        sendCycles += siamese::GetCycles() - t0;
+
+        // The recovery rows point into the sender's buffer, which is
+        // rewritten when the next group completes
+        if ((index + 1) % groupSize == 0)
+            batch.Flush();
+    }
+    batch.Flush();
+
+    // End markers.  Several in case some are dropped
+    header.Row = 0;
+    header.Flags = longhair::kWireFlagEndOfStream;
+    for (int ii = 0; ii < kEndMarkers; ++ii)
+        batch.Queue(header, ring.data(), settings.Bytes);
+    batch.Flush();
+
+    result.Packets = batch.Result.Packets;
+    result.Dropped = batch.Result.Dropped;
+    result.Calls = batch.Result.Calls;
+    result.Failed |= batch.Result.Failed;
+    // Flushes inside Send() are not codec time
+    result.CodecCycles = sendCycles > batch.FlushCycles ? sendCycles - batch.FlushCycles : 0;
+    result.CpuUsec = GetThreadCpuUsec() - cpuStart;
+}
+
+
+//------------------------------------------------------------------------------
+// Receiver
+
+struct ReceiveResult
+{
+    uint64_t Packets = 0;
+    uint64_t Calls = 0;
+    uint64_t Delivered = 0;
+    uint64_t Corrupted = 0;
+    uint64_t LostGenerations = 0;
+    uint64_t CpuUsec = 0;
+    uint64_t CodecCycles = 0;
+    uint64_t StartUsec = 0;
+    uint64_t EndUsec = 0;
+    bool Failed = false;
+};
+
+static void ReceiveThread(const UdpSettings& settings, const longhair::SessionSettings& session,
+    int fd, const atomic<bool>& senderDone, ReceiveResult& result)
+{
+    const uint64_t cpuStart = GetThreadCpuUsec();
+
+    longhair::GenerationManagerSettings managerSettings;
+    managerSettings.Session = session;
+    managerSettings.MaxGenerations = max(64u, 4 * session.Interleave);
+    managerSettings.ReserveBuffers = managerSettings.MaxGenerations * session.K;
+
+    longhair::GenerationManager manager;
+    const bool initialized = manager.Initialize(managerSettings,
+        [&](uint32_t generation, unsigned row, const uint8_t* data, int bytes) {
+            ++result.Delivered;
+            if (!CheckOriginal(data, bytes, longhair::OriginalStreamIndex(session, generation, row)))
+                ++result.Corrupted;
+        });
+    if (!initialized)
+    {
+        result.Failed = true;
+        return;
+    }
+
+    const int batch = settings.Batch;
+    vector<uint8_t> headers(batch * longhair::kWireHeaderBytes);
+    vector<uint8_t*> buffers(batch, nullptr);
+    vector<iovec> iovecs(batch * 2);
+    vector<mmsghdr> messages(batch);
+
+    bool ended = false;
+    while (!ended)
+    {
+        // Post a pooled buffer for the payload of every message
+        for (int ii = 0; ii < batch; ++ii)
+        {
+            if (!buffers[ii])
+                buffers[ii] = manager.AllocateBuffer();
+            if (!buffers[ii])
+            {
+                manager.Expire(siamese::GetTimeMsec(), 0);
+                buffers[ii] = manager.AllocateBuffer();
+            }
+            if (!buffers[ii])
+            {
+                result.Failed = true;
+                ended = true;
+                break;
+            }
+
+            iovecs[ii * 2].iov_base = &headers[ii * longhair::kWireHeaderBytes];
+            iovecs[ii * 2].iov_len = longhair::kWireHeaderBytes;
+            iovecs[ii * 2 + 1].iov_base = buffers[ii];
+            iovecs[ii * 2 + 1].iov_len = session.BlockBytes;
+            memset(&messages[ii], 0, sizeof(mmsghdr));
+            messages[ii].msg_hdr.msg_iov = &iovecs[ii * 2];
+            messages[ii].msg_hdr.msg_iovlen = 2;
+        }
+        if (ended)
+            break;
+
+        const int count = recvmmsg(fd, messages.data(), batch, MSG_WAITFORONE, nullptr);
+        ++result.Calls;
+        if (count <= 0)
+        {
+            if (count < 0 && errno == EINTR)
+                continue;
+            // Timed out: the end markers were lost
+            if (senderDone)
+                break;
+            continue;
+        }
+
+        if (result.Packets == 0)
+            result.StartUsec = siamese::GetTimeUsec();
+
+        const uint64_t nowMsec = siamese::GetTimeMsec();
+        const uint64_t t0 = siamese::GetCycles();
+
+        for (int ii = 0; ii < count; ++ii)
+        {
+            longhair::WireHeader header;
+            if (messages[ii].msg_len != longhair::WirePacketBytes(session.BlockBytes) ||
+                !longhair::ReadWireHeader(&headers[ii * longhair::kWireHeaderBytes], header) ||
+                header.K != session.K || header.M != session.M)
+                continue;
+
+            if (header.Flags & longhair::kWireFlagEndOfStream)
+            {
+                ended = true;
+                continue;
+            }
+            ++result.Packets;
+            result.EndUsec = siamese::GetTimeUsec();
+
+            // The manager takes the buffer either way
+            manager.OnPacket(header.Generation, header.Row, buffers[ii], nowMsec);
+            buffers[ii] = nullptr;
+        }
+
+        result.CodecCycles += siamese::GetCycles() - t0;
+    }
+
+    for (uint8_t* buffer : buffers)
+        if (buffer)
+            manager.FreeBuffer(buffer);
+
+    manager.Expire(~(uint64_t)0 >> 1, 0);
+    result.LostGenerations = manager.GetLostGenerations();
+    result.CpuUsec = GetThreadCpuUsec() - cpuStart;
+}
+
+
+//------------------------------------------------------------------------------
+// Entrypoint
+
+static int OpenSocket(int receiveBufferBytes)
+{
+    const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+        return -1;
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBufferBytes, sizeof(receiveBufferBytes));
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bench::LossModel* CreateLossModel(const UdpSettings& settings)
+{
+    if (settings.GilbertElliott)
+    {
+        double p = 0., r = 1., good = 0., bad = 1.;
+        const int count = sscanf(settings.GilbertElliott, "%lf,%lf,%lf,%lf", &p, &r, &good, &bad);
+        if (count < 2 || p < 0. || p > 1. || r <= 0. || r > 1.)
+            return nullptr;
+        return new bench::GilbertElliottLoss(settings.Seed, p, r, good, bad);
+    }
+
+    // Independent loss is the Good state on its own
+    return new bench::GilbertElliottLoss(settings.Seed, 0., 1., settings.Loss, settings.Loss);
+}
+
+int main(int argc, char** argv)
+{
+    UdpSettings settings;
+    if (!ParseSettings(argc, argv, settings))
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    longhair::SessionSettings session;
+    session.K = settings.K;
+    session.M = settings.M;
+    session.BlockBytes = settings.Bytes;
+    session.Interleave = settings.Interleave;
+    if (!session.IsValid())
+    {
+        printf("Invalid k/m/bytes/interleave\n");
+        return 1;
+    }
+
+    unique_ptr<bench::LossModel> loss(CreateLossModel(settings));
+    if (!loss)
+    {
+        printf("Invalid Gilbert-Elliott parameters: %s\n", settings.GilbertElliott);
+        return 1;
+    }
+
+    const int rx = OpenSocket(8 * 1024 * 1024);
+    const int tx = OpenSocket(0);
+    if (rx < 0 || tx < 0)
+    {
+        printf("Unable to open loopback sockets\n");
+        return 1;
+    }
+
+    // Connect the sender to the receiver's ephemeral port
+    sockaddr_in addr;
+    socklen_t addrLen = sizeof(addr);
+    getsockname(rx, (sockaddr*)&addr, &addrLen);
+    if (connect(tx, (sockaddr*)&addr, addrLen) < 0)
+    {
+        printf("Unable to connect loopback sockets\n");
+        return 1;
+    }
+
+    timeval timeout = { 0, 200 * 1000 };
+    setsockopt(rx, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    SendResult sent;
+    ReceiveResult received;
+    atomic<bool> senderDone(false);
+
+    std::thread receiver(ReceiveThread, std::cref(settings), std::cref(session), rx,
+        std::cref(senderDone), std::ref(received));
+    std::thread sender([&]() {
+        SendThread(settings, session, tx, loss.get(), sent);
+        senderDone = true;
+    });
+    sender.join();
+    receiver.join();
+
+    close(tx);
+    close(rx);
+
+    const double cyclesPerUsec = bench::GetCyclesPerUsec();
+    const uint64_t originals = (uint64_t)settings.Generations * settings.K;
+    const uint64_t attempted = sent.Packets + sent.Dropped;
+    const double seconds = (received.EndUsec - received.StartUsec) / 1000000.;
+    const double goodBytes = (double)received.Delivered * settings.Bytes;
+    const double gigabytes = goodBytes / 1e9;
+
+    // End markers are not data packets
+    const uint64_t dataSent = sent.Packets > kEndMarkers ? sent.Packets - kEndMarkers : 0;
+    const uint64_t socketLost = dataSent > received.Packets ? dataSent - received.Packets : 0;
+
+    bench::Report report(settings.Format);
+    report.Columns({ "k", "m", "bytes", "D", "batch",
+        "inj_loss_pct", "sock_loss_pct", "rx_pps", "goodput_MBps", "delivered_pct", "lost_gens",
+        "tx_cpu_s_GB", "tx_codec_pct", "rx_cpu_s_GB", "rx_codec_pct", "tx_calls", "rx_calls" });
+
+    const double txCodecUsec = sent.CodecCycles / cyclesPerUsec;
+    const double rxCodecUsec = received.CodecCycles / cyclesPerUsec;
+
+    report.Row({
+        to_string(settings.K),
+        to_string(settings.M),
+        to_string(settings.Bytes),
+        to_string(settings.Interleave),
+        to_string(settings.Batch),
+        bench::Fixed(attempted ? 100. * sent.Dropped / attempted : 0., 2),
+        bench::Fixed(dataSent ? 100. * socketLost / dataSent : 0., 2),
+        bench::Fixed(seconds > 0. ? received.Packets / seconds : 0., 0),
+        bench::Fixed(seconds > 0. ? goodBytes / seconds / 1e6 : 0., 1),
+        bench::Fixed(100. * received.Delivered / originals, 3),
+        to_string(received.LostGenerations),
+        bench::Fixed(gigabytes > 0. ? sent.CpuUsec / 1e6 / gigabytes : 0., 3),
+        bench::Fixed(sent.CpuUsec ? 100. * txCodecUsec / sent.CpuUsec : 0., 1),
+        bench::Fixed(gigabytes > 0. ? received.CpuUsec / 1e6 / gigabytes : 0., 3),
+        bench::Fixed(received.CpuUsec ? 100. * rxCodecUsec / received.CpuUsec : 0., 1),
+        to_string(sent.Calls),
+        to_string(received.Calls),
+    });
+    report.End();
+
+    if (received.Corrupted)
+        printf("Corrupted originals: %llu\n", (unsigned long long)received.Corrupted);
+
+    return (sent.Failed || received.Failed || received.Corrupted) ? 1 : 0;
+}
@@ -0,0 +1,265 @@
+/** \file
+    \brief Longhair Tests: Sliding-Window FEC
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "TestTools.h"
+#include "../longhair_window.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+using namespace longhair;
+
+
+//------------------------------------------------------------------------------
+// Helpers
+
+/// Checks the bounds of the decoder's rows after every packet
+class CheckedDecoder : public WindowDecoder
+{
+public:
+    /// Every row's sequence range is inside the history, so no slot is
+    /// read for two sequence numbers, and the pivot is its oldest source
+    void CheckRows()
+    {
+        for (const Row& r : Rows)
+        {
+            if (!r.Used)
+                continue;
+            TEST_CHECK(r.Lo - Base < HistorySize);
+            TEST_CHECK(r.Hi - r.Lo < HistorySize);
+            TEST_CHECK(r.Hi - Base < HistorySize);
+            TEST_CHECK(r.Pivot == r.Lo);
+        }
+    }
+};
+
+struct WindowPacket
+{
+    bool IsRepair;
+
+    /// Source sequence number, or the repair header
+    uint32_t Sequence;
+    WindowRepair Header;
+
+    std::vector<uint8_t> Data;
+};
+
+
+//------------------------------------------------------------------------------
+// Tests
+
+/**
+    Run a stream of sources with a repair after every `sourcesPerRepair`
+    through random loss and reordering.
+
+    Every delivered (sequence, data) must match what was sent, and no
+    sequence may be delivered twice.  Reordering moves packets by less than
+    the window, so every source that arrives after the first packet is
+    delivered.
+*/
+static void TestRoundTrip(unsigned windowSize, unsigned sourcesPerRepair, unsigned lossPercent, uint64_t seed)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(seed);
+
+    WindowSettings settings;
+    settings.WindowSize = windowSize;
+    settings.BlockBytes = 16;
+
+    const unsigned sourceCount = 4 * windowSize + 200;
+    std::vector<uint8_t> sources((size_t)sourceCount * settings.BlockBytes);
+    test::FillRandom(prng, sources.data(), sources.size());
+
+    WindowEncoder encoder;
+    TEST_CHECK(encoder.Initialize(settings));
+
+    std::vector<WindowPacket> packets;
+    for (unsigned ii = 0; ii < sourceCount; ++ii)
+    {
+        const uint8_t* data = &sources[(size_t)ii * settings.BlockBytes];
+        const uint32_t sequence = encoder.AddSource(data);
+        TEST_CHECK(sequence == ii);
+
+        WindowPacket source;
+        source.IsRepair = false;
+        source.Sequence = sequence;
+        source.Data.assign(data, data + settings.BlockBytes);
+        packets.push_back(source);
+
+        if ((ii + 1) % sourcesPerRepair == 0)
+        {
+            WindowPacket repair;
+            repair.IsRepair = true;
+            repair.Sequence = 0;
+            repair.Data.resize(settings.BlockBytes);
+            TEST_CHECK(encoder.GenerateRepair(repair.Data.data(), repair.Header));
+            TEST_CHECK(repair.Header.Count == std::min(ii + 1, windowSize));
+            TEST_CHECK(repair.Header.FirstSequence + repair.Header.Count == ii + 1);
+            packets.push_back(repair);
+        }
+    }
+
+    // Move each packet back by less than the window, then lose some
+    std::vector<std::pair<size_t, size_t>> order(packets.size());
+    for (size_t ii = 0; ii < packets.size(); ++ii)
+        order[ii] = std::make_pair(ii + prng.Next() % windowSize, ii);
+    std::sort(order.begin(), order.end());
+
+    std::vector<const WindowPacket*> received;
+    std::vector<bool> sourceArrived(sourceCount, false);
+    for (const auto& position : order)
+    {
+        if (prng.Next() % 100 < lossPercent)
+            continue;
+        const WindowPacket& packet = packets[position.second];
+        if (!packet.IsRepair)
+            sourceArrived[packet.Sequence] = true;
+        received.push_back(&packet);
+    }
+    TEST_CHECK(!received.empty());
+    if (received.empty())
+        return;
+
+    std::vector<unsigned> deliveries(sourceCount, 0);
+    std::vector<bool> fed(sourceCount, false);
+    uint64_t recovered = 0;
+    CheckedDecoder decoder;
+    TEST_CHECK(decoder.Initialize(settings, [&](uint32_t sequence, const uint8_t* data, int bytes) {
+        TEST_CHECK(bytes == settings.BlockBytes);
+        TEST_CHECK(sequence < sourceCount);
+        if (sequence >= sourceCount)
+            return;
+        TEST_CHECK(0 == memcmp(data, &sources[(size_t)sequence * settings.BlockBytes], bytes));
+        ++deliveries[sequence];
+        if (!fed[sequence])
+            ++recovered;
+    }));
+
+    for (const WindowPacket* packet : received)
+    {
+        if (packet->IsRepair)
+            TEST_CHECK(decoder.OnRepair(packet->Header, packet->Data.data()));
+        else
+        {
+            fed[packet->Sequence] = true;
+            TEST_CHECK(decoder.OnSource(packet->Sequence, packet->Data.data()));
+        }
+        decoder.CheckRows();
+    }
+
+    const WindowPacket* first = received[0];
+    const uint32_t firstSequence = first->IsRepair ? first->Header.FirstSequence : first->Sequence;
+
+    uint64_t delivered = 0;
+    for (unsigned ii = 0; ii < sourceCount; ++ii)
+    {
+        TEST_CHECK(deliveries[ii] <= 1);
+        // The decoder starts from the first packet it sees, so sources
+        // reordered in front of that one are too old
+        if (sourceArrived[ii] && ii >= firstSequence)
+            TEST_CHECK(deliveries[ii] == 1);
+        delivered += deliveries[ii];
+    }
+    TEST_CHECK(decoder.GetRecoveredCount() == recovered);
+    TEST_CHECK(delivered + decoder.GetLostCount() <= sourceCount);
+
+    // Repairs outnumber the losses: some are always recovered.  Past that
+    // the test only checks that nothing wrong is delivered
+    if (lossPercent > 0 && lossPercent <= 20)
+        TEST_CHECK(recovered > 0);
+}
+
+/// The repair covering a single lost source recovers it right away
+static void TestSingleLoss()
+{
+    siamese::PCGRandom prng;
+    prng.Seed(30);
+
+    WindowSettings settings;
+    settings.WindowSize = 8;
+    settings.BlockBytes = 64;
+
+    std::vector<uint8_t> sources(8 * 64);
+    test::FillRandom(prng, sources.data(), sources.size());
+
+    WindowEncoder encoder;
+    TEST_CHECK(encoder.Initialize(settings));
+    for (unsigned ii = 0; ii < 8; ++ii)
+        encoder.AddSource(&sources[ii * 64]);
+    std::vector<uint8_t> repair(64);
+    WindowRepair header;
+    TEST_CHECK(encoder.GenerateRepair(repair.data(), header));
+
+    std::vector<uint32_t> order;
+    WindowDecoder decoder;
+    TEST_CHECK(decoder.Initialize(settings, [&](uint32_t sequence, const uint8_t* data, int bytes) {
+        TEST_CHECK(0 == memcmp(data, &sources[sequence * 64], bytes));
+        order.push_back(sequence);
+    }));
+    for (unsigned ii = 0; ii < 8; ++ii)
+        if (ii != 5)
+            TEST_CHECK(decoder.OnSource(ii, &sources[ii * 64]));
+    TEST_CHECK(order.size() == 7);
+    TEST_CHECK(decoder.OnRepair(header, repair.data()));
+    TEST_CHECK(order.size() == 8 && order.back() == 5);
+    TEST_CHECK(decoder.GetRecoveredCount() == 1);
+
+    // Duplicates and the repair again change nothing
+    TEST_CHECK(decoder.OnSource(5, &sources[5 * 64]));
+    TEST_CHECK(decoder.OnRepair(header, repair.data()));
+    TEST_CHECK(order.size() == 8);
+
+    // Invalid headers are rejected
+    WindowRepair bad = header;
+    bad.Count = 0;
+    TEST_CHECK(!decoder.OnRepair(bad, repair.data()));
+    bad.Count = 9;
+    TEST_CHECK(!decoder.OnRepair(bad, repair.data()));
+}
+
+
+//------------------------------------------------------------------------------
+// Entrypoint
+
+int main()
+{
+    TestSingleLoss();
+
+    for (unsigned windowSize = 1; windowSize <= kMaxWindowSize; ++windowSize)
+    {
+        TestRoundTrip(windowSize, std::min(windowSize, 4u), 0, windowSize);
+        TestRoundTrip(windowSize, std::min(windowSize, 8u), 5, 1000 + windowSize);
+        TestRoundTrip(windowSize, std::min(windowSize, 4u), 10, 2000 + windowSize);
+        TestRoundTrip(windowSize, std::min(windowSize, 2u), 20, 3000 + windowSize);
+        TestRoundTrip(windowSize, std::min(windowSize, 2u), 40, 4000 + windowSize);
+    }
+
+    return test::Finish("longhair_window_tests");
+}
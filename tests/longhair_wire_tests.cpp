@@ -0,0 +1,243 @@
+/** \file
+    \brief Longhair Tests: Packet Wire Header
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "TestTools.h"
+#include "../longhair_wire.h"
+
+#include <cstring>
+
+using namespace longhair;
+
+
+//------------------------------------------------------------------------------
+// Helpers
+
+static WireHeader RandomHeader(siamese::PCGRandom& prng)
+{
+    WireHeader header;
+    header.K = (uint8_t)(1 + prng.Next() % 255);
+    header.M = (uint8_t)(1 + prng.Next() % (256 - header.K));
+    header.Row = (uint8_t)(prng.Next() % (header.K + header.M));
+    header.Flags = (uint8_t)(prng.Next() % 2);
+    header.Generation = prng.Next();
+    header.BlockBytes = (uint16_t)(8 * (1 + prng.Next() % 200));
+    header.OriginalBytes = prng.Next() % ((uint32_t)header.K * header.BlockBytes + 1);
+    return header;
+}
+
+static bool HeadersEqual(const WireHeader& a, const WireHeader& b)
+{
+    return a.K == b.K && a.M == b.M && a.Row == b.Row && a.Flags == b.Flags &&
+        a.Generation == b.Generation && a.OriginalBytes == b.OriginalBytes &&
+        a.BlockBytes == b.BlockBytes;
+}
+
+/// Header followed by a random payload
+static std::vector<uint8_t> MakePacket(siamese::PCGRandom& prng, const WireHeader& header)
+{
+    std::vector<uint8_t> packet(WirePacketBytes(header.BlockBytes));
+    uint8_t* payload = WriteWireHeader(packet.data(), header);
+    TEST_CHECK(payload == packet.data() + kWireHeaderBytes);
+    test::FillRandom(prng, payload, header.BlockBytes);
+    return packet;
+}
+
+static bool Parse(const std::vector<uint8_t>& packet, size_t bytes)
+{
+    WireHeader header;
+    const uint8_t* payload = nullptr;
+    return ParseWirePacket(packet.data(), bytes, header, payload);
+}
+
+
+//------------------------------------------------------------------------------
+// Tests
+
+static void TestRoundTrip()
+{
+    siamese::PCGRandom prng;
+    prng.Seed(40);
+
+    for (int ii = 0; ii < 1000; ++ii)
+    {
+        const WireHeader header = RandomHeader(prng);
+        TEST_CHECK(header.IsValid());
+        const std::vector<uint8_t> packet = MakePacket(prng, header);
+
+        WireHeader parsed;
+        const uint8_t* payload = nullptr;
+        TEST_CHECK(ParseWirePacket(packet.data(), packet.size(), parsed, payload));
+        TEST_CHECK(HeadersEqual(header, parsed));
+        TEST_CHECK(payload == packet.data() + kWireHeaderBytes);
+        TEST_CHECK(parsed.IsOriginal() == (header.Row < header.K));
+    }
+
+    // Byte layout from the table in longhair_wire.h
+    WireHeader header;
+    header.K = 10, header.M = 4, header.Row = 12, header.Flags = kWireFlagEndOfStream;
+    header.Generation = 0x12345678;
+    header.OriginalBytes = 0x00001234;
+    header.BlockBytes = 0x0208;
+    uint8_t bytes[kWireHeaderBytes];
+    WriteWireHeader(bytes, header);
+    const uint8_t expected[kWireHeaderBytes] = {
+        kWireVersion, 10, 4, 12, 0x78, 0x56, 0x34, 0x12,
+        0x34, 0x12, 0x00, 0x00, 0x08, 0x02, kWireFlagEndOfStream, 0
+    };
+    TEST_CHECK(0 == memcmp(bytes, expected, kWireHeaderBytes));
+}
+
+static void TestTruncated()
+{
+    siamese::PCGRandom prng;
+    prng.Seed(41);
+
+    for (int ii = 0; ii < 100; ++ii)
+    {
+        const WireHeader header = RandomHeader(prng);
+        const std::vector<uint8_t> packet = MakePacket(prng, header);
+
+        TEST_CHECK(Parse(packet, packet.size()));
+        TEST_CHECK(!Parse(packet, packet.size() - 1));
+        TEST_CHECK(!Parse(packet, packet.size() - 8));
+        TEST_CHECK(!Parse(packet, kWireHeaderBytes));
+        TEST_CHECK(!Parse(packet, kWireHeaderBytes - 1));
+        TEST_CHECK(!Parse(packet, 0));
+
+        // Trailing bytes are not a valid packet either
+        std::vector<uint8_t> longer = packet;
+        longer.push_back(0);
+        TEST_CHECK(!Parse(longer, longer.size()));
+    }
+}
+
+static void TestGarbage()
+{
+    siamese::PCGRandom prng;
+    prng.Seed(42);
+
+    WireHeader header;
+    header.K = 10, header.M = 4, header.Row = 3, header.BlockBytes = 64;
+    header.OriginalBytes = 600;
+    const std::vector<uint8_t> good = MakePacket(prng, header);
+    TEST_CHECK(Parse(good, good.size()));
+
+    // Change one byte of the header
+    struct Corruption
+    {
+        unsigned Offset;
+        uint8_t Value;
+    };
+    const Corruption corruptions[] = {
+        { 0, 0 }, { 0, kWireVersion + 1 },  // Version
+        { 1, 0 },                           // K = 0
+        { 2, 0 },                           // M = 0
+        { 2, 250 },                         // K + M > 256
+        { 3, 14 },                          // Row >= K + M
+        { 12, 60 },                         // BlockBytes not a multiple of 8
+        { 12, 0 },                          // BlockBytes = 0
+        { 9, 3 },                           // OriginalBytes > K * BlockBytes
+        { 15, 1 }, { 15, 0x80 },            // Reserved
+    };
+    for (const Corruption& corruption : corruptions)
+    {
+        std::vector<uint8_t> bad = good;
+        bad[corruption.Offset] = corruption.Value;
+        TEST_CHECK(!Parse(bad, bad.size()));
+    }
+
+    // Random bytes: anything accepted must write back to the same header
+    unsigned accepted = 0;
+    for (int ii = 0; ii < 100000; ++ii)
+    {
+        const bool plausible = (prng.Next() % 2) == 0;
+        const size_t bytes = plausible ? WirePacketBytes(8 * (1 + prng.Next() % 8)) : prng.Next() % 128;
+        std::vector<uint8_t> packet(bytes);
+        test::FillRandom(prng, packet.data(), bytes);
+        if (plausible)
+        {
+            // Fix the version, reserved byte and length, and keep
+            // OriginalBytes small, so that the other checks are reached
+            packet[0] = kWireVersion;
+            packet[9] &= 0x07;
+            packet[10] = packet[11] = 0;
+            packet[12] = (uint8_t)(bytes - kWireHeaderBytes);
+            packet[13] = 0;
+            packet[15] = 0;
+        }
+
+        WireHeader parsed;
+        const uint8_t* payload = nullptr;
+        if (!ParseWirePacket(packet.data(), bytes, parsed, payload))
+            continue;
+        ++accepted;
+
+        TEST_CHECK(parsed.IsValid());
+        TEST_CHECK(bytes == WirePacketBytes(parsed.BlockBytes));
+        uint8_t rewritten[kWireHeaderBytes];
+        WriteWireHeader(rewritten, parsed);
+        TEST_CHECK(0 == memcmp(rewritten, packet.data(), kWireHeaderBytes));
+    }
+    TEST_CHECK(accepted > 0);
+}
+
+static void TestOriginalBytes()
+{
+    WireHeader header;
+    header.K = 4, header.M = 2, header.BlockBytes = 64;
+
+    // 3.5 blocks of data: the last original is half padding, none is empty
+    header.OriginalBytes = 224;
+    TEST_CHECK(WireOriginalBytes(header, 0) == 64);
+    TEST_CHECK(WireOriginalBytes(header, 2) == 64);
+    TEST_CHECK(WireOriginalBytes(header, 3) == 32);
+
+    // 1 byte: the rest are all padding
+    header.OriginalBytes = 1;
+    TEST_CHECK(WireOriginalBytes(header, 0) == 1);
+    TEST_CHECK(WireOriginalBytes(header, 1) == 0);
+    TEST_CHECK(WireOriginalBytes(header, 3) == 0);
+
+    header.OriginalBytes = 256;
+    TEST_CHECK(WireOriginalBytes(header, 3) == 64);
+}
+
+
+//------------------------------------------------------------------------------
+// Entrypoint
+
+int main()
+{
+    TestRoundTrip();
+    TestTruncated();
+    TestGarbage();
+    TestOriginalBytes();
+
+    return test::Finish("longhair_wire_tests");
+}
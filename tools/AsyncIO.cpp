@@ -0,0 +1,324 @@
+/** \file
+    \brief Longhair Tools: Asynchronous File I/O
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "AsyncIO.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+    #if __has_include(<linux/io_uring.h>)
+        #define TOOLS_HAS_IO_URING
+    #endif
+#endif
+
+#ifdef TOOLS_HAS_IO_URING
+    #include <linux/io_uring.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <sys/uio.h>
+#endif
+
+namespace tools {
+
+
+//------------------------------------------------------------------------------
+// AsyncIO
+
+static const size_t kPageBytes = 4096;
+
+AsyncIO::~AsyncIO()
+{
+    CloseRing();
+    free(Buffers);
+}
+
+bool AsyncIO::Initialize(unsigned depth, unsigned bufferCount, size_t bufferBytes, bool allowAsync)
+{
+    if (depth == 0 || bufferCount == 0 || bufferBytes == 0 || Buffers)
+        return false;
+
+    BufferBytes = (bufferBytes + kPageBytes - 1) / kPageBytes * kPageBytes;
+    BuffersAllocated = BufferBytes * bufferCount;
+    Buffers = (uint8_t*)aligned_alloc(kPageBytes, BuffersAllocated);
+    if (!Buffers)
+        return false;
+
+    // Touch the pages now rather than during the first reads
+    memset(Buffers, 0, BuffersAllocated);
+
+    Depth = depth;
+    if (allowAsync && !SetupRing(bufferCount))
+        CloseRing();
+    return true;
+}
+
+/// Blocking transfer for the fallback path.  Returns bytes or -errno
+static int TransferSync(bool write, int fd, uint64_t offset, uint8_t* data, unsigned bytes)
+{
+    unsigned done = 0;
+    while (done < bytes)
+    {
+        const ssize_t count = write ?
+            pwrite(fd, data + done, bytes - done, (off_t)(offset + done)) :
+            pread(fd, data + done, bytes - done, (off_t)(offset + done));
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count < 0)
+            return -errno;
+        if (count == 0)
+            break;
+        done += (unsigned)count;
+    }
+    return (int)done;
+}
+
+bool AsyncIO::Queue(bool write, int fd, uint64_t offset, uint8_t* data, unsigned bytes, unsigned buffer, uint64_t userData)
+{
+    if (InFlight >= Depth)
+        return false;
+    ++InFlight;
+
+    if (RingFd >= 0)
+        return QueueRing(write, fd, offset, data, bytes, buffer, userData);
+
+    Done.push_back(Completion{ userData, TransferSync(write, fd, offset, data, bytes) });
+    return true;
+}
+
+bool AsyncIO::Wait(unsigned minCompletions, std::vector<Completion>& completions)
+{
+    if (minCompletions > InFlight)
+        minCompletions = InFlight;
+
+    if (RingFd >= 0)
+        return WaitRing(minCompletions, completions);
+
+    completions.insert(completions.end(), Done.begin(), Done.end());
+    InFlight -= (unsigned)Done.size();
+    Done.clear();
+    return true;
+}
+
+bool AsyncIO::Read(int fd, uint64_t offset, uint8_t* data, unsigned bytes, unsigned buffer, uint64_t userData)
+{
+    return Queue(false, fd, offset, data, bytes, buffer, userData);
+}
+
+bool AsyncIO::Write(int fd, uint64_t offset, uint8_t* data, unsigned bytes, unsigned buffer, uint64_t userData)
+{
+    return Queue(true, fd, offset, data, bytes, buffer, userData);
+}
+
+#ifdef TOOLS_HAS_IO_URING
+
+static int RingSetup(unsigned entries, io_uring_params* params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int RingEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0);
+}
+
+static int RingRegister(int fd, unsigned opcode, const void* arg, unsigned count)
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+bool AsyncIO::SetupRing(unsigned bufferCount)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    RingFd = RingSetup(Depth, &params);
+    if (RingFd < 0)
+        return false;
+
+    // Needed so a full completion queue cannot lose results
+    if (!(params.features & IORING_FEAT_NODROP) || params.sq_entries < Depth)
+        return false;
+
+    SqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    CqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single && CqRingBytes > SqRingBytes)
+        SqRingBytes = CqRingBytes;
+
+    SqRing = mmap(nullptr, SqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, RingFd, IORING_OFF_SQ_RING);
+    if (SqRing == MAP_FAILED)
+    {
+        SqRing = nullptr;
+        return false;
+    }
+
+    if (single)
+    {
+        CqRing = SqRing;
+        CqRingBytes = 0;
+    }
+    else
+    {
+        CqRing = mmap(nullptr, CqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, RingFd, IORING_OFF_CQ_RING);
+        if (CqRing == MAP_FAILED)
+        {
+            CqRing = nullptr;
+            return false;
+        }
+    }
+
+    SqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+    Sqes = mmap(nullptr, SqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, RingFd, IORING_OFF_SQES);
+    if (Sqes == MAP_FAILED)
+    {
+        Sqes = nullptr;
+        return false;
+    }
+
+    uint8_t* sq = (uint8_t*)SqRing;
+    SqHead = (unsigned*)(sq + params.sq_off.head);
+    SqTail = (unsigned*)(sq + params.sq_off.tail);
+    SqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+    SqArray = (unsigned*)(sq + params.sq_off.array);
+
+    uint8_t* cq = (uint8_t*)CqRing;
+    CqHead = (unsigned*)(cq + params.cq_off.head);
+    CqTail = (unsigned*)(cq + params.cq_off.tail);
+    CqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+    Cqes = cq + params.cq_off.cqes;
+
+    // Register every buffer so reads and writes can use the fixed variants
+    std::vector<iovec> iovecs(bufferCount);
+    for (unsigned ii = 0; ii < bufferCount; ++ii)
+    {
+        iovecs[ii].iov_base = GetBuffer(ii);
+        iovecs[ii].iov_len = BufferBytes;
+    }
+    return 0 == RingRegister(RingFd, IORING_REGISTER_BUFFERS, iovecs.data(), bufferCount);
+}
+
+void AsyncIO::CloseRing()
+{
+    if (Sqes)
+        munmap(Sqes, SqesBytes);
+    if (CqRing && CqRing != SqRing)
+        munmap(CqRing, CqRingBytes);
+    if (SqRing)
+        munmap(SqRing, SqRingBytes);
+    if (RingFd >= 0)
+        close(RingFd);
+
+    Sqes = SqRing = CqRing = nullptr;
+    RingFd = -1;
+}
+
+bool AsyncIO::QueueRing(bool write, int fd, uint64_t offset, uint8_t* data, unsigned bytes, unsigned buffer, uint64_t userData)
+{
+    const unsigned tail = *SqTail;
+    const unsigned index = tail & *SqMask;
+
+    io_uring_sqe* sqe = (io_uring_sqe*)Sqes + index;
+    memset(sqe, 0, sizeof(io_uring_sqe));
+    sqe->opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = (uint64_t)(uintptr_t)data;
+    sqe->len = bytes;
+    sqe->buf_index = (uint16_t)buffer;
+    sqe->user_data = userData;
+
+    SqArray[index] = index;
+    // Publish the entry before the new tail
+    __atomic_store_n(SqTail, tail + 1, __ATOMIC_RELEASE);
+    ++ToSubmit;
+    return true;
+}
+
+bool AsyncIO::WaitRing(unsigned minCompletions, std::vector<Completion>& completions)
+{
+    unsigned reaped = 0;
+    for (;;)
+    {
+        // Drain what has completed
+        unsigned head = *CqHead;
+        const unsigned tail = __atomic_load_n(CqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head, ++reaped)
+        {
+            const io_uring_cqe* cqe = (const io_uring_cqe*)Cqes + (head & *CqMask);
+            completions.push_back(Completion{ cqe->user_data, cqe->res });
+        }
+        __atomic_store_n(CqHead, head, __ATOMIC_RELEASE);
+
+        if (reaped >= minCompletions && ToSubmit == 0)
+            break;
+
+        // Submit and wait in one call
+        const unsigned wanted = reaped >= minCompletions ? 0 : minCompletions - reaped;
+        const int result = RingEnter(RingFd, ToSubmit, wanted, wanted ? IORING_ENTER_GETEVENTS : 0);
+        if (result < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                continue;
+            return false;
+        }
+        ToSubmit -= (unsigned)result;
+    }
+
+    InFlight -= reaped;
+    return true;
+}
+
+#else // TOOLS_HAS_IO_URING
+
+bool AsyncIO::SetupRing(unsigned /*bufferCount*/)
+{
+    return false;
+}
+
+void AsyncIO::CloseRing()
+{
+}
+
+bool AsyncIO::QueueRing(bool, int, uint64_t, uint8_t*, unsigned, unsigned, uint64_t)
+{
+    return false;
+}
+
+bool AsyncIO::WaitRing(unsigned, std::vector<Completion>&)
+{
+    return false;
+}
+
+#endif // TOOLS_HAS_IO_URING
+
+
+} // namespace tools
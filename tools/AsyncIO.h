@@ -0,0 +1,148 @@
+/** \file
+    \brief Longhair Tools: Asynchronous File I/O
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#pragma once
+
+/**
+    Asynchronous file reads and writes into registered buffers.
+
+    On Linux this drives an io_uring directly through the system calls
+    (no liburing): the buffers are registered once with the kernel and
+    every operation is a READ_FIXED/WRITE_FIXED, so there is no per-I/O
+    page pinning or copying.  Many operations can be queued and are
+    submitted together by the next Wait().
+
+    Where io_uring is not available (other platforms, old kernels, or
+    disabled by seccomp/sysctl) the same interface does each operation
+    synchronously with pread()/pwrite() when it is queued, and Wait()
+    hands back the results, so callers need only one code path.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace tools {
+
+
+//------------------------------------------------------------------------------
+// AsyncIO
+
+class AsyncIO
+{
+public:
+    struct Completion
+    {
+        uint64_t UserData;
+
+        /// Bytes transferred, or -errno
+        int Result;
+    };
+
+    ~AsyncIO();
+
+    /**
+        Allocate `bufferCount` page-aligned buffers of `bufferBytes` and set
+        up a queue for `depth` operations in flight.
+
+        Uses io_uring if `allowAsync` is true and the kernel supports it.
+        Returns false if out of memory.
+    */
+    bool Initialize(unsigned depth, unsigned bufferCount, size_t bufferBytes, bool allowAsync = true);
+
+    /// True if operations really run asynchronously (io_uring)
+    bool IsAsync() const
+    {
+        return RingFd >= 0;
+    }
+
+    uint8_t* GetBuffer(unsigned index) const
+    {
+        return Buffers + index * BufferBytes;
+    }
+
+    /**
+        Queue a transfer between the file and `data`, which must lie inside
+        buffer `buffer`.  Returns false if `depth` operations are already
+        in flight.
+    */
+    bool Read(int fd, uint64_t offset, uint8_t* data, unsigned bytes, unsigned buffer, uint64_t userData);
+    bool Write(int fd, uint64_t offset, uint8_t* data, unsigned bytes, unsigned buffer, uint64_t userData);
+
+    /// Submit the queued operations and wait for at least `minCompletions`
+    /// of them (fewer if fewer are in flight).  Appends to `completions`.
+    /// Returns false on a queue error
+    bool Wait(unsigned minCompletions, std::vector<Completion>& completions);
+
+    /// Operations queued or in flight
+    unsigned GetInFlight() const
+    {
+        return InFlight;
+    }
+
+protected:
+    uint8_t* Buffers = nullptr;
+    size_t BufferBytes = 0;
+    size_t BuffersAllocated = 0;
+
+    unsigned Depth = 0;
+    unsigned InFlight = 0;
+
+    /// Synchronous fallback: results waiting for Wait()
+    std::vector<Completion> Done;
+
+    // io_uring state
+    int RingFd = -1;
+    unsigned ToSubmit = 0;
+
+    void* SqRing = nullptr;
+    size_t SqRingBytes = 0;
+    void* CqRing = nullptr;
+    size_t CqRingBytes = 0;
+    void* Sqes = nullptr;
+    size_t SqesBytes = 0;
+
+    unsigned* SqHead = nullptr;
+    unsigned* SqTail = nullptr;
+    unsigned* SqMask = nullptr;
+    unsigned* SqArray = nullptr;
+    unsigned* CqHead = nullptr;
+    unsigned* CqTail = nullptr;
+    unsigned* CqMask = nullptr;
+    void* Cqes = nullptr;
+
+    bool SetupRing(unsigned bufferCount);
+    void CloseRing();
+    bool Queue(bool write, int fd, uint64_t offset, uint8_t* data, unsigned bytes, unsigned buffer, uint64_t userData);
+    bool QueueRing(bool write, int fd, uint64_t offset, uint8_t* data, unsigned bytes, unsigned buffer, uint64_t userData);
+    bool WaitRing(unsigned minCompletions, std::vector<Completion>& completions);
+};
+
+
+} // namespace tools
@@ -0,0 +1,1423 @@
+/** \file
+    \brief Longhair: Erasure-Coded File Tool
+    \copyright Copyright (c) 2017 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Longhair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+    longhair: Stripe a file into k + m shards and put it back together.
+
+        longhair encode [-k 10] [-m 4] [-b 65536] [-j N] [--container] [-o out] <file>
+        longhair decode [-j N] -o <file> <shards or container...>
+        longhair repair [-j N] [-o prefix] <shards or container...>
+        longhair rebuild [-q 16] [--direct] [--sync] [-o prefix] <shards...>
+
+    encode maps the input and cuts it into stripes of k blocks.  Each stripe
+    is encoded with cauchy_256_encode_ws() on a worker thread, and block i
+    of every stripe goes to shard i, so shards 0..k-1 hold the file itself
+    and shards k..k+m-1 the recovery blocks.  The shards are written as
+    `<out>.000` .. `<out>.NNN`, or all into one container file `<out>`
+    with --container.
+
+    decode rebuilds the file from any k good shards.  Every block has a
+    checksum, so a corrupt block is treated as lost for its stripe only,
+    and each stripe can use a different set of shards.
+
+    repair rewrites missing shard files (named from -o, or after the shards
+    given) and corrupt blocks in place.
+
+    rebuild recreates missing shard files, as after a disk failure, with a
+    deep queue of asynchronous reads and writes (io_uring on Linux, see
+    AsyncIO.h) so the decoder and the disks work at the same time.  It
+    takes separate shard files only, not containers.
+
+    Shard layout, all integers little-endian:
+
+        0     Header (kHeaderBytes): magic, format and matrix version, file
+              id, file size, k, m, shard index, block size, stripe count,
+              data offset and a checksum of the header
+        128   Checksum of each block, 8 bytes per stripe
+        ...   Blocks, one per stripe, starting at the data offset
+
+    The block size and data offset are multiples of kPageBytes, so every
+    block is page-aligned in the file and can be read with O_DIRECT.
+    A container has one header page followed by the k + m shard images,
+    which are all the same size.
+
+    The matrix version is CAUCHY_256_VERSION.  Shards made with a
+    different version are rejected rather than decoded into garbage.
+*/
+
+#include "../cauchy_256.h"
+#include "../SiameseTools.h"
+#include "AsyncIO.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+
+//------------------------------------------------------------------------------
+// Format
+
+static const char kShardMagic[8] = { 'L', 'H', 'S', 'H', 'A', 'R', 'D', '1' };
+static const char kContainerMagic[8] = { 'L', 'H', 'C', 'O', 'N', 'T', 'R', '1' };
+static const uint32_t kFormatVersion = 1;
+
+static const uint64_t kPageBytes = 4096;
+
+/// Bytes at the front of a shard before the checksum table
+static const uint64_t kHeaderBytes = 128;
+
+struct ShardInfo
+{
+    uint32_t MatrixVersion = CAUCHY_256_VERSION;
+    uint64_t FileId = 0;
+    uint64_t FileBytes = 0;
+    uint32_t K = 0;
+    uint32_t M = 0;
+    uint32_t Index = 0;
+    uint32_t BlockBytes = 0;
+    uint64_t StripeCount = 0;
+    uint64_t DataOffset = 0;
+
+    /// Shard image size in bytes
+    uint64_t ImageBytes() const
+    {
+        return DataOffset + StripeCount * BlockBytes;
+    }
+
+    /// True if the shards belong to the same encoding of the same file
+    bool Matches(const ShardInfo& other) const
+    {
+        return MatrixVersion == other.MatrixVersion && FileId == other.FileId &&
+            FileBytes == other.FileBytes && K == other.K && M == other.M &&
+            BlockBytes == other.BlockBytes && StripeCount == other.StripeCount &&
+            DataOffset == other.DataOffset;
+    }
+};
+
+static uint64_t AlignUp(uint64_t bytes, uint64_t alignment)
+{
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+static void StoreLE32(uint8_t* data, uint32_t value)
+{
+    for (int ii = 0; ii < 4; ++ii)
+        data[ii] = (uint8_t)(value >> (ii * 8));
+}
+
+static void StoreLE64(uint8_t* data, uint64_t value)
+{
+    for (int ii = 0; ii < 8; ++ii)
+        data[ii] = (uint8_t)(value >> (ii * 8));
+}
+
+static uint32_t LoadLE32(const uint8_t* data)
+{
+    uint32_t value = 0;
+    for (int ii = 3; ii >= 0; --ii)
+        value = (value << 8) | data[ii];
+    return value;
+}
+
+static uint64_t LoadLE64(const uint8_t* data)
+{
+    uint64_t value = 0;
+    for (int ii = 7; ii >= 0; --ii)
+        value = (value << 8) | data[ii];
+    return value;
+}
+
+
+//------------------------------------------------------------------------------
+// Checksum
+
+static inline uint64_t Rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static const uint64_t kPrime1 = UINT64_C(0x9E3779B185EBCA87);
+static const uint64_t kPrime2 = UINT64_C(0xC2B2AE3D27D4EB4F);
+
+/// 64-bit block checksum: four independent multiply-rotate lanes over
+/// 32-byte chunks (the xxHash64 round), then a final avalanche.  Detects
+/// corruption, not tampering
+static uint64_t Checksum(const uint8_t* data, uint64_t bytes)
+{
+    uint64_t lanes[4] = { kPrime1 + kPrime2, kPrime2, 0, (uint64_t)0 - kPrime1 };
+
+    const uint64_t chunks = bytes / 32;
+    for (uint64_t ii = 0; ii < chunks; ++ii, data += 32)
+    {
+        for (int jj = 0; jj < 4; ++jj)
+        {
+            uint64_t word;
+            memcpy(&word, data + jj * 8, 8);
+            lanes[jj] = Rotl64(lanes[jj] + word * kPrime2, 31) * kPrime1;
+        }
+    }
+
+    uint64_t h = Rotl64(lanes[0], 1) + Rotl64(lanes[1], 7) + Rotl64(lanes[2], 12) + Rotl64(lanes[3], 18);
+    h += bytes;
+    for (uint64_t ii = chunks * 32; ii < bytes; ++ii)
+        h = Rotl64(h ^ (*data++ * kPrime1), 11) * kPrime2;
+
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime1;
+    h ^= h >> 32;
+    return h;
+}
+
+
+//------------------------------------------------------------------------------
+// Headers
+
+static void WriteShardHeader(uint8_t* image, const ShardInfo& info)
+{
+    memset(image, 0, kHeaderBytes);
+    memcpy(image, kShardMagic, 8);
+    StoreLE32(image + 8, kFormatVersion);
+    StoreLE32(image + 12, info.MatrixVersion);
+    StoreLE64(image + 16, info.FileId);
+    StoreLE64(image + 24, info.FileBytes);
+    StoreLE32(image + 32, info.K);
+    StoreLE32(image + 36, info.M);
+    StoreLE32(image + 40, info.Index);
+    StoreLE32(image + 44, info.BlockBytes);
+    StoreLE64(image + 48, info.StripeCount);
+    StoreLE64(image + 56, info.DataOffset);
+    StoreLE64(image + 64, Checksum(image, 64));
+}
+
+/// Returns false if the header is damaged or inconsistent with the image size
+static bool ReadShardHeader(const uint8_t* image, uint64_t bytes, ShardInfo& info)
+{
+    if (bytes < kPageBytes || memcmp(image, kShardMagic, 8) != 0 ||
+        LoadLE32(image + 8) != kFormatVersion ||
+        LoadLE64(image + 64) != Checksum(image, 64))
+        return false;
+
+    info.MatrixVersion = LoadLE32(image + 12);
+    info.FileId = LoadLE64(image + 16);
+    info.FileBytes = LoadLE64(image + 24);
+    info.K = LoadLE32(image + 32);
+    info.M = LoadLE32(image + 36);
+    info.Index = LoadLE32(image + 40);
+    info.BlockBytes = LoadLE32(image + 44);
+    info.StripeCount = LoadLE64(image + 48);
+    info.DataOffset = LoadLE64(image + 56);
+
+    return info.K > 0 && info.M > 0 && info.K + info.M <= 256 && info.Index < info.K + info.M &&
+        info.BlockBytes > 0 && info.BlockBytes % kPageBytes == 0 &&
+        info.DataOffset == AlignUp(kHeaderBytes + 8 * info.StripeCount, kPageBytes) &&
+        info.StripeCount * info.K * info.BlockBytes >= info.FileBytes &&
+        info.ImageBytes() <= bytes;
+}
+
+static void WriteContainerHeader(uint8_t* data, uint32_t shardCount, uint64_t shardBytes)
+{
+    memset(data, 0, kPageBytes);
+    memcpy(data, kContainerMagic, 8);
+    StoreLE32(data + 8, kFormatVersion);
+    StoreLE32(data + 12, shardCount);
+    StoreLE64(data + 16, shardBytes);
+    StoreLE64(data + 24, Checksum(data, 24));
+}
+
+static bool ReadContainerHeader(const uint8_t* data, uint64_t bytes, uint32_t& shardCount, uint64_t& shardBytes)
+{
+    if (bytes < kPageBytes || memcmp(data, kContainerMagic, 8) != 0 ||
+        LoadLE32(data + 8) != kFormatVersion ||
+        LoadLE64(data + 24) != Checksum(data, 24))
+        return false;
+
+    shardCount = LoadLE32(data + 12);
+    shardBytes = LoadLE64(data + 16);
+    return shardCount > 0 && shardCount <= 256 && shardBytes % kPageBytes == 0 &&
+        kPageBytes + shardCount * shardBytes <= bytes;
+}
+
+
+//------------------------------------------------------------------------------
+// Mapped files
+
+class MappedFile
+{
+public:
+    ~MappedFile()
+    {
+        if (Data)
+            munmap(Data, (size_t)Bytes);
+        if (Fd >= 0)
+            close(Fd);
+    }
+
+    /// Map an existing file.  A private mapping is copy-on-write, so it can
+    /// be decoded in place without touching the file
+    bool Open(const char* path, bool writeShared)
+    {
+        Fd = open(path, writeShared ? O_RDWR : O_RDONLY);
+        if (Fd < 0)
+            return false;
+
+        struct stat st;
+        if (fstat(Fd, &st) < 0)
+            return false;
+        Bytes = (uint64_t)st.st_size;
+        if (Bytes == 0)
+            return true;
+
+        void* data = mmap(nullptr, (size_t)Bytes, PROT_READ | PROT_WRITE,
+            writeShared ? MAP_SHARED : MAP_PRIVATE, Fd, 0);
+        if (data == MAP_FAILED)
+            return false;
+        Data = (uint8_t*)data;
+        return true;
+    }
+
+    /// Create or truncate a file of the given size and map it for writing
+    bool Create(const char* path, uint64_t bytes)
+    {
+        Fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (Fd < 0 || ftruncate(Fd, (off_t)bytes) < 0)
+            return false;
+        Bytes = bytes;
+        if (Bytes == 0)
+            return true;
+
+        void* data = mmap(nullptr, (size_t)Bytes, PROT_READ | PROT_WRITE, MAP_SHARED, Fd, 0);
+        if (data == MAP_FAILED)
+            return false;
+        Data = (uint8_t*)data;
+        return true;
+    }
+
+    uint8_t* Data = nullptr;
+    uint64_t Bytes = 0;
+
+protected:
+    int Fd = -1;
+};
+
+/// One shard image inside a mapped shard file or container
+struct ShardView
+{
+    uint8_t* Image = nullptr;
+    ShardInfo Info;
+
+    /// Created by repair: every block needs writing
+    bool Fresh = false;
+
+    uint8_t* GetBlock(uint64_t stripe) const
+    {
+        return Image + Info.DataOffset + stripe * Info.BlockBytes;
+    }
+
+    bool IsBlockGood(uint64_t stripe) const
+    {
+        return !Fresh && LoadLE64(Image + kHeaderBytes + stripe * 8) == Checksum(GetBlock(stripe), Info.BlockBytes);
+    }
+
+    void SetChecksum(uint64_t stripe) const
+    {
+        StoreLE64(Image + kHeaderBytes + stripe * 8, Checksum(GetBlock(stripe), Info.BlockBytes));
+    }
+};
+
+/// Shards of one encoding, indexed by shard number.  Null where missing
+struct ShardSet
+{
+    vector<unique_ptr<MappedFile>> Files;
+    vector<ShardView> Views;
+    ShardInfo Info;
+    bool HaveInfo = false;
+
+    /// Path of the first single-shard file, to name repaired shards after
+    string FirstShardPath;
+
+    /// Map the files and index their shards.  Damaged or mismatched ones
+    /// are reported and skipped
+    bool Load(const vector<const char*>& paths, bool writeShared);
+
+    ShardView* Get(unsigned index)
+    {
+        return Views[index].Image ? &Views[index] : nullptr;
+    }
+
+    unsigned Count() const
+    {
+        unsigned count = 0;
+        for (const ShardView& view : Views)
+            count += view.Image ? 1 : 0;
+        return count;
+    }
+
+protected:
+    void Add(const char* path, uint8_t* image, uint64_t bytes);
+};
+
+void ShardSet::Add(const char* path, uint8_t* image, uint64_t bytes)
+{
+    ShardView view;
+    view.Image = image;
+    if (!ReadShardHeader(image, bytes, view.Info))
+    {
+        fprintf(stderr, "%s: damaged shard header, skipped\n", path);
+        return;
+    }
+
+    if (!HaveInfo)
+    {
+        if (view.Info.MatrixVersion != CAUCHY_256_VERSION)
+        {
+            fprintf(stderr, "%s: made with matrix version %u, this build has %u\n",
+                path, view.Info.MatrixVersion, CAUCHY_256_VERSION);
+            return;
+        }
+        Info = view.Info;
+        HaveInfo = true;
+        Views.resize(Info.K + Info.M);
+    }
+    else if (!view.Info.Matches(Info))
+    {
+        fprintf(stderr, "%s: shard of a different file or encoding, skipped\n", path);
+        return;
+    }
+
+    if (Views[view.Info.Index].Image)
+    {
+        fprintf(stderr, "%s: duplicate shard %u, skipped\n", path, view.Info.Index);
+        return;
+    }
+    Views[view.Info.Index] = view;
+}
+
+bool ShardSet::Load(const vector<const char*>& paths, bool writeShared)
+{
+    for (const char* path : paths)
+    {
+        unique_ptr<MappedFile> file(new MappedFile);
+        if (!file->Open(path, writeShared) || !file->Data)
+        {
+            fprintf(stderr, "%s: unable to map, skipped\n", path);
+            continue;
+        }
+
+        uint32_t shardCount = 0;
+        uint64_t shardBytes = 0;
+        if (ReadContainerHeader(file->Data, file->Bytes, shardCount, shardBytes))
+        {
+            for (uint32_t ii = 0; ii < shardCount; ++ii)
+                Add(path, file->Data + kPageBytes + ii * shardBytes, shardBytes);
+        }
+        else
+        {
+            if (FirstShardPath.empty())
+                FirstShardPath = path;
+            Add(path, file->Data, file->Bytes);
+        }
+
+        Files.push_back(std::move(file));
+    }
+
+    return HaveInfo;
+}
+
+
+//------------------------------------------------------------------------------
+// Parallel stripes
+
+/// Per-thread state for StripeFunctionT
+struct StripeContext
+{
+    CauchyWorkspace* Workspace = nullptr;
+    vector<uint8_t> Scratch;
+};
+
+/// Process one stripe.  Returns false if it failed
+typedef std::function<bool(uint64_t stripe, StripeContext& context)> StripeFunctionT;
+
+/// Run the function for every stripe on `threads` threads, each with its
+/// own workspace.  Returns the number of stripes that failed
+static uint64_t ForEachStripe(unsigned threads, uint64_t stripeCount, const ShardInfo& info, const StripeFunctionT& function)
+{
+    atomic<uint64_t> next(0);
+    atomic<uint64_t> failures(0);
+
+    auto worker = [&]() {
+        StripeContext context;
+        context.Workspace = cauchy_256_workspace_create();
+        if (!context.Workspace ||
+            cauchy_256_workspace_reserve(context.Workspace, info.K, info.M, info.BlockBytes))
+        {
+            failures += 1;
+            cauchy_256_workspace_free(context.Workspace);
+            return;
+        }
+        context.Scratch.resize((size_t)(info.K + info.M) * info.BlockBytes);
+
+        for (;;)
+        {
+            const uint64_t stripe = next++;
+            if (stripe >= stripeCount)
+                break;
+            if (!function(stripe, context))
+                failures += 1;
+        }
+
+        cauchy_256_workspace_free(context.Workspace);
+    };
+
+    vector<std::thread> pool;
+    for (unsigned ii = 1; ii < threads; ++ii)
+        pool.emplace_back(worker);
+    worker();
+    for (std::thread& thread : pool)
+        thread.join();
+
+    return failures;
+}
+
+static string ShardPath(const string& prefix, unsigned index)
+{
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), ".%03u", index);
+    return prefix + suffix;
+}
+
+/// Name missing shards after an existing one: "file.003" -> "file".
+/// Empty if the path does not look like a shard
+static string ShardPrefix(const string& path)
+{
+    const size_t dot = path.find_last_of('.');
+    if (dot == string::npos || path.size() - dot != 4)
+        return string();
+    return path.substr(0, dot);
+}
+
+static void ReportSpeed(const char* what, uint64_t bytes, uint64_t usec)
+{
+    printf("%s %llu bytes in %.3f s: %.1f MB/s\n", what, (unsigned long long)bytes,
+        usec / 1000000., usec ? bytes / (double)usec : 0.);
+}
+
+
+//------------------------------------------------------------------------------
+// Encode
+
+struct EncodeSettings
+{
+    int K = 10;
+    int M = 4;
+    int BlockBytes = 65536;
+    unsigned Threads = 0;
+    bool Container = false;
+    string Output;
+    const char* Input = nullptr;
+};
+
+static int Encode(const EncodeSettings& settings)
+{
+    MappedFile input;
+    if (!input.Open(settings.Input, false))
+    {
+        fprintf(stderr, "%s: unable to map input\n", settings.Input);
+        return 1;
+    }
+
+    const uint64_t stripeBytes = (uint64_t)settings.K * settings.BlockBytes;
+
+    ShardInfo info;
+    info.FileBytes = input.Bytes;
+    info.K = settings.K;
+    info.M = settings.M;
+    info.BlockBytes = settings.BlockBytes;
+    info.StripeCount = (input.Bytes + stripeBytes - 1) / stripeBytes;
+    info.DataOffset = AlignUp(kHeaderBytes + 8 * info.StripeCount, kPageBytes);
+
+    siamese::PCGRandom prng;
+    prng.Seed(siamese::GetTimeUsec(), (uint64_t)getpid());
+    info.FileId = ((uint64_t)prng.Next() << 32) | prng.Next();
+
+    const unsigned shardCount = info.K + info.M;
+    const uint64_t imageBytes = info.ImageBytes();
+
+    // Map the outputs
+    vector<unique_ptr<MappedFile>> files;
+    vector<ShardView> views(shardCount);
+    if (settings.Container)
+    {
+        unique_ptr<MappedFile> file(new MappedFile);
+        if (!file->Create(settings.Output.c_str(), kPageBytes + shardCount * imageBytes))
+        {
+            fprintf(stderr, "%s: unable to create\n", settings.Output.c_str());
+            return 1;
+        }
+        WriteContainerHeader(file->Data, shardCount, imageBytes);
+        for (unsigned ii = 0; ii < shardCount; ++ii)
+            views[ii].Image = file->Data + kPageBytes + ii * imageBytes;
+        files.push_back(std::move(file));
+    }
+    else
+    {
+        for (unsigned ii = 0; ii < shardCount; ++ii)
+        {
+            const string path = ShardPath(settings.Output, ii);
+            unique_ptr<MappedFile> file(new MappedFile);
+            if (!file->Create(path.c_str(), imageBytes))
+            {
+                fprintf(stderr, "%s: unable to create\n", path.c_str());
+                return 1;
+            }
+            views[ii].Image = file->Data;
+            files.push_back(std::move(file));
+        }
+    }
+
+    for (unsigned ii = 0; ii < shardCount; ++ii)
+    {
+        views[ii].Info = info;
+        views[ii].Info.Index = ii;
+        WriteShardHeader(views[ii].Image, views[ii].Info);
+    }
+
+    const uint64_t t0 = siamese::GetTimeUsec();
+
+    const uint64_t failures = ForEachStripe(settings.Threads, info.StripeCount, info,
+        [&](uint64_t stripe, StripeContext& context) -> bool {
+            const int blockBytes = settings.BlockBytes;
+            const uint64_t offset = stripe * stripeBytes;
+            uint8_t* recovery = &context.Scratch[0];
+
+            // The last stripe is zero-padded in scratch after the recovery blocks
+            const unsigned char* dataPtrs[256];
+            const uint8_t* source = input.Data + offset;
+            if (offset + stripeBytes > input.Bytes)
+            {
+                uint8_t* padded = recovery + (size_t)info.M * blockBytes;
+                memset(padded, 0, (size_t)stripeBytes);
+                memcpy(padded, source, (size_t)(input.Bytes - offset));
+                source = padded;
+            }
+
+            for (unsigned ii = 0; ii < info.K; ++ii)
+            {
+                dataPtrs[ii] = source + (size_t)ii * blockBytes;
+                memcpy(views[ii].GetBlock(stripe), dataPtrs[ii], blockBytes);
+                views[ii].SetChecksum(stripe);
+            }
+
+            if (cauchy_256_encode_ws(context.Workspace, info.K, info.M, dataPtrs, recovery, blockBytes))
+                return false;
+
+            for (unsigned ii = 0; ii < info.M; ++ii)
+            {
+                const ShardView& view = views[info.K + ii];
+                memcpy(view.GetBlock(stripe), recovery + (size_t)ii * blockBytes, blockBytes);
+                view.SetChecksum(stripe);
+            }
+            return true;
+        });
+
+    const uint64_t t1 = siamese::GetTimeUsec();
+
+    if (failures)
+    {
+        fprintf(stderr, "Encoding failed for %llu stripes\n", (unsigned long long)failures);
+        return 1;
+    }
+
+    ReportSpeed("Encoded", input.Bytes, t1 - t0);
+    printf("%u shards of %llu bytes: k = %u, m = %u, %u byte blocks, %llu stripes\n",
+        shardCount, (unsigned long long)imageBytes, info.K, info.M, info.BlockBytes,
+        (unsigned long long)info.StripeCount);
+    return 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Decode
+
+static int Decode(const vector<const char*>& paths, const char* output, unsigned threads)
+{
+    // Private mappings so recovery blocks can be decoded in place
+    ShardSet shards;
+    if (!shards.Load(paths, false))
+    {
+        fprintf(stderr, "No usable shards\n");
+        return 1;
+    }
+
+    const ShardInfo& info = shards.Info;
+    if (shards.Count() < info.K)
+    {
+        fprintf(stderr, "Only %u of the %u shards needed are available\n", shards.Count(), info.K);
+        return 1;
+    }
+
+    MappedFile out;
+    if (!out.Create(output, info.FileBytes))
+    {
+        fprintf(stderr, "%s: unable to create\n", output);
+        return 1;
+    }
+
+    atomic<uint64_t> recovered(0);
+    const uint64_t stripeBytes = (uint64_t)info.K * info.BlockBytes;
+    const uint64_t t0 = siamese::GetTimeUsec();
+
+    const uint64_t failures = ForEachStripe(threads, info.StripeCount, info,
+        [&](uint64_t stripe, StripeContext& context) -> bool {
+            // Good originals first, then as many recovery blocks as needed
+            Block blocks[256];
+            unsigned count = 0, erasures = 0;
+            for (unsigned ii = 0; ii < info.K + info.M && count < info.K; ++ii)
+            {
+                ShardView* view = shards.Get(ii);
+                if (view && view->IsBlockGood(stripe))
+                {
+                    blocks[count].data = view->GetBlock(stripe);
+                    blocks[count].row = (unsigned char)ii;
+                    ++count;
+                    if (ii >= info.K)
+                        ++erasures;
+                }
+            }
+            if (count < info.K)
+                return false;
+
+            if (erasures > 0)
+            {
+                if (cauchy_256_decode_ws(context.Workspace, info.K, info.M, blocks, info.BlockBytes))
+                    return false;
+                recovered += erasures;
+            }
+
+            // Trim the padding of the last stripe
+            for (unsigned ii = 0; ii < info.K; ++ii)
+            {
+                const uint64_t offset = stripe * stripeBytes + (uint64_t)blocks[ii].row * info.BlockBytes;
+                if (offset >= info.FileBytes)
+                    continue;
+                const uint64_t bytes = min<uint64_t>(info.BlockBytes, info.FileBytes - offset);
+                memcpy(out.Data + offset, blocks[ii].data, (size_t)bytes);
+            }
+            return true;
+        });
+
+    const uint64_t t1 = siamese::GetTimeUsec();
+
+    if (failures)
+    {
+        fprintf(stderr, "%llu stripes have fewer than k good blocks\n", (unsigned long long)failures);
+        return 1;
+    }
+
+    ReportSpeed("Decoded", info.FileBytes, t1 - t0);
+    printf("Recovered %llu blocks from %u shards\n", (unsigned long long)recovered.load(), shards.Count());
+    return 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Repair
+
+static int Repair(const vector<const char*>& paths, string prefix, unsigned threads)
+{
+    ShardSet shards;
+    if (!shards.Load(paths, true))
+    {
+        fprintf(stderr, "No usable shards\n");
+        return 1;
+    }
+
+    const ShardInfo& info = shards.Info;
+    const unsigned shardCount = info.K + info.M;
+
+    if (prefix.empty())
+        prefix = ShardPrefix(shards.FirstShardPath);
+
+    for (unsigned ii = 0; ii < shardCount; ++ii)
+    {
+        if (shards.Get(ii))
+            continue;
+        if (prefix.empty())
+        {
+            fprintf(stderr, "Shard %u is missing: use -o to name the repaired shards\n", ii);
+            return 1;
+        }
+
+        const string path = ShardPath(prefix, ii);
+        unique_ptr<MappedFile> file(new MappedFile);
+        if (!file->Create(path.c_str(), info.ImageBytes()))
+        {
+            fprintf(stderr, "%s: unable to create\n", path.c_str());
+            return 1;
+        }
+
+        ShardView& view = shards.Views[ii];
+        view.Image = file->Data;
+        view.Info = info;
+        view.Info.Index = ii;
+        view.Fresh = true;
+        WriteShardHeader(view.Image, view.Info);
+        shards.Files.push_back(std::move(file));
+        printf("Recreating %s\n", path.c_str());
+    }
+
+    atomic<uint64_t> repaired(0);
+    const uint64_t t0 = siamese::GetTimeUsec();
+
+    const uint64_t failures = ForEachStripe(threads, info.StripeCount, info,
+        [&](uint64_t stripe, StripeContext& context) -> bool {
+            const int blockBytes = info.BlockBytes;
+            bool bad[256];
+            unsigned badCount = 0;
+            for (unsigned ii = 0; ii < shardCount; ++ii)
+            {
+                bad[ii] = !shards.Views[ii].IsBlockGood(stripe);
+                badCount += bad[ii] ? 1 : 0;
+            }
+            if (badCount == 0)
+                return true;
+            if (shardCount - badCount < info.K)
+                return false;
+
+            // Decode a copy of k good blocks, since the shards are mapped
+            // shared and must not be overwritten by the decoder
+            uint8_t* originals = &context.Scratch[0];
+            uint8_t* recovery = originals + (size_t)info.K * blockBytes;
+
+            Block blocks[256];
+            unsigned count = 0;
+            bool needDecode = false;
+            for (unsigned ii = 0; ii < shardCount && count < info.K; ++ii)
+            {
+                if (bad[ii])
+                    continue;
+                blocks[count].data = originals + (size_t)count * blockBytes;
+                blocks[count].row = (unsigned char)ii;
+                memcpy(blocks[count].data, shards.Views[ii].GetBlock(stripe), blockBytes);
+                needDecode |= ii >= info.K;
+                ++count;
+            }
+            if (needDecode && cauchy_256_decode_ws(context.Workspace, info.K, info.M, blocks, blockBytes))
+                return false;
+
+            const unsigned char* dataPtrs[256];
+            for (unsigned ii = 0; ii < info.K; ++ii)
+                dataPtrs[blocks[ii].row] = blocks[ii].data;
+
+            bool needEncode = false;
+            for (unsigned ii = 0; ii < shardCount; ++ii)
+            {
+                if (!bad[ii])
+                    continue;
+                if (ii >= info.K)
+                {
+                    needEncode = true;
+                    continue;
+                }
+                memcpy(shards.Views[ii].GetBlock(stripe), dataPtrs[ii], blockBytes);
+                shards.Views[ii].SetChecksum(stripe);
+            }
+
+            if (needEncode)
+            {
+                if (cauchy_256_encode_ws(context.Workspace, info.K, info.M, dataPtrs, recovery, blockBytes))
+                    return false;
+                for (unsigned ii = info.K; ii < shardCount; ++ii)
+                {
+                    if (!bad[ii])
+                        continue;
+                    memcpy(shards.Views[ii].GetBlock(stripe), recovery + (size_t)(ii - info.K) * blockBytes, blockBytes);
+                    shards.Views[ii].SetChecksum(stripe);
+                }
+            }
+
+            repaired += badCount;
+            return true;
+        });
+
+    const uint64_t t1 = siamese::GetTimeUsec();
+
+    printf("Repaired %llu blocks in %.3f s\n", (unsigned long long)repaired.load(), (t1 - t0) / 1000000.);
+    if (failures)
+    {
+        fprintf(stderr, "%llu stripes have fewer than k good blocks\n", (unsigned long long)failures);
+        return 1;
+    }
+    return 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Rebuild
+
+struct RebuildSettings
+{
+    /// Stripes in flight
+    unsigned Depth = 16;
+
+    /// Open the shards with O_DIRECT
+    bool Direct = false;
+
+    /// Use io_uring if available
+    bool Async = true;
+
+    string Prefix;
+};
+
+/// A shard file opened for reading or being rebuilt
+struct RebuildShard
+{
+    int Fd = -1;
+    bool Present = false;
+    bool Target = false;
+    string Path;
+
+    /// Block checksums: read from the file, or computed for targets
+    vector<uint64_t> Checksums;
+
+    ~RebuildShard()
+    {
+        if (Fd >= 0)
+            close(Fd);
+    }
+};
+
+/// Page-aligned buffer for O_DIRECT metadata transfers
+struct AlignedBuffer
+{
+    explicit AlignedBuffer(uint64_t bytes)
+        : Data((uint8_t*)aligned_alloc(kPageBytes, (size_t)AlignUp(bytes, kPageBytes)))
+    {
+    }
+    ~AlignedBuffer()
+    {
+        free(Data);
+    }
+    uint8_t* Data;
+};
+
+/// Read the header and checksum table of an open shard file
+static bool ReadShardMetadata(int fd, ShardInfo& info, vector<uint64_t>& checksums)
+{
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+        return false;
+
+    AlignedBuffer header(kPageBytes);
+    if (!header.Data || pread(fd, header.Data, kPageBytes, 0) != (ssize_t)kPageBytes ||
+        !ReadShardHeader(header.Data, (uint64_t)st.st_size, info))
+        return false;
+
+    AlignedBuffer table(info.DataOffset);
+    if (!table.Data || pread(fd, table.Data, (size_t)info.DataOffset, 0) != (ssize_t)info.DataOffset)
+        return false;
+
+    checksums.resize((size_t)info.StripeCount);
+    for (uint64_t ii = 0; ii < info.StripeCount; ++ii)
+        checksums[(size_t)ii] = LoadLE64(table.Data + kHeaderBytes + ii * 8);
+    return true;
+}
+
+/**
+    Rebuild missing shard files with asynchronous I/O.
+
+    Up to Depth stripes are in flight.  Each has one registered buffer with
+    room for k + m blocks: the first k hold the blocks being read, and the
+    encoder writes recovery rows after them.  For each stripe, k reads are
+    queued from the surviving shards (originals first).  A read that fails
+    its checksum is replaced with a read from the next shard.  Once k good
+    blocks are in, the stripe is decoded in place, and the missing rows are
+    queued as writes straight from the same buffer.  Decoding runs on this
+    thread while the reads and writes of the other stripes are in flight,
+    so the codec and the disks overlap.
+*/
+static int Rebuild(const vector<const char*>& paths, const RebuildSettings& settings)
+{
+    const int openFlags = settings.Direct ? O_DIRECT : 0;
+
+    ShardInfo info;
+    bool haveInfo = false;
+    vector<RebuildShard> shards(256);
+    string firstPath;
+
+    for (const char* path : paths)
+    {
+        const int fd = open(path, O_RDONLY | openFlags);
+        ShardInfo shardInfo;
+        vector<uint64_t> checksums;
+        if (fd < 0 || !ReadShardMetadata(fd, shardInfo, checksums))
+        {
+            fprintf(stderr, "%s: unable to read shard header, skipped\n", path);
+            if (fd >= 0)
+                close(fd);
+            continue;
+        }
+
+        if (!haveInfo)
+        {
+            if (shardInfo.MatrixVersion != CAUCHY_256_VERSION)
+            {
+                fprintf(stderr, "%s: made with matrix version %u, this build has %u\n",
+                    path, shardInfo.MatrixVersion, CAUCHY_256_VERSION);
+                close(fd);
+                continue;
+            }
+            info = shardInfo;
+            haveInfo = true;
+            firstPath = path;
+        }
+        else if (!shardInfo.Matches(info) || shards[shardInfo.Index].Present)
+        {
+            fprintf(stderr, "%s: duplicate or shard of a different file, skipped\n", path);
+            close(fd);
+            continue;
+        }
+
+        RebuildShard& shard = shards[shardInfo.Index];
+        shard.Fd = fd;
+        shard.Present = true;
+        shard.Path = path;
+        shard.Checksums.swap(checksums);
+    }
+
+    if (!haveInfo)
+    {
+        fprintf(stderr, "No usable shards\n");
+        return 1;
+    }
+
+    const unsigned shardCount = info.K + info.M;
+    const unsigned blockBytes = info.BlockBytes;
+
+    // Surviving shards to read from, originals first
+    vector<unsigned> candidates;
+    for (unsigned ii = 0; ii < shardCount; ++ii)
+        if (shards[ii].Present)
+            candidates.push_back(ii);
+    if (candidates.size() < info.K)
+    {
+        fprintf(stderr, "Only %u of the %u shards needed are available\n", (unsigned)candidates.size(), info.K);
+        return 1;
+    }
+    if (candidates.size() == shardCount)
+    {
+        printf("No shards are missing\n");
+        return 0;
+    }
+
+    const string prefix = settings.Prefix.empty() ? ShardPrefix(firstPath) : settings.Prefix;
+    if (prefix.empty())
+    {
+        fprintf(stderr, "Use -o to name the rebuilt shards\n");
+        return 1;
+    }
+
+    vector<unsigned> targets;
+    for (unsigned ii = 0; ii < shardCount; ++ii)
+    {
+        RebuildShard& shard = shards[ii];
+        if (shard.Present)
+            continue;
+
+        shard.Path = ShardPath(prefix, ii);
+        shard.Fd = open(shard.Path.c_str(), O_RDWR | O_CREAT | O_TRUNC | openFlags, 0644);
+        if (shard.Fd < 0 || ftruncate(shard.Fd, (off_t)info.ImageBytes()) < 0)
+        {
+            fprintf(stderr, "%s: unable to create\n", shard.Path.c_str());
+            return 1;
+        }
+        shard.Target = true;
+        shard.Checksums.assign((size_t)info.StripeCount, 0);
+        targets.push_back(ii);
+        printf("Rebuilding %s\n", shard.Path.c_str());
+    }
+
+    // Each stripe can have k reads, or up to k + m writes, in flight
+    unsigned depth = max(1u, settings.Depth);
+    while (depth > 1 && depth * shardCount > 32768)
+        --depth;
+
+    tools::AsyncIO io;
+    if (!io.Initialize(depth * shardCount, depth, (size_t)shardCount * blockBytes, settings.Async))
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    CauchyWorkspace* workspace = cauchy_256_workspace_create();
+    if (!workspace || cauchy_256_workspace_reserve(workspace, info.K, info.M, blockBytes))
+    {
+        cauchy_256_workspace_free(workspace);
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    struct Slot
+    {
+        bool Active = false;
+        bool Failed = false;
+        uint64_t Stripe = 0;
+        unsigned Pending = 0;
+        unsigned Good = 0;
+        unsigned NextCandidate = 0;
+        Block Blocks[256];
+    };
+    vector<Slot> slots(depth);
+
+    // User data: slot, block position and whether it is a write
+    auto makeUserData = [](unsigned slot, unsigned position, bool write) -> uint64_t {
+        return ((uint64_t)slot << 16) | (position << 1) | (write ? 1 : 0);
+    };
+
+    uint64_t bytesRead = 0, bytesWritten = 0, badBlocks = 0, failedStripes = 0;
+    bool ioError = false;
+
+    auto issueRead = [&](unsigned slotIndex, unsigned position) -> bool {
+        Slot& slot = slots[slotIndex];
+        if (slot.NextCandidate >= candidates.size())
+            return false;
+        const unsigned row = candidates[slot.NextCandidate++];
+        Block& block = slot.Blocks[position];
+        block.row = (unsigned char)row;
+        block.data = io.GetBuffer(slotIndex) + (size_t)position * blockBytes;
+        if (!io.Read(shards[row].Fd, info.DataOffset + slot.Stripe * blockBytes, block.data, blockBytes,
+            slotIndex, makeUserData(slotIndex, position, false)))
+        {
+            // No completion will arrive for it
+            ioError = true;
+            return false;
+        }
+        ++slot.Pending;
+        return true;
+    };
+
+    auto endStripe = [&](unsigned slotIndex) {
+        Slot& slot = slots[slotIndex];
+        failedStripes += slot.Failed ? 1 : 0;
+        slot.Active = false;
+    };
+
+    auto startStripe = [&](unsigned slotIndex, uint64_t stripe) {
+        Slot& slot = slots[slotIndex];
+        slot.Active = true;
+        slot.Failed = false;
+        slot.Stripe = stripe;
+        slot.Pending = 0;
+        slot.Good = 0;
+        slot.NextCandidate = 0;
+        for (unsigned ii = 0; ii < info.K; ++ii)
+            if (!issueRead(slotIndex, ii))
+                slot.Failed = true;
+        if (slot.Pending == 0)
+            endStripe(slotIndex);
+    };
+
+    // All k blocks are in: decode and queue the writes
+    auto finishReads = [&](unsigned slotIndex) {
+        Slot& slot = slots[slotIndex];
+        uint8_t* buffer = io.GetBuffer(slotIndex);
+
+        bool needDecode = false;
+        for (unsigned ii = 0; ii < info.K; ++ii)
+            needDecode |= slot.Blocks[ii].row >= info.K;
+        if (needDecode && cauchy_256_decode_ws(workspace, info.K, info.M, slot.Blocks, blockBytes))
+        {
+            slot.Failed = true;
+            return;
+        }
+
+        // After decoding every block holds the original of its row
+        const unsigned char* dataPtrs[256];
+        for (unsigned ii = 0; ii < info.K; ++ii)
+            dataPtrs[slot.Blocks[ii].row] = slot.Blocks[ii].data;
+
+        uint8_t* recovery = buffer + (size_t)info.K * blockBytes;
+        bool encoded = false;
+
+        for (unsigned target : targets)
+        {
+            uint8_t* data;
+            if (target < info.K)
+                data = const_cast<uint8_t*>(dataPtrs[target]);
+            else
+            {
+                if (!encoded && cauchy_256_encode_ws(workspace, info.K, info.M, dataPtrs, recovery, blockBytes))
+                {
+                    slot.Failed = true;
+                    return;
+                }
+                encoded = true;
+                data = recovery + (size_t)(target - info.K) * blockBytes;
+            }
+
+            shards[target].Checksums[(size_t)slot.Stripe] = Checksum(data, blockBytes);
+            if (!io.Write(shards[target].Fd, info.DataOffset + slot.Stripe * blockBytes, data, blockBytes,
+                slotIndex, makeUserData(slotIndex, (unsigned)(data - buffer) / blockBytes, true)))
+            {
+                ioError = true;
+                slot.Failed = true;
+                return;
+            }
+            ++slot.Pending;
+        }
+    };
+
+    const uint64_t t0 = siamese::GetTimeUsec();
+    uint64_t nextStripe = 0;
+    vector<tools::AsyncIO::Completion> completions;
+
+    for (;;)
+    {
+        for (unsigned ii = 0; ii < depth && nextStripe < info.StripeCount && !ioError; ++ii)
+            if (!slots[ii].Active)
+                startStripe(ii, nextStripe++);
+
+        if (io.GetInFlight() == 0)
+            break;
+
+        completions.clear();
+        if (!io.Wait(1, completions))
+        {
+            fprintf(stderr, "I/O queue error\n");
+            ioError = true;
+            break;
+        }
+
+        for (const tools::AsyncIO::Completion& completion : completions)
+        {
+            const unsigned slotIndex = (unsigned)(completion.UserData >> 16);
+            const unsigned position = (unsigned)(completion.UserData & 0xffff) >> 1;
+            const bool isWrite = (completion.UserData & 1) != 0;
+            Slot& slot = slots[slotIndex];
+            --slot.Pending;
+
+            if (isWrite)
+            {
+                if (completion.Result != (int)blockBytes)
+                    ioError = true;
+                else
+                    bytesWritten += blockBytes;
+            }
+            else
+            {
+                const Block& block = slot.Blocks[position];
+                if (completion.Result == (int)blockBytes)
+                    bytesRead += blockBytes;
+
+                if (completion.Result == (int)blockBytes &&
+                    Checksum(block.data, blockBytes) == shards[block.row].Checksums[(size_t)slot.Stripe])
+                    ++slot.Good;
+                else
+                {
+                    // Bad or unreadable block: try the next surviving shard
+                    ++badBlocks;
+                    if (!issueRead(slotIndex, position))
+                        slot.Failed = true;
+                }
+
+                if (slot.Pending == 0 && !slot.Failed && slot.Good == info.K)
+                    finishReads(slotIndex);
+            }
+
+            if (slot.Pending == 0)
+                endStripe(slotIndex);
+        }
+    }
+
+    cauchy_256_workspace_free(workspace);
+    const uint64_t t1 = siamese::GetTimeUsec();
+
+    // Headers and checksum tables go last, so an interrupted rebuild
+    // leaves shards that fail the header check instead of bad data
+    AlignedBuffer table(info.DataOffset);
+    for (unsigned target : targets)
+    {
+        RebuildShard& shard = shards[target];
+        ShardInfo targetInfo = info;
+        targetInfo.Index = target;
+        memset(table.Data, 0, (size_t)info.DataOffset);
+        WriteShardHeader(table.Data, targetInfo);
+        for (uint64_t ii = 0; ii < info.StripeCount; ++ii)
+            StoreLE64(table.Data + kHeaderBytes + ii * 8, shard.Checksums[(size_t)ii]);
+
+        if (pwrite(shard.Fd, table.Data, (size_t)info.DataOffset, 0) != (ssize_t)info.DataOffset ||
+            fdatasync(shard.Fd) < 0)
+            ioError = true;
+    }
+
+    ReportSpeed(io.IsAsync() ? "Rebuilt (io_uring)" : "Rebuilt (synchronous)", bytesWritten, t1 - t0);
+    printf("Read %llu bytes, %llu bad blocks replaced, %u stripes in flight\n",
+        (unsigned long long)bytesRead, (unsigned long long)badBlocks, depth);
+
+    if (ioError)
+    {
+        fprintf(stderr, "I/O errors during the rebuild\n");
+        return 1;
+    }
+    if (failedStripes)
+    {
+        fprintf(stderr, "%llu stripes have fewer than k good blocks\n", (unsigned long long)failedStripes);
+        return 1;
+    }
+    return 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Entrypoint
+
+static void Usage(const char* argv0)
+{
+    printf("Usage:\n");
+    printf("  %s encode [options] <file>\n", argv0);
+    printf("      -k <count>     Data shards (default 10)\n");
+    printf("      -m <count>     Recovery shards (default 4), k + m <= 256\n");
+    printf("      -b <bytes>     Block size, a multiple of %u (default 65536)\n", (unsigned)kPageBytes);
+    printf("      -o <path>      Shard prefix, or container file (default <file>)\n");
+    printf("      --container    Write one container file instead of k + m shards\n");
+    printf("  %s decode -o <file> <shards or container...>\n", argv0);
+    printf("  %s repair [-o <prefix>] <shards or container...>\n", argv0);
+    printf("  %s rebuild [options] <shards...>\n", argv0);
+    printf("      -o <prefix>    Name of the missing shards (default: from the shards given)\n");
+    printf("      -q <stripes>   Stripes in flight (default 16)\n");
+    printf("      --direct       Open the shards with O_DIRECT\n");
+    printf("      --sync         Use synchronous reads/writes instead of io_uring\n");
+    printf("  All commands:\n");
+    printf("      -j <threads>   Worker threads (default: one per core)\n");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    if (cauchy_256_init())
+    {
+        fprintf(stderr, "Wrong static library\n");
+        return 1;
+    }
+
+    const string command = argv[1];
+    EncodeSettings settings;
+    RebuildSettings rebuild;
+    vector<const char*> files;
+    bool valid = command == "encode" || command == "decode" || command == "repair" || command == "rebuild";
+
+    for (int ii = 2; ii < argc && valid; ++ii)
+    {
+        const char* arg = argv[ii];
+        const char* value = (ii + 1 < argc) ? argv[ii + 1] : nullptr;
+
+        if (!strcmp(arg, "-k") && value)
+            settings.K = atoi(argv[++ii]);
+        else if (!strcmp(arg, "-m") && value)
+            settings.M = atoi(argv[++ii]);
+        else if (!strcmp(arg, "-b") && value)
+            settings.BlockBytes = atoi(argv[++ii]);
+        else if (!strcmp(arg, "-j") && value)
+            settings.Threads = (unsigned)atoi(argv[++ii]);
+        else if (!strcmp(arg, "-o") && value)
+            settings.Output = argv[++ii];
+        else if (!strcmp(arg, "--container"))
+            settings.Container = true;
+        else if (!strcmp(arg, "-q") && value)
+            rebuild.Depth = (unsigned)atoi(argv[++ii]);
+        else if (!strcmp(arg, "--direct"))
+            rebuild.Direct = true;
+        else if (!strcmp(arg, "--sync"))
+            rebuild.Async = false;
+        else if (arg[0] == '-')
+            valid = false;
+        else
+            files.push_back(arg);
+    }
+
+    if (settings.Threads == 0)
+        settings.Threads = max(1u, std::thread::hardware_concurrency());
+
+    if (!valid || files.empty())
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    if (command == "encode")
+    {
+        if (files.size() != 1 || settings.K <= 0 || settings.M <= 0 || settings.K + settings.M > 256 ||
+            settings.BlockBytes <= 0 || settings.BlockBytes % kPageBytes != 0)
+        {
+            Usage(argv[0]);
+            return 1;
+        }
+        settings.Input = files[0];
+        if (settings.Output.empty())
+            settings.Output = settings.Container ? string(files[0]) + ".lhc" : string(files[0]);
+        return Encode(settings);
+    }
+
+    if (command == "decode")
+    {
+        if (settings.Output.empty())
+        {
+            Usage(argv[0]);
+            return 1;
+        }
+        return Decode(files, settings.Output.c_str(), settings.Threads);
+    }
+
+    if (command == "rebuild")
+    {
+        rebuild.Prefix = settings.Output;
+        return Rebuild(files, rebuild);
+    }
+
+    return Repair(files, settings.Output, settings.Threads);
+}